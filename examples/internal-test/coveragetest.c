@@ -0,0 +1,136 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Compares the SSE2 trapezoid pixel coverage runs with the scalar
+ * coverage function on random trapezoids. The library source is
+ * included so that its static functions can be called.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "glitz_trap.c"
+
+#define ITERATIONS 1000000
+#define TOLERANCE  (1.0f / 1024.0f)
+
+static glitz_float_t
+_random (glitz_float_t min,
+	 glitz_float_t max)
+{
+    return min + (max - min) * ((glitz_float_t) rand () / RAND_MAX);
+}
+
+static void
+_random_edge (glitz_edge_t  *edge,
+	      glitz_float_t x,
+	      glitz_float_t top,
+	      glitz_float_t bottom)
+{
+    glitz_float_t x1 = x, x2 = x;
+
+    /* vertical edges take their own path */
+    if (rand () % 4)
+    {
+	x1 += _random (-4.0f, 4.0f);
+	x2 += _random (-4.0f, 4.0f);
+    }
+
+    EDGE_INIT (edge, x1, top, x2, bottom);
+}
+
+int
+main (int argc, char **argv)
+{
+    glitz_edge_t  left, right;
+    glitz_float_t top, bottom, x, step_x, step_y, diff, max_diff = 0.0f;
+    glitz_float_t pixel_x, pixel_y;
+    glitz_float_t run[PIXEL_RUN], area;
+    unsigned int  seed = 1;
+    int           i, j, n, failed = 0;
+
+    if (argc > 1)
+	seed = atoi (argv[1]);
+
+    srand (seed);
+
+#ifdef USE_SSE2
+    if (!glitz_have_sse2 ())
+#endif
+	printf ("SSE2 not available, testing scalar coverage only\n");
+
+    for (i = 0; i < ITERATIONS; i++)
+    {
+	top = _random (0.0f, 4.0f);
+	bottom = top + _random (0.01f, 4.0f);
+
+	x = _random (0.0f, 8.0f);
+	_random_edge (&left, x, top, bottom);
+	_random_edge (&right, x + _random (0.01f, 8.0f), top, bottom);
+
+	if (rand () % 2)
+	{
+	    step_x = 1.0f;
+	    step_y = 0.0f;
+	}
+	else
+	{
+	    step_x = 0.0f;
+	    step_y = 1.0f;
+	}
+
+	pixel_x = floorf (_random (-2.0f, 16.0f));
+	pixel_y = floorf (_random (-1.0f, 8.0f));
+	n = 1 + rand () % PIXEL_RUN;
+
+	_glitz_pixel_area_run (run, n, pixel_x, pixel_y, step_x, step_y,
+			       top, bottom, &left, &right);
+
+	for (j = 0; j < n; j++)
+	{
+	    area = _glitz_pixel_area (pixel_x + j * step_x,
+				      pixel_y + j * step_y,
+				      top, bottom, &left, &right);
+
+	    diff = fabsf (run[j] - area);
+	    if (diff > max_diff)
+		max_diff = diff;
+
+	    if (!(diff <= TOLERANCE))
+	    {
+		if (failed++ < 10)
+		    printf ("pixel %g,%g top %g bottom %g: "
+			    "run %g, expected %g\n",
+			    pixel_x + j * step_x, pixel_y + j * step_y,
+			    top, bottom, run[j], area);
+	    }
+	}
+    }
+
+    printf ("seed %u, %d runs, max difference %g, %d failed\n",
+	    seed, ITERATIONS, max_diff, failed);
+
+    return (failed)? 1: 0;
+}
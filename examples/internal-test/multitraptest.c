@@ -0,0 +1,230 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Checks that glitz_add_traps_multi and glitz_add_trapezoids_multi add
+ * the same trapezoids and vertices as the sequential functions, also
+ * when the buffer is too small for all chunks. The library source is
+ * included so that the multi array can be inspected.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glitz_trap.c"
+
+#define BUFFER_SIZE (1 << 22)
+
+static glitz_fixed16_16_t
+_random_fixed (int min,
+	       int max)
+{
+    return (min << 16) + rand () % ((max - min) << 16);
+}
+
+static void
+_random_traps (glitz_trap_t      *traps,
+	       glitz_trapezoid_t *trapezoids,
+	       int               n_traps)
+{
+    int i;
+
+    for (i = 0; i < n_traps; i++)
+    {
+	traps[i].top.y = _random_fixed (0, 64);
+	traps[i].bottom.y = traps[i].top.y + _random_fixed (1, 8);
+	traps[i].top.left = _random_fixed (0, 64);
+	traps[i].top.right = traps[i].top.left + _random_fixed (1, 16);
+	traps[i].bottom.left = _random_fixed (0, 64);
+	traps[i].bottom.right = traps[i].bottom.left + _random_fixed (1, 16);
+
+	trapezoids[i].top = traps[i].top.y;
+	trapezoids[i].bottom = traps[i].bottom.y;
+	trapezoids[i].left.p1.x = traps[i].top.left;
+	trapezoids[i].left.p1.y = traps[i].top.y;
+	trapezoids[i].left.p2.x = traps[i].bottom.left;
+	trapezoids[i].left.p2.y = traps[i].bottom.y;
+	trapezoids[i].right.p1.x = traps[i].top.right;
+	trapezoids[i].right.p1.y = traps[i].top.y;
+	trapezoids[i].right.p2.x = traps[i].bottom.right;
+	trapezoids[i].right.p2.y = traps[i].bottom.y;
+    }
+}
+
+static int
+_add (glitz_bool_t        multi,
+      glitz_bool_t        trapezoids,
+      glitz_buffer_t      *buffer,
+      unsigned int        size,
+      glitz_surface_t     *mask,
+      glitz_trap_t        *traps,
+      glitz_trapezoid_t   *traps_fixed,
+      int                 n_traps,
+      glitz_multi_array_t *array,
+      int                 *n_added)
+{
+    if (multi)
+    {
+	glitz_multi_array_reset (array);
+
+	if (trapezoids)
+	    return glitz_add_trapezoids_multi (buffer, 0, size,
+					       GLITZ_DATA_TYPE_FLOAT, mask,
+					       traps_fixed, n_traps, array,
+					       n_added);
+
+	return glitz_add_traps_multi (buffer, 0, size, GLITZ_DATA_TYPE_FLOAT,
+				      mask, traps, n_traps, array, n_added);
+    }
+
+    if (trapezoids)
+	return glitz_add_trapezoids (buffer, 0, size, GLITZ_DATA_TYPE_FLOAT,
+				     mask, traps_fixed, n_traps, n_added);
+
+    return glitz_add_traps (buffer, 0, size, GLITZ_DATA_TYPE_FLOAT,
+			    mask, traps, n_traps, n_added);
+}
+
+/* The arrays must be ascending, disjoint and hold the sequential
+   output in order. */
+static int
+_compare (glitz_multi_array_t *array,
+	  unsigned char       *multi_data,
+	  unsigned char       *data,
+	  int                 count)
+{
+    int i, bytes_per_vertex = 3 * sizeof (glitz_float_t);
+    int offset = 0, end = 0;
+
+    for (i = 0; i < array->n_arrays; i++)
+    {
+	if (array->first[i] < end)
+	    return 1;
+
+	end = array->first[i] + array->count[i];
+	if (end * bytes_per_vertex > BUFFER_SIZE ||
+	    offset + array->count[i] * bytes_per_vertex > count)
+	    return 1;
+
+	if (memcmp (multi_data + array->first[i] * bytes_per_vertex,
+		    data + offset, array->count[i] * bytes_per_vertex))
+	    return 1;
+
+	offset += array->count[i] * bytes_per_vertex;
+    }
+
+    return offset != count;
+}
+
+int
+main (int argc, char **argv)
+{
+    static const int counts[] = { 300, 512, 1000, 4096, 20000 };
+    static const int sizes[] = { 0, 1, 2, 3, 8, 17, 32, 64 };
+    glitz_surface_t     mask;
+    glitz_trap_t        *traps;
+    glitz_trapezoid_t   *trapezoids;
+    glitz_multi_array_t *array;
+    glitz_buffer_t      *buffer, *multi_buffer;
+    unsigned char       *data, *multi_data;
+    unsigned int        seed = 1, size;
+    int                 i, j, t, n_traps, full, count, multi_count;
+    int                 n_added, multi_added, failed = 0, tests = 0;
+
+    if (argc > 1)
+	seed = atoi (argv[1]);
+
+    srand (seed);
+
+    glitz_pixel_set_threads (4, 0);
+
+    memset (&mask, 0, sizeof (mask));
+    mask.texture.box.x2 = 64;
+    mask.texture.texcoord_width_unit = 1.0f / 64.0f;
+
+    traps = malloc (20000 * sizeof (glitz_trap_t));
+    trapezoids = malloc (20000 * sizeof (glitz_trapezoid_t));
+    data = malloc (BUFFER_SIZE);
+    multi_data = malloc (BUFFER_SIZE);
+    array = glitz_multi_array_create (TRAP_CHUNKS_MAX);
+    if (!traps || !trapezoids || !data || !multi_data || !array)
+	return 1;
+
+    buffer = glitz_buffer_create_for_data (data);
+    multi_buffer = glitz_buffer_create_for_data (multi_data);
+    if (!buffer || !multi_buffer)
+	return 1;
+
+    for (i = 0; i < sizeof (counts) / sizeof (counts[0]); i++)
+    {
+	n_traps = counts[i];
+	_random_traps (traps, trapezoids, n_traps);
+
+	for (t = 0; t < 2; t++)
+	{
+	    full = _add (0, t, buffer, BUFFER_SIZE, &mask, traps, trapezoids,
+			 n_traps, array, &n_added);
+
+	    /* a buffer that fits the whole input exactly, where a chunk
+	       with more than its share of vertices overflows into the
+	       chunks after it, then buffers that run out in the first
+	       chunks */
+	    for (j = 0; j < sizeof (sizes) / sizeof (sizes[0]); j++)
+	    {
+		size = (j)? full / sizes[j] + 12: full;
+
+		count = _add (0, t, buffer, size, &mask, traps, trapezoids,
+			      n_traps, array, &n_added);
+		multi_count = _add (1, t, multi_buffer, size, &mask, traps,
+				    trapezoids, n_traps, array,
+				    &multi_added);
+
+		tests++;
+		if (multi_added != n_added || multi_count != count ||
+		    multi_count > size ||
+		    _compare (array, multi_data, data, count))
+		{
+		    if (failed++ < 10)
+			printf ("%s, %d traps, size %u: added %d of %d, "
+				"count %d of %d, %d arrays\n",
+				(t)? "trapezoids": "traps", n_traps, size,
+				multi_added, n_added, multi_count, count,
+				array->n_arrays);
+		}
+	    }
+	}
+    }
+
+    printf ("seed %u, %d cases, %d failed\n", seed, tests, failed);
+
+    glitz_buffer_destroy (multi_buffer);
+    glitz_buffer_destroy (buffer);
+    glitz_multi_array_destroy (array);
+    free (multi_data);
+    free (data);
+    free (trapezoids);
+    free (traps);
+
+    return (failed)? 1: 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+
+/*
+ * Times 10000 random damage boxes added to a region the way surface
+ * damage is tracked, with and without coalescing, and reports how many
+ * boxes are left and how many pixels the result covers beyond the
+ * damage itself.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+
+#include "glitz_region.c"
+
+#define DAMAGES 10000
+
+static double
+_elapsed_ms (struct timeval *start,
+	     struct timeval *stop)
+{
+    return (stop->tv_sec - start->tv_sec) * 1000.0 +
+	(stop->tv_usec - start->tv_usec) / 1000.0;
+}
+
+static int
+_run (glitz_box_t  *damage,
+      int          coalesce,
+      int          *area_return)
+{
+    glitz_region_t region;
+    struct timeval start, stop;
+    glitz_box_t    *box;
+    int            i, area = 0;
+
+    region.data = NULL;
+    region.size = 0;
+    GLITZ_REGION_INIT (&region, GLITZ_NULL_BOX);
+    GLITZ_REGION_SET_COALESCE (&region, coalesce);
+
+    gettimeofday (&start, NULL);
+
+    for (i = 0; i < DAMAGES; i++)
+    {
+	if (glitz_region_union (&region, &damage[i]))
+	{
+	    printf ("out of memory\n");
+	    return 1;
+	}
+    }
+
+    gettimeofday (&stop, NULL);
+
+    box = GLITZ_REGION_RECTS (&region);
+    for (i = 0; i < GLITZ_REGION_NUM_RECTS (&region); i++, box++)
+	area += (box->x2 - box->x1) * (box->y2 - box->y1);
+
+    printf ("coalesce %4d: %8.3f ms, %6d boxes, %8d pixels",
+	    coalesce, _elapsed_ms (&start, &stop),
+	    GLITZ_REGION_NUM_RECTS (&region), area);
+
+    *area_return = area;
+
+    GLITZ_REGION_UNINIT (&region);
+
+    return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+    glitz_box_t  *damage;
+    unsigned int seed = 1;
+    int          size = 2048, max_damage = 32;
+    int          i, status, exact, area;
+
+    if (argc > 1)
+	seed = atoi (argv[1]);
+    if (argc > 2)
+	size = atoi (argv[2]);
+    if (argc > 3)
+	max_damage = atoi (argv[3]);
+
+    if (size < 1 || max_damage < 1)
+    {
+	printf ("usage: %s [SEED] [SIZE] [MAX_DAMAGE]\n", argv[0]);
+	return 1;
+    }
+
+    damage = malloc (DAMAGES * sizeof (glitz_box_t));
+    if (!damage)
+	return 1;
+
+    srand (seed);
+
+    for (i = 0; i < DAMAGES; i++)
+    {
+	damage[i].x1 = rand () % size;
+	damage[i].y1 = rand () % size;
+	damage[i].x2 = damage[i].x1 + 1 + rand () % max_damage;
+	damage[i].y2 = damage[i].y1 + 1 + rand () % max_damage;
+    }
+
+    printf ("seed %u, %d damages of up to %dx%d in %dx%d\n",
+	    seed, DAMAGES, max_damage, max_damage, size, size);
+
+    status = _run (damage, 0, &exact);
+    if (!status)
+    {
+	printf ("\n");
+	status = _run (damage, GLITZ_REGION_COALESCE_DEFAULT, &area);
+	if (!status)
+	    printf (", %d extra\n", area - exact);
+    }
+
+    free (damage);
+
+    return status;
+}
@@ -35,7 +35,7 @@
 #include "rendertest.h"
 #include "glitz_common.h"
 
-static render_status_t
+render_status_t
 _glitz_status (glitz_status_t status)
 {
   switch (status) {
@@ -272,6 +272,8 @@ rendertest_main (void)
     return 1;
 
   status = render_run (&surface, &state.settings);
+  if (!status)
+    status = _glitz_render_run_tests (&surface, &state.settings);
 
   glitz_surface_destroy ((glitz_surface_t *) surface.surface);
 
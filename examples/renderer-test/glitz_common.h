@@ -32,6 +32,9 @@
 #define GLITZ_SURFACE_CLIP(surface) \
   ((surface)->flags & RENDER_GLITZ_SURFACE_FLAG_CLIP_MASK)
 
+render_status_t
+_glitz_status (glitz_status_t status);
+
 render_surface_t *
 _glitz_render_create_similar (render_surface_t *other,
 			      render_format_t format,
@@ -105,3 +108,9 @@ _glitz_create_and_attach_surface_to_drawable (glitz_drawable_t *drawable,
 					      glitz_drawable_t *attach,
 					      int width,
 					      int height);
+
+/* glitz_tests.c */
+
+int
+_glitz_render_run_tests (render_surface_t *surface,
+			 render_settings_t *settings);
@@ -235,6 +235,8 @@ main (int argc, char **argv)
   XSelectInput (display, win, 0);
 
   status = render_run (&surface, &state.settings);
+  if (!status)
+    status = _glitz_render_run_tests (&surface, &state.settings);
 
   glitz_surface_destroy ((glitz_surface_t *) surface.surface);
 
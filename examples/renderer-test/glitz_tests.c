@@ -0,0 +1,542 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include <glitz.h>
+
+#include "rendertest.h"
+#include "glitz_common.h"
+
+/* Tests of glitz features that have no RENDER equivalent. They run
+   after the generic tests and only with glitz backends. */
+
+typedef render_status_t (*glitz_test_func_t) (render_surface_t *surface,
+					      render_settings_t *settings);
+
+typedef struct glitz_test {
+  const char *name;
+  glitz_test_func_t func;
+} glitz_test_t;
+
+static render_status_t
+_glitz_test_status (glitz_surface_t *surface)
+{
+  glitz_status_t status;
+
+  status = glitz_surface_get_status (surface);
+  while (glitz_surface_get_status (surface));
+
+  return _glitz_status (status);
+}
+
+static render_status_t
+_glitz_test_clear (glitz_surface_t *surface,
+		   int width,
+		   int height)
+{
+  glitz_color_t clear = { 0, 0, 0, 0 };
+
+  glitz_set_rectangle (surface, &clear, 0, 0, width, height);
+
+  return _glitz_test_status (surface);
+}
+
+static render_status_t
+_glitz_test_read_a8 (glitz_surface_t *surface,
+		     unsigned char *data,
+		     int width,
+		     int height)
+{
+  glitz_pixel_format_t pf;
+  glitz_buffer_t *buffer;
+
+  pf.fourcc = GLITZ_FOURCC_RGB;
+  pf.masks.bpp = 8;
+  pf.masks.alpha_mask = 0xff;
+  pf.masks.red_mask = 0;
+  pf.masks.green_mask = 0;
+  pf.masks.blue_mask = 0;
+  pf.xoffset = 0;
+  pf.skip_lines = 0;
+  pf.bytes_per_line = width;
+  pf.scanline_order = GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN;
+
+  buffer = glitz_buffer_create_for_data (data);
+  if (!buffer)
+    return RENDER_STATUS_NO_MEMORY;
+
+  glitz_get_pixels (surface, 0, 0, width, height, &pf, buffer);
+
+  glitz_buffer_destroy (buffer);
+
+  return _glitz_test_status (surface);
+}
+
+#define TRAP_TEST_SIZE      64
+#define TRAP_TEST_TRAPS     32
+/* largest difference measured between the edge overlap coverage and
+   the exact area for these trapezoids */
+#define TRAP_TEST_TOLERANCE 12
+
+/* One trapezoid per two pixel rows with fractional top and bottom,
+   slanted edges and widths down to thin slivers. */
+static void
+_glitz_test_trapezoids_init (glitz_trapezoid_t *traps,
+			     int n_traps)
+{
+  static const double widths[] = { 0.125, 0.25, 0.5, 1.0, 3.0, 7.5 };
+  double top, bottom, x, w, dl, dr;
+  int i;
+
+  for (i = 0; i < n_traps; i++) {
+    top = 2 * i + (i % 4) / 8.0;
+    bottom = 2 * i + 2 - ((i / 4) % 4) / 8.0;
+    x = 4 + (i * 11) % 40 + (i % 5) / 16.0;
+    w = widths[i % 6];
+    dl = ((i * 3) % 9 - 4) / 8.0;
+    if (w < 1.0)
+      dr = dl + (i % 3 - 1) / 16.0;
+    else
+      dr = ((i * 5) % 9 - 4) / 8.0;
+
+    traps[i].top = DOUBLE_TO_FIXED (top);
+    traps[i].bottom = DOUBLE_TO_FIXED (bottom);
+    traps[i].left.p1.x = DOUBLE_TO_FIXED (x);
+    traps[i].left.p1.y = traps[i].top;
+    traps[i].left.p2.x = DOUBLE_TO_FIXED (x + dl);
+    traps[i].left.p2.y = traps[i].bottom;
+    traps[i].right.p1.x = DOUBLE_TO_FIXED (x + w);
+    traps[i].right.p1.y = traps[i].top;
+    traps[i].right.p2.x = DOUBLE_TO_FIXED (x + w + dr);
+    traps[i].right.p2.y = traps[i].bottom;
+  }
+}
+
+/* Compares trapezoids drawn by the coverage fragment program with the
+   scanline rasterizer, which computes exact pixel areas on the CPU. */
+static render_status_t
+_glitz_test_trapezoids (render_surface_t *surface,
+			render_settings_t *settings)
+{
+  glitz_trapezoid_t traps[TRAP_TEST_TRAPS];
+  unsigned char cpu_data[TRAP_TEST_SIZE * TRAP_TEST_SIZE];
+  unsigned char gpu_data[TRAP_TEST_SIZE * TRAP_TEST_SIZE];
+  render_surface_t *cpu, *gpu;
+  glitz_drawable_t *drawable;
+  render_status_t status;
+  int i, diff, max_diff = 0;
+
+  /* without fragment programs both draws use the scanline rasterizer */
+  drawable = glitz_surface_get_drawable ((glitz_surface_t *) surface->surface);
+  if (!(glitz_drawable_get_features (drawable) &
+	GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK))
+    return RENDER_STATUS_NOT_SUPPORTED;
+
+  cpu = _glitz_render_create_similar (surface, RENDER_FORMAT_A8,
+				      TRAP_TEST_SIZE, TRAP_TEST_SIZE);
+  if (!cpu)
+    return RENDER_STATUS_NOT_SUPPORTED;
+
+  gpu = _glitz_render_create_similar (surface, RENDER_FORMAT_A8,
+				      TRAP_TEST_SIZE, TRAP_TEST_SIZE);
+  if (!gpu) {
+    _glitz_render_destroy (cpu);
+    return RENDER_STATUS_NOT_SUPPORTED;
+  }
+
+  _glitz_test_trapezoids_init (traps, TRAP_TEST_TRAPS);
+
+  status = _glitz_test_clear ((glitz_surface_t *) cpu->surface,
+			      TRAP_TEST_SIZE, TRAP_TEST_SIZE);
+  if (!status)
+    status = _glitz_test_clear ((glitz_surface_t *) gpu->surface,
+				TRAP_TEST_SIZE, TRAP_TEST_SIZE);
+
+  /* this many trapezoids over a small area take the scanline
+     rasterizer, smaller batches are drawn by the fragment program */
+  if (!status) {
+    glitz_rasterize_trapezoids ((glitz_surface_t *) cpu->surface,
+				traps, TRAP_TEST_TRAPS);
+    status = _glitz_test_status ((glitz_surface_t *) cpu->surface);
+  }
+
+  for (i = 0; (!status) && i < TRAP_TEST_TRAPS; i += 8) {
+    glitz_rasterize_trapezoids ((glitz_surface_t *) gpu->surface,
+				traps + i, 8);
+    status = _glitz_test_status ((glitz_surface_t *) gpu->surface);
+  }
+
+  if (!status)
+    status = _glitz_test_read_a8 ((glitz_surface_t *) cpu->surface,
+				  cpu_data, TRAP_TEST_SIZE, TRAP_TEST_SIZE);
+  if (!status)
+    status = _glitz_test_read_a8 ((glitz_surface_t *) gpu->surface,
+				  gpu_data, TRAP_TEST_SIZE, TRAP_TEST_SIZE);
+
+  if (!status) {
+    for (i = 0; i < TRAP_TEST_SIZE * TRAP_TEST_SIZE; i++) {
+      diff = abs (cpu_data[i] - gpu_data[i]);
+      if (diff > max_diff)
+	max_diff = diff;
+    }
+
+    if (!settings->quiet)
+      printf ("(max difference %d) ", max_diff);
+
+    if (max_diff > TRAP_TEST_TOLERANCE)
+      status = RENDER_STATUS_FAILED;
+  }
+
+  _glitz_render_destroy (gpu);
+  _glitz_render_destroy (cpu);
+
+  return status;
+}
+
+#define READBACK_TEST_SIZE  2048
+#define READBACK_TEST_READS 16
+
+/* Times reads of growing tiles from a large surface that has no
+   drawable attached. Only the requested area should be transferred,
+   so small tiles must not cost as much as reading the whole texture.
+   The read column is what the library asked GL for, per call. */
+static render_status_t
+_glitz_test_readback (render_surface_t *surface,
+		      render_settings_t *settings)
+{
+  static const int tiles[] = { 16, 64, 256, 1024, READBACK_TEST_SIZE };
+  render_surface_t *src;
+  render_status_t status;
+  glitz_drawable_t *drawable;
+  glitz_pixel_format_t pf;
+  glitz_buffer_t *buffer;
+  unsigned char *data;
+  struct timeval tv1, tv2, tv_diff;
+  unsigned long bytes1, bytes2;
+  double ms, read;
+  int i, j, n, tile, x, y;
+
+  src = _glitz_render_create_similar (surface, RENDER_FORMAT_ARGB32,
+				      READBACK_TEST_SIZE,
+				      READBACK_TEST_SIZE);
+  if (!src)
+    return RENDER_STATUS_NOT_SUPPORTED;
+
+  data = malloc (READBACK_TEST_SIZE * READBACK_TEST_SIZE * 4);
+  if (!data) {
+    _glitz_render_destroy (src);
+    return RENDER_STATUS_NO_MEMORY;
+  }
+
+  buffer = glitz_buffer_create_for_data (data);
+  if (!buffer) {
+    free (data);
+    _glitz_render_destroy (src);
+    return RENDER_STATUS_NO_MEMORY;
+  }
+
+  pf.fourcc = GLITZ_FOURCC_RGB;
+  pf.masks.bpp = 32;
+  pf.masks.alpha_mask = 0xff000000;
+  pf.masks.red_mask = 0x00ff0000;
+  pf.masks.green_mask = 0x0000ff00;
+  pf.masks.blue_mask = 0x000000ff;
+  pf.xoffset = 0;
+  pf.skip_lines = 0;
+  pf.scanline_order = GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN;
+
+  status = _glitz_test_clear ((glitz_surface_t *) src->surface,
+			      READBACK_TEST_SIZE, READBACK_TEST_SIZE);
+
+  drawable = glitz_surface_get_drawable ((glitz_surface_t *) src->surface);
+  n = READBACK_TEST_READS * settings->repeat;
+
+  for (i = 0; (!status) && i < sizeof (tiles) / sizeof (tiles[0]); i++) {
+    tile = tiles[i];
+    pf.bytes_per_line = tile * 4;
+
+    glitz_drawable_get_readback_counters (drawable, NULL, &bytes1);
+    gettimeofday (&tv1, NULL);
+
+    for (j = 0; j < n; j++) {
+      x = (j * 197) % (READBACK_TEST_SIZE - tile + 1);
+      y = (j * 89) % (READBACK_TEST_SIZE - tile + 1);
+
+      glitz_get_pixels ((glitz_surface_t *) src->surface,
+			x, y, tile, tile, &pf, buffer);
+    }
+
+    gettimeofday (&tv2, NULL);
+    glitz_drawable_get_readback_counters (drawable, NULL, &bytes2);
+
+    status = _glitz_test_status ((glitz_surface_t *) src->surface);
+
+    timeval_subtract (&tv2, &tv1, &tv_diff);
+    ms = (tv_diff.tv_sec * 1000.0 + tv_diff.tv_usec / 1000.0) / n;
+
+    /* bytes transferred by GL per call, which is the whole texture
+       when the glGetTexImage fallback is used */
+    read = (double) (bytes2 - bytes1) / n;
+
+    if ((!status) && !settings->quiet)
+      printf ("\n  %4dx%-4d %8d bytes, %10.0f read: %8.3f ms, %8.1f MB/s",
+	      tile, tile, tile * tile * 4, read, ms,
+	      (ms > 0.0)? read / (ms * 1000.0): 0.0);
+  }
+
+  if (!settings->quiet)
+    printf ("\n  ");
+
+  glitz_buffer_destroy (buffer);
+  free (data);
+  _glitz_render_destroy (src);
+
+  return status;
+}
+
+#define MULTI_TEST_SIZE    512
+#define MULTI_TEST_ARRAYS  10000
+#define MULTI_TEST_COLUMNS 100
+#define MULTI_TEST_STEP    5
+#define MULTI_TEST_DRAWS   4
+
+/* Adds one small quad per array, each moved to its own grid cell.
+   Arrays added in reverse order do not use ascending vertex ranges,
+   which keeps them on the translate per span path. */
+static void
+_glitz_test_multi_array_init (glitz_multi_array_t *array,
+			      int reverse)
+{
+  int i, n, x, y, last_x = 0, last_y = 0;
+
+  for (n = 0; n < MULTI_TEST_ARRAYS; n++) {
+    i = (reverse)? MULTI_TEST_ARRAYS - 1 - n: n;
+    x = (i % MULTI_TEST_COLUMNS) * MULTI_TEST_STEP;
+    y = (i / MULTI_TEST_COLUMNS) * MULTI_TEST_STEP;
+
+    glitz_multi_array_add (array, i * 4, 2, 4,
+			   (x - last_x) << 16, (y - last_y) << 16);
+
+    last_x = x;
+    last_y = y;
+  }
+}
+
+static render_status_t
+_glitz_test_multi_array_draw (glitz_surface_t *src,
+			      glitz_surface_t *dst,
+			      glitz_multi_array_t *array,
+			      render_settings_t *settings,
+			      double *ms)
+{
+  struct timeval tv1, tv2, tv_diff;
+  render_status_t status;
+  int i, n;
+
+  status = _glitz_test_clear (dst, MULTI_TEST_SIZE, MULTI_TEST_SIZE);
+  if (status)
+    return status;
+
+  glitz_set_multi_array (dst, array, 0, 0);
+
+  n = MULTI_TEST_DRAWS * settings->repeat;
+
+  glitz_drawable_finish (glitz_surface_get_drawable (dst));
+  gettimeofday (&tv1, NULL);
+
+  for (i = 0; i < n; i++)
+    glitz_composite (GLITZ_OPERATOR_SRC, src, NULL, dst,
+		     0, 0, 0, 0, 0, 0, MULTI_TEST_SIZE, MULTI_TEST_SIZE);
+
+  glitz_drawable_finish (glitz_surface_get_drawable (dst));
+  gettimeofday (&tv2, NULL);
+
+  timeval_subtract (&tv2, &tv1, &tv_diff);
+  *ms = (tv_diff.tv_sec * 1000.0 + tv_diff.tv_usec / 1000.0) / n;
+
+  return _glitz_test_status (dst);
+}
+
+/* Draws 10000 small arrays with per vertex offsets and with a
+   translation per span, and checks that both give the same result. */
+static render_status_t
+_glitz_test_multi_array (render_surface_t *surface,
+			 render_settings_t *settings)
+{
+  glitz_geometry_format_t gf;
+  glitz_drawable_t *drawable;
+  glitz_buffer_t *buffer;
+  glitz_multi_array_t *offset_array, *span_array;
+  glitz_color_t color = { 0xffff, 0xffff, 0xffff, 0xffff };
+  render_surface_t *src, *dst;
+  render_status_t status;
+  glitz_float_t *data;
+  unsigned char *offset_data, *span_data;
+  double offset_ms = 0.0, span_ms = 0.0;
+  int i;
+
+  src = _glitz_render_create_similar (surface, RENDER_FORMAT_A8, 1, 1);
+  if (!src)
+    return RENDER_STATUS_NOT_SUPPORTED;
+
+  dst = _glitz_render_create_similar (surface, RENDER_FORMAT_A8,
+				      MULTI_TEST_SIZE, MULTI_TEST_SIZE);
+  if (!dst) {
+    _glitz_render_destroy (src);
+    return RENDER_STATUS_NOT_SUPPORTED;
+  }
+
+  drawable = glitz_surface_get_drawable ((glitz_surface_t *) dst->surface);
+
+  buffer = glitz_vertex_buffer_create (drawable, NULL,
+				       MULTI_TEST_ARRAYS * 8 *
+				       sizeof (glitz_float_t),
+				       GLITZ_BUFFER_HINT_STATIC_DRAW);
+  offset_array = glitz_multi_array_create (MULTI_TEST_ARRAYS);
+  span_array = glitz_multi_array_create (MULTI_TEST_ARRAYS);
+  offset_data = malloc (MULTI_TEST_SIZE * MULTI_TEST_SIZE * 2);
+
+  if (!buffer || !offset_array || !span_array || !offset_data) {
+    status = RENDER_STATUS_NO_MEMORY;
+    goto out;
+  }
+
+  span_data = offset_data + MULTI_TEST_SIZE * MULTI_TEST_SIZE;
+
+  data = glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+  if (!data) {
+    status = RENDER_STATUS_NO_MEMORY;
+    goto out;
+  }
+
+  for (i = 0; i < MULTI_TEST_ARRAYS; i++) {
+    *data++ = 0.0f;
+    *data++ = 0.0f;
+    *data++ = 3.0f;
+    *data++ = 0.0f;
+    *data++ = 3.0f;
+    *data++ = 3.0f;
+    *data++ = 0.0f;
+    *data++ = 3.0f;
+  }
+  glitz_buffer_unmap (buffer);
+
+  _glitz_test_multi_array_init (offset_array, 0);
+  _glitz_test_multi_array_init (span_array, 1);
+
+  glitz_set_rectangle ((glitz_surface_t *) src->surface, &color, 0, 0, 1, 1);
+  glitz_surface_set_fill ((glitz_surface_t *) src->surface,
+			  GLITZ_FILL_REPEAT);
+
+  gf.vertex.primitive = GLITZ_PRIMITIVE_QUADS;
+  gf.vertex.type = GLITZ_DATA_TYPE_FLOAT;
+  gf.vertex.bytes_per_vertex = sizeof (glitz_float_t) * 2;
+  gf.vertex.attributes = 0;
+
+  glitz_set_geometry ((glitz_surface_t *) dst->surface,
+		      GLITZ_GEOMETRY_TYPE_VERTEX, &gf, buffer);
+
+  status = _glitz_test_multi_array_draw ((glitz_surface_t *) src->surface,
+					 (glitz_surface_t *) dst->surface,
+					 offset_array, settings, &offset_ms);
+  if (!status)
+    status = _glitz_test_read_a8 ((glitz_surface_t *) dst->surface,
+				  offset_data,
+				  MULTI_TEST_SIZE, MULTI_TEST_SIZE);
+
+  if (!status)
+    status = _glitz_test_multi_array_draw ((glitz_surface_t *) src->surface,
+					   (glitz_surface_t *) dst->surface,
+					   span_array, settings, &span_ms);
+  if (!status)
+    status = _glitz_test_read_a8 ((glitz_surface_t *) dst->surface,
+				  span_data,
+				  MULTI_TEST_SIZE, MULTI_TEST_SIZE);
+
+  glitz_set_geometry ((glitz_surface_t *) dst->surface,
+		      GLITZ_GEOMETRY_TYPE_NONE, NULL, NULL);
+
+  if (!status) {
+    if (!settings->quiet)
+      printf ("(%d arrays: offsets %.3f ms, translate per span %.3f ms) ",
+	      MULTI_TEST_ARRAYS, offset_ms, span_ms);
+
+    if (memcmp (offset_data, span_data, MULTI_TEST_SIZE * MULTI_TEST_SIZE))
+      status = RENDER_STATUS_FAILED;
+  }
+
+ out:
+  if (offset_data)
+    free (offset_data);
+  if (span_array)
+    glitz_multi_array_destroy (span_array);
+  if (offset_array)
+    glitz_multi_array_destroy (offset_array);
+  if (buffer)
+    glitz_buffer_destroy (buffer);
+
+  _glitz_render_destroy (dst);
+  _glitz_render_destroy (src);
+
+  return status;
+}
+
+static const glitz_test_t _glitz_tests[] = {
+  { "trapezoid coverage", _glitz_test_trapezoids },
+  { "texture readback", _glitz_test_readback },
+  { "multi array offsets", _glitz_test_multi_array },
+  { NULL, NULL }
+};
+
+int
+_glitz_render_run_tests (render_surface_t *surface,
+			 render_settings_t *settings)
+{
+  render_status_t status;
+  int i, failed = 0;
+
+  for (i = 0; _glitz_tests[i].name; i++) {
+    if (!settings->quiet) {
+      printf ("%s: ", _glitz_tests[i].name);
+      fflush (stdout);
+    }
+
+    status = _glitz_tests[i].func (surface, settings);
+    if (status != RENDER_STATUS_SUCCESS &&
+	status != RENDER_STATUS_NOT_SUPPORTED)
+      failed++;
+
+    if (!settings->quiet)
+      printf ("[%s]\n", _render_status_string (status));
+  }
+
+  return (failed)? RENDER_STATUS_FAILED: RENDER_STATUS_SUCCESS;
+}
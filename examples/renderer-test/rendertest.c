@@ -72,7 +72,7 @@ static char _no_memory[] = {
 };
 
 
-static char *
+char *
 _render_status_string (render_status_t status)
 {
   switch (status) {
@@ -335,7 +335,7 @@ _print_comp_info (render_surface_t *src,
   }
 }
 
-static void
+void
 timeval_subtract (const struct timeval *x,
 		  const struct timeval *y,
 		  struct timeval *diff)
@@ -225,6 +225,16 @@ typedef struct render_settings_t {
 int
 render_run (render_surface_t *surface, render_settings_t *settings);
 
+char *
+_render_status_string (render_status_t status);
+
+struct timeval;
+
+void
+timeval_subtract (const struct timeval *x,
+		  const struct timeval *y,
+		  struct timeval *diff);
+
 
 /* png.c */
 
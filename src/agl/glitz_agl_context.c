@@ -312,7 +312,8 @@ glitz_agl_context_get (glitz_agl_thread_info_t *thread_info,
     if (!thread_info->root_context)
 	thread_info->root_context = context->context;
 
-    context->backend.gl = &_glitz_agl_gl_proc_address;
+    context->gl = _glitz_agl_gl_proc_address;
+    context->backend.gl = &context->gl;
 
     context->backend.create_pbuffer = glitz_agl_create_pbuffer;
     context->backend.destroy = glitz_agl_destroy;
@@ -393,7 +394,8 @@ _glitz_agl_context_initialize (glitz_agl_thread_info_t *thread_info,
 
     _glitz_agl_release_bundle (bundle);
 
-    glitz_initiate_state (&_glitz_agl_gl_proc_address);
+    glitz_initiate_state (context->backend.gl,
+			  &thread_info->state_generation);
 
     context->initialized = 1;
 }
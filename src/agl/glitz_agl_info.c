@@ -43,6 +43,7 @@ glitz_gl_proc_address_list_t _glitz_agl_gl_proc_address = {
     (glitz_gl_vertex_pointer_t) glVertexPointer,
     (glitz_gl_tex_coord_pointer_t) glTexCoordPointer,
     (glitz_gl_draw_arrays_t) glDrawArrays,
+    (glitz_gl_draw_elements_t) glDrawElements,
     (glitz_gl_tex_env_f_t) glTexEnvf,
     (glitz_gl_tex_env_fv_t) glTexEnvfv,
     (glitz_gl_tex_gen_i_t) glTexGeni,
@@ -99,12 +100,31 @@ glitz_gl_proc_address_list_t _glitz_agl_gl_proc_address = {
     (glitz_gl_active_texture_t) 0,
     (glitz_gl_client_active_texture_t) 0,
     (glitz_gl_multi_draw_arrays_t) 0,
+    (glitz_gl_multi_draw_elements_t) 0,
     (glitz_gl_gen_programs_t) 0,
     (glitz_gl_delete_programs_t) 0,
     (glitz_gl_program_string_t) 0,
     (glitz_gl_bind_program_t) 0,
     (glitz_gl_program_local_param_4fv_t) 0,
+    (glitz_gl_program_env_param_4fv_t) 0,
     (glitz_gl_get_program_iv_t) 0,
+    (glitz_gl_vertex_attrib_pointer_t) 0,
+    (glitz_gl_enable_vertex_attrib_array_t) 0,
+    (glitz_gl_disable_vertex_attrib_array_t) 0,
+    (glitz_gl_create_shader_t) 0,
+    (glitz_gl_shader_source_t) 0,
+    (glitz_gl_compile_shader_t) 0,
+    (glitz_gl_get_shader_iv_t) 0,
+    (glitz_gl_delete_shader_t) 0,
+    (glitz_gl_create_program_t) 0,
+    (glitz_gl_attach_shader_t) 0,
+    (glitz_gl_link_program_t) 0,
+    (glitz_gl_get_program_object_iv_t) 0,
+    (glitz_gl_use_program_t) 0,
+    (glitz_gl_delete_program_t) 0,
+    (glitz_gl_get_uniform_location_t) 0,
+    (glitz_gl_uniform_1i_t) 0,
+    (glitz_gl_uniform_4fv_t) 0,
     (glitz_gl_gen_buffers_t) 0,
     (glitz_gl_delete_buffers_t) 0,
     (glitz_gl_bind_buffer_t) 0,
@@ -123,7 +143,17 @@ glitz_gl_proc_address_list_t _glitz_agl_gl_proc_address = {
     (glitz_gl_delete_renderbuffers_t) 0,
     (glitz_gl_bind_renderbuffer_t) 0,
     (glitz_gl_renderbuffer_storage_t) 0,
-    (glitz_gl_get_renderbuffer_parameter_iv_t) 0
+    (glitz_gl_get_renderbuffer_parameter_iv_t) 0,
+    (glitz_gl_renderbuffer_storage_multisample_t) 0,
+    (glitz_gl_blit_framebuffer_t) 0,
+    (glitz_gl_fence_sync_t) 0,
+    (glitz_gl_delete_sync_t) 0,
+    (glitz_gl_client_wait_sync_t) 0,
+    (glitz_gl_gen_fences_t) 0,
+    (glitz_gl_delete_fences_t) 0,
+    (glitz_gl_set_fence_t) 0,
+    (glitz_gl_test_fence_t) 0,
+    (glitz_gl_finish_fence_t) 0
 };
 
 static void
@@ -236,6 +266,8 @@ glitz_agl_thread_info_init (glitz_agl_thread_info_t *thread_info)
 
     thread_info->root_context = NULL;
 
+    thread_info->state_generation = 0;
+
     thread_info->agl_feature_mask = 0;
 
     thread_info->cctx = NULL;
@@ -57,6 +57,7 @@ typedef struct _glitz_agl_context_t {
     AGLPixelFormat    pixel_format;
     glitz_bool_t      pbuffer;
     glitz_backend_t   backend;
+    glitz_gl_proc_address_list_t gl;
     glitz_bool_t      initialized;
 } glitz_agl_context_t;
 
@@ -70,6 +71,7 @@ typedef struct _glitz_agl_thread_info_t {
     glitz_agl_context_info_t    context_stack[GLITZ_CONTEXT_STACK_SIZE];
     int                         context_stack_size;
     AGLContext                  root_context;
+    unsigned long               state_generation;
     unsigned long               agl_feature_mask;
     glitz_context_t             *cctx;
     glitz_program_map_t         program_map;
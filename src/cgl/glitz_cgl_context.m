@@ -291,7 +291,8 @@ glitz_cgl_context_get (glitz_cgl_thread_info_t *thread_info,
     if (!thread_info->root_context)
 	thread_info->root_context = context->context;
 
-    context->backend.gl = &_glitz_cgl_gl_proc_address;
+    context->gl = _glitz_cgl_gl_proc_address;
+    context->backend.gl = &context->gl;
 
     context->backend.create_pbuffer = glitz_cgl_create_pbuffer;
     context->backend.destroy = glitz_cgl_destroy;
@@ -373,7 +374,8 @@ _glitz_cgl_context_initialize (glitz_cgl_thread_info_t *thread_info,
 
     _glitz_cgl_release_bundle (bundle);
 
-    glitz_initiate_state (&_glitz_cgl_gl_proc_address);
+    glitz_initiate_state (context->backend.gl,
+			  &thread_info->state_generation);
 
     context->initialized = 1;
 }
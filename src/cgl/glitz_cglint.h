@@ -58,6 +58,7 @@ typedef struct _glitz_cgl_context_t {
     NSOpenGLPixelFormat *pixel_format;
     glitz_bool_t        pbuffer;
     glitz_backend_t     backend;
+    glitz_gl_proc_address_list_t gl;
     glitz_bool_t        initialized;
 } glitz_cgl_context_t;
 
@@ -71,6 +72,7 @@ typedef struct _glitz_cgl_thread_info_t {
     glitz_cgl_context_info_t    context_stack[GLITZ_CONTEXT_STACK_SIZE];
     int                         context_stack_size;
     NSOpenGLContext             *root_context;
+    unsigned long               state_generation;
     unsigned long               cgl_feature_mask;
     glitz_context_t             *cctx;
     glitz_program_map_t         program_map;
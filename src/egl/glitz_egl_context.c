@@ -191,7 +191,8 @@ glitz_egl_context_get (glitz_egl_screen_info_t *screen_info,
     if (!screen_info->egl_root_context)
 	screen_info->egl_root_context = context->egl_context;
 
-    context->backend.gl = &_glitz_egl_gl_proc_address;
+    context->gl = _glitz_egl_gl_proc_address;
+    context->backend.gl = &context->gl;
 
     context->backend.create_pbuffer = glitz_egl_create_pbuffer;
     context->backend.destroy = glitz_egl_destroy;
@@ -268,7 +269,8 @@ _glitz_egl_context_initialize (glitz_egl_screen_info_t *screen_info,
 			glitz_egl_get_proc_address,
 			(void *) screen_info);
 
-    glitz_initiate_state (&_glitz_egl_gl_proc_address);
+    glitz_initiate_state (context->backend.gl,
+			  &screen_info->state_generation);
 
     version = (const char *)
 	context->backend.gl->get_string (GLITZ_GL_VERSION);
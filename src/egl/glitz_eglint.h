@@ -67,6 +67,7 @@ typedef struct _glitz_egl_context_t {
     glitz_format_id_t id;
     EGLConfig         egl_config;
     glitz_backend_t   backend;
+    glitz_gl_proc_address_list_t gl;
     glitz_bool_t      initialized;
 } glitz_egl_context_t;
 
@@ -81,6 +82,7 @@ struct _glitz_egl_screen_info_t {
     glitz_egl_context_info_t    context_stack[GLITZ_CONTEXT_STACK_SIZE];
     int                         context_stack_size;
     EGLContext                  egl_root_context;
+    unsigned long               state_generation;
     unsigned long               egl_feature_mask;
     glitz_gl_float_t            egl_version;
     glitz_program_map_t         program_map;
@@ -41,6 +41,349 @@ typedef struct _glitz_texture_unit_t {
   glitz_bool_t    transform;
 } glitz_texture_unit_t;
 
+#define BATCH_FLOATS_PER_VERTEX 6
+
+static void
+_glitz_batch_release (glitz_composite_batch_t *batch,
+		      glitz_surface_t         *dst)
+{
+    if (batch->src)
+    {
+	if (batch->src->batch_owner == dst)
+	    batch->src->batch_owner = NULL;
+
+	glitz_surface_destroy (batch->src);
+	batch->src = NULL;
+    }
+
+    if (batch->mask)
+    {
+	if (batch->mask->batch_owner == dst)
+	    batch->mask->batch_owner = NULL;
+
+	glitz_surface_destroy (batch->mask);
+	batch->mask = NULL;
+    }
+
+    batch->n_rects = 0;
+}
+
+#define BATCH_TEXCOORDS(v, texture, x, y, x_off, y_off)                \
+    if (texture)                                                        \
+    {                                                                   \
+	(v)[0] = ((x) - (x_off) + (texture)->box.x1) *                  \
+	    (texture)->texcoord_width_unit;                             \
+	(v)[1] = ((y_off) + (texture)->box.y2 - (y)) *                  \
+	    (texture)->texcoord_height_unit;                            \
+    }                                                                   \
+    else                                                                \
+	(v)[0] = (v)[1] = 0.0f
+
+#define BATCH_VERTEX(v, x, y, rect, stexture, mtexture)                 \
+    (v)[0] = (glitz_float_t) (x);                                       \
+    (v)[1] = (glitz_float_t) (y);                                       \
+    BATCH_TEXCOORDS ((v) + 2, mtexture, x, y,                           \
+		     (rect)->x_mask, (rect)->y_mask);                   \
+    BATCH_TEXCOORDS ((v) + 4, stexture, x, y,                           \
+		     (rect)->x_src, (rect)->y_src);                     \
+    (v) += BATCH_FLOATS_PER_VERTEX
+
+/* Draws all rectangles of a batch with a single glitz_composite call.
+   Texture coordinates are computed here, using the same mapping as the
+   eye-linear planes glitz_texture_set_tex_gen would have set up, and
+   passed to glitz_composite as a temporary vertex geometry. */
+static void
+_glitz_batch_flush (glitz_surface_t *dst)
+{
+    glitz_composite_batch_t *batch = dst->batch;
+    glitz_composite_op_t    comp_op;
+    glitz_texture_t         *stexture = NULL, *mtexture = NULL;
+    glitz_geometry_t        geometry;
+    glitz_batch_rect_t      *rect;
+    glitz_float_t           *v;
+    int                     i, n_vertices;
+
+    if (!batch || !batch->n_rects)
+	return;
+
+    glitz_composite_op_init (&comp_op, batch->op, batch->src, batch->mask,
+			     dst);
+
+    if (comp_op.src)
+	stexture = glitz_surface_get_texture (comp_op.src, 0);
+
+    if (comp_op.mask)
+	mtexture = glitz_surface_get_texture (comp_op.mask, 0);
+
+    n_vertices = batch->n_rects * 4;
+    if (n_vertices > batch->n_vertices)
+    {
+	v = realloc (batch->vertices, n_vertices * BATCH_FLOATS_PER_VERTEX *
+		     sizeof (glitz_float_t));
+	if (!v)
+	{
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	    _glitz_batch_release (batch, dst);
+	    return;
+	}
+
+	batch->vertices = v;
+	batch->n_vertices = n_vertices;
+    }
+
+    v = batch->vertices;
+    for (i = 0, rect = batch->rects; i < batch->n_rects; i++, rect++)
+    {
+	BATCH_VERTEX (v, rect->box.x1, rect->box.y1, rect, stexture, mtexture);
+	BATCH_VERTEX (v, rect->box.x2, rect->box.y1, rect, stexture, mtexture);
+	BATCH_VERTEX (v, rect->box.x2, rect->box.y2, rect, stexture, mtexture);
+	BATCH_VERTEX (v, rect->box.x1, rect->box.y2, rect, stexture, mtexture);
+    }
+
+    geometry = dst->geometry;
+
+    dst->geometry.buffer = glitz_buffer_create_for_data (batch->vertices);
+    if (!dst->geometry.buffer)
+    {
+	dst->geometry = geometry;
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	_glitz_batch_release (batch, dst);
+	return;
+    }
+
+    dst->geometry.type       = GLITZ_GEOMETRY_TYPE_VERTEX;
+    dst->geometry.stride     = BATCH_FLOATS_PER_VERTEX *
+	sizeof (glitz_float_t);
+    dst->geometry.first      = 0;
+    dst->geometry.count      = n_vertices;
+    dst->geometry.off.v[0]   = dst->geometry.off.v[1] = 0.0f;
+    dst->geometry.array      = NULL;
+    dst->geometry.indices    = NULL;
+    dst->geometry.attributes = GLITZ_VERTEX_ATTRIBUTE_SRC_COORD_MASK |
+	GLITZ_VERTEX_ATTRIBUTE_MASK_COORD_MASK;
+
+    dst->geometry.u.v.prim        = GLITZ_GL_QUADS;
+    dst->geometry.u.v.type        = GLITZ_GL_FLOAT;
+    dst->geometry.u.v.mask.type   = GLITZ_GL_FLOAT;
+    dst->geometry.u.v.mask.size   = 2;
+    dst->geometry.u.v.mask.offset = 2 * sizeof (glitz_float_t);
+    dst->geometry.u.v.src.type    = GLITZ_GL_FLOAT;
+    dst->geometry.u.v.src.size    = 2;
+    dst->geometry.u.v.src.offset  = 4 * sizeof (glitz_float_t);
+
+    /* keep glitz_composite from recording into the batch */
+    dst->batch = NULL;
+
+    glitz_composite (batch->op, batch->src, batch->mask, dst,
+		     0, 0, 0, 0,
+		     batch->bounds.x1, batch->bounds.y1,
+		     batch->bounds.x2 - batch->bounds.x1,
+		     batch->bounds.y2 - batch->bounds.y1);
+
+    dst->batch = batch;
+
+    glitz_buffer_destroy (dst->geometry.buffer);
+    dst->geometry = geometry;
+
+    _glitz_batch_release (batch, dst);
+}
+
+void
+glitz_surface_flush_batch (glitz_surface_t *surface)
+{
+    if (surface->batch && surface->batch->n_rects)
+	_glitz_batch_flush (surface);
+
+    if (surface->batch_owner)
+	_glitz_batch_flush (surface->batch_owner);
+}
+
+static glitz_bool_t
+_glitz_batch_can_record (glitz_surface_t *surface,
+			 glitz_surface_t *dst)
+{
+    if (!surface)
+	return 1;
+
+    if (SURFACE_TRANSFORM (surface) || SURFACE_EYE_COORDS (surface))
+	return 0;
+
+    /* a surface can only be tracked by one batch at a time */
+    if (surface->batch_owner && surface->batch_owner != dst)
+	_glitz_batch_flush (surface->batch_owner);
+
+    /* draws pending in the surface's own batch must be read */
+    if (surface->batch && surface->batch->n_rects)
+	_glitz_batch_flush (surface);
+
+    /* reading from the destination requires the batch to be drawn */
+    if (surface == dst)
+	return 0;
+
+    return 1;
+}
+
+static glitz_bool_t
+_glitz_batch_record (glitz_operator_t op,
+		     glitz_surface_t  *src,
+		     glitz_surface_t  *mask,
+		     glitz_surface_t  *dst,
+		     int              x_src,
+		     int              y_src,
+		     int              x_mask,
+		     int              y_mask,
+		     int              x_dst,
+		     int              y_dst,
+		     glitz_box_t      *box)
+{
+    glitz_composite_batch_t *batch = dst->batch;
+    glitz_batch_rect_t      *rect;
+
+    if (dst->geometry.type != GLITZ_GEOMETRY_TYPE_NONE)
+	return 0;
+
+    /* another batch reading from dst must be drawn before dst changes */
+    if (dst->batch_owner && dst->batch_owner != dst)
+	_glitz_batch_flush (dst->batch_owner);
+
+    if (batch->n_rects &&
+	(batch->op != op || batch->src != src || batch->mask != mask))
+	_glitz_batch_flush (dst);
+
+    if (!batch->n_rects)
+    {
+	glitz_composite_op_t comp_op;
+
+	if (!_glitz_batch_can_record (src, dst) ||
+	    !_glitz_batch_can_record (mask, dst))
+	    return 0;
+
+	glitz_composite_op_init (&comp_op, op, src, mask, dst);
+	if (comp_op.type == GLITZ_COMBINE_TYPE_NA || comp_op.per_component)
+	    return 0;
+
+	glitz_surface_reference (src);
+	glitz_surface_reference (mask);
+
+	batch->op   = op;
+	batch->src  = src;
+	batch->mask = mask;
+
+	if (src)
+	    src->batch_owner = dst;
+
+	if (mask)
+	    mask->batch_owner = dst;
+
+	batch->bounds = *box;
+    }
+
+    if (batch->n_rects == batch->size)
+    {
+	int size = batch->size ? batch->size * 2 : 64;
+
+	rect = realloc (batch->rects, size * sizeof (glitz_batch_rect_t));
+	if (!rect)
+	{
+	    _glitz_batch_flush (dst);
+	    return 0;
+	}
+
+	batch->rects = rect;
+	batch->size  = size;
+    }
+
+    rect = &batch->rects[batch->n_rects++];
+
+    rect->box    = *box;
+    rect->x_src  = x_dst - x_src;
+    rect->y_src  = y_dst - y_src;
+    rect->x_mask = x_dst - x_mask;
+    rect->y_mask = y_dst - y_mask;
+
+    batch->bounds.x1 = MIN (batch->bounds.x1, box->x1);
+    batch->bounds.y1 = MIN (batch->bounds.y1, box->y1);
+    batch->bounds.x2 = MAX (batch->bounds.x2, box->x2);
+    batch->bounds.y2 = MAX (batch->bounds.y2, box->y2);
+
+    return 1;
+}
+
+/* Consecutive glitz_composite calls with the same operator, source and
+   mask are collected and drawn with a single vertex array once the state
+   changes, once any of the involved surfaces is used in some other way,
+   or when glitz_surface_end_batch is called. */
+void
+glitz_surface_begin_batch (glitz_surface_t *surface)
+{
+    if (!surface->batch)
+    {
+	surface->batch = calloc (1, sizeof (glitz_composite_batch_t));
+	if (!surface->batch)
+	{
+	    glitz_surface_status_add (surface, GLITZ_STATUS_NO_MEMORY_MASK);
+	    return;
+	}
+    }
+
+    surface->batch->level++;
+}
+slim_hidden_def(glitz_surface_begin_batch);
+
+void
+glitz_surface_end_batch (glitz_surface_t *surface)
+{
+    glitz_composite_batch_t *batch = surface->batch;
+
+    if (!batch)
+	return;
+
+    _glitz_batch_flush (surface);
+
+    if (--batch->level)
+	return;
+
+    surface->batch = NULL;
+
+    if (batch->rects)
+	free (batch->rects);
+
+    if (batch->vertices)
+	free (batch->vertices);
+
+    free (batch);
+}
+slim_hidden_def(glitz_surface_end_batch);
+
+#define VP_TEX_GEN(flags, unit)                                 \
+    (((((flags) & GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK)? 1: 0) |  \
+      (((flags) & GLITZ_SURFACE_FLAG_GEN_T_COORDS_MASK)? 2: 0)) << \
+     (2 * (unit)))
+
+#define TEXTURE_MATRIX(surface)                               \
+    (((surface)->transform)?                                  \
+     (SURFACE_EYE_COORDS (surface)?                           \
+      (surface)->transform->m: (surface)->transform->t): NULL)
+
+static unsigned long
+_glitz_coord_flags (glitz_surface_t        *surface,
+		    glitz_int_coordinate_t *coord,
+		    unsigned long          attribute)
+{
+    unsigned long flags;
+
+    flags = surface->flags | GLITZ_SURFACE_FLAGS_GEN_COORDS_MASK;
+    if (attribute)
+    {
+	flags &= ~GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK;
+
+	if (coord->size == 2)
+	    flags &= ~GLITZ_SURFACE_FLAG_GEN_T_COORDS_MASK;
+    }
+
+    return flags;
+}
+
 void
 glitz_composite (glitz_operator_t op,
 		 glitz_surface_t *src,
@@ -62,7 +405,9 @@ glitz_composite (glitz_operator_t op,
     glitz_texture_parameters_t param;
     glitz_box_t                bounds;
     glitz_bool_t               no_border_clamp;
-    unsigned long              flags;
+    unsigned long              mflags = 0, sflags = 0;
+    glitz_gl_uint_t            vp = 0;
+    int                        unit, tex_gen = 0;
 
     GLITZ_GL_SURFACE (dst);
 
@@ -82,6 +427,16 @@ glitz_composite (glitz_operator_t op,
     if (dst->geometry.buffer && (!dst->geometry.count))
 	return;
 
+    if (dst->batch && _glitz_batch_record (op, src, mask, dst,
+					   x_src, y_src, x_mask, y_mask,
+					   x_dst, y_dst, &bounds))
+	return;
+
+    glitz_surface_flush_batch (dst);
+    glitz_surface_flush_batch (src);
+    if (mask)
+	glitz_surface_flush_batch (mask);
+
     glitz_composite_op_init (&comp_op, op, src, mask, dst);
     if (comp_op.type == GLITZ_COMBINE_TYPE_NA)
     {
@@ -121,6 +476,35 @@ glitz_composite (glitz_operator_t op,
     no_border_clamp = !(dst->drawable->backend->feature_mask &
 			GLITZ_FEATURE_TEXTURE_BORDER_CLAMP_MASK);
 
+    if (mtexture)
+	mflags = _glitz_coord_flags (mask, &dst->geometry.u.v.mask,
+				     dst->geometry.attributes &
+				     GLITZ_VERTEX_ATTRIBUTE_MASK_COORD_MASK);
+
+    if (stexture)
+	sflags = _glitz_coord_flags (src, &dst->geometry.u.v.src,
+				     dst->geometry.attributes &
+				     GLITZ_VERTEX_ATTRIBUTE_SRC_COORD_MASK);
+
+    /* the vertex program replaces texgen, the texture matrices and the
+       modelview translations; bitmaps still need the raster position */
+    if ((dst->drawable->backend->feature_mask &
+	 GLITZ_FEATURE_VERTEX_PROGRAM_MASK) &&
+	dst->geometry.type != GLITZ_GEOMETRY_TYPE_BITMAP)
+    {
+	unit = 0;
+	if (mtexture)
+	    tex_gen |= VP_TEX_GEN (mflags, unit++);
+
+	if (stexture)
+	{
+	    while (unit < comp_op.combine->texture_units)
+		tex_gen |= VP_TEX_GEN (sflags, unit++);
+	}
+
+	vp = glitz_get_vertex_program (dst, tex_gen);
+    }
+
     if (mtexture)
     {
 	textures[0].texture = mtexture;
@@ -130,30 +514,33 @@ glitz_composite (glitz_operator_t op,
 
 	glitz_texture_bind (gl, mtexture);
 
-	flags = mask->flags | GLITZ_SURFACE_FLAGS_GEN_COORDS_MASK;
-	if (dst->geometry.attributes & GLITZ_VERTEX_ATTRIBUTE_MASK_COORD_MASK)
-	{
-	    flags &= ~GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK;
-
-	    if (dst->geometry.u.v.mask.size == 2)
-		flags &= ~GLITZ_SURFACE_FLAG_GEN_T_COORDS_MASK;
-	}
-
-	glitz_texture_set_tex_gen (gl,
-				   mtexture,
-				   &dst->geometry,
-				   x_dst - x_mask,
-				   y_dst - y_mask,
-				   flags,
-				   &dst->geometry.u.v.mask);
+	if (vp)
+	    glitz_texture_set_tex_gen_env (gl,
+					   mtexture,
+					   &dst->geometry,
+					   x_dst - x_mask,
+					   y_dst - y_mask,
+					   mflags,
+					   &dst->geometry.u.v.mask,
+					   0, TEXTURE_MATRIX (mask));
+	else
+	    glitz_texture_set_tex_gen (gl,
+				       mtexture,
+				       &dst->geometry,
+				       x_dst - x_mask,
+				       y_dst - y_mask,
+				       mflags,
+				       &dst->geometry.u.v.mask);
 
 	if (mask->transform)
 	{
-	    textures[0].transform = 1;
-	    gl->matrix_mode (GLITZ_GL_TEXTURE);
-	    gl->load_matrix_f (SURFACE_EYE_COORDS (mask)?
-			       mask->transform->m: mask->transform->t);
-	    gl->matrix_mode (GLITZ_GL_MODELVIEW);
+	    if (!vp)
+	    {
+		textures[0].transform = 1;
+		glitz_state_matrix_mode (gl, GLITZ_GL_TEXTURE);
+		gl->load_matrix_f (TEXTURE_MATRIX (mask));
+		glitz_state_matrix_mode (gl, GLITZ_GL_MODELVIEW);
+	    }
 
 	    if (SURFACE_LINEAR_TRANSFORM_FILTER (mask))
 		param.filter[0] = GLITZ_GL_LINEAR;
@@ -202,36 +589,41 @@ glitz_composite (glitz_operator_t op,
 	    textures[texture_nr].transform = 0;
 	    if (texture_nr > 0)
 	    {
-		gl->active_texture (textures[texture_nr].unit);
+		glitz_state_active_texture (gl, textures[texture_nr].unit);
 		gl->client_active_texture (textures[texture_nr].unit);
 	    }
 	    glitz_texture_bind (gl, stexture);
-	}
 
-	flags = src->flags | GLITZ_SURFACE_FLAGS_GEN_COORDS_MASK;
-	if (dst->geometry.attributes & GLITZ_VERTEX_ATTRIBUTE_SRC_COORD_MASK)
-	{
-	    flags &= ~GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK;
-
-	    if (dst->geometry.u.v.src.size == 2)
-		flags &= ~GLITZ_SURFACE_FLAG_GEN_T_COORDS_MASK;
+	    if (vp)
+		glitz_texture_set_tex_gen_env (gl,
+					       stexture,
+					       &dst->geometry,
+					       x_dst - x_src,
+					       y_dst - y_src,
+					       sflags,
+					       &dst->geometry.u.v.src,
+					       texture_nr,
+					       TEXTURE_MATRIX (src));
 	}
 
-	glitz_texture_set_tex_gen (gl,
-				   stexture,
-				   &dst->geometry,
-				   x_dst - x_src,
-				   y_dst - y_src,
-				   flags,
-				   &dst->geometry.u.v.src);
+	if (!vp)
+	    glitz_texture_set_tex_gen (gl,
+				       stexture,
+				       &dst->geometry,
+				       x_dst - x_src,
+				       y_dst - y_src,
+				       sflags,
+				       &dst->geometry.u.v.src);
 
 	if (src->transform)
 	{
-	    textures[texture_nr].transform = 1;
-	    gl->matrix_mode (GLITZ_GL_TEXTURE);
-	    gl->load_matrix_f (SURFACE_EYE_COORDS (src)?
-			       src->transform->m: src->transform->t);
-	    gl->matrix_mode (GLITZ_GL_MODELVIEW);
+	    if (!vp)
+	    {
+		textures[texture_nr].transform = 1;
+		glitz_state_matrix_mode (gl, GLITZ_GL_TEXTURE);
+		gl->load_matrix_f (TEXTURE_MATRIX (src));
+		glitz_state_matrix_mode (gl, GLITZ_GL_MODELVIEW);
+	    }
 
 	    if (SURFACE_LINEAR_TRANSFORM_FILTER (src))
 		param.filter[0] = GLITZ_GL_LINEAR;
@@ -269,6 +661,20 @@ glitz_composite (glitz_operator_t op,
 	glitz_texture_ensure_parameters (gl, stexture, &param);
     }
 
+    if (vp)
+    {
+	dst->geometry.tex_gen = tex_gen;
+	dst->geometry.vp_off.v[0] = dst->geometry.vp_off.v[1] = 0.0f;
+	dst->geometry.vp_off.v[2] = dst->geometry.vp_off.v[3] = 0.0f;
+
+	gl->program_env_param_4fv (GLITZ_GL_VERTEX_PROGRAM,
+				   GLITZ_VP_ENV_OFFSET,
+				   dst->geometry.vp_off.v);
+
+	glitz_state_enable (gl, GLITZ_GL_VERTEX_PROGRAM);
+	glitz_state_bind_program (gl, GLITZ_GL_VERTEX_PROGRAM, vp);
+    }
+
     glitz_geometry_enable (gl, dst, &bounds);
 
     if (comp_op.per_component)
@@ -296,10 +702,8 @@ glitz_composite (glitz_operator_t op,
 	    comp_op.alpha_mask.blue  = alpha_map[component][2] * alpha.blue;
 	    comp_op.alpha_mask.alpha = alpha_map[component][3] * alpha.alpha;
 
-	    gl->color_mask ((cmask & 1)     ,
-			    (cmask & 2) >> 1,
-			    (cmask & 4) >> 2,
-			    (cmask & 8) >> 3);
+	    glitz_state_color_mask (gl, (cmask & 1), (cmask & 2) >> 1,
+				    (cmask & 4) >> 2, (cmask & 8) >> 3);
 
 	    glitz_composite_enable (&comp_op);
 	    glitz_geometry_draw_arrays (gl, dst,
@@ -308,7 +712,7 @@ glitz_composite (glitz_operator_t op,
 	    cmask <<= 1;
 	}
 
-	gl->color_mask (1, 1, 1, 1);
+	glitz_state_color_mask (gl, 1, 1, 1, 1);
     }
     else
     {
@@ -321,20 +725,27 @@ glitz_composite (glitz_operator_t op,
     glitz_composite_disable (&comp_op);
     glitz_geometry_disable (dst);
 
+    if (vp)
+    {
+	glitz_state_bind_program (gl, GLITZ_GL_VERTEX_PROGRAM, 0);
+	glitz_state_disable (gl, GLITZ_GL_VERTEX_PROGRAM);
+	dst->geometry.tex_gen = -1;
+    }
+
     for (i = texture_nr; i >= 0; i--)
     {
 	glitz_texture_unbind (gl, textures[i].texture);
 	if (textures[i].transform)
 	{
-	    gl->matrix_mode (GLITZ_GL_TEXTURE);
+	    glitz_state_matrix_mode (gl, GLITZ_GL_TEXTURE);
 	    gl->load_identity ();
-	    gl->matrix_mode (GLITZ_GL_MODELVIEW);
+	    glitz_state_matrix_mode (gl, GLITZ_GL_MODELVIEW);
 	}
 
 	if (i > 0)
 	{
 	    gl->client_active_texture (textures[i - 1].unit);
-	    gl->active_texture (textures[i - 1].unit);
+	    glitz_state_active_texture (gl, textures[i - 1].unit);
 	}
     }
 
@@ -358,6 +769,9 @@ glitz_copy_area (glitz_surface_t *src,
 
     GLITZ_GL_SURFACE (dst);
 
+    glitz_surface_flush_batch (src);
+    glitz_surface_flush_batch (dst);
+
     if (x_src < 0)
     {
 	bounds.x1 = x_dst - x_src;
@@ -424,6 +838,7 @@ glitz_copy_area (glitz_surface_t *src,
 
 		src->drawable->backend->read_buffer (src->drawable,
 						     src->buffer);
+		_glitz_fbo_resolve (src);
 		dst->drawable->backend->draw_buffer (dst->drawable,
 						     dst->buffer);
 
@@ -453,10 +868,9 @@ glitz_copy_area (glitz_surface_t *src,
 					      dst->x + box.x1,
 					      target_height - (dst->y + box.y2));
 
-			gl->scissor (dst->x + box.x1,
-				     target_height - (dst->y + box.y2),
-				     box.x2 - box.x1,
-				     box.y2 - box.y1);
+			glitz_state_scissor (gl, dst->x + box.x1,
+					     target_height - (dst->y + box.y2),
+					     box.x2 - box.x1, box.y2 - box.y1);
 
 			gl->copy_pixels (x_src + (box.x1 - x_dst),
 					 target_height -
@@ -492,9 +906,9 @@ glitz_copy_area (glitz_surface_t *src,
 					       mask,
 					       NULL);
 
-		    gl->tex_env_f (GLITZ_GL_TEXTURE_ENV,
-				   GLITZ_GL_TEXTURE_ENV_MODE,
-				   GLITZ_GL_REPLACE);
+		    glitz_state_tex_env_f (gl, GLITZ_GL_TEXTURE_ENV,
+					   GLITZ_GL_TEXTURE_ENV_MODE,
+					   GLITZ_GL_REPLACE);
 
 		    gl->color_4us (0x0, 0x0, 0x0, 0xffff);
 
@@ -561,10 +975,12 @@ glitz_copy_area (glitz_surface_t *src,
 
 			if (vertices)
 			{
-			    gl->scissor (bounds.x1 + dst->x,
-					 (target_height - dst->y) - bounds.y2,
-					 bounds.x2 - bounds.x1,
-					 bounds.y2 - bounds.y1);
+			    glitz_state_scissor (gl,
+						 bounds.x1 + dst->x,
+						 (target_height - dst->y) -
+						 bounds.y2,
+						 bounds.x2 - bounds.x1,
+						 bounds.y2 - bounds.y1);
 
 			    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, ptr);
 			    gl->draw_arrays (GLITZ_GL_QUADS, 0, vertices);
@@ -599,6 +1015,7 @@ glitz_copy_area (glitz_surface_t *src,
 	    glitz_texture_t *texture;
 
 	    src->drawable->backend->read_buffer (src->drawable, src->buffer);
+	    _glitz_fbo_resolve (src);
 
 	    texture = glitz_surface_get_texture (dst, 1);
 	    if (texture)
@@ -606,7 +1023,7 @@ glitz_copy_area (glitz_surface_t *src,
 		glitz_box_t box, *clip  = dst->clip;
 		int         n_clip = dst->n_clip;
 
-		gl->disable (GLITZ_GL_SCISSOR_TEST);
+		glitz_state_disable (gl, GLITZ_GL_SCISSOR_TEST);
 
 		glitz_texture_bind (gl, texture);
 
@@ -650,7 +1067,7 @@ glitz_copy_area (glitz_surface_t *src,
 
 		glitz_texture_unbind (gl, texture);
 
-		gl->enable (GLITZ_GL_SCISSOR_TEST);
+		glitz_state_enable (gl, GLITZ_GL_SCISSOR_TEST);
 
 		status = GLITZ_STATUS_SUCCESS;
 	    }
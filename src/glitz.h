@@ -307,6 +307,23 @@ typedef enum {
   GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
 } glitz_pixel_scanline_order_t;
 
+/**
+ * glitz_pixel_alpha_t:
+ * @GLITZ_PIXEL_ALPHA_PREMULTIPLIED: Color components are premultiplied
+ * with alpha.
+ * @GLITZ_PIXEL_ALPHA_STRAIGHT: Color components are not premultiplied
+ * with alpha.
+ *
+ * #glitz_pixel_alpha_t specifies how color components relate to alpha
+ * in a pixel buffer, see glitz_pixel_buffer_set_alpha(). Surfaces always
+ * hold premultiplied colors, straight alpha pixels are converted when
+ * transferred.
+ **/
+typedef enum {
+  GLITZ_PIXEL_ALPHA_PREMULTIPLIED,
+  GLITZ_PIXEL_ALPHA_STRAIGHT
+} glitz_pixel_alpha_t;
+
 typedef enum {
   GLITZ_FEATURE_TEXTURE_RECTANGLE_MASK        = (1L <<  0),
   GLITZ_FEATURE_TEXTURE_NON_POWER_OF_TWO_MASK = (1L <<  1),
@@ -326,7 +343,12 @@ typedef enum {
   GLITZ_FEATURE_MULTI_DRAW_ARRAYS_MASK        = (1L << 15),
   GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK       = (1L << 16),
   GLITZ_FEATURE_COPY_SUB_BUFFER_MASK          = (1L << 17),
-  GLITZ_FEATURE_DIRECT_RENDERING_MASK         = (1L << 18)
+  GLITZ_FEATURE_DIRECT_RENDERING_MASK         = (1L << 18),
+  GLITZ_FEATURE_SYNC_MASK                     = (1L << 19),
+  GLITZ_FEATURE_FENCE_MASK                    = (1L << 20),
+  GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK  = (1L << 21),
+  GLITZ_FEATURE_VERTEX_PROGRAM_MASK           = (1L << 22),
+  GLITZ_FEATURE_FRAGMENT_SHADER_MASK          = (1L << 23)
 } glitz_feature_t;
 
 /* glitz_format.c */
@@ -428,6 +450,10 @@ typedef unsigned int glitz_fourcc_t;
 #define GLITZ_FOURCC_RGB  ((glitz_fourcc_t) 0x0)
 #define GLITZ_FOURCC_YV12 GLITZ_FOURCC ('Y', 'V', '1', '2')
 #define GLITZ_FOURCC_YUY2 GLITZ_FOURCC ('Y', 'U', 'Y', '2')
+#define GLITZ_FOURCC_UYVY GLITZ_FOURCC ('U', 'Y', 'V', 'Y')
+#define GLITZ_FOURCC_I420 GLITZ_FOURCC ('I', '4', '2', '0')
+#define GLITZ_FOURCC_NV12 GLITZ_FOURCC ('N', 'V', '1', '2')
+#define GLITZ_FOURCC_P010 GLITZ_FOURCC ('P', '0', '1', '0')
 
 /**
  * @glitz_color_format_t:
@@ -523,6 +549,7 @@ glitz_find_pbuffer_format (glitz_drawable_t              *other,
  * with too many parameters).
  * @GLITZ_STATUS_CONTENT_DESTROYED: The surface is not available anymore,
  * its backing buffer has been deleted.
+ * @GLITZ_STATUS_BAD_ARGUMENT: An argument is outside its valid range.
  *
  * #glitz_status_t defines the possible statuses of a surface,
  * which are returned by #glitz_surface_get_status.
@@ -538,7 +565,8 @@ typedef enum {
   GLITZ_STATUS_NO_MEMORY,
   GLITZ_STATUS_BAD_COORDINATE,
   GLITZ_STATUS_NOT_SUPPORTED,
-  GLITZ_STATUS_CONTENT_DESTROYED
+  GLITZ_STATUS_CONTENT_DESTROYED,
+  GLITZ_STATUS_BAD_ARGUMENT
 } glitz_status_t;
 
 const char *
@@ -624,6 +652,26 @@ const char *
 glitz_drawable_get_gl_string (glitz_drawable_t  *drawable,
 			      glitz_gl_string_t name);
 
+void
+glitz_drawable_get_state_counters (glitz_drawable_t *drawable,
+				   unsigned long    *issued,
+				   unsigned long    *skipped);
+
+void
+glitz_drawable_set_pool_budget (glitz_drawable_t *drawable,
+				unsigned long    budget);
+
+void
+glitz_drawable_get_pool_counters (glitz_drawable_t *drawable,
+				  unsigned long    *hits,
+				  unsigned long    *misses,
+				  unsigned long    *size);
+
+void
+glitz_drawable_get_readback_counters (glitz_drawable_t *drawable,
+				      unsigned long    *calls,
+				      unsigned long    *bytes);
+
 
 /* glitz_surface.c */
 
@@ -704,6 +752,20 @@ void
 glitz_surface_set_dither (glitz_surface_t *surface,
 			  glitz_bool_t    dither);
 
+/**
+ * glitz_yuv_matrix_t:
+ * GLITZ_YUV_MATRIX_BT601: YUV data uses ITU-R BT.601 (SDTV) coefficients.
+ * GLITZ_YUV_MATRIX_BT709: YUV data uses ITU-R BT.709 (HDTV) coefficients.
+ **/
+typedef enum {
+  GLITZ_YUV_MATRIX_BT601,
+  GLITZ_YUV_MATRIX_BT709
+} glitz_yuv_matrix_t;
+
+void
+glitz_surface_set_yuv_matrix (glitz_surface_t    *surface,
+			      glitz_yuv_matrix_t matrix);
+
 unsigned int
 glitz_surface_get_width (glitz_surface_t *surface);
 
@@ -1006,6 +1068,12 @@ glitz_vertex_buffer_create (glitz_drawable_t    *drawable,
 			    unsigned int        size,
 			    glitz_buffer_hint_t hint);
 
+glitz_buffer_t *
+glitz_index_buffer_create (glitz_drawable_t    *drawable,
+			   void                *data,
+			   unsigned int        size,
+			   glitz_buffer_hint_t hint);
+
 glitz_buffer_t *
 glitz_pixel_buffer_create (glitz_drawable_t    *drawable,
 			   void                *data,
@@ -1015,6 +1083,10 @@ glitz_pixel_buffer_create (glitz_drawable_t    *drawable,
 glitz_buffer_t *
 glitz_buffer_create_for_data (void *data);
 
+void
+glitz_pixel_buffer_set_alpha (glitz_buffer_t      *buffer,
+			      glitz_pixel_alpha_t alpha);
+
 void
 glitz_buffer_destroy (glitz_buffer_t *buffer);
 
@@ -1078,6 +1150,30 @@ glitz_get_pixels (glitz_surface_t      *src,
 		  glitz_pixel_format_t *format,
 		  glitz_buffer_t       *buffer);
 
+typedef struct _glitz_pixel_readback glitz_pixel_readback_t;
+
+glitz_pixel_readback_t *
+glitz_get_pixels_async (glitz_surface_t      *src,
+			int                  x_src,
+			int                  y_src,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer);
+
+glitz_bool_t
+glitz_pixel_readback_is_done (glitz_pixel_readback_t *readback);
+
+void *
+glitz_pixel_readback_map (glitz_pixel_readback_t *readback);
+
+void
+glitz_pixel_readback_destroy (glitz_pixel_readback_t *readback);
+
+void
+glitz_pixel_set_threads (unsigned int  n_threads,
+			 unsigned long threshold);
+
 
 /* glitz_geometry.c */
 
@@ -1112,8 +1208,14 @@ typedef struct _glitz_coordinate_attribute {
     int                     offset;
 } glitz_coordinate_attribute_t;
 
+typedef struct _glitz_index_attribute {
+    glitz_data_type_t type;
+    glitz_buffer_t    *buffer;
+} glitz_index_attribute_t;
+
 #define GLITZ_VERTEX_ATTRIBUTE_SRC_COORD_MASK  (1L << 0)
 #define GLITZ_VERTEX_ATTRIBUTE_MASK_COORD_MASK (1L << 1)
+#define GLITZ_VERTEX_ATTRIBUTE_INDEX_MASK      (1L << 2)
 
 typedef struct _glitz_vertex_format {
   glitz_primitive_t            primitive;
@@ -1122,6 +1224,7 @@ typedef struct _glitz_vertex_format {
   unsigned long                attributes;
   glitz_coordinate_attribute_t src;
   glitz_coordinate_attribute_t mask;
+  glitz_index_attribute_t      index;
 } glitz_vertex_format_t;
 
 typedef struct _glitz_bitmap_format {
@@ -1206,6 +1309,94 @@ glitz_add_traps (glitz_buffer_t    *buffer,
 		 int               n_traps,
 		 int               *n_added);
 
+int
+glitz_add_trapezoids_multi (glitz_buffer_t      *buffer,
+			    int                 offset,
+			    unsigned int        size,
+			    glitz_data_type_t   type,
+			    glitz_surface_t     *mask,
+			    glitz_trapezoid_t   *traps,
+			    int                 n_traps,
+			    glitz_multi_array_t *array,
+			    int                 *n_added);
+
+int
+glitz_add_traps_multi (glitz_buffer_t      *buffer,
+		       int                 offset,
+		       unsigned int        size,
+		       glitz_data_type_t   type,
+		       glitz_surface_t     *mask,
+		       glitz_trap_t        *traps,
+		       int                 n_traps,
+		       glitz_multi_array_t *array,
+		       int                 *n_added);
+
+void
+glitz_rasterize_trapezoids (glitz_surface_t   *dst,
+			    glitz_trapezoid_t *traps,
+			    int               n_traps);
+
+void
+glitz_rasterize_traps (glitz_surface_t *dst,
+		       glitz_trap_t    *traps,
+		       int             n_traps);
+
+
+/* glitz_glyph.c */
+
+typedef struct _glitz_glyph_cache glitz_glyph_cache_t;
+
+/**
+ * glitz_glyph_t:
+ * @id: Identifier the glyph was added to the cache with
+ * @x: X coordinate of the glyph origin in the destination
+ * @y: Y coordinate of the glyph origin in the destination
+ *
+ * A #glitz_glyph_t places one cached glyph for glitz_composite_glyphs().
+ **/
+typedef struct _glitz_glyph_t {
+  unsigned long id;
+  int           x;
+  int           y;
+} glitz_glyph_t;
+
+glitz_glyph_cache_t *
+glitz_glyph_cache_create (glitz_drawable_t *drawable,
+			  glitz_format_t   *format,
+			  int              width,
+			  int              height);
+
+void
+glitz_glyph_cache_destroy (glitz_glyph_cache_t *cache);
+
+glitz_status_t
+glitz_glyph_cache_add (glitz_glyph_cache_t  *cache,
+		       unsigned long        id,
+		       int                  x_origin,
+		       int                  y_origin,
+		       int                  width,
+		       int                  height,
+		       glitz_pixel_format_t *format,
+		       glitz_buffer_t       *buffer);
+
+glitz_bool_t
+glitz_glyph_cache_lookup (glitz_glyph_cache_t *cache,
+			  unsigned long       id);
+
+void
+glitz_glyph_cache_remove (glitz_glyph_cache_t *cache,
+			  unsigned long       id);
+
+void
+glitz_composite_glyphs (glitz_operator_t    op,
+			glitz_surface_t     *src,
+			glitz_glyph_cache_t *cache,
+			glitz_surface_t     *dst,
+			int                 x_src,
+			int                 y_src,
+			const glitz_glyph_t *glyphs,
+			int                 n_glyphs);
+
 
 /* glitz.c */
 
@@ -1233,6 +1424,12 @@ glitz_copy_area (glitz_surface_t *src,
 		 int             x_dst,
 		 int             y_dst);
 
+void
+glitz_surface_begin_batch (glitz_surface_t *surface);
+
+void
+glitz_surface_end_batch (glitz_surface_t *surface);
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
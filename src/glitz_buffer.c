@@ -40,6 +40,7 @@ _glitz_buffer_init (glitz_buffer_t      *buffer,
 
     buffer->ref_count = 1;
     buffer->name = 0;
+    buffer->alpha = GLITZ_PIXEL_ALPHA_PREMULTIPLIED;
 
     if (drawable)
     {
@@ -149,6 +150,38 @@ glitz_vertex_buffer_create (glitz_drawable_t    *drawable,
     return buffer;
 }
 
+glitz_buffer_t *
+glitz_index_buffer_create (glitz_drawable_t    *drawable,
+			   void                *data,
+			   unsigned int        size,
+			   glitz_buffer_hint_t hint)
+{
+    glitz_buffer_t *buffer;
+    glitz_status_t status;
+
+    if (size == 0)
+	return NULL;
+
+    buffer = (glitz_buffer_t *) malloc (sizeof (glitz_buffer_t));
+    if (buffer == NULL)
+	return NULL;
+
+    buffer->target = GLITZ_GL_ELEMENT_ARRAY_BUFFER;
+
+    if (drawable->backend->feature_mask &
+	GLITZ_FEATURE_VERTEX_BUFFER_OBJECT_MASK)
+	status = _glitz_buffer_init (buffer, drawable, data, size, hint);
+    else
+	status = _glitz_buffer_init (buffer, NULL, data, size, hint);
+
+    if (status != GLITZ_STATUS_SUCCESS) {
+	free (buffer);
+	return NULL;
+    }
+
+    return buffer;
+}
+
 glitz_buffer_t *
 glitz_pixel_buffer_create (glitz_drawable_t    *drawable,
 			   void                *data,
@@ -207,6 +240,13 @@ glitz_buffer_create_for_data (void *data)
     return buffer;
 }
 
+void
+glitz_pixel_buffer_set_alpha (glitz_buffer_t      *buffer,
+			      glitz_pixel_alpha_t alpha)
+{
+    buffer->alpha = alpha;
+}
+
 void
 glitz_buffer_destroy (glitz_buffer_t *buffer)
 {
@@ -367,3 +407,151 @@ glitz_buffer_unbind (glitz_buffer_t *buffer)
     if (buffer->drawable)
 	buffer->drawable->backend->gl->bind_buffer (buffer->target, 0);
 }
+
+/*
+ * Per drawable ring of pixel unpack buffers for small uploads. A slot
+ * that the GPU may still be reading from is orphaned before it is
+ * mapped. When fences are available, slots that have completed are
+ * mapped in place instead.
+ */
+static glitz_bool_t
+_glitz_upload_slot_idle (glitz_gl_proc_address_list_t *gl,
+			 glitz_upload_slot_t          *slot)
+{
+    if (slot->sync)
+    {
+	if (gl->client_wait_sync (slot->sync, 0, 0) ==
+	    GLITZ_GL_TIMEOUT_EXPIRED)
+	    return 0;
+
+	gl->delete_sync (slot->sync);
+	slot->sync = NULL;
+
+	return 1;
+    }
+
+    if (slot->fence)
+	return gl->test_fence (slot->fence);
+
+    return 0;
+}
+
+void *
+glitz_upload_ring_map (glitz_drawable_t *drawable,
+		       int              size)
+{
+    glitz_upload_ring_t *ring = &drawable->upload_ring;
+    glitz_upload_slot_t *slot = &ring->slot[ring->current];
+    glitz_bool_t        orphan;
+    void                *pointer;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (size > GLITZ_UPLOAD_RING_SLOT_SIZE)
+	return NULL;
+
+    if (!(drawable->backend->feature_mask &
+	  GLITZ_FEATURE_PIXEL_BUFFER_OBJECT_MASK))
+	return NULL;
+
+    if (!slot->name)
+    {
+	gl->gen_buffers (1, &slot->name);
+	if (!slot->name)
+	    return NULL;
+
+	orphan = 1;
+    }
+    else
+	orphan = !_glitz_upload_slot_idle (gl, slot);
+
+    gl->bind_buffer (GLITZ_GL_PIXEL_UNPACK_BUFFER, slot->name);
+
+    if (orphan)
+	gl->buffer_data (GLITZ_GL_PIXEL_UNPACK_BUFFER,
+			 GLITZ_UPLOAD_RING_SLOT_SIZE, NULL,
+			 GLITZ_GL_STREAM_DRAW);
+
+    pointer = gl->map_buffer (GLITZ_GL_PIXEL_UNPACK_BUFFER,
+			      GLITZ_GL_WRITE_ONLY);
+    if (!pointer)
+	gl->bind_buffer (GLITZ_GL_PIXEL_UNPACK_BUFFER, 0);
+
+    return pointer;
+}
+
+/* the slot stays bound so that it can be sourced at offset 0 */
+void
+glitz_upload_ring_unmap (glitz_drawable_t *drawable)
+{
+    GLITZ_GL_DRAWABLE (drawable);
+
+    gl->unmap_buffer (GLITZ_GL_PIXEL_UNPACK_BUFFER);
+}
+
+void
+glitz_upload_ring_release (glitz_drawable_t *drawable)
+{
+    glitz_upload_ring_t *ring = &drawable->upload_ring;
+    glitz_upload_slot_t *slot = &ring->slot[ring->current];
+    unsigned long       feature_mask = drawable->backend->feature_mask;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (feature_mask & GLITZ_FEATURE_SYNC_MASK)
+    {
+	if (slot->sync)
+	    gl->delete_sync (slot->sync);
+
+	slot->sync = gl->fence_sync (GLITZ_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    else if (feature_mask & GLITZ_FEATURE_FENCE_MASK)
+    {
+	if (!slot->fence)
+	    gl->gen_fences (1, &slot->fence);
+
+	gl->set_fence (slot->fence, GLITZ_GL_ALL_COMPLETED_NV);
+    }
+
+    gl->bind_buffer (GLITZ_GL_PIXEL_UNPACK_BUFFER, 0);
+
+    ring->current = (ring->current + 1) % GLITZ_UPLOAD_RING_SLOTS;
+}
+
+void
+glitz_upload_ring_fini (glitz_drawable_t *drawable)
+{
+    glitz_upload_ring_t *ring = &drawable->upload_ring;
+    glitz_upload_slot_t *slot;
+    int                 i;
+
+    GLITZ_GL_DRAWABLE (drawable);
+
+    for (i = 0; i < GLITZ_UPLOAD_RING_SLOTS; i++)
+	if (ring->slot[i].name)
+	    break;
+
+    if (i == GLITZ_UPLOAD_RING_SLOTS)
+	return;
+
+    drawable->backend->push_current (drawable, NULL,
+				     GLITZ_ANY_CONTEXT_CURRENT, NULL);
+
+    for (i = 0; i < GLITZ_UPLOAD_RING_SLOTS; i++)
+    {
+	slot = &ring->slot[i];
+
+	if (slot->sync)
+	    gl->delete_sync (slot->sync);
+
+	if (slot->fence)
+	    gl->delete_fences (1, &slot->fence);
+
+	if (slot->name)
+	    gl->delete_buffers (1, &slot->name);
+    }
+
+    drawable->backend->pop_current (drawable);
+
+    memset (ring, 0, sizeof (glitz_upload_ring_t));
+}
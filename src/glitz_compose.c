@@ -34,36 +34,36 @@ _glitz_combine_argb_argb (glitz_composite_op_t *op)
 {
     glitz_set_operator (op->gl, op->render_op);
 
-    op->gl->active_texture (GLITZ_GL_TEXTURE0);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-		       GLITZ_GL_REPLACE);
+    glitz_state_active_texture (op->gl, GLITZ_GL_TEXTURE0);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_REPLACE);
     op->gl->color_4us (0x0, 0x0, 0x0, 0xffff);
 
-    op->gl->active_texture (GLITZ_GL_TEXTURE1);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-		       GLITZ_GL_COMBINE);
-
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_RGB,
-		       GLITZ_GL_MODULATE);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_RGB,
-		       GLITZ_GL_TEXTURE);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE1_RGB,
-		       GLITZ_GL_PREVIOUS);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_RGB,
-		       GLITZ_GL_SRC_COLOR);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND1_RGB,
-		       GLITZ_GL_SRC_ALPHA);
-
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_ALPHA,
-		       GLITZ_GL_MODULATE);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_ALPHA,
-		       GLITZ_GL_TEXTURE);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE1_ALPHA,
-		       GLITZ_GL_PREVIOUS);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_ALPHA,
-		       GLITZ_GL_SRC_ALPHA);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND1_ALPHA,
-		       GLITZ_GL_SRC_ALPHA);
+    glitz_state_active_texture (op->gl, GLITZ_GL_TEXTURE1);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_COMBINE);
+
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_RGB,
+			   GLITZ_GL_MODULATE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_RGB,
+			   GLITZ_GL_TEXTURE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE1_RGB,
+			   GLITZ_GL_PREVIOUS);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_RGB,
+			   GLITZ_GL_SRC_COLOR);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND1_RGB,
+			   GLITZ_GL_SRC_ALPHA);
+
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_COMBINE_ALPHA, GLITZ_GL_MODULATE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_SOURCE0_ALPHA, GLITZ_GL_TEXTURE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_SOURCE1_ALPHA, GLITZ_GL_PREVIOUS);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_OPERAND0_ALPHA, GLITZ_GL_SRC_ALPHA);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_OPERAND1_ALPHA, GLITZ_GL_SRC_ALPHA);
 }
 
 static void
@@ -72,54 +72,54 @@ _glitz_combine_argb_argbc (glitz_composite_op_t *op)
     if (op->count == 0) {
 	glitz_set_operator (op->gl, op->render_op);
 
-	op->gl->active_texture (GLITZ_GL_TEXTURE0);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_COMBINE);
-
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_RGB,
-			   GLITZ_GL_INTERPOLATE);
-
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_RGB,
-			   GLITZ_GL_TEXTURE);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE1_RGB,
-			   GLITZ_GL_PRIMARY_COLOR);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE2_RGB,
-			   GLITZ_GL_PRIMARY_COLOR);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_RGB,
-			   GLITZ_GL_SRC_COLOR);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND1_RGB,
-			   GLITZ_GL_SRC_COLOR);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND2_RGB,
-			   GLITZ_GL_SRC_ALPHA);
+	glitz_state_active_texture (op->gl, GLITZ_GL_TEXTURE0);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_COMBINE);
+
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_COMBINE_RGB, GLITZ_GL_INTERPOLATE);
+
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_SOURCE0_RGB, GLITZ_GL_TEXTURE);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_SOURCE1_RGB, GLITZ_GL_PRIMARY_COLOR);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_SOURCE2_RGB, GLITZ_GL_PRIMARY_COLOR);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_OPERAND0_RGB, GLITZ_GL_SRC_COLOR);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_OPERAND1_RGB, GLITZ_GL_SRC_COLOR);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_OPERAND2_RGB, GLITZ_GL_SRC_ALPHA);
 
 	/* we don't care about the alpha channel */
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_ALPHA,
-			   GLITZ_GL_REPLACE);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_ALPHA,
-			   GLITZ_GL_PRIMARY_COLOR);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_ALPHA,
-			   GLITZ_GL_SRC_ALPHA);
-
-
-	op->gl->active_texture (GLITZ_GL_TEXTURE1);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_COMBINE);
-
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_RGB,
-			   GLITZ_GL_DOT3_RGBA);
-
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_RGB,
-			   GLITZ_GL_PREVIOUS);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE1_RGB,
-			   GLITZ_GL_PRIMARY_COLOR);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_RGB,
-			   GLITZ_GL_SRC_COLOR);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND1_RGB,
-			   GLITZ_GL_SRC_COLOR);
-
-	op->gl->active_texture (GLITZ_GL_TEXTURE2);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_MODULATE);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_COMBINE_ALPHA, GLITZ_GL_REPLACE);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_SOURCE0_ALPHA, GLITZ_GL_PRIMARY_COLOR);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_OPERAND0_ALPHA, GLITZ_GL_SRC_ALPHA);
+
+
+	glitz_state_active_texture (op->gl, GLITZ_GL_TEXTURE1);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_COMBINE);
+
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_COMBINE_RGB, GLITZ_GL_DOT3_RGBA);
+
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_SOURCE0_RGB, GLITZ_GL_PREVIOUS);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_SOURCE1_RGB, GLITZ_GL_PRIMARY_COLOR);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_OPERAND0_RGB, GLITZ_GL_SRC_COLOR);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_OPERAND1_RGB, GLITZ_GL_SRC_COLOR);
+
+	glitz_state_active_texture (op->gl, GLITZ_GL_TEXTURE2);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_MODULATE);
     }
 
     if (op->alpha_mask.red) {
@@ -129,17 +129,17 @@ _glitz_combine_argb_argbc (glitz_composite_op_t *op)
     } else if (op->alpha_mask.blue) {
 	op->gl->color_4f (0.5f, 0.5f, 1.0f, 0.5f);
     } else {
-	op->gl->active_texture (GLITZ_GL_TEXTURE0);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_REPLACE);
+	glitz_state_active_texture (op->gl, GLITZ_GL_TEXTURE0);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_REPLACE);
 	op->gl->color_4us (0x0, 0x0, 0x0, 0xffff);
 
-	op->gl->active_texture (GLITZ_GL_TEXTURE1);
+	glitz_state_active_texture (op->gl, GLITZ_GL_TEXTURE1);
 	glitz_texture_unbind (op->gl, &op->src->texture);
 
-	op->gl->active_texture (GLITZ_GL_TEXTURE2);
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_MODULATE);
+	glitz_state_active_texture (op->gl, GLITZ_GL_TEXTURE2);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_MODULATE);
     }
 }
 
@@ -161,15 +161,15 @@ _glitz_combine_argb_solid (glitz_composite_op_t *op)
     glitz_set_operator (op->gl, op->render_op);
 
     if (op->alpha_mask.alpha != 0xffff) {
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_MODULATE);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_MODULATE);
 	op->gl->color_4us (op->alpha_mask.alpha,
 			   op->alpha_mask.alpha,
 			   op->alpha_mask.alpha,
 			   op->alpha_mask.alpha);
     } else {
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_REPLACE);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_REPLACE);
 	op->gl->color_4us (0x0, 0x0, 0x0, 0xffff);
     }
 }
@@ -192,12 +192,12 @@ _glitz_combine_argb_solidc (glitz_composite_op_t *op)
 	alpha = op->alpha_mask.alpha;
 
     if (alpha != 0xffff) {
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_MODULATE);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_MODULATE);
 	op->gl->color_4us (alpha, alpha, alpha, alpha);
     } else {
-	op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-			   GLITZ_GL_REPLACE);
+	glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_REPLACE);
 	op->gl->color_4us (0x0, 0x0, 0x0, 0xffff);
     }
 }
@@ -265,30 +265,30 @@ _glitz_combine_solid_argb (glitz_composite_op_t *op)
 {
     glitz_set_operator (op->gl, op->render_op);
 
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-		       GLITZ_GL_COMBINE);
-
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_RGB,
-		       GLITZ_GL_MODULATE);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_RGB,
-		       GLITZ_GL_TEXTURE);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE1_RGB,
-		       GLITZ_GL_PRIMARY_COLOR);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_RGB,
-		       GLITZ_GL_SRC_ALPHA);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND1_RGB,
-		       GLITZ_GL_SRC_COLOR);
-
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_ALPHA,
-		       GLITZ_GL_MODULATE);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_ALPHA,
-		       GLITZ_GL_TEXTURE);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE1_ALPHA,
-		       GLITZ_GL_PRIMARY_COLOR);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_ALPHA,
-		       GLITZ_GL_SRC_ALPHA);
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND1_ALPHA,
-		       GLITZ_GL_SRC_ALPHA);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_COMBINE);
+
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_COMBINE_RGB,
+			   GLITZ_GL_MODULATE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE0_RGB,
+			   GLITZ_GL_TEXTURE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_SOURCE1_RGB,
+			   GLITZ_GL_PRIMARY_COLOR);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND0_RGB,
+			   GLITZ_GL_SRC_ALPHA);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV, GLITZ_GL_OPERAND1_RGB,
+			   GLITZ_GL_SRC_COLOR);
+
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_COMBINE_ALPHA, GLITZ_GL_MODULATE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_SOURCE0_ALPHA, GLITZ_GL_TEXTURE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_SOURCE1_ALPHA, GLITZ_GL_PRIMARY_COLOR);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_OPERAND0_ALPHA, GLITZ_GL_SRC_ALPHA);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_OPERAND1_ALPHA, GLITZ_GL_SRC_ALPHA);
 
     op->gl->color_4us (SHORT_MULT (op->solid->red, op->alpha_mask.alpha),
 		       SHORT_MULT (op->solid->green, op->alpha_mask.alpha),
@@ -307,8 +307,9 @@ _glitz_combine_solid_argbc (glitz_composite_op_t *op)
     solid.blue = SHORT_MULT (op->solid->blue, op->alpha_mask.alpha);
     solid.alpha = SHORT_MULT (op->solid->alpha, op->alpha_mask.alpha);
 
-    op->gl->enable (GLITZ_GL_BLEND);
-    op->gl->blend_func (GLITZ_GL_CONSTANT_COLOR, GLITZ_GL_ONE_MINUS_SRC_COLOR);
+    glitz_state_enable (op->gl, GLITZ_GL_BLEND);
+    glitz_state_blend_func (op->gl, GLITZ_GL_CONSTANT_COLOR,
+			    GLITZ_GL_ONE_MINUS_SRC_COLOR);
 
     if (solid.alpha > 0)
 	op->gl->blend_color ((glitz_gl_clampf_t) solid.red / solid.alpha,
@@ -318,8 +319,8 @@ _glitz_combine_solid_argbc (glitz_composite_op_t *op)
     else
 	op->gl->blend_color (1.0f, 1.0f, 1.0f, 1.0f);
 
-    op->gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-		       GLITZ_GL_MODULATE);
+    glitz_state_tex_env_f (op->gl, GLITZ_GL_TEXTURE_ENV,
+			   GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_MODULATE);
     op->gl->color_4us (solid.alpha,
 		       solid.alpha,
 		       solid.alpha,
@@ -342,8 +343,9 @@ _glitz_combine_solid_argbf (glitz_composite_op_t *op)
 static void
 _glitz_combine_solid_solidc (glitz_composite_op_t *op)
 {
-    op->gl->enable (GLITZ_GL_BLEND);
-    op->gl->blend_func (GLITZ_GL_CONSTANT_COLOR, GLITZ_GL_ONE_MINUS_SRC_COLOR);
+    glitz_state_enable (op->gl, GLITZ_GL_BLEND);
+    glitz_state_blend_func (op->gl, GLITZ_GL_CONSTANT_COLOR,
+			    GLITZ_GL_ONE_MINUS_SRC_COLOR);
 
     if (op->solid->alpha > 0)
 	op->gl->blend_color ((glitz_gl_clampf_t)
@@ -449,7 +451,8 @@ _glitz_get_surface_type (glitz_surface_t *surface,
 	    if (SURFACE_COMPONENT_ALPHA (surface))
 		return GLITZ_SURFACE_TYPE_NA;
 
-	    if (feature_mask & GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK)
+	    if (feature_mask & (GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK |
+				GLITZ_FEATURE_FRAGMENT_SHADER_MASK))
 		return GLITZ_SURFACE_TYPE_ARGBF;
 
 	} else if (SURFACE_COMPONENT_ALPHA (surface)) {
@@ -488,6 +491,7 @@ glitz_composite_op_init (glitz_composite_op_t *op,
     op->solid = NULL;
     op->per_component = 0;
     op->fp = 0;
+    op->shader = NULL;
 
     if (dst->attached)
     {
@@ -616,8 +620,10 @@ glitz_composite_enable (glitz_composite_op_t *op)
 void
 glitz_composite_disable (glitz_composite_op_t *op)
 {
-    if (op->fp) {
-	op->gl->bind_program (GLITZ_GL_FRAGMENT_PROGRAM, 0);
-	op->gl->disable (GLITZ_GL_FRAGMENT_PROGRAM);
+    if (op->shader) {
+	op->gl->use_program (0);
+    } else if (op->fp) {
+	glitz_state_bind_program (op->gl, GLITZ_GL_FRAGMENT_PROGRAM, 0);
+	glitz_state_disable (op->gl, GLITZ_GL_FRAGMENT_PROGRAM);
     }
 }
@@ -152,6 +152,9 @@ glitz_context_make_current (glitz_context_t  *context,
 
     context->lose_current = lose_current;
 
+    /* the application may use the stencil buffer */
+    drawable->stencil_clip = 0;
+
     drawable->backend->make_current (drawable, context);
 }
 slim_hidden_def(glitz_context_make_current);
@@ -178,10 +181,16 @@ glitz_context_bind_texture (glitz_context_t	   *context,
 	glitz_context_make_current (context, context->drawable);
     }
 
+    /* the state cache describes the drawable's own context, not the
+       application's */
+    glitz_state_invalidate (gl);
+
     glitz_texture_bind (gl, &texture->surface->texture);
     glitz_texture_ensure_parameters (gl,
 				     &texture->surface->texture,
 				     &texture->param);
+
+    glitz_state_invalidate (gl);
 }
 slim_hidden_def(glitz_context_bind_texture);
 
@@ -191,7 +200,9 @@ glitz_context_unbind_texture (glitz_context_t	     *context,
 {
     glitz_gl_proc_address_list_t *gl = context->drawable->backend->gl;
 
+    glitz_state_invalidate (gl);
     glitz_texture_unbind (gl, &texture->surface->texture);
+    glitz_state_invalidate (gl);
 }
 slim_hidden_def(glitz_context_unbind_texture);
 
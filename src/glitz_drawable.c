@@ -55,6 +55,15 @@ _glitz_drawable_init (glitz_drawable_t	          *drawable,
     drawable->update_all = 1;
     drawable->flushed    = 0;
     drawable->finished   = 0;
+
+    drawable->stencil_clip = 0;
+
+    drawable->read_calls = 0;
+    drawable->read_bytes = 0;
+
+    memset (&drawable->upload_ring, 0, sizeof (glitz_upload_ring_t));
+
+    glitz_pool_init (&drawable->pool);
 }
 
 void
@@ -148,6 +157,9 @@ glitz_drawable_destroy (glitz_drawable_t *drawable)
     if (drawable->ref_count)
 	return;
 
+    glitz_upload_ring_fini (drawable);
+    glitz_pool_fini (drawable);
+
     drawable->backend->destroy (drawable);
 }
 
@@ -173,7 +185,8 @@ glitz_drawable_update_size (glitz_drawable_t *drawable,
     drawable->viewport.width = 65535;
     drawable->viewport.height = 65535;
 
-    drawable->update_all = 1;
+    drawable->update_all   = 1;
+    drawable->stencil_clip = 0;
 }
 
 unsigned int
@@ -280,11 +293,11 @@ glitz_drawable_swap_buffer_region (glitz_drawable_t *drawable,
 	    drawable->update_all = 1;
 
 	    gl->viewport (0, 0, drawable->width, drawable->height);
-	    gl->matrix_mode (GLITZ_GL_PROJECTION);
+	    glitz_state_matrix_mode (gl, GLITZ_GL_PROJECTION);
 	    gl->load_identity ();
 	    gl->ortho (0.0, drawable->width, 0.0,
 		       drawable->height, -1.0, 1.0);
-	    gl->matrix_mode (GLITZ_GL_MODELVIEW);
+	    glitz_state_matrix_mode (gl, GLITZ_GL_MODELVIEW);
 	    gl->load_identity ();
 	    gl->scale_f (1.0f, -1.0f, 1.0f);
 	    gl->translate_f (0.0f, -drawable->height, 0.0f);
@@ -296,7 +309,7 @@ glitz_drawable_swap_buffer_region (glitz_drawable_t *drawable,
 	}
     }
 
-    gl->disable (GLITZ_GL_DITHER);
+    glitz_state_disable (gl, GLITZ_GL_DITHER);
 
     drawable->backend->read_buffer (drawable, GLITZ_GL_BACK);
     drawable->backend->draw_buffer (drawable, GLITZ_GL_FRONT);
@@ -330,7 +343,7 @@ glitz_drawable_swap_buffer_region (glitz_drawable_t *drawable,
 		y_pos = y;
 	    }
 
-	    gl->scissor (x, y, w, h);
+	    glitz_state_scissor (gl, x, y, w, h);
 	    gl->copy_pixels (x, y, w, h, GLITZ_GL_COLOR);
 
 	    if (surface)
@@ -441,3 +454,58 @@ glitz_drawable_get_gl_string (glitz_drawable_t  *drawable,
     return (const char *) string;
 }
 slim_hidden_def(glitz_drawable_get_gl_string);
+
+void
+glitz_drawable_get_state_counters (glitz_drawable_t *drawable,
+				   unsigned long    *issued,
+				   unsigned long    *skipped)
+{
+    glitz_gl_state_t *state = &drawable->backend->gl->state;
+
+    if (issued)
+	*issued = state->issued;
+
+    if (skipped)
+	*skipped = state->skipped;
+}
+slim_hidden_def(glitz_drawable_get_state_counters);
+
+void
+glitz_drawable_set_pool_budget (glitz_drawable_t *drawable,
+				unsigned long    budget)
+{
+    drawable->pool.budget = budget;
+
+    glitz_pool_trim (drawable);
+}
+slim_hidden_def(glitz_drawable_set_pool_budget);
+
+void
+glitz_drawable_get_pool_counters (glitz_drawable_t *drawable,
+				  unsigned long    *hits,
+				  unsigned long    *misses,
+				  unsigned long    *size)
+{
+    if (hits)
+	*hits = drawable->pool.hits;
+
+    if (misses)
+	*misses = drawable->pool.misses;
+
+    if (size)
+	*size = drawable->pool.size;
+}
+slim_hidden_def(glitz_drawable_get_pool_counters);
+
+void
+glitz_drawable_get_readback_counters (glitz_drawable_t *drawable,
+				      unsigned long    *calls,
+				      unsigned long    *bytes)
+{
+    if (calls)
+	*calls = drawable->read_calls;
+
+    if (bytes)
+	*bytes = drawable->read_bytes;
+}
+slim_hidden_def(glitz_drawable_get_readback_counters);
@@ -36,6 +36,18 @@ struct _glitz_filter_params_t {
     int          n_vectors;
 };
 
+/* chroma coefficients of the YUV to RGB conversion, must match the
+   tables used by _glitz_pixel_transform */
+static glitz_vec4_t _yuv_coefficients[][2] = {
+    /* BT.601 */
+    { { { 1.596f, -0.813f, 0.0f, 0.0f } },
+      { { 0.0f, -0.391f, 2.018f, 0.0f } } },
+
+    /* BT.709 */
+    { { { 1.793f, -0.533f, 0.0f, 0.0f } },
+      { { 0.0f, -0.213f, 2.112f, 0.0f } } }
+};
+
 static glitz_status_t
 _glitz_filter_params_ensure (glitz_surface_t *surface,
 			     int             vectors)
@@ -334,17 +346,40 @@ glitz_filter_set_params (glitz_surface_t *surface,
     case GLITZ_FILTER_NEAREST:
 	switch (surface->format->color.fourcc) {
 	case GLITZ_FOURCC_YV12:
+	case GLITZ_FOURCC_I420:
+	case GLITZ_FOURCC_NV12:
+	case GLITZ_FOURCC_P010:
+	case GLITZ_FOURCC_YUY2:
+	case GLITZ_FOURCC_UYVY:
 	    if (_glitz_filter_params_ensure (surface, 2))
 		return GLITZ_STATUS_NO_MEMORY;
 
 	    vecs = surface->filter_params->vectors;
 
-	    vecs->v[0] = 0.0f;
-	    vecs->v[1] = surface->texture.texcoord_height_unit *
-		((surface->texture.box.y2 + 1) & ~1);
-	    vecs->v[2] = surface->texture.texcoord_width_unit *
-		(surface->texture.width >> 1);
-	    vecs->v[3] = 0.0f;
+	    switch (surface->format->color.fourcc) {
+	    case GLITZ_FOURCC_YUY2:
+	    case GLITZ_FOURCC_UYVY:
+		vecs->v[0] = surface->texture.texcoord_width_unit * 2.0f;
+		vecs->v[1] = 1.0f / vecs->v[0];
+		vecs->v[2] = 0.0f;
+		vecs->v[3] = 0.0f;
+		break;
+	    case GLITZ_FOURCC_NV12:
+	    case GLITZ_FOURCC_P010:
+		vecs->v[0] = 0.0f;
+		vecs->v[1] = surface->texture.texcoord_height_unit *
+		    ((surface->texture.box.y2 + 1) & ~1);
+		vecs->v[2] = surface->texture.texcoord_width_unit;
+		vecs->v[3] = 1.0f / vecs->v[2];
+		break;
+	    default:
+		vecs->v[0] = 0.0f;
+		vecs->v[1] = surface->texture.texcoord_height_unit *
+		    ((surface->texture.box.y2 + 1) & ~1);
+		vecs->v[2] = surface->texture.texcoord_width_unit *
+		    (surface->texture.width >> 1);
+		vecs->v[3] = 0.0f;
+	    }
 
 	    vecs++;
 
@@ -387,10 +422,29 @@ glitz_filter_set_type (glitz_surface_t *surface,
 {
     switch (surface->format->color.fourcc) {
     case GLITZ_FOURCC_YV12:
+    case GLITZ_FOURCC_I420:
+    case GLITZ_FOURCC_NV12:
+    case GLITZ_FOURCC_P010:
+    case GLITZ_FOURCC_YUY2:
+    case GLITZ_FOURCC_UYVY:
 	switch (filter) {
 	case GLITZ_FILTER_BILINEAR:
 	case GLITZ_FILTER_NEAREST:
-	    surface->filter_params->fp_type = GLITZ_FP_COLORSPACE_YV12;
+	    switch (surface->format->color.fourcc) {
+	    case GLITZ_FOURCC_NV12:
+	    case GLITZ_FOURCC_P010:
+		surface->filter_params->fp_type = GLITZ_FP_COLORSPACE_NV12;
+		break;
+	    case GLITZ_FOURCC_YUY2:
+		surface->filter_params->fp_type = GLITZ_FP_COLORSPACE_YUY2;
+		break;
+	    case GLITZ_FOURCC_UYVY:
+		surface->filter_params->fp_type = GLITZ_FP_COLORSPACE_UYVY;
+		break;
+	    default:
+		/* I420 planes are uploaded in YV12 order */
+		surface->filter_params->fp_type = GLITZ_FP_COLORSPACE_YV12;
+	    }
 	    break;
 	default:
 	    surface->filter_params->fp_type = GLITZ_FP_UNSUPPORTED;
@@ -438,22 +492,61 @@ glitz_filter_set_type (glitz_surface_t *surface,
     }
 }
 
+/* Fragment programs take the parameters as program.local, fragment
+   shaders collect them for a single upload of the local array. */
+static void
+_glitz_filter_param (glitz_composite_op_t *op,
+		     glitz_vec4_t         *params,
+		     int                  i,
+		     glitz_float_t        *v)
+{
+    if (op->shader)
+	params[i] = *(glitz_vec4_t *) v;
+    else
+	op->gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, i, v);
+}
+
+#define GLITZ_FILTER_PARAMS 32
+
 void
 glitz_filter_enable (glitz_surface_t *surface,
 		     glitz_composite_op_t *op)
 {
     glitz_gl_proc_address_list_t *gl = op->gl;
-    int i;
+    glitz_vec4_t		 stack[GLITZ_FILTER_PARAMS];
+    glitz_vec4_t		 *params = stack;
+    int				 i, n = 0, count = 0;
+
+    if (op->shader)
+    {
+	gl->use_program (op->fp);
 
-    gl->enable (GLITZ_GL_FRAGMENT_PROGRAM);
-    gl->bind_program (GLITZ_GL_FRAGMENT_PROGRAM, op->fp);
+	/* at most two extra stops besides the parameters */
+	if (surface->filter_params->id + 4 > GLITZ_FILTER_PARAMS)
+	{
+	    params = malloc ((surface->filter_params->id + 4) *
+			     sizeof (glitz_vec4_t));
+	    if (!params)
+	    {
+		glitz_surface_status_add (op->dst,
+					  GLITZ_STATUS_NO_MEMORY_MASK);
+		return;
+	    }
+	}
+    }
+    else
+    {
+	glitz_state_enable (gl, GLITZ_GL_FRAGMENT_PROGRAM);
+	glitz_state_bind_program (gl, GLITZ_GL_FRAGMENT_PROGRAM, op->fp);
+    }
 
     switch (surface->filter) {
     case GLITZ_FILTER_GAUSSIAN:
     case GLITZ_FILTER_CONVOLUTION:
 	for (i = 0; i < surface->filter_params->id; i++)
-	    gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, i,
-					 surface->filter_params->vectors[i].v);
+	    _glitz_filter_param (op, params, i,
+				 surface->filter_params->vectors[i].v);
+	n = count = i;
 	break;
     case GLITZ_FILTER_LINEAR_GRADIENT:
     case GLITZ_FILTER_RADIAL_GRADIENT: {
@@ -462,19 +555,20 @@ glitz_filter_enable (glitz_surface_t *surface,
 
 	vec = surface->filter_params->vectors;
 
-	gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, 0, vec->v);
+	_glitz_filter_param (op, params, 0, vec->v);
 
 	vec++;
 
 	j = 1;
 	if (surface->filter == GLITZ_FILTER_RADIAL_GRADIENT)
 	{
-	    gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, j++,
-					 vec->v);
+	    _glitz_filter_param (op, params, j++, vec->v);
 
 	    vec++;
 	}
 
+	count = surface->filter_params->id;
+
 	if (fp_type == GLITZ_FP_LINEAR_GRADIENT_TRANSPARENT ||
 	    fp_type == GLITZ_FP_RADIAL_GRADIENT_TRANSPARENT) {
 	    glitz_vec4_t v;
@@ -483,12 +577,13 @@ glitz_filter_enable (glitz_surface_t *surface,
 	    v.v[2] = 0.0f;
 	    v.v[3] = (vec->v[3])? 1.0f / vec->v[3]: 1.0f;
 
-	    gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, j++, v.v);
+	    _glitz_filter_param (op, params, j++, v.v);
+
+	    count += 2;
 	}
 
 	for (i = 0; i < surface->filter_params->id; i++, vec++)
-	    gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM,
-					 i + j, vec->v);
+	    _glitz_filter_param (op, params, i + j, vec->v);
 
 	if (fp_type == GLITZ_FP_LINEAR_GRADIENT_TRANSPARENT ||
 	    fp_type == GLITZ_FP_RADIAL_GRADIENT_TRANSPARENT) {
@@ -497,24 +592,48 @@ glitz_filter_enable (glitz_surface_t *surface,
 	    v.v[0] = v.v[1] = -1.0f;
 	    v.v[2] = v.v[3] = 1.0f;
 
-	    gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM,
-					 i + j, v.v);
+	    _glitz_filter_param (op, params, i + j, v.v);
+
+	    i++;
 	}
+
+	n = i + j;
     } break;
     case GLITZ_FILTER_BILINEAR:
     case GLITZ_FILTER_NEAREST:
 	switch (surface->format->color.fourcc) {
-	case GLITZ_FOURCC_YV12: {
+	case GLITZ_FOURCC_YV12:
+	case GLITZ_FOURCC_I420:
+	case GLITZ_FOURCC_NV12:
+	case GLITZ_FOURCC_P010:
+	case GLITZ_FOURCC_YUY2:
+	case GLITZ_FOURCC_UYVY: {
 	    glitz_vec4_t *vec;
 
 	    vec = surface->filter_params->vectors;
 
-	    gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, 0,
-					 vec[0].v);
-	    gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, 1,
-					 vec[1].v);
+	    _glitz_filter_param (op, params, 0, vec[0].v);
+	    _glitz_filter_param (op, params, 1, vec[1].v);
+
+	    vec = _yuv_coefficients[surface->yuv_matrix];
+
+	    _glitz_filter_param (op, params, 2, vec[0].v);
+	    _glitz_filter_param (op, params, 3, vec[1].v);
+
+	    n = 4;
 	} break;
 	}
 	break;
     }
+
+    if (op->shader)
+    {
+	if (n)
+	    gl->uniform_4fv (op->shader->local, n, params[0].v);
+
+	gl->uniform_1i (op->shader->n, count);
+
+	if (params != stack)
+	    free (params);
+    }
 }
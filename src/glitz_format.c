@@ -55,8 +55,16 @@ static struct _texture_format {
     { GLITZ_GL_RGBA16,   { 0, { GLITZ_FOURCC_RGB, 16, 16, 16, 16 } } }
 };
 
-static glitz_format_t _texture_format_yv12 = {
-    0, { GLITZ_FOURCC_YV12,  0,  0,  0,  0 }
+/* planar 4:2:0 formats are stored as one luminance texture with the
+   chroma samples below the luma plane, packed 4:2:2 formats as one RGBA
+   texel for every two pixels */
+static struct _texture_format _texture_formats_yuv[] = {
+    { GLITZ_GL_LUMINANCE8,  { 0, { GLITZ_FOURCC_YV12, 0, 0, 0, 0 } } },
+    { GLITZ_GL_LUMINANCE8,  { 0, { GLITZ_FOURCC_I420, 0, 0, 0, 0 } } },
+    { GLITZ_GL_LUMINANCE8,  { 0, { GLITZ_FOURCC_NV12, 0, 0, 0, 0 } } },
+    { GLITZ_GL_LUMINANCE16, { 0, { GLITZ_FOURCC_P010, 0, 0, 0, 0 } } },
+    { GLITZ_GL_RGBA8,       { 0, { GLITZ_FOURCC_YUY2, 0, 0, 0, 0 } } },
+    { GLITZ_GL_RGBA8,       { 0, { GLITZ_FOURCC_UYVY, 0, 0, 0, 0 } } }
 };
 
 static void
@@ -145,8 +153,13 @@ glitz_create_surface_formats (glitz_gl_proc_address_list_t *gl,
     /* formats used for YUV surfaces */
     if (features & GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK)
     {
-	_glitz_add_texture_format (formats, texture_formats, n_formats,
-				   GLITZ_GL_LUMINANCE8, &_texture_format_yv12);
+	n_texture_formats =
+	    sizeof (_texture_formats_yuv) / sizeof (struct _texture_format);
+
+	for (i = 0; i < n_texture_formats; i++)
+	    _glitz_add_texture_format (formats, texture_formats, n_formats,
+				       _texture_formats_yuv[i].texture_format,
+				       &_texture_formats_yuv[i].format);
     }
 }
 
@@ -190,6 +203,7 @@ _glitz_add_drawable_formats (glitz_gl_proc_address_list_t *gl,
 	    { 0, { GLITZ_FOURCC_RGB, 8, 8, 8, 0 }, 24, 8, 1, 1, 32, GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN },
 	    { 0, { GLITZ_FOURCC_RGB, 8, 8, 8, 8 }, 24, 8, 1, 1, 32, GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN }
 	};
+	glitz_gl_int_t		    samples = 0;
 	int			    i;
 
 	format.types  = GLITZ_DRAWABLE_TYPE_FBO_MASK;
@@ -203,6 +217,22 @@ _glitz_add_drawable_formats (glitz_gl_proc_address_list_t *gl,
 
 	    _glitz_add_drawable_format (&format, formats, n_formats);
 	}
+
+	/* multisampled variants, resolved into the attached textures */
+	if (feature_mask & GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK)
+	    gl->get_integer_v (GLITZ_GL_MAX_SAMPLES, &samples);
+
+	if (samples > 1)
+	{
+	    for (i = 0; i < sizeof (d) / sizeof (d[0]); i++)
+	    {
+		format.d         = d[i];
+		format.d.id      = *n_formats;
+		format.d.samples = MIN (samples, 4);
+
+		_glitz_add_drawable_format (&format, formats, n_formats);
+	    }
+	}
     }
 }
 
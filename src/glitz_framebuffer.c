@@ -42,8 +42,83 @@ typedef struct _glitz_fbo_drawable {
     glitz_gl_uint_t  front_texture;
     glitz_gl_uint_t  back_texture;
     glitz_gl_enum_t  internal_format;
+    int              samples;
+    glitz_gl_uint_t  ms_fb;
+    glitz_gl_uint_t  ms_color[2];
 } glitz_fbo_drawable_t;
 
+/*
+  Multisampled drawables render into 'ms_fb', which holds multisampled
+  color, depth and stencil renderbuffers. 'fb' then only holds the
+  single sampled color buffers, usually the surface textures, that
+  'ms_fb' is resolved into before they are sampled or read.
+*/
+
+static void
+_glitz_fbo_renderbuffer_multisample (glitz_gl_proc_address_list_t *gl,
+				     glitz_fbo_drawable_t         *drawable,
+				     glitz_gl_uint_t              *name,
+				     glitz_gl_enum_t              format,
+				     glitz_gl_enum_t              attachment)
+{
+    if (!*name)
+	gl->gen_renderbuffers (1, name);
+
+    gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER, *name);
+    gl->renderbuffer_storage_multisample (GLITZ_GL_RENDERBUFFER,
+					  drawable->samples, format,
+					  drawable->base.width,
+					  drawable->base.height);
+    gl->bind_renderbuffer (GLITZ_GL_RENDERBUFFER, 0);
+
+    gl->framebuffer_renderbuffer (GLITZ_GL_FRAMEBUFFER, attachment,
+				  GLITZ_GL_RENDERBUFFER, *name);
+}
+
+static glitz_bool_t
+_glitz_fbo_bind_multisample (glitz_fbo_drawable_t *drawable,
+			     glitz_bool_t         update)
+{
+    GLITZ_GL_DRAWABLE (drawable->other);
+
+    if (!drawable->ms_fb)
+    {
+	gl->gen_framebuffers (1, &drawable->ms_fb);
+	update = 1;
+    }
+
+    gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, drawable->ms_fb);
+
+    if (update)
+    {
+	_glitz_fbo_renderbuffer_multisample (gl, drawable,
+					     &drawable->ms_color[0],
+					     drawable->internal_format,
+					     GLITZ_GL_COLOR_ATTACHMENT0);
+
+	if (drawable->base.format->d.doublebuffer)
+	    _glitz_fbo_renderbuffer_multisample (gl, drawable,
+						 &drawable->ms_color[1],
+						 drawable->internal_format,
+						 GLITZ_GL_COLOR_ATTACHMENT1);
+
+	if (drawable->base.format->d.depth_size)
+	    _glitz_fbo_renderbuffer_multisample (gl, drawable,
+						 &drawable->depth,
+						 GLITZ_GL_DEPTH_COMPONENT,
+						 GLITZ_GL_DEPTH_ATTACHMENT);
+
+	if (drawable->base.format->d.stencil_size)
+	    _glitz_fbo_renderbuffer_multisample (gl, drawable,
+						 &drawable->stencil,
+						 GLITZ_GL_STENCIL_INDEX,
+						 GLITZ_GL_STENCIL_ATTACHMENT);
+    }
+
+    return (gl->check_framebuffer_status (GLITZ_GL_FRAMEBUFFER) ==
+	    GLITZ_GL_FRAMEBUFFER_COMPLETE);
+}
+
 static glitz_bool_t
 _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
 {
@@ -140,7 +215,7 @@ _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
 	}
     }
 
-    if (update)
+    if (update && !drawable->samples)
     {
 	if (drawable->base.format->d.depth_size)
 	{
@@ -181,10 +256,76 @@ _glitz_fbo_bind (glitz_fbo_drawable_t *drawable)
     }
 
     status = gl->check_framebuffer_status (GLITZ_GL_FRAMEBUFFER);
-    if (status == GLITZ_GL_FRAMEBUFFER_COMPLETE)
-	return 1;
+    if (status != GLITZ_GL_FRAMEBUFFER_COMPLETE)
+	return 0;
 
-    return 0;
+    if (drawable->samples)
+	return _glitz_fbo_bind_multisample (drawable, update);
+
+    return 1;
+}
+
+static void
+_glitz_fbo_resolve_damage (glitz_fbo_drawable_t *drawable,
+			   glitz_surface_t      *surface)
+{
+    glitz_gl_enum_t attachment = GLITZ_GL_COLOR_ATTACHMENT0;
+    glitz_box_t     *box;
+    int             n_box, x1, y1, x2, y2;
+
+    GLITZ_GL_DRAWABLE (drawable->other);
+
+    if (surface->buffer == GLITZ_GL_BACK)
+	attachment = GLITZ_GL_COLOR_ATTACHMENT1;
+
+    if (GLITZ_REGION_NOTEMPTY (&surface->texture_damage))
+    {
+	box = GLITZ_REGION_RECTS (&surface->texture_damage);
+	n_box = GLITZ_REGION_NUM_RECTS (&surface->texture_damage);
+
+	gl->bind_framebuffer (GLITZ_GL_READ_FRAMEBUFFER, drawable->ms_fb);
+	gl->read_buffer (attachment);
+	gl->bind_framebuffer (GLITZ_GL_DRAW_FRAMEBUFFER, drawable->fb);
+	gl->draw_buffer (attachment);
+
+	glitz_state_disable (gl, GLITZ_GL_SCISSOR_TEST);
+
+	while (n_box--)
+	{
+	    x1 = surface->x + box->x1;
+	    x2 = surface->x + box->x2;
+	    y1 = drawable->base.height - surface->y - box->y2;
+	    y2 = drawable->base.height - surface->y - box->y1;
+
+	    gl->blit_framebuffer (x1, y1, x2, y2, x1, y1, x2, y2,
+				  GLITZ_GL_COLOR_BUFFER_BIT,
+				  GLITZ_GL_NEAREST);
+	    box++;
+	}
+
+	glitz_state_enable (gl, GLITZ_GL_SCISSOR_TEST);
+
+	GLITZ_REGION_EMPTY (&surface->texture_damage);
+
+	gl->bind_framebuffer (GLITZ_GL_DRAW_FRAMEBUFFER, drawable->ms_fb);
+    }
+
+    /* reads come from the resolved buffers until the next bind */
+    gl->bind_framebuffer (GLITZ_GL_READ_FRAMEBUFFER, drawable->fb);
+    gl->read_buffer (attachment);
+}
+
+void
+_glitz_fbo_resolve (glitz_surface_t *surface)
+{
+    glitz_fbo_drawable_t *drawable;
+
+    if (!surface->attached || !DRAWABLE_IS_FBO (surface->attached))
+	return;
+
+    drawable = (glitz_fbo_drawable_t *) surface->attached;
+    if (drawable->ms_fb)
+	_glitz_fbo_resolve_damage (drawable, surface);
 }
 
 static void
@@ -274,7 +415,7 @@ _glitz_fbo_push_current (void               *abstract_drawable,
 	if (_glitz_fbo_bind (drawable))
 	{
 	    drawable->base.update_all = drawable->other->update_all = 1;
-	    surface->fb = drawable->fb;
+	    surface->fb = (drawable->ms_fb) ? drawable->ms_fb : drawable->fb;
 	    return 1;
 	}
     }
@@ -329,6 +470,35 @@ _glitz_fbo_swap_buffers (void *abstract_drawable)
 	drawable->base.front->texture = drawable->base.back->texture;
 	drawable->base.back->texture  = tmp;
 
+	/* the multisampled buffers follow the textures they resolve into */
+	if (drawable->ms_fb)
+	{
+	    glitz_gl_uint_t name;
+
+	    GLITZ_GL_DRAWABLE (drawable->other);
+
+	    name = drawable->ms_color[0];
+	    drawable->ms_color[0] = drawable->ms_color[1];
+	    drawable->ms_color[1] = name;
+
+	    drawable->other->backend->push_current (drawable->other, NULL,
+						    GLITZ_ANY_CONTEXT_CURRENT,
+						    NULL);
+
+	    gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, drawable->ms_fb);
+	    gl->framebuffer_renderbuffer (GLITZ_GL_FRAMEBUFFER,
+					  GLITZ_GL_COLOR_ATTACHMENT0,
+					  GLITZ_GL_RENDERBUFFER,
+					  drawable->ms_color[0]);
+	    gl->framebuffer_renderbuffer (GLITZ_GL_FRAMEBUFFER,
+					  GLITZ_GL_COLOR_ATTACHMENT1,
+					  GLITZ_GL_RENDERBUFFER,
+					  drawable->ms_color[1]);
+	    gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, 0);
+
+	    drawable->other->backend->pop_current (drawable->other);
+	}
+
 	return 1;
     }
 
@@ -345,8 +515,8 @@ _glitz_fbo_copy_sub_buffer (void *abstract_drawable,
     return 0;
 }
 
-static void
-_glitz_fbo_destroy (void *abstract_drawable)
+void
+_glitz_fbo_drawable_free (glitz_drawable_t *abstract_drawable)
 {
     glitz_fbo_drawable_t *drawable = (glitz_fbo_drawable_t *)
 	abstract_drawable;
@@ -373,14 +543,51 @@ _glitz_fbo_destroy (void *abstract_drawable)
 	if (drawable->stencil)
 	    gl->delete_renderbuffers (1, &drawable->stencil);
 
+	if (drawable->ms_fb)
+	{
+	    gl->delete_framebuffers (1, &drawable->ms_fb);
+	    gl->delete_renderbuffers (drawable->ms_color[1] ? 2 : 1,
+				      drawable->ms_color);
+	}
+
 	drawable->other->backend->pop_current (drawable->other);
     }
 
-    glitz_drawable_destroy (drawable->other);
-
     free (drawable);
 }
 
+static void
+_glitz_fbo_destroy (void *abstract_drawable)
+{
+    glitz_fbo_drawable_t *drawable = (glitz_fbo_drawable_t *)
+	abstract_drawable;
+    glitz_drawable_t     *other = drawable->other;
+    unsigned long        size, samples = MAX (drawable->samples, 1);
+
+    /* renderbuffers owned by the framebuffer object, 4 bytes a sample */
+    size = sizeof (glitz_fbo_drawable_t) + sizeof (glitz_backend_t);
+    size += (unsigned long) drawable->base.width * drawable->base.height *
+	4 * ((drawable->front       ? 1 : 0) +
+	     (drawable->back        ? 1 : 0) +
+	     (drawable->ms_color[0] ? samples : 0) +
+	     (drawable->ms_color[1] ? samples : 0) +
+	     (drawable->depth       ? samples : 0) +
+	     (drawable->stencil     ? samples : 0));
+
+    /* park the framebuffer object in the pool of the drawable it was
+       created from, unless that drawable is about to go away too */
+    if (other->ref_count > 1 &&
+	glitz_pool_put_drawable (other, &drawable->base, size))
+    {
+	glitz_drawable_destroy (other);
+	return;
+    }
+
+    _glitz_fbo_drawable_free (&drawable->base);
+
+    glitz_drawable_destroy (other);
+}
+
 static void
 _glitz_fbo_draw_buffer (void                  *abstract_drawable,
 			const glitz_gl_enum_t buffer)
@@ -434,6 +641,17 @@ _glitz_fbo_drawable_create (glitz_drawable_t	        *other,
     glitz_fbo_drawable_t *drawable;
     glitz_backend_t	 *backend;
 
+    drawable = (glitz_fbo_drawable_t *)
+	glitz_pool_get_drawable (other, format, width, height);
+    if (drawable)
+    {
+	glitz_drawable_reference (other);
+	_glitz_drawable_init (&drawable->base, format, drawable->base.backend,
+			      width, height);
+
+	return &drawable->base;
+    }
+
     drawable = malloc (sizeof (glitz_fbo_drawable_t) +
 		       sizeof (glitz_backend_t));
     if (!drawable)
@@ -468,6 +686,16 @@ _glitz_fbo_drawable_create (glitz_drawable_t	        *other,
     drawable->front_texture = 0;
     drawable->back_texture  = 0;
 
+    drawable->ms_fb       = 0;
+    drawable->ms_color[0] = 0;
+    drawable->ms_color[1] = 0;
+
+    drawable->samples = 0;
+    if (format->d.samples > 1 &&
+	(other->backend->feature_mask &
+	 GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK))
+	drawable->samples = format->d.samples;
+
     /* XXX: temporary solution until we have proper format validation */
     if (format->d.color.alpha_size)
 	drawable->internal_format = GLITZ_GL_RGBA;
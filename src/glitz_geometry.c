@@ -45,6 +45,16 @@ _glitz_data_type (glitz_data_type_t type)
     }
 }
 
+static void
+_glitz_geometry_set_indices (glitz_surface_t *dst,
+			     glitz_buffer_t  *indices)
+{
+    glitz_buffer_reference (indices);
+    if (dst->geometry.indices)
+	glitz_buffer_destroy (dst->geometry.indices);
+    dst->geometry.indices = indices;
+}
+
 void
 glitz_set_geometry (glitz_surface_t         *dst,
 		    glitz_geometry_type_t   type,
@@ -121,6 +131,19 @@ glitz_set_geometry (glitz_surface_t         *dst,
 	    else
 		dst->geometry.u.v.mask.size = 1;
 	}
+
+	/* arrays select ranges of the index buffer instead of vertices */
+	if (format->vertex.attributes & GLITZ_VERTEX_ATTRIBUTE_INDEX_MASK)
+	{
+	    _glitz_geometry_set_indices (dst, format->vertex.index.buffer);
+
+	    if (format->vertex.index.type == GLITZ_DATA_TYPE_SHORT)
+		dst->geometry.u.v.index_type = GLITZ_GL_UNSIGNED_SHORT;
+	    else
+		dst->geometry.u.v.index_type = GLITZ_GL_UNSIGNED_INT;
+	}
+	else
+	    _glitz_geometry_set_indices (dst, NULL);
     } break;
     case GLITZ_GEOMETRY_TYPE_BITMAP:
 	glitz_buffer_reference (buffer);
@@ -153,6 +176,8 @@ glitz_set_geometry (glitz_surface_t         *dst,
 
 	dst->geometry.stride = format->bitmap.bytes_per_line;
 	dst->geometry.attributes = 0;
+
+	_glitz_geometry_set_indices (dst, NULL);
 	break;
     default:
 	dst->geometry.type = GLITZ_GEOMETRY_TYPE_NONE;
@@ -161,6 +186,8 @@ glitz_set_geometry (glitz_surface_t         *dst,
 
 	dst->geometry.buffer = NULL;
 	dst->geometry.attributes = 0;
+
+	_glitz_geometry_set_indices (dst, NULL);
 	break;
     }
 }
@@ -354,44 +381,225 @@ glitz_geometry_disable (glitz_surface_t *dst)
 	glitz_buffer_unbind (dst->geometry.buffer);
 }
 
+/*
+  Clip strategies. A single visible clip box is a scissor rectangle.
+  Plain rectangles are clipped against all boxes on the CPU and drawn
+  with one call. Other geometry is drawn once through a stencil mask
+  of the clip region when the drawable has a stencil buffer and
+  drawing it again for each box would cost more than writing the mask.
+  The mask is kept until the clip region or the surface changes.
+*/
+
+#define N_STACK_CLIP_BOX 16
+
+/* vertices worth as much as clearing one box in the stencil buffer */
+#define CLIP_STENCIL_BOX_COST 64
+
+static glitz_bool_t
+_glitz_clip_box (glitz_surface_t *dst,
+		 glitz_box_t     *clip,
+		 glitz_box_t     *bounds,
+		 glitz_box_t     *box)
+{
+    box->x1 = clip->x1 + dst->x_clip;
+    box->y1 = clip->y1 + dst->y_clip;
+    box->x2 = clip->x2 + dst->x_clip;
+    box->y2 = clip->y2 + dst->y_clip;
+    if (bounds->x1 > box->x1)
+	box->x1 = bounds->x1;
+    if (bounds->y1 > box->y1)
+	box->y1 = bounds->y1;
+    if (bounds->x2 < box->x2)
+	box->x2 = bounds->x2;
+    if (bounds->y2 < box->y2)
+	box->y2 = bounds->y2;
+
+    return (box->x1 < box->x2 && box->y1 < box->y2);
+}
+
+static int
+_glitz_clip_extents (glitz_surface_t *dst,
+		     glitz_box_t     *bounds,
+		     glitz_box_t     *extents)
+{
+    glitz_box_t *clip = dst->clip;
+    int         n_clip = dst->n_clip;
+    int         n = 0;
+    glitz_box_t box;
+
+    while (n_clip--)
+    {
+	if (_glitz_clip_box (dst, clip++, bounds, &box))
+	{
+	    if (n++)
+	    {
+		extents->x1 = MIN (extents->x1, box.x1);
+		extents->y1 = MIN (extents->y1, box.y1);
+		extents->x2 = MAX (extents->x2, box.x2);
+		extents->y2 = MAX (extents->y2, box.y2);
+	    }
+	    else
+		*extents = box;
+	}
+    }
+
+    return n;
+}
+
+static void
+_glitz_clip_scissor (glitz_gl_proc_address_list_t *gl,
+		     glitz_surface_t              *dst,
+		     glitz_box_t                  *box)
+{
+    glitz_state_scissor (gl, box->x1 + dst->x,
+			 dst->attached->height - dst->y - box->y2,
+			 box->x2 - box->x1, box->y2 - box->y1);
+}
+
+static void
+_glitz_clip_damage (glitz_surface_t *dst,
+		    glitz_box_t     *bounds,
+		    int             damage)
+{
+    glitz_box_t *clip = dst->clip;
+    int         n_clip = dst->n_clip;
+    glitz_box_t box;
+
+    while (n_clip--)
+    {
+	if (_glitz_clip_box (dst, clip++, bounds, &box))
+	    glitz_surface_damage (dst, &box, damage);
+    }
+}
+
+static glitz_bool_t
+_glitz_clip_stencil_begin (glitz_gl_proc_address_list_t *gl,
+			   glitz_surface_t              *dst,
+			   glitz_box_t                  *bounds,
+			   int                          size)
+{
+    glitz_drawable_t *drawable = dst->attached;
+    glitz_box_t      *clip = dst->clip;
+    int              n_clip = dst->n_clip;
+    glitz_box_t      box, extents;
+    int              n;
+
+    if (!drawable->format->d.stencil_size)
+	return 0;
+
+    n = _glitz_clip_extents (dst, bounds, &extents);
+    if (n < 2)
+	return 0;
+
+    if (drawable->stencil_clip != dst->clip_serial)
+    {
+	if ((n - 1) * size <= n_clip * CLIP_STENCIL_BOX_COST)
+	    return 0;
+
+	gl->clear_stencil (0);
+	_glitz_clip_scissor (gl, dst, &dst->box);
+	gl->clear (GLITZ_GL_STENCIL_BUFFER_BIT);
+
+	gl->clear_stencil (1);
+	while (n_clip--)
+	{
+	    if (_glitz_clip_box (dst, clip++, &dst->box, &box))
+	    {
+		_glitz_clip_scissor (gl, dst, &box);
+		gl->clear (GLITZ_GL_STENCIL_BUFFER_BIT);
+	    }
+	}
+
+	drawable->stencil_clip = dst->clip_serial;
+    }
+
+    _glitz_clip_scissor (gl, dst, &extents);
+
+    glitz_state_enable (gl, GLITZ_GL_STENCIL_TEST);
+    gl->stencil_func (GLITZ_GL_EQUAL, 1, 1);
+    gl->stencil_op (GLITZ_GL_KEEP, GLITZ_GL_KEEP, GLITZ_GL_KEEP);
+
+    return 1;
+}
+
+static void
+_glitz_clip_stencil_end (glitz_gl_proc_address_list_t *gl,
+			 glitz_surface_t              *dst,
+			 glitz_box_t                  *bounds,
+			 int                          damage)
+{
+    glitz_state_disable (gl, GLITZ_GL_STENCIL_TEST);
+
+    if (damage)
+	_glitz_clip_damage (dst, bounds, damage);
+}
+
 static void
 _glitz_draw_rectangle (glitz_gl_proc_address_list_t *gl,
 		       glitz_surface_t              *dst,
 		       glitz_box_t                  *bounds,
 		       int                          damage)
 {
-    glitz_box_t *clip = dst->clip;
-    int         n_clip = dst->n_clip;
-    glitz_box_t box;
+    glitz_box_t   *clip = dst->clip;
+    int           n_clip = dst->n_clip;
+    glitz_float_t stack_data[N_STACK_CLIP_BOX * 8];
+    glitz_float_t *data, *ptr = NULL;
+    glitz_box_t   box, extents;
+    int           n;
+
+    n = _glitz_clip_extents (dst, bounds, &extents);
+    if (n > 1)
+    {
+	data = stack_data;
+	if (n > N_STACK_CLIP_BOX)
+	    data = ptr = malloc (n * 8 * sizeof (glitz_float_t));
+
+	if (data)
+	{
+	    glitz_float_t *v = data;
+
+	    while (n_clip--)
+	    {
+		if (_glitz_clip_box (dst, clip++, bounds, &box))
+		{
+		    *v++ = (glitz_float_t) box.x1;
+		    *v++ = (glitz_float_t) box.y1;
+		    *v++ = (glitz_float_t) box.x2;
+		    *v++ = (glitz_float_t) box.y1;
+		    *v++ = (glitz_float_t) box.x2;
+		    *v++ = (glitz_float_t) box.y2;
+		    *v++ = (glitz_float_t) box.x1;
+		    *v++ = (glitz_float_t) box.y2;
+
+		    if (damage)
+			glitz_surface_damage (dst, &box, damage);
+		}
+	    }
+
+	    _glitz_clip_scissor (gl, dst, &extents);
+
+	    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, data);
+	    gl->draw_arrays (GLITZ_GL_QUADS, 0, n << 2);
+	    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 0, dst->geometry.data);
+
+	    if (ptr)
+		free (ptr);
+
+	    return;
+	}
+    }
 
     while (n_clip--)
     {
-	box.x1 = clip->x1 + dst->x_clip;
-	box.y1 = clip->y1 + dst->y_clip;
-	box.x2 = clip->x2 + dst->x_clip;
-	box.y2 = clip->y2 + dst->y_clip;
-	if (bounds->x1 > box.x1)
-	    box.x1 = bounds->x1;
-	if (bounds->y1 > box.y1)
-	    box.y1 = bounds->y1;
-	if (bounds->x2 < box.x2)
-	    box.x2 = bounds->x2;
-	if (bounds->y2 < box.y2)
-	    box.y2 = bounds->y2;
-
-	if (box.x1 < box.x2 && box.y1 < box.y2)
+	if (_glitz_clip_box (dst, clip++, bounds, &box))
 	{
-	    gl->scissor (box.x1 + dst->x,
-			 dst->attached->height - dst->y - box.y2,
-			 box.x2 - box.x1, box.y2 - box.y1);
+	    _glitz_clip_scissor (gl, dst, &box);
 
 	    gl->draw_arrays (GLITZ_GL_QUADS, 0, 4);
 
 	    if (damage)
 		glitz_surface_damage (dst, &box, damage);
 	}
-
-	clip++;
     }
 }
 
@@ -399,6 +607,263 @@ _glitz_draw_rectangle (glitz_gl_proc_address_list_t *gl,
     ((surface)->drawable->backend->feature_mask &       \
      GLITZ_FEATURE_MULTI_DRAW_ARRAYS_MASK)
 
+/* The geometry offset translates the modelview matrix in the fixed
+   function pipeline and is a program parameter with a vertex program. */
+static void
+_glitz_geometry_push_offset (glitz_gl_proc_address_list_t *gl,
+			     glitz_surface_t              *dst)
+{
+    if (dst->geometry.tex_gen < 0)
+    {
+	gl->push_matrix ();
+
+	if (dst->geometry.off.v[0] || dst->geometry.off.v[1])
+	    gl->translate_f (dst->geometry.off.v[0],
+			     dst->geometry.off.v[1], 0.0f);
+    }
+    else
+    {
+	dst->geometry.vp_off.v[0] = dst->geometry.off.v[0];
+	dst->geometry.vp_off.v[1] = dst->geometry.off.v[1];
+	dst->geometry.vp_off.v[2] = dst->geometry.vp_off.v[3] = 0.0f;
+
+	gl->program_env_param_4fv (GLITZ_GL_VERTEX_PROGRAM,
+				   GLITZ_VP_ENV_OFFSET,
+				   dst->geometry.vp_off.v);
+    }
+}
+
+static void
+_glitz_geometry_translate (glitz_gl_proc_address_list_t *gl,
+			   glitz_surface_t              *dst,
+			   glitz_float_t                x,
+			   glitz_float_t                y)
+{
+    if (dst->geometry.tex_gen < 0)
+    {
+	gl->translate_f (x, y, 0.0f);
+    }
+    else if (x || y)
+    {
+	dst->geometry.vp_off.v[0] += x;
+	dst->geometry.vp_off.v[1] += y;
+
+	gl->program_env_param_4fv (GLITZ_GL_VERTEX_PROGRAM,
+				   GLITZ_VP_ENV_OFFSET,
+				   dst->geometry.vp_off.v);
+    }
+}
+
+static void
+_glitz_geometry_pop_offset (glitz_gl_proc_address_list_t *gl,
+			    glitz_surface_t              *dst)
+{
+    if (dst->geometry.tex_gen < 0)
+	gl->pop_matrix ();
+}
+
+#define OFFSET_ATTRIB 6
+
+/* Draws all arrays with one call when the offset of each array can be
+   passed as a vertex attribute. That needs the composite vertex program
+   and arrays that use separate, ascending vertex ranges. */
+static glitz_bool_t
+_glitz_draw_offset_arrays (glitz_gl_proc_address_list_t *gl,
+			   glitz_surface_t              *dst,
+			   glitz_multi_array_t          *array)
+{
+    glitz_float_t   *offsets, *v, x = 0.0f, y = 0.0f;
+    glitz_gl_uint_t vp;
+    int             i, j, end = 0, n_spans = 0;
+
+    if (dst->geometry.tex_gen < 0 || !MULTI_DRAW_ARRAYS (dst))
+	return 0;
+
+    for (i = 0; i < array->n_arrays; i++)
+    {
+	if (array->span[i])
+	    n_spans++;
+
+	if (array->count[i])
+	{
+	    if (array->first[i] < end)
+		return 0;
+
+	    end = array->first[i] + array->count[i];
+	}
+    }
+
+    if (n_spans < 2)
+	return 0;
+
+    vp = glitz_get_vertex_program (dst, dst->geometry.tex_gen |
+				   GLITZ_VP_OFFSET_ATTRIB);
+    if (!vp)
+	return 0;
+
+    offsets = malloc (end * 2 * sizeof (glitz_float_t));
+    if (!offsets)
+	return 0;
+
+    for (i = 0; i < array->n_arrays; i++)
+    {
+	if (array->span[i])
+	{
+	    x += array->off[i].v[0];
+	    y += array->off[i].v[1];
+	}
+
+	v = offsets + array->first[i] * 2;
+	for (j = 0; j < array->count[i]; j++)
+	{
+	    *v++ = x;
+	    *v++ = y;
+	}
+    }
+
+    glitz_state_bind_program (gl, GLITZ_GL_VERTEX_PROGRAM, vp);
+
+    /* the offsets live in client memory */
+    if (dst->geometry.buffer && dst->geometry.buffer->name)
+	gl->bind_buffer (GLITZ_GL_ARRAY_BUFFER, 0);
+
+    gl->enable_vertex_attrib_array (OFFSET_ATTRIB);
+    gl->vertex_attrib_pointer (OFFSET_ATTRIB, 2, GLITZ_GL_FLOAT,
+			       GLITZ_GL_FALSE, 0, offsets);
+
+    gl->multi_draw_arrays (dst->geometry.u.v.prim,
+			   array->first, array->count, array->n_arrays);
+
+    gl->disable_vertex_attrib_array (OFFSET_ATTRIB);
+
+    glitz_state_bind_program (gl, GLITZ_GL_VERTEX_PROGRAM,
+			      glitz_get_vertex_program (dst,
+							dst->geometry.tex_gen));
+
+    free (offsets);
+
+    return 1;
+}
+
+#define N_STACK_INDEX_ARRAYS 64
+
+static void
+_glitz_draw_indexed_arrays (glitz_gl_proc_address_list_t *gl,
+			    glitz_surface_t              *dst)
+{
+    glitz_multi_array_t    *array = dst->geometry.array;
+    glitz_gl_enum_t        type = dst->geometry.u.v.index_type;
+    const glitz_gl_void_t  *stack_indices[N_STACK_INDEX_ARRAYS];
+    const glitz_gl_void_t  **indices;
+    unsigned char          *base;
+    int                    i, j, size;
+
+    size = (type == GLITZ_GL_UNSIGNED_SHORT) ? 2 : 4;
+    base = glitz_buffer_bind (dst->geometry.indices,
+			      GLITZ_GL_ELEMENT_ARRAY_BUFFER);
+
+    if (array)
+    {
+	for (i = 0; i < array->n_arrays;)
+	{
+	    _glitz_geometry_translate (gl, dst, array->off[i].v[0],
+				       array->off[i].v[1]);
+
+	    indices = NULL;
+	    if (MULTI_DRAW_ARRAYS (dst))
+	    {
+		indices = stack_indices;
+		if (array->span[i] > N_STACK_INDEX_ARRAYS)
+		    indices = malloc (array->span[i] *
+				      sizeof (glitz_gl_void_t *));
+	    }
+
+	    if (indices)
+	    {
+		for (j = 0; j < array->span[i]; j++)
+		    indices[j] = base + array->first[i + j] * size;
+
+		gl->multi_draw_elements (dst->geometry.u.v.prim,
+					 &array->count[i], type,
+					 indices, array->span[i]);
+
+		if (indices != stack_indices)
+		    free (indices);
+
+		i += array->span[i];
+	    }
+	    else
+	    {
+		do {
+		    if (array->count[i])
+			gl->draw_elements (dst->geometry.u.v.prim,
+					   array->count[i], type,
+					   base + array->first[i] * size);
+
+		} while (array->span[++i] == 0);
+	    }
+	}
+    } else
+	gl->draw_elements (dst->geometry.u.v.prim,
+			   dst->geometry.count, type,
+			   base + dst->geometry.first * size);
+
+    glitz_buffer_unbind (dst->geometry.indices);
+}
+
+static void
+_glitz_draw_vertex_arrays_once (glitz_gl_proc_address_list_t *gl,
+				glitz_surface_t              *dst)
+{
+    glitz_multi_array_t *array = dst->geometry.array;
+    int                 i;
+
+    _glitz_geometry_push_offset (gl, dst);
+
+    if (dst->geometry.indices)
+    {
+	_glitz_draw_indexed_arrays (gl, dst);
+    }
+    else if (array)
+    {
+	if (_glitz_draw_offset_arrays (gl, dst, array))
+	{
+	    _glitz_geometry_pop_offset (gl, dst);
+	    return;
+	}
+
+	for (i = 0; i < array->n_arrays;)
+	{
+	    _glitz_geometry_translate (gl, dst, array->off[i].v[0],
+				       array->off[i].v[1]);
+
+	    if (MULTI_DRAW_ARRAYS (dst))
+	    {
+		gl->multi_draw_arrays (dst->geometry.u.v.prim,
+				       &array->first[i],
+				       &array->count[i],
+				       array->span[i]);
+		i += array->span[i];
+	    }
+	    else
+	    {
+		do {
+		    if (array->count[i])
+			gl->draw_arrays (dst->geometry.u.v.prim,
+					 array->first[i],
+					 array->count[i]);
+
+		} while (array->span[++i] == 0);
+	    }
+	}
+    } else
+	gl->draw_arrays (dst->geometry.u.v.prim,
+			 dst->geometry.first,
+			 dst->geometry.count);
+
+    _glitz_geometry_pop_offset (gl, dst);
+}
+
 static void
 _glitz_draw_vertex_arrays (glitz_gl_proc_address_list_t *gl,
 			   glitz_surface_t              *dst,
@@ -407,74 +872,35 @@ _glitz_draw_vertex_arrays (glitz_gl_proc_address_list_t *gl,
 {
     glitz_multi_array_t *array = dst->geometry.array;
     glitz_box_t         *clip = dst->clip;
-    int                 i, n_clip = dst->n_clip;
+    int                 i, size, n_clip = dst->n_clip;
     glitz_box_t         box;
 
-    while (n_clip--)
+    if (array)
     {
-	box.x1 = clip->x1 + dst->x_clip;
-	box.y1 = clip->y1 + dst->y_clip;
-	box.x2 = clip->x2 + dst->x_clip;
-	box.y2 = clip->y2 + dst->y_clip;
-	if (bounds->x1 > box.x1)
-	    box.x1 = bounds->x1;
-	if (bounds->y1 > box.y1)
-	    box.y1 = bounds->y1;
-	if (bounds->x2 < box.x2)
-	    box.x2 = bounds->x2;
-	if (bounds->y2 < box.y2)
-	    box.y2 = bounds->y2;
-
-	if (box.x1 < box.x2 && box.y1 < box.y2)
-	{
-	    gl->scissor (box.x1 + dst->x,
-			 dst->attached->height - dst->y - box.y2,
-			 box.x2 - box.x1, box.y2 - box.y1);
-
-	    gl->push_matrix ();
+	for (size = 0, i = 0; i < array->n_arrays; i++)
+	    size += array->count[i];
+    }
+    else
+	size = dst->geometry.count;
 
-	    if (dst->geometry.off.v[0] || dst->geometry.off.v[1])
-		gl->translate_f (dst->geometry.off.v[0],
-				 dst->geometry.off.v[1], 0.0f);
+    if (_glitz_clip_stencil_begin (gl, dst, bounds, size))
+    {
+	_glitz_draw_vertex_arrays_once (gl, dst);
+	_glitz_clip_stencil_end (gl, dst, bounds, damage);
+	return;
+    }
 
-	    if (array)
-	    {
-		for (i = 0; i < array->n_arrays;)
-		{
-		    gl->translate_f (array->off[i].v[0],
-				     array->off[i].v[1], 0.0f);
-
-		    if (MULTI_DRAW_ARRAYS (dst))
-		    {
-			gl->multi_draw_arrays (dst->geometry.u.v.prim,
-					       &array->first[i],
-					       &array->count[i],
-					       array->span[i]);
-			i += array->span[i];
-		    }
-		    else
-		    {
-			do {
-			    if (array->count[i])
-				gl->draw_arrays (dst->geometry.u.v.prim,
-						 array->first[i],
-						 array->count[i]);
-
-			} while (array->span[++i] == 0);
-		    }
-		}
-	    } else
-		gl->draw_arrays (dst->geometry.u.v.prim,
-				 dst->geometry.first,
-				 dst->geometry.count);
+    while (n_clip--)
+    {
+	if (_glitz_clip_box (dst, clip++, bounds, &box))
+	{
+	    _glitz_clip_scissor (gl, dst, &box);
 
-	    gl->pop_matrix ();
+	    _glitz_draw_vertex_arrays_once (gl, dst);
 
 	    if (damage)
 		glitz_surface_damage (dst, &box, damage);
 	}
-
-	clip++;
     }
 }
 
@@ -511,8 +937,69 @@ _glitz_draw_vertex_arrays (glitz_gl_proc_address_list_t *gl,
 	(_b_off) = 0;                                                   \
     }
 
-/* TODO: clipping could be done without glScissor, that might be
-   faster. Other then solid colors can be used if bitmap fits into a
+static void
+_glitz_draw_bitmaps_once (glitz_gl_proc_address_list_t *gl,
+			  glitz_surface_t              *dst,
+			  glitz_gl_ubyte_t             *bitmap,
+			  int                          *pixel_offset)
+{
+    glitz_multi_array_t *array = dst->geometry.array;
+    int                 n, i;
+    int                 y, w, h, min_stride, dst_stride, src_stride;
+    glitz_gl_ubyte_t    *base;
+    int                 byte_offset;
+    glitz_float_t       x_off, y_off;
+
+    x_off = dst->x + dst->geometry.off.v[0];
+    y_off = dst->y + dst->geometry.off.v[1];
+
+    if (array)
+    {
+	x_off += array->off->v[0];
+	y_off += array->off->v[1];
+
+	glitz_set_raster_pos (gl, x_off,
+			      dst->attached->height - y_off);
+
+	for (i = 0, n = array->n_arrays; n--; i++)
+	{
+	    if (n)
+	    {
+		x_off = array->off[i + 1].v[0];
+		y_off = array->off[i + 1].v[1];
+	    }
+
+	    BITMAP_SETUP (dst,
+			  array->first[i],
+			  array->sizes[i],
+			  array->count[i],
+			  w, h, byte_offset, *pixel_offset);
+
+	    gl->bitmap (w, h,
+			0.0f, (glitz_gl_float_t) array->count[i],
+			x_off, -y_off,
+			bitmap + byte_offset);
+	}
+    }
+    else
+    {
+	glitz_set_raster_pos (gl, x_off,
+			      dst->attached->height - y_off);
+
+	BITMAP_SETUP (dst,
+		      dst->geometry.first,
+		      dst->geometry.size,
+		      dst->geometry.count,
+		      w, h, byte_offset, *pixel_offset);
+
+	gl->bitmap (w, h,
+		    0.0f, (glitz_gl_float_t) dst->geometry.count,
+		    0.0f, 0.0f,
+		    bitmap + byte_offset);
+    }
+}
+
+/* TODO: Other then solid colors can be used if bitmap fits into a
    stipple pattern. Maybe we should add a repeat parameter to
    glitz_bitmap_format_t as 2, 4, 8, 16 and 32 sized bitmaps can be tiled.
 */
@@ -525,12 +1012,11 @@ _glitz_draw_bitmap_arrays (glitz_gl_proc_address_list_t *gl,
     glitz_multi_array_t *array = dst->geometry.array;
     glitz_box_t         *clip = dst->clip;
     int                 n, i, n_clip = dst->n_clip;
-    int                 x, y, w, h, min_stride, dst_stride, src_stride;
+    int                 x, w;
     glitz_gl_ubyte_t    *heap_bitmap = NULL;
     glitz_gl_ubyte_t    stack_bitmap[N_STACK_BITMAP];
-    glitz_gl_ubyte_t    *base, *bitmap = dst->geometry.u.b.base;
-    int                 byte_offset, pixel_offset = 0;
-    glitz_float_t       x_off, y_off;
+    glitz_gl_ubyte_t    *bitmap = dst->geometry.u.b.base;
+    int                 pixel_offset = 0;
     glitz_box_t         box;
 
     if (dst->geometry.u.b.top_down)
@@ -579,80 +1065,27 @@ _glitz_draw_bitmap_arrays (glitz_gl_proc_address_list_t *gl,
 			   dst->geometry.stride * 8);
     }
 
-    while (n_clip--)
+    /* each bitmap costs about as much as a quad */
+    if (_glitz_clip_stencil_begin (gl, dst, bounds,
+				   (array) ? array->n_arrays << 2 : 4))
+    {
+	_glitz_draw_bitmaps_once (gl, dst, bitmap, &pixel_offset);
+	_glitz_clip_stencil_end (gl, dst, bounds, damage);
+    }
+    else
     {
-	box.x1 = clip->x1 + dst->x_clip;
-	box.y1 = clip->y1 + dst->y_clip;
-	box.x2 = clip->x2 + dst->x_clip;
-	box.y2 = clip->y2 + dst->y_clip;
-	if (bounds->x1 > box.x1)
-	    box.x1 = bounds->x1;
-	if (bounds->y1 > box.y1)
-	    box.y1 = bounds->y1;
-	if (bounds->x2 < box.x2)
-	    box.x2 = bounds->x2;
-	if (bounds->y2 < box.y2)
-	    box.y2 = bounds->y2;
-
-	if (box.x1 < box.x2 && box.y1 < box.y2)
+	while (n_clip--)
 	{
-	    gl->scissor (box.x1 + dst->x,
-			 dst->attached->height - dst->y - box.y2,
-			 box.x2 - box.x1, box.y2 - box.y1);
-
-	    x_off = dst->x + dst->geometry.off.v[0];
-	    y_off = dst->y + dst->geometry.off.v[1];
-
-	    if (array)
+	    if (_glitz_clip_box (dst, clip++, bounds, &box))
 	    {
-		x_off += array->off->v[0];
-		y_off += array->off->v[1];
+		_glitz_clip_scissor (gl, dst, &box);
 
-		glitz_set_raster_pos (gl, x_off,
-				      dst->attached->height - y_off);
+		_glitz_draw_bitmaps_once (gl, dst, bitmap, &pixel_offset);
 
-		for (i = 0, n = array->n_arrays; n--; i++)
-		{
-		    if (n)
-		    {
-			x_off = array->off[i + 1].v[0];
-			y_off = array->off[i + 1].v[1];
-		    }
-
-		    BITMAP_SETUP (dst,
-				  array->first[i],
-				  array->sizes[i],
-				  array->count[i],
-				  w, h, byte_offset, pixel_offset);
-
-		    gl->bitmap (w, h,
-				0.0f, (glitz_gl_float_t) array->count[i],
-				x_off, -y_off,
-				bitmap + byte_offset);
-		}
+		if (damage)
+		    glitz_surface_damage (dst, &box, damage);
 	    }
-	    else
-	    {
-		glitz_set_raster_pos (gl, x_off,
-				      dst->attached->height - y_off);
-
-		BITMAP_SETUP (dst,
-			      dst->geometry.first,
-			      dst->geometry.size,
-			      dst->geometry.count,
-			      w, h, byte_offset, pixel_offset);
-
-		gl->bitmap (w, h,
-			    0.0f, (glitz_gl_float_t) dst->geometry.count,
-			    0.0f, 0.0f,
-			    bitmap + byte_offset);
-	    }
-
-	    if (damage)
-		glitz_surface_damage (dst, &box, damage);
 	}
-
-	clip++;
     }
 
     if (heap_bitmap)
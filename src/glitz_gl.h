@@ -50,8 +50,15 @@ typedef unsigned int glitz_gl_bitfield_t;
 typedef double glitz_gl_clampd_t;
 typedef float glitz_gl_clampf_t;
 typedef unsigned char glitz_gl_ubyte_t;
+typedef char glitz_gl_char_t;
 typedef ptrdiff_t glitz_gl_intptr_t;
 typedef ptrdiff_t glitz_gl_sizeiptr_t;
+typedef struct _glitz_gl_sync *glitz_gl_sync_t;
+#ifdef _MSC_VER
+typedef unsigned __int64 glitz_gl_uint64_t;
+#else
+typedef unsigned long long glitz_gl_uint64_t;
+#endif
 
 
 #define GLITZ_GL_FALSE 0x0
@@ -66,6 +73,8 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_EXTENSIONS                  0x1F03
 
 #define GLITZ_GL_UNSIGNED_BYTE               0x1401
+#define GLITZ_GL_UNSIGNED_SHORT              0x1403
+#define GLITZ_GL_UNSIGNED_INT                0x1405
 #define GLITZ_GL_UNSIGNED_BYTE_3_3_2         0x8032
 #define GLITZ_GL_UNSIGNED_BYTE_2_3_3_REV     0x8362
 #define GLITZ_GL_UNSIGNED_SHORT_5_6_5        0x8363
@@ -217,6 +226,7 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_ALPHA12    0x803D
 #define GLITZ_GL_ALPHA16    0x803E
 #define GLITZ_GL_LUMINANCE8 0x8040
+#define GLITZ_GL_LUMINANCE16 0x8042
 #define GLITZ_GL_R3_G3_B2   0x2A10
 #define GLITZ_GL_RGB4       0x804F
 #define GLITZ_GL_RGB5       0x8050
@@ -281,6 +291,7 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_MULTISAMPLE_FILTER_HINT 0x8534
 
 #define GLITZ_GL_FRAGMENT_PROGRAM                    0x8804
+#define GLITZ_GL_VERTEX_PROGRAM                      0x8620
 #define GLITZ_GL_PROGRAM_STRING                      0x8628
 #define GLITZ_GL_PROGRAM_FORMAT_ASCII                0x8875
 #define GLITZ_GL_PROGRAM_ERROR_POSITION              0x864B
@@ -307,7 +318,12 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_MAX_PROGRAM_NATIVE_TEX_INSTRUCTIONS 0x880F
 #define GLITZ_GL_MAX_PROGRAM_NATIVE_TEX_INDIRECTIONS 0x8810
 
+#define GLITZ_GL_FRAGMENT_SHADER 0x8B30
+#define GLITZ_GL_COMPILE_STATUS  0x8B81
+#define GLITZ_GL_LINK_STATUS     0x8B82
+
 #define GLITZ_GL_ARRAY_BUFFER         0x8892
+#define GLITZ_GL_ELEMENT_ARRAY_BUFFER 0x8893
 #define GLITZ_GL_PIXEL_PACK_BUFFER    0x88EB
 #define GLITZ_GL_PIXEL_UNPACK_BUFFER  0x88EC
 
@@ -351,6 +367,19 @@ typedef ptrdiff_t glitz_gl_sizeiptr_t;
 #define GLITZ_GL_RENDERBUFFER_DEPTH_SIZE   0x8D54
 #define GLITZ_GL_RENDERBUFFER_STENCIL_SIZE 0x8D55
 
+#define GLITZ_GL_READ_FRAMEBUFFER 0x8CA8
+#define GLITZ_GL_DRAW_FRAMEBUFFER 0x8CA9
+#define GLITZ_GL_MAX_SAMPLES      0x8D57
+
+#define GLITZ_GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GLITZ_GL_SYNC_FLUSH_COMMANDS_BIT    0x00000001
+#define GLITZ_GL_ALREADY_SIGNALED           0x911A
+#define GLITZ_GL_TIMEOUT_EXPIRED            0x911B
+#define GLITZ_GL_CONDITION_SATISFIED        0x911C
+#define GLITZ_GL_WAIT_FAILED                0x911D
+
+#define GLITZ_GL_ALL_COMPLETED_NV 0x84F2
+
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_enable_t)
      (glitz_gl_enum_t cap);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_disable_t)
@@ -371,9 +400,16 @@ typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_tex_coord_pointer_t)
       const glitz_gl_void_t *ptr);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_draw_arrays_t)
      (glitz_gl_enum_t mode, glitz_gl_int_t first, glitz_gl_sizei_t count);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_draw_elements_t)
+     (glitz_gl_enum_t mode, glitz_gl_sizei_t count, glitz_gl_enum_t type,
+      const glitz_gl_void_t *indices);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_multi_draw_arrays_t)
      (glitz_gl_enum_t mode, glitz_gl_int_t *first, glitz_gl_sizei_t *count,
       glitz_gl_sizei_t primcount);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_multi_draw_elements_t)
+     (glitz_gl_enum_t mode, const glitz_gl_sizei_t *count,
+      glitz_gl_enum_t type, const glitz_gl_void_t **indices,
+      glitz_gl_sizei_t primcount);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_tex_env_f_t)
      (glitz_gl_enum_t target, glitz_gl_enum_t pname, glitz_gl_float_t param);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_tex_env_fv_t)
@@ -529,8 +565,46 @@ typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_bind_program_t)
      (glitz_gl_enum_t, glitz_gl_uint_t);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_program_local_param_4fv_t)
      (glitz_gl_enum_t, glitz_gl_uint_t, const glitz_gl_float_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_program_env_param_4fv_t)
+     (glitz_gl_enum_t, glitz_gl_uint_t, const glitz_gl_float_t *);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_get_program_iv_t)
      (glitz_gl_enum_t, glitz_gl_enum_t, glitz_gl_int_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_vertex_attrib_pointer_t)
+     (glitz_gl_uint_t, glitz_gl_int_t, glitz_gl_enum_t, glitz_gl_boolean_t,
+      glitz_gl_sizei_t, const glitz_gl_void_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_enable_vertex_attrib_array_t)
+     (glitz_gl_uint_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_disable_vertex_attrib_array_t)
+     (glitz_gl_uint_t);
+typedef glitz_gl_uint_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_create_shader_t)
+     (glitz_gl_enum_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_shader_source_t)
+     (glitz_gl_uint_t, glitz_gl_sizei_t, const glitz_gl_char_t **,
+      const glitz_gl_int_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_compile_shader_t)
+     (glitz_gl_uint_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_get_shader_iv_t)
+     (glitz_gl_uint_t, glitz_gl_enum_t, glitz_gl_int_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_delete_shader_t)
+     (glitz_gl_uint_t);
+typedef glitz_gl_uint_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_create_program_t)
+     (glitz_gl_void_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_attach_shader_t)
+     (glitz_gl_uint_t, glitz_gl_uint_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_link_program_t)
+     (glitz_gl_uint_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_get_program_object_iv_t)
+     (glitz_gl_uint_t, glitz_gl_enum_t, glitz_gl_int_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_use_program_t)
+     (glitz_gl_uint_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_delete_program_t)
+     (glitz_gl_uint_t);
+typedef glitz_gl_int_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_get_uniform_location_t)
+     (glitz_gl_uint_t, const glitz_gl_char_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_uniform_1i_t)
+     (glitz_gl_int_t, glitz_gl_int_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_uniform_4fv_t)
+     (glitz_gl_int_t, glitz_gl_sizei_t, const glitz_gl_float_t *);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_gen_buffers_t)
      (glitz_gl_sizei_t, glitz_gl_uint_t *buffers);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_delete_buffers_t)
@@ -574,5 +648,29 @@ typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_renderbuffer_storage_
      (glitz_gl_enum_t, glitz_gl_enum_t, glitz_gl_sizei_t, glitz_gl_sizei_t);
 typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_get_renderbuffer_parameter_iv_t)
      (glitz_gl_enum_t, glitz_gl_enum_t, glitz_gl_int_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_renderbuffer_storage_multisample_t)
+     (glitz_gl_enum_t, glitz_gl_sizei_t, glitz_gl_enum_t,
+      glitz_gl_sizei_t, glitz_gl_sizei_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_blit_framebuffer_t)
+     (glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t,
+      glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t, glitz_gl_int_t,
+      glitz_gl_bitfield_t, glitz_gl_enum_t);
+
+typedef glitz_gl_sync_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_fence_sync_t)
+     (glitz_gl_enum_t, glitz_gl_bitfield_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_delete_sync_t)
+     (glitz_gl_sync_t);
+typedef glitz_gl_enum_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_client_wait_sync_t)
+     (glitz_gl_sync_t, glitz_gl_bitfield_t, glitz_gl_uint64_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_gen_fences_t)
+     (glitz_gl_sizei_t, glitz_gl_uint_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_delete_fences_t)
+     (glitz_gl_sizei_t, const glitz_gl_uint_t *);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_set_fence_t)
+     (glitz_gl_uint_t, glitz_gl_enum_t);
+typedef glitz_gl_boolean_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_test_fence_t)
+     (glitz_gl_uint_t);
+typedef glitz_gl_void_t (GLITZ_GL_API_ATTRIBUTE * glitz_gl_finish_fence_t)
+     (glitz_gl_uint_t);
 
 #endif /* GLITZ_GL_H_INCLUDED */
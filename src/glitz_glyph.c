@@ -0,0 +1,660 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#define GLITZ_GLYPH_HASH_SIZE_MIN 64
+#define GLITZ_GLYPH_SHELF_ROUND   4
+#define GLITZ_GLYPH_FLOATS_PER_VERTEX 4
+
+typedef struct _glitz_glyph_span {
+    int x1, x2;
+} glitz_glyph_span_t;
+
+/* A shelf is a horizontal strip of the atlas. Free space within the
+   strip is kept as a list of spans sorted by x. */
+typedef struct _glitz_glyph_shelf {
+    int                y, height;
+    glitz_glyph_span_t *spans;
+    int                n_spans, size;
+} glitz_glyph_shelf_t;
+
+typedef struct _glitz_glyph_entry glitz_glyph_entry_t;
+
+struct _glitz_glyph_entry {
+    unsigned long       id;
+    int                 x_origin, y_origin;
+    glitz_box_t         box;
+    int                 shelf;
+    glitz_glyph_entry_t *next;
+    glitz_glyph_entry_t *lru_prev, *lru_next;
+};
+
+struct _glitz_glyph_cache {
+    glitz_surface_t     *surface;
+    glitz_bool_t        color;
+    int                 width, height;
+
+    glitz_glyph_shelf_t *shelves;
+    int                 n_shelves, size;
+    int                 top;
+
+    glitz_glyph_entry_t **hash;
+    int                 hash_size;
+    int                 n_glyphs;
+
+    /* most recently used glyph first */
+    glitz_glyph_entry_t *lru_head, *lru_tail;
+
+    glitz_float_t       *vertices;
+    int                 n_vertices;
+};
+
+#define GLYPH_HASH(cache, id)                                   \
+    (((id) ^ ((id) >> 11) ^ ((id) >> 21)) & ((cache)->hash_size - 1))
+
+glitz_glyph_cache_t *
+glitz_glyph_cache_create (glitz_drawable_t *drawable,
+			  glitz_format_t   *format,
+			  int              width,
+			  int              height)
+{
+    glitz_glyph_cache_t *cache;
+
+    if (width <= 0 || height <= 0)
+	return NULL;
+
+    cache = calloc (1, sizeof (glitz_glyph_cache_t));
+    if (!cache)
+	return NULL;
+
+    cache->hash = calloc (GLITZ_GLYPH_HASH_SIZE_MIN,
+			  sizeof (glitz_glyph_entry_t *));
+    if (!cache->hash)
+    {
+	free (cache);
+	return NULL;
+    }
+
+    cache->surface = glitz_surface_create (drawable, format, width, height,
+					   0, NULL);
+    if (!cache->surface)
+    {
+	free (cache->hash);
+	free (cache);
+	return NULL;
+    }
+
+    cache->hash_size = GLITZ_GLYPH_HASH_SIZE_MIN;
+    cache->color     = format->color.red_size ||
+	format->color.green_size || format->color.blue_size;
+    cache->width     = width;
+    cache->height    = height;
+
+    return cache;
+}
+
+void
+glitz_glyph_cache_destroy (glitz_glyph_cache_t *cache)
+{
+    glitz_glyph_entry_t *entry, *next;
+    int                 i;
+
+    for (entry = cache->lru_head; entry; entry = next)
+    {
+	next = entry->lru_next;
+	free (entry);
+    }
+
+    for (i = 0; i < cache->n_shelves; i++)
+	free (cache->shelves[i].spans);
+
+    glitz_surface_destroy (cache->surface);
+
+    free (cache->shelves);
+    free (cache->hash);
+    free (cache->vertices);
+    free (cache);
+}
+
+static glitz_glyph_entry_t *
+_glitz_glyph_cache_find (glitz_glyph_cache_t *cache,
+			 unsigned long       id)
+{
+    glitz_glyph_entry_t *entry;
+
+    for (entry = cache->hash[GLYPH_HASH (cache, id)]; entry;
+	 entry = entry->next)
+	if (entry->id == id)
+	    return entry;
+
+    return NULL;
+}
+
+static void
+_glitz_glyph_cache_lru_unlink (glitz_glyph_cache_t *cache,
+			       glitz_glyph_entry_t *entry)
+{
+    if (entry->lru_prev)
+	entry->lru_prev->lru_next = entry->lru_next;
+    else
+	cache->lru_head = entry->lru_next;
+
+    if (entry->lru_next)
+	entry->lru_next->lru_prev = entry->lru_prev;
+    else
+	cache->lru_tail = entry->lru_prev;
+}
+
+static void
+_glitz_glyph_cache_lru_push (glitz_glyph_cache_t *cache,
+			     glitz_glyph_entry_t *entry)
+{
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+
+    if (cache->lru_head)
+	cache->lru_head->lru_prev = entry;
+    else
+	cache->lru_tail = entry;
+
+    cache->lru_head = entry;
+}
+
+static void
+_glitz_glyph_cache_touch (glitz_glyph_cache_t *cache,
+			  glitz_glyph_entry_t *entry)
+{
+    if (cache->lru_head != entry)
+    {
+	_glitz_glyph_cache_lru_unlink (cache, entry);
+	_glitz_glyph_cache_lru_push (cache, entry);
+    }
+}
+
+static glitz_bool_t
+_glitz_glyph_cache_grow_hash (glitz_glyph_cache_t *cache)
+{
+    glitz_glyph_entry_t **hash, *entry, *next;
+    int                 i, old_size = cache->hash_size;
+
+    hash = calloc (old_size * 2, sizeof (glitz_glyph_entry_t *));
+    if (!hash)
+	return 0;
+
+    cache->hash_size = old_size * 2;
+    for (i = 0; i < old_size; i++)
+    {
+	for (entry = cache->hash[i]; entry; entry = next)
+	{
+	    next = entry->next;
+	    entry->next = hash[GLYPH_HASH (cache, entry->id)];
+	    hash[GLYPH_HASH (cache, entry->id)] = entry;
+	}
+    }
+
+    free (cache->hash);
+    cache->hash = hash;
+
+    return 1;
+}
+
+static glitz_bool_t
+_glitz_glyph_shelf_insert_span (glitz_glyph_shelf_t *shelf,
+				int                 index,
+				int                 x1,
+				int                 x2)
+{
+    if (shelf->n_spans == shelf->size)
+    {
+	glitz_glyph_span_t *spans;
+	int                size = shelf->size ? shelf->size * 2 : 4;
+
+	spans = realloc (shelf->spans, size * sizeof (glitz_glyph_span_t));
+	if (!spans)
+	    return 0;
+
+	shelf->spans = spans;
+	shelf->size  = size;
+    }
+
+    memmove (shelf->spans + index + 1, shelf->spans + index,
+	     (shelf->n_spans - index) * sizeof (glitz_glyph_span_t));
+
+    shelf->spans[index].x1 = x1;
+    shelf->spans[index].x2 = x2;
+    shelf->n_spans++;
+
+    return 1;
+}
+
+static void
+_glitz_glyph_shelf_remove_span (glitz_glyph_shelf_t *shelf,
+				int                 index)
+{
+    shelf->n_spans--;
+    memmove (shelf->spans + index, shelf->spans + index + 1,
+	     (shelf->n_spans - index) * sizeof (glitz_glyph_span_t));
+}
+
+static int
+_glitz_glyph_shelf_find_span (glitz_glyph_shelf_t *shelf,
+			      int                 width)
+{
+    int i;
+
+    for (i = 0; i < shelf->n_spans; i++)
+	if (shelf->spans[i].x2 - shelf->spans[i].x1 >= width)
+	    return i;
+
+    return -1;
+}
+
+/* Picks the lowest shelf that is tall enough for the glyph, opening a
+   new shelf at the top of the used area when no existing one fits. */
+static glitz_bool_t
+_glitz_glyph_cache_alloc (glitz_glyph_cache_t *cache,
+			  int                 width,
+			  int                 height,
+			  glitz_glyph_entry_t *entry)
+{
+    glitz_glyph_shelf_t *shelf;
+    int                 i, span, best = -1, best_span = -1;
+
+    for (i = 0; i < cache->n_shelves; i++)
+    {
+	shelf = &cache->shelves[i];
+	if (shelf->height < height)
+	    continue;
+
+	if (best >= 0 && shelf->height >= cache->shelves[best].height)
+	    continue;
+
+	span = _glitz_glyph_shelf_find_span (shelf, width);
+	if (span >= 0)
+	{
+	    best      = i;
+	    best_span = span;
+	}
+    }
+
+    /* avoid wasting a tall shelf on a short glyph while there is room
+       for a better fitting one */
+    if (best >= 0 && cache->shelves[best].height > height * 2 &&
+	cache->top + height <= cache->height)
+	best = -1;
+
+    if (best < 0)
+    {
+	int shelf_height;
+
+	if (cache->top + height > cache->height)
+	    return 0;
+
+	shelf_height = (height + GLITZ_GLYPH_SHELF_ROUND - 1) &
+	    ~(GLITZ_GLYPH_SHELF_ROUND - 1);
+	if (cache->top + shelf_height > cache->height)
+	    shelf_height = cache->height - cache->top;
+
+	if (cache->n_shelves == cache->size)
+	{
+	    glitz_glyph_shelf_t *shelves;
+	    int                 size = cache->size ? cache->size * 2 : 8;
+
+	    shelves = realloc (cache->shelves,
+			       size * sizeof (glitz_glyph_shelf_t));
+	    if (!shelves)
+		return 0;
+
+	    cache->shelves = shelves;
+	    cache->size    = size;
+	}
+
+	shelf = &cache->shelves[cache->n_shelves];
+	shelf->y       = cache->top;
+	shelf->height  = shelf_height;
+	shelf->spans   = NULL;
+	shelf->n_spans = shelf->size = 0;
+
+	if (!_glitz_glyph_shelf_insert_span (shelf, 0, 0, cache->width))
+	    return 0;
+
+	best      = cache->n_shelves++;
+	best_span = 0;
+	cache->top += shelf_height;
+    }
+
+    shelf = &cache->shelves[best];
+
+    entry->shelf  = best;
+    entry->box.x1 = shelf->spans[best_span].x1;
+    entry->box.y1 = shelf->y;
+    entry->box.x2 = entry->box.x1 + width;
+    entry->box.y2 = entry->box.y1 + height;
+
+    shelf->spans[best_span].x1 += width;
+    if (shelf->spans[best_span].x1 == shelf->spans[best_span].x2)
+	_glitz_glyph_shelf_remove_span (shelf, best_span);
+
+    return 1;
+}
+
+static void
+_glitz_glyph_cache_free (glitz_glyph_cache_t *cache,
+			 glitz_glyph_entry_t *entry)
+{
+    glitz_glyph_shelf_t *shelf = &cache->shelves[entry->shelf];
+    int                 x1 = entry->box.x1, x2 = entry->box.x2;
+    int                 i;
+
+    for (i = 0; i < shelf->n_spans; i++)
+	if (shelf->spans[i].x1 >= x2)
+	    break;
+
+    if (i > 0 && shelf->spans[i - 1].x2 == x1)
+    {
+	shelf->spans[i - 1].x2 = x2;
+	if (i < shelf->n_spans && shelf->spans[i].x1 == x2)
+	{
+	    shelf->spans[i - 1].x2 = shelf->spans[i].x2;
+	    _glitz_glyph_shelf_remove_span (shelf, i);
+	}
+    }
+    else if (i < shelf->n_spans && shelf->spans[i].x1 == x2)
+    {
+	shelf->spans[i].x1 = x1;
+    }
+    else if (!_glitz_glyph_shelf_insert_span (shelf, i, x1, x2))
+    {
+	/* space is lost until the shelf is released */
+	return;
+    }
+
+    /* give empty shelves at the top back to the free area */
+    while (cache->n_shelves)
+    {
+	shelf = &cache->shelves[cache->n_shelves - 1];
+	if (shelf->n_spans != 1 || shelf->spans[0].x1 != 0 ||
+	    shelf->spans[0].x2 != cache->width)
+	    break;
+
+	cache->top = shelf->y;
+	free (shelf->spans);
+	cache->n_shelves--;
+    }
+}
+
+static void
+_glitz_glyph_cache_remove_entry (glitz_glyph_cache_t *cache,
+				 glitz_glyph_entry_t *entry)
+{
+    glitz_glyph_entry_t **prev;
+
+    for (prev = &cache->hash[GLYPH_HASH (cache, entry->id)]; *prev;
+	 prev = &(*prev)->next)
+    {
+	if (*prev == entry)
+	{
+	    *prev = entry->next;
+	    break;
+	}
+    }
+
+    _glitz_glyph_cache_lru_unlink (cache, entry);
+
+    if (entry->shelf >= 0)
+	_glitz_glyph_cache_free (cache, entry);
+
+    cache->n_glyphs--;
+    free (entry);
+}
+
+glitz_bool_t
+glitz_glyph_cache_lookup (glitz_glyph_cache_t *cache,
+			  unsigned long       id)
+{
+    return _glitz_glyph_cache_find (cache, id) != NULL;
+}
+
+void
+glitz_glyph_cache_remove (glitz_glyph_cache_t *cache,
+			  unsigned long       id)
+{
+    glitz_glyph_entry_t *entry;
+
+    entry = _glitz_glyph_cache_find (cache, id);
+    if (entry)
+	_glitz_glyph_cache_remove_entry (cache, entry);
+}
+
+glitz_status_t
+glitz_glyph_cache_add (glitz_glyph_cache_t  *cache,
+		       unsigned long        id,
+		       int                  x_origin,
+		       int                  y_origin,
+		       int                  width,
+		       int                  height,
+		       glitz_pixel_format_t *format,
+		       glitz_buffer_t       *buffer)
+{
+    glitz_glyph_entry_t *entry;
+
+    if (width < 0 || height < 0 ||
+	width > cache->width || height > cache->height)
+	return GLITZ_STATUS_NOT_SUPPORTED;
+
+    entry = _glitz_glyph_cache_find (cache, id);
+    if (entry)
+	_glitz_glyph_cache_remove_entry (cache, entry);
+
+    if (cache->n_glyphs >= cache->hash_size * 2)
+	_glitz_glyph_cache_grow_hash (cache);
+
+    entry = malloc (sizeof (glitz_glyph_entry_t));
+    if (!entry)
+	return GLITZ_STATUS_NO_MEMORY;
+
+    entry->id       = id;
+    entry->x_origin = x_origin;
+    entry->y_origin = y_origin;
+    entry->shelf    = -1;
+    entry->box.x1   = entry->box.y1 = entry->box.x2 = entry->box.y2 = 0;
+
+    if (width && height)
+    {
+	/* evict least recently used glyphs until there is room */
+	while (!_glitz_glyph_cache_alloc (cache, width, height, entry))
+	{
+	    if (!cache->lru_tail)
+	    {
+		free (entry);
+		return GLITZ_STATUS_NO_MEMORY;
+	    }
+
+	    _glitz_glyph_cache_remove_entry (cache, cache->lru_tail);
+	}
+
+	glitz_set_pixels (cache->surface, entry->box.x1, entry->box.y1,
+			  width, height, format, buffer);
+    }
+
+    entry->next = cache->hash[GLYPH_HASH (cache, id)];
+    cache->hash[GLYPH_HASH (cache, id)] = entry;
+    _glitz_glyph_cache_lru_push (cache, entry);
+    cache->n_glyphs++;
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+#define GLYPH_VERTEX(v, x, y, s, t)             \
+    (v)[0] = (glitz_float_t) (x);               \
+    (v)[1] = (glitz_float_t) (y);               \
+    (v)[2] = (s);                               \
+    (v)[3] = (t);                               \
+    (v) += GLITZ_GLYPH_FLOATS_PER_VERTEX
+
+/* All glyphs are drawn with a single glitz_composite call. Atlas
+   texture coordinates are passed as explicit vertex attributes while
+   the other surface, if any, keeps using generated coordinates. */
+void
+glitz_composite_glyphs (glitz_operator_t    op,
+			glitz_surface_t     *src,
+			glitz_glyph_cache_t *cache,
+			glitz_surface_t     *dst,
+			int                 x_src,
+			int                 y_src,
+			const glitz_glyph_t *glyphs,
+			int                 n_glyphs)
+{
+    glitz_glyph_entry_t *entry;
+    glitz_texture_t     *texture;
+    glitz_geometry_t    geometry;
+    glitz_box_t         bounds;
+    glitz_float_t       *v, s1, t1, s2, t2;
+    int                 i, x1, y1, x2, y2, n_vertices;
+
+    if (n_glyphs <= 0)
+	return;
+
+    texture = glitz_surface_get_texture (cache->surface, 0);
+    if (!texture)
+	return;
+
+    if (n_glyphs * 4 > cache->n_vertices)
+    {
+	v = realloc (cache->vertices, n_glyphs * 4 *
+		     GLITZ_GLYPH_FLOATS_PER_VERTEX * sizeof (glitz_float_t));
+	if (!v)
+	{
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	    return;
+	}
+
+	cache->vertices   = v;
+	cache->n_vertices = n_glyphs * 4;
+    }
+
+    bounds.x1 = bounds.y1 = MAXSHORT;
+    bounds.x2 = bounds.y2 = MINSHORT;
+
+    v = cache->vertices;
+    for (i = 0; i < n_glyphs; i++)
+    {
+	entry = _glitz_glyph_cache_find (cache, glyphs[i].id);
+	if (!entry)
+	    continue;
+
+	_glitz_glyph_cache_touch (cache, entry);
+
+	if (entry->shelf < 0)
+	    continue;
+
+	x1 = glyphs[i].x - entry->x_origin;
+	y1 = glyphs[i].y - entry->y_origin;
+	x2 = x1 + entry->box.x2 - entry->box.x1;
+	y2 = y1 + entry->box.y2 - entry->box.y1;
+
+	s1 = (entry->box.x1 + texture->box.x1) * texture->texcoord_width_unit;
+	s2 = (entry->box.x2 + texture->box.x1) * texture->texcoord_width_unit;
+	t1 = (texture->box.y2 - entry->box.y1) *
+	    texture->texcoord_height_unit;
+	t2 = (texture->box.y2 - entry->box.y2) *
+	    texture->texcoord_height_unit;
+
+	GLYPH_VERTEX (v, x1, y1, s1, t1);
+	GLYPH_VERTEX (v, x2, y1, s2, t1);
+	GLYPH_VERTEX (v, x2, y2, s2, t2);
+	GLYPH_VERTEX (v, x1, y2, s1, t2);
+
+	if (x1 < bounds.x1)
+	    bounds.x1 = x1;
+	if (y1 < bounds.y1)
+	    bounds.y1 = y1;
+	if (x2 > bounds.x2)
+	    bounds.x2 = x2;
+	if (y2 > bounds.y2)
+	    bounds.y2 = y2;
+    }
+
+    n_vertices = (v - cache->vertices) / GLITZ_GLYPH_FLOATS_PER_VERTEX;
+    if (!n_vertices)
+	return;
+
+    geometry = dst->geometry;
+
+    dst->geometry.buffer = glitz_buffer_create_for_data (cache->vertices);
+    if (!dst->geometry.buffer)
+    {
+	dst->geometry = geometry;
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
+
+    dst->geometry.type     = GLITZ_GEOMETRY_TYPE_VERTEX;
+    dst->geometry.stride   = GLITZ_GLYPH_FLOATS_PER_VERTEX *
+	sizeof (glitz_float_t);
+    dst->geometry.first    = 0;
+    dst->geometry.count    = n_vertices;
+    dst->geometry.off.v[0] = dst->geometry.off.v[1] = 0.0f;
+    dst->geometry.array    = NULL;
+    dst->geometry.indices  = NULL;
+
+    dst->geometry.u.v.prim = GLITZ_GL_QUADS;
+    dst->geometry.u.v.type = GLITZ_GL_FLOAT;
+
+    if (cache->color)
+    {
+	dst->geometry.attributes     = GLITZ_VERTEX_ATTRIBUTE_SRC_COORD_MASK;
+	dst->geometry.u.v.src.type   = GLITZ_GL_FLOAT;
+	dst->geometry.u.v.src.size   = 2;
+	dst->geometry.u.v.src.offset = 2 * sizeof (glitz_float_t);
+
+	glitz_composite (op, cache->surface, src, dst,
+			 0, 0,
+			 x_src + bounds.x1, y_src + bounds.y1,
+			 bounds.x1, bounds.y1,
+			 bounds.x2 - bounds.x1,
+			 bounds.y2 - bounds.y1);
+    }
+    else
+    {
+	dst->geometry.attributes      = GLITZ_VERTEX_ATTRIBUTE_MASK_COORD_MASK;
+	dst->geometry.u.v.mask.type   = GLITZ_GL_FLOAT;
+	dst->geometry.u.v.mask.size   = 2;
+	dst->geometry.u.v.mask.offset = 2 * sizeof (glitz_float_t);
+
+	glitz_composite (op, src, cache->surface, dst,
+			 x_src + bounds.x1, y_src + bounds.y1,
+			 0, 0,
+			 bounds.x1, bounds.y1,
+			 bounds.x2 - bounds.x1,
+			 bounds.y2 - bounds.y1);
+    }
+
+    glitz_buffer_destroy (dst->geometry.buffer);
+    dst->geometry = geometry;
+}
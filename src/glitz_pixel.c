@@ -124,6 +124,81 @@ static glitz_gl_pixel_format_t _gl_yuv_pixel_formats[] = {
 	},
 	GLITZ_GL_LUMINANCE,
 	GLITZ_GL_UNSIGNED_BYTE
+    }, {
+	{
+	    GLITZ_FOURCC_I420,
+	    {
+		12,
+		0x00000000,
+		0x00000000,
+		0x00000000,
+		0x00000000
+	    },
+	    0, 0, 0,
+	    GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
+	},
+	GLITZ_GL_LUMINANCE,
+	GLITZ_GL_UNSIGNED_BYTE
+    }, {
+	{
+	    GLITZ_FOURCC_NV12,
+	    {
+		12,
+		0x00000000,
+		0x00000000,
+		0x00000000,
+		0x00000000
+	    },
+	    0, 0, 0,
+	    GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
+	},
+	GLITZ_GL_LUMINANCE,
+	GLITZ_GL_UNSIGNED_BYTE
+    }, {
+	{
+	    GLITZ_FOURCC_P010,
+	    {
+		24,
+		0x00000000,
+		0x00000000,
+		0x00000000,
+		0x00000000
+	    },
+	    0, 0, 0,
+	    GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
+	},
+	GLITZ_GL_LUMINANCE,
+	GLITZ_GL_UNSIGNED_SHORT
+    }, {
+	{
+	    GLITZ_FOURCC_YUY2,
+	    {
+		16,
+		0x00000000,
+		0x00000000,
+		0x00000000,
+		0x00000000
+	    },
+	    0, 0, 0,
+	    GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
+	},
+	GLITZ_GL_RGBA,
+	GLITZ_GL_UNSIGNED_BYTE
+    }, {
+	{
+	    GLITZ_FOURCC_UYVY,
+	    {
+		16,
+		0x00000000,
+		0x00000000,
+		0x00000000,
+		0x00000000
+	    },
+	    0, 0, 0,
+	    GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP
+	},
+	GLITZ_GL_RGBA,
+	GLITZ_GL_UNSIGNED_BYTE
     }
 };
 
@@ -187,11 +262,135 @@ typedef struct _glitz_pixel_color {
     uint32_t r, g, b, a;
 } glitz_pixel_color_t;
 
+/* YUV <-> RGB conversion tables. Conversion to RGB is done in fixed
+ * point with all coefficients multiplied by 0x010101 so that results
+ * in the range [0, 0x1000000) can be shifted into a 32 bit color
+ * component. Conversion from RGB is done with one table per color
+ * component and YUV channel. */
+
+typedef struct _glitz_yuv_matrix_coefficients {
+    int32_t  y, rv, gu, gv, bu;
+    uint32_t yr, yg, yb, vr, vg, vb, ur, ug, ub;
+} glitz_yuv_matrix_coefficients_t;
+
+static const glitz_yuv_matrix_coefficients_t _yuv_matrix_coefficients[] = {
+    /* BT.601:
+     * R = 1.164(Y - 16) + 1.596(V - 128)
+     * G = 1.164(Y - 16) - 0.813(V - 128) - 0.391(U - 128)
+     * B = 1.164(Y - 16) + 2.018(U - 128)
+     *
+     * Y =  (0.257 * R) + (0.504 * G) + (0.098 * B) + 16
+     * V =  (0.439 * R) - (0.368 * G) - (0.071 * B) + 128
+     * U = -(0.148 * R) - (0.291 * G) + (0.439 * B) + 128
+     */
+    {
+	0x012b27, 0x019a2e, 0x00647e, 0x00d0f2, 0x0206a2,
+	0x03e41be4, 0x01fbefbf, 0x0a343eb2,
+	0x024724bd, 0x02b7a6f5, 0x0e15a241,
+	0x06c1bad0, 0x036fb99f, 0x024724bd
+    },
+
+    /* BT.709:
+     * R = 1.164(Y - 16) + 1.793(V - 128)
+     * G = 1.164(Y - 16) - 0.533(V - 128) - 0.213(U - 128)
+     * B = 1.164(Y - 16) + 2.112(U - 128)
+     *
+     * Y =  (0.183 * R) + (0.614 * G) + (0.062 * B) + 16
+     * V =  (0.439 * R) - (0.399 * G) - (0.040 * B) + 128
+     * U = -(0.101 * R) - (0.339 * G) + (0.439 * B) + 128
+     */
+    {
+	0x012b27, 0x01cccf, 0x0036be, 0x0088fc, 0x021ecb,
+	0x057c649d, 0x01a292bb, 0x1031397b,
+	0x02496e2b, 0x02841ebf, 0x19191919,
+	0x09f097e1, 0x02f61fa8, 0x02496e2b
+    }
+};
+
+typedef struct _glitz_yuv_tables {
+    int32_t y[256], rv[256], gu[256], gv[256], bu[256];
+    int16_t yr[256], yg[256], yb[256];
+    int16_t vr[256], vg[256], vb[256];
+    int16_t ur[256], ug[256], ub[256];
+} glitz_yuv_tables_t;
+
+static glitz_yuv_tables_t _yuv_tables[GLITZ_YUV_MATRIX_BT709 + 1];
+static glitz_bool_t	  _yuv_tables_initialized[GLITZ_YUV_MATRIX_BT709 + 1];
+
+#define YUV_COEFFICIENTS(t) (&_yuv_matrix_coefficients[(t) - _yuv_tables])
+
+static const glitz_yuv_tables_t *
+_glitz_get_yuv_tables (glitz_yuv_matrix_t matrix)
+{
+    const glitz_yuv_matrix_coefficients_t *c;
+    glitz_yuv_tables_t			  *t = &_yuv_tables[matrix];
+    uint32_t				  v;
+    int					  i;
+
+    if (_yuv_tables_initialized[matrix])
+	return t;
+
+    c = &_yuv_matrix_coefficients[matrix];
+
+    for (i = 0; i < 256; i++)
+    {
+	t->y[i]  = c->y  * (i - 16);
+	t->rv[i] = c->rv * (i - 128);
+	t->gu[i] = c->gu * (i - 128);
+	t->gv[i] = c->gv * (i - 128);
+	t->bu[i] = c->bu * (i - 128);
+
+	v = (uint32_t) i * 0x01010101;
+
+	t->yr[i] = v / c->yr;
+	t->yg[i] = v / c->yg;
+	t->yb[i] = v / c->yb;
+	t->vr[i] = v / c->vr;
+	t->vg[i] = v / c->vg;
+	t->vb[i] = v / c->vb;
+	t->ur[i] = v / c->ur;
+	t->ug[i] = v / c->ug;
+	t->ub[i] = v / c->ub;
+    }
+
+    _yuv_tables_initialized[matrix] = 1;
+
+    return t;
+}
+
+#define YUV_R(t, yi, ui, vi) ((t)->y[yi] + (t)->rv[vi])
+#define YUV_G(t, yi, ui, vi) ((t)->y[yi] - (t)->gv[vi] - (t)->gu[ui])
+#define YUV_B(t, yi, ui, vi) ((t)->y[yi] + (t)->bu[ui])
+
+/* clamp fixed point YUV conversion result to 32 bit color component */
+#define YUV_CLAMP_32(c)				\
+    ((c) >= 0 ? (c) < 0x1000000 ? (((uint32_t) (c)) << 8) : 0xffffffff : 0)
+
+/* same as YUV_CLAMP_32 followed by STORE into an 8 bit channel */
+#define YUV_CLAMP_8(c)						      \
+    ((c) >= 0 ? (c) < 0x1000000 ? (((uint32_t) (c)) * 0xff) >> 24 : 0xff : 0)
+
+#define RGB_Y(t, r, g, b) ((t)->yr[r] + (t)->yg[g] + (t)->yb[b] + 16)
+#define RGB_V(t, r, g, b) ((t)->vr[r] - (t)->vg[g] - (t)->vb[b] + 128)
+#define RGB_U(t, r, g, b) ((t)->ub[b] - (t)->ur[r] - (t)->ug[g] + 128)
+
+/* same as above for full precision 32 bit color components, as the
+   tables only hold exact results for 8 bit channels */
+#define RGB_Y_32(c, r, g, b) \
+    ((r) / (c)->yr + (g) / (c)->yg + (b) / (c)->yb + 16)
+#define RGB_V_32(c, r, g, b) \
+    ((r) / (c)->vr - (g) / (c)->vg - (b) / (c)->vb + 128)
+#define RGB_U_32(c, r, g, b) \
+    ((b) / (c)->ub - (r) / (c)->ur - (g) / (c)->ug + 128)
+
+#define YUV_CLAMP(c) ((c) > 0 ? (c) < 255 ? (c) : 255 : 0)
+
 typedef struct _glitz_pixel_transform_op {
-    char		 *line, *line2, *line3;
-    int			 offset;
-    glitz_pixel_format_t *format;
-    glitz_pixel_color_t  *color;
+    char		     *line, *line2, *line3;
+    int			     offset;
+    glitz_pixel_format_t     *format;
+    glitz_pixel_color_t      *color;
+    const glitz_yuv_tables_t *yuv;
 } glitz_pixel_transform_op_t;
 
 #define FETCH(p, mask)                                                 \
@@ -275,51 +474,41 @@ _fetch_32 (glitz_pixel_transform_op_t *op)
 static void
 _fetch_yv12 (glitz_pixel_transform_op_t *op)
 {
-    int16_t y = ((uint8_t *) op->line)[op->offset] - 16;
-    int16_t v = ((uint8_t *) op->line2)[op->offset >> 1] - 128;
-    int16_t u = ((uint8_t *) op->line3)[op->offset >> 1] - 128;
+    uint8_t y = ((uint8_t *) op->line)[op->offset];
+    uint8_t v = ((uint8_t *) op->line2)[op->offset >> 1];
+    uint8_t u = ((uint8_t *) op->line3)[op->offset >> 1];
     int32_t r, g, b;
 
-    /* TODO: use tables, in a tight loop */
     op->color->a = 0xffffffff;
-    /* all colors multiplied by 0x010101, cropped, shifted */
-    /* R = 1.164(Y - 16) + 1.596(V - 128) */
-    r = 0x012b27 * y + 0x019a2e * v;
-    op->color->r = r >= 0 ? r < 0x1000000 ? (((unsigned) r) << 8) :
-	0xffffffff : 0;
-    /* G = 1.164(Y - 16) - 0.813(V - 128) - 0.391(U - 128) */
-    g = 0x012b27 * y - 0x00d0f2 * v - 0x00647e * u;
-    op->color->g = g >= 0 ? g < 0x1000000 ? (((unsigned) g) << 8) :
-	0xffffffff : 0;
-    /* B = 1.164(Y - 16) + 2.018(U - 128) */
-    b = 0x012b27 * y + 0x0206a2 * u;
-    op->color->b = b >= 0 ? b < 0x1000000 ? (((unsigned) b) << 8) :
-	0xffffffff : 0;
+
+    r = YUV_R (op->yuv, y, u, v);
+    op->color->r = YUV_CLAMP_32 (r);
+
+    g = YUV_G (op->yuv, y, u, v);
+    op->color->g = YUV_CLAMP_32 (g);
+
+    b = YUV_B (op->yuv, y, u, v);
+    op->color->b = YUV_CLAMP_32 (b);
 }
 
 static void
 _fetch_yuy2 (glitz_pixel_transform_op_t *op)
 {
-    int16_t y = ((uint8_t *) op->line)[op->offset << 1] - 16;
-    int16_t u = ((uint8_t *) op->line)[((op->offset << 1) & -4) + 1] - 128;
-    int16_t v = ((uint8_t *) op->line)[((op->offset << 1) & -4) + 3] - 128;
+    uint8_t y = ((uint8_t *) op->line)[op->offset << 1];
+    uint8_t u = ((uint8_t *) op->line)[((op->offset << 1) & -4) + 1];
+    uint8_t v = ((uint8_t *) op->line)[((op->offset << 1) & -4) + 3];
     int32_t r, g, b;
 
-    /* TODO: use tables, in a tight loop */
     op->color->a = 0xffffffff;
-    /* all colors multiplied by 0x010101, cropped, shifted */
-    /* R = 1.164(Y - 16) + 1.596(V - 128) */
-    r = 0x012b27 * y + 0x019a2e * v;
-    op->color->r = r >= 0 ? r < 0x1000000 ? (((unsigned) r) << 8) :
-	0xffffffff : 0;
-    /* G = 1.164(Y - 16) - 0.813(V - 128) - 0.391(U - 128) */
-    g = 0x012b27 * y - 0x00d0f2 * v - 0x00647e * u;
-    op->color->g = g >= 0 ? g < 0x1000000 ? (((unsigned) g) << 8) :
-	0xffffffff : 0;
-    /* B = 1.164(Y - 16) + 2.018(U - 128) */
-    b = 0x012b27 * y + 0x0206a2 * u;
-    op->color->b = b >= 0 ? b < 0x1000000 ? (((unsigned) b) << 8) :
-	0xffffffff : 0;
+
+    r = YUV_R (op->yuv, y, u, v);
+    op->color->r = YUV_CLAMP_32 (r);
+
+    g = YUV_G (op->yuv, y, u, v);
+    op->color->g = YUV_CLAMP_32 (g);
+
+    b = YUV_B (op->yuv, y, u, v);
+    op->color->b = YUV_CLAMP_32 (b);
 }
 
 typedef void (*glitz_pixel_store_function_t) (glitz_pixel_transform_op_t *op);
@@ -408,14 +597,15 @@ _store_32 (glitz_pixel_transform_op_t *op)
 static void
 _store_yv12 (glitz_pixel_transform_op_t *op)
 {
+    const glitz_yuv_matrix_coefficients_t *c = YUV_COEFFICIENTS (op->yuv);
     uint8_t *yp = &((uint8_t *) op->line)[op->offset];
+    uint32_t r = op->color->r;
+    uint32_t g = op->color->g;
+    uint32_t b = op->color->b;
     int16_t y;
 
-    /* Y =  (0.257 * R) + (0.504 * G) + (0.098 * B) + 16 */
-    y = op->color->r / 0x03e41be4 + op->color->g / 0x01fbefbf +
-	op->color->b / 0x0a343eb2 + 16;
-
-    *yp = y > 0 ? y < 255 ? y : 255 : 0;
+    y = RGB_Y_32 (c, r, g, b);
+    *yp = YUV_CLAMP (y);
 
     if (op->line2 && (op->offset & 1) == 0)
     {
@@ -423,905 +613,3462 @@ _store_yv12 (glitz_pixel_transform_op_t *op)
 	uint8_t *up = &((uint8_t *) op->line3)[op->offset >> 1];
 	int16_t v, u;
 
-	/* V =  (0.439 * R) - (0.368 * G) - (0.071 * B) + 128 */
-	v = op->color->r / 0x024724bd - op->color->g / 0x02b7a6f5 -
-	    op->color->b / 0x0e15a241 + 128;
-	*vp = v > 0 ? v < 255 ? v : 255 : 0;
+	v = RGB_V_32 (c, r, g, b);
+	*vp = YUV_CLAMP (v);
 
-	/* U = -(0.148 * R) - (0.291 * G) + (0.439 * B) + 128 */
-	u = op->color->b / 0x024724bd - op->color->r / 0x06c1bad0 -
-	    op->color->g / 0x36fb99f + 128;
-
-	*up = u > 0 ? u < 255 ? u : 255 : 0;
+	u = RGB_U_32 (c, r, g, b);
+	*up = YUV_CLAMP (u);
     }
 }
 
 static void
 _store_yuy2 (glitz_pixel_transform_op_t *op)
 {
+    const glitz_yuv_matrix_coefficients_t *c = YUV_COEFFICIENTS (op->yuv);
     uint8_t *p = (uint8_t *) &op->line[op->offset << 1];
+    uint32_t r = op->color->r;
+    uint32_t g = op->color->g;
+    uint32_t b = op->color->b;
     int16_t y, v, u;
 
-    /* Y =  (0.257 * R) + (0.504 * G) + (0.098 * B) + 16 */
-    y = op->color->r / 0x03e41be4 + op->color->g / 0x01fbefbf +
-	op->color->b / 0x0a343eb2 + 16;
-
-    p[0] = y >= 0 ? y < 255 ? y : 255 : 0;
+    y = RGB_Y_32 (c, r, g, b);
+    p[0] = YUV_CLAMP (y);
 
     if ((op->offset & 1) == 0)
     {
-	/* U = -(0.148 * R) - (0.291 * G) + (0.439 * B) + 128 */
-	u = op->color->b / 0x024724bd - op->color->r / 0x06c1bad0 -
-	    op->color->g / 0x36fb99f + 128;
-
-	p[1] = u >= 0 ? u < 255 ? u : 255 : 0;
+	u = RGB_U_32 (c, r, g, b);
+	p[1] = YUV_CLAMP (u);
     }
     else
     {
-	/* V =  (0.439 * R) - (0.368 * G) - (0.071 * B) + 128 */
-	v = op->color->r / 0x024724bd - op->color->g / 0x02b7a6f5 -
-	    op->color->b / 0x0e15a241 + 128;
-
-	p[1] = v >= 0 ? v < 255 ? v : 255 : 0;
+	v = RGB_V_32 (c, r, g, b);
+	p[1] = YUV_CLAMP (v);
     }
 }
 
-#define GLITZ_TRANSFORM_PIXELS_MASK         (1L << 0)
-#define GLITZ_TRANSFORM_SCANLINE_ORDER_MASK (1L << 1)
-#define GLITZ_TRANSFORM_COPY_BOX_MASK       (1L << 2)
+/* Whole-scanline converters for the most common format pairs. These
+ * produce exactly the same result as the generic fetch/store path but
+ * avoid the per-pixel indirect calls and 64-bit divisions. */
+
+typedef void (*glitz_pixel_scanline_function_t) (glitz_pixel_transform_op_t *src,
+						 glitz_pixel_transform_op_t *dst,
+						 int			    width,
+						 uint32_t		    and_mask,
+						 uint32_t		    or_mask);
+
+typedef struct _glitz_pixel_scanline {
+    glitz_fourcc_t		    src_fourcc;
+    glitz_pixel_masks_t		    src;
+    glitz_fourcc_t		    dst_fourcc;
+    glitz_pixel_masks_t		    dst;
+    uint32_t			    and_mask;
+    uint32_t			    or_mask;
+    glitz_pixel_scanline_function_t convert;
+    glitz_pixel_scanline_function_t convert_simd;
+} glitz_pixel_scanline_t;
+
+/* 5 and 6 bit channels expanded and reduced the same way as FETCH and
+ * STORE do it */
+#define EXPAND_5(v) (((v) * 0xff) / 0x1f)
+#define EXPAND_6(v) (((v) * 0xff) / 0x3f)
+#define REDUCE_5(v) (((v) * 0x1f) / 0xff)
+#define REDUCE_6(v) (((v) * 0x3f) / 0xff)
 
-typedef struct _glitz_image {
-    char		 *data;
-    glitz_pixel_format_t *format;
-    int			 width;
-    int			 height;
-} glitz_image_t;
+static void
+_scanline_copy_32 (glitz_pixel_transform_op_t *src,
+		   glitz_pixel_transform_op_t *dst,
+		   int			      width,
+		   uint32_t		      and_mask,
+		   uint32_t		      or_mask)
+{
+    const uint32_t *s = (const uint32_t *) src->line + src->offset;
+    uint32_t	   *d = (uint32_t *) dst->line + dst->offset;
+
+    while (width--)
+	*d++ = (*s++ & and_mask) | or_mask;
+}
 
 static void
-_glitz_pixel_transform (unsigned long transform,
-			glitz_image_t *src,
-			glitz_image_t *dst,
-			int           x_src,
-			int           y_src,
-			int           x_dst,
-			int           y_dst,
-			int           width,
-			int           height)
+_scanline_swap_32 (glitz_pixel_transform_op_t *src,
+		   glitz_pixel_transform_op_t *dst,
+		   int			      width,
+		   uint32_t		      and_mask,
+		   uint32_t		      or_mask)
 {
-    int				 src_stride, dst_stride;
-    int				 src_planeoffset = 0, dst_planeoffset = 0;
-    int				 x, y, bytes_per_pixel = 0;
-    glitz_pixel_fetch_function_t fetch;
-    glitz_pixel_store_function_t store;
-    glitz_pixel_color_t		 color;
-    glitz_pixel_transform_op_t	 src_op, dst_op;
+    const uint32_t *s = (const uint32_t *) src->line + src->offset;
+    uint32_t	   *d = (uint32_t *) dst->line + dst->offset;
+    uint32_t	   p;
 
-    switch (src->format->fourcc) {
-    case GLITZ_FOURCC_RGB:
-	switch (src->format->masks.bpp) {
-	case 1:
-	    fetch = _fetch_1;
-	    break;
-	case 8:
-	    fetch = _fetch_8;
-	    break;
-	case 16:
-	    fetch = _fetch_16;
-	    break;
-	case 24:
-	    fetch = _fetch_24;
-	    break;
-	case 32:
-	default:
-	    fetch = _fetch_32;
-	}
-	break;
-    case GLITZ_FOURCC_YV12:
-	fetch = _fetch_yv12;
-	break;
-    case GLITZ_FOURCC_YUY2:
-	fetch = _fetch_yuy2;
-	break;
-    default:
-	fetch = _fetch_32;
+    while (width--)
+    {
+	p = *s++;
+	*d++ = (((p & 0xff00ff00) |
+		 ((p >> 16) & 0xff) | ((p & 0xff) << 16)) & and_mask) |
+	    or_mask;
     }
+}
 
-    switch (dst->format->fourcc) {
-    case GLITZ_FOURCC_RGB:
-	switch (dst->format->masks.bpp) {
-	case 1:
-	    store = _store_1;
-	    break;
-	case 8:
-	    store = _store_8;
-	    break;
-	case 16:
-	    store = _store_16;
-	    break;
-	case 24:
-	    store = _store_24;
-	    break;
-	case 32:
-	default:
-	    store = _store_32;
-	}
-	break;
-    case GLITZ_FOURCC_YV12:
-	store = _store_yv12;
-	break;
-    case GLITZ_FOURCC_YUY2:
-	store = _store_yuy2;
-	break;
-    default:
-	store = _store_32;
+static void
+_scanline_16_to_32 (glitz_pixel_transform_op_t *src,
+		    glitz_pixel_transform_op_t *dst,
+		    int			       width,
+		    uint32_t		       and_mask,
+		    uint32_t		       or_mask)
+{
+    const uint16_t *s = (const uint16_t *) src->line + src->offset;
+    uint32_t	   *d = (uint32_t *) dst->line + dst->offset;
+    uint32_t	   p;
+
+    while (width--)
+    {
+	p = *s++;
+	*d++ = (EXPAND_5 (p >> 11) << 16) |
+	    (EXPAND_6 ((p >> 5) & 0x3f) << 8) |
+	    EXPAND_5 (p & 0x1f) | or_mask;
     }
+}
 
-    switch (src->format->fourcc) {
-    case GLITZ_FOURCC_YV12:
-	src_stride = (src->format->bytes_per_line) ?
-	    src->format->bytes_per_line: (src->width + 3) & -4;
-	src_planeoffset = src_stride * src->height;
-	bytes_per_pixel = 1;
-	break;
-    default:
-	src_stride = (src->format->bytes_per_line) ?
-	    src->format->bytes_per_line:
-	    (((src->width * src->format->masks.bpp) / 8) + 3) & -4;
-	/* This only works for bpp % 8 = 0, but it shouldn't be a problem as
-	 * it will never be used for bitmaps */
-	bytes_per_pixel = src->format->masks.bpp / 8;
+static void
+_scanline_32_to_16 (glitz_pixel_transform_op_t *src,
+		    glitz_pixel_transform_op_t *dst,
+		    int			       width,
+		    uint32_t		       and_mask,
+		    uint32_t		       or_mask)
+{
+    const uint32_t *s = (const uint32_t *) src->line + src->offset;
+    uint16_t	   *d = (uint16_t *) dst->line + dst->offset;
+    uint32_t	   p;
+
+    while (width--)
+    {
+	p = *s++;
+	*d++ = (uint16_t) ((REDUCE_5 ((p >> 16) & 0xff) << 11) |
+			   (REDUCE_6 ((p >> 8) & 0xff) << 5) |
+			   REDUCE_5 (p & 0xff));
     }
+}
 
-    if (src_stride == 0)
-	src_stride = 1;
+static void
+_scanline_24_to_32 (glitz_pixel_transform_op_t *src,
+		    glitz_pixel_transform_op_t *dst,
+		    int			       width,
+		    uint32_t		       and_mask,
+		    uint32_t		       or_mask)
+{
+    const uint8_t *s = (const uint8_t *) src->line + src->offset * 3;
+    uint32_t	  *d = (uint32_t *) dst->line + dst->offset;
 
-    src_op.format = src->format;
-    src_op.color = &color;
+    while (width--)
+    {
 
-    switch (dst->format->fourcc) {
-    case GLITZ_FOURCC_YV12:
-	dst_stride = (dst->format->bytes_per_line) ?
-	    dst->format->bytes_per_line: (dst->width + 3) & -4;
-	dst_planeoffset = dst_stride * dst->height;
-	break;
-    default:
-	dst_stride = (dst->format->bytes_per_line) ?
-	    dst->format->bytes_per_line:
-	    (((dst->width * dst->format->masks.bpp) / 8) + 3) & -4;
+#if IMAGE_BYTE_ORDER == MSBFirst
+	*d++ = (s[2] << 16) | (s[1] << 8) | s[0] | or_mask;
+#else
+	*d++ = (s[0] << 16) | (s[1] << 8) | s[2] | or_mask;
+#endif
+
+	s += 3;
     }
+}
 
-    if (dst_stride == 0)
-	dst_stride = 1;
+static void
+_scanline_32_to_24 (glitz_pixel_transform_op_t *src,
+		    glitz_pixel_transform_op_t *dst,
+		    int			       width,
+		    uint32_t		       and_mask,
+		    uint32_t		       or_mask)
+{
+    const uint32_t *s = (const uint32_t *) src->line + src->offset;
+    uint8_t	   *d = (uint8_t *) dst->line + dst->offset * 3;
+    uint32_t	   p;
 
-    dst_op.format = dst->format;
-    dst_op.color = &color;
+    while (width--)
+    {
+	p = *s++;
 
-    for (y = 0; y < height; y++) {
-	if (src->format->scanline_order != dst->format->scanline_order)
-	{
-	    src_op.line = &src->data[(src->height + y_src - y - 1) *
-				     src_stride];
-	}
-	else
-	    src_op.line = &src->data[(y + y_src) * src_stride];
+#if IMAGE_BYTE_ORDER == MSBFirst
+	d[2] = p >> 16;
+	d[1] = p >> 8;
+	d[0] = p;
+#else
+	d[0] = p >> 16;
+	d[1] = p >> 8;
+	d[2] = p;
+#endif
 
-	switch (src->format->fourcc) {
-	case GLITZ_FOURCC_YV12:
-	    if (src->format->scanline_order != dst->format->scanline_order)
-	    {
-		src_op.line2 =
-		    &src->data[src_planeoffset +
-			       (((src->height + y_src - y - 1) >> 1))
-			       * (src_stride >> 1)];
-		src_op.line3 =
-		    &src->data[src_planeoffset +
-			       (src_planeoffset >> 2) +
-			       (((src->height + y_src - y - 1) >> 1))
-			       * (src_stride >> 1)];
-	    }
-	    else
-	    {
-		src_op.line2 =
-		    &src->data[src_planeoffset +
-			       ((y + y_src) >> 1) * (src_stride >> 1)];
-		src_op.line3 =
-		    &src->data[src_planeoffset +
-			       (src_planeoffset >> 2) +
-			       ((y + y_src) >> 1) * (src_stride >> 1)];
-	    }
-	    break;
-	}
+	d += 3;
+    }
+}
 
-	dst_op.line  = &dst->data[(y + y_dst) * dst_stride];
-	dst_op.line2 = dst_op.line3 = NULL;
+static void
+_scanline_1_to_8 (glitz_pixel_transform_op_t *src,
+		  glitz_pixel_transform_op_t *dst,
+		  int			     width,
+		  uint32_t		     and_mask,
+		  uint32_t		     or_mask)
+{
+    const uint8_t *s = (const uint8_t *) src->line;
+    uint8_t	  *d = (uint8_t *) dst->line + dst->offset;
+    int		  x;
 
-	switch (dst->format->fourcc) {
-	case GLITZ_FOURCC_YV12:
-	    if ((y & 1) == 0)
-	    {
-		dst_op.line2 =
-		    &dst->data[dst_planeoffset +
-			       ((y + y_dst) >> 1) * (dst_stride >> 1)];
-		dst_op.line3 =
-		    &dst->data[dst_planeoffset + (dst_planeoffset >> 2) +
-			       ((y + y_dst) >> 1) * (dst_stride >> 1)];
-	    }
-	    break;
-	}
-
-	if (transform & GLITZ_TRANSFORM_PIXELS_MASK)
-	{
-	    for (x = 0; x < width; x++)
-	    {
-		src_op.offset = x_src + x;
-		dst_op.offset = x_dst + x;
+    for (x = src->offset; x < src->offset + width; x++)
+    {
 
-		fetch (&src_op);
-		store (&dst_op);
-	    }
-	}
-	else
-	{
-	    memcpy (&dst_op.line[x_dst * bytes_per_pixel],
-		    &src_op.line[x_src * bytes_per_pixel],
-		    width * bytes_per_pixel);
+#if BITMAP_BIT_ORDER == MSBFirst
+	*d++ = ((s[x >> 3] >> (7 - (x & 7))) & 0x1) ? 0xff : 0x00;
+#else
+	*d++ = ((s[x >> 3] >> (x & 7)) & 0x1) ? 0xff : 0x00;
+#endif
 
-	    switch (dst->format->fourcc) {
-	    case GLITZ_FOURCC_YV12:
-		/* Will overwrite color components of adjacent pixels for odd
-		 * image sizes or not update color on odd start lines -
-		 * who cares? */
-		if ((y & 1) == 0)
-		{
-		    memcpy (&dst_op.line2[x_dst >> 1],
-			    &src_op.line2[x_src >> 1],
-			    width >> 1);
-		    memcpy (&dst_op.line3[x_dst >> 1],
-			    &src_op.line3[x_src >> 1],
-			    width >> 1);
-		}
-		break;
-	    }
-	}
     }
 }
 
-static glitz_bool_t
-_glitz_format_match (glitz_pixel_format_t *format1,
-		     glitz_pixel_format_t *format2,
-		     unsigned long	   mask)
+static void
+_scanline_8_to_1 (glitz_pixel_transform_op_t *src,
+		  glitz_pixel_transform_op_t *dst,
+		  int			     width,
+		  uint32_t		     and_mask,
+		  uint32_t		     or_mask)
 {
-    if (format1->fourcc != format2->fourcc)
-	return 0;
+    const uint8_t *s = (const uint8_t *) src->line + src->offset;
+    uint8_t	  *d = (uint8_t *) dst->line;
+    int		  x;
 
-    switch (format1->fourcc) {
-    case GLITZ_FOURCC_RGB:
-	if (format1->masks.bpp != format2->masks.bpp)
-	    return 0;
+    /* like _store_1, only full coverage sets a bit and bits are never
+       cleared */
+    for (x = dst->offset; x < dst->offset + width; x++)
+    {
+	if (*s++ == 0xff)
+	{
 
-	if (mask & GLITZ_FORMAT_RED_SIZE_MASK)
-	    if (format1->masks.red_mask != format2->masks.red_mask)
-		return 0;
+#if BITMAP_BIT_ORDER == MSBFirst
+	    d[x >> 3] |= 0x1 << (7 - (x & 7));
+#else
+	    d[x >> 3] |= 0x1 << (x & 7);
+#endif
 
-	if (mask & GLITZ_FORMAT_GREEN_SIZE_MASK)
-	    if (format1->masks.green_mask != format2->masks.green_mask)
-		return 0;
+	}
+    }
+}
 
-	if (mask & GLITZ_FORMAT_BLUE_SIZE_MASK)
-	    if (format1->masks.blue_mask != format2->masks.blue_mask)
-		return 0;
+static void
+_scanline_yv12_to_32 (glitz_pixel_transform_op_t *src,
+		      glitz_pixel_transform_op_t *dst,
+		      int			 width,
+		      uint32_t			 and_mask,
+		      uint32_t			 or_mask)
+{
+    const glitz_yuv_tables_t *t = src->yuv;
+    const uint8_t	     *yp = (const uint8_t *) src->line;
+    const uint8_t	     *vp = (const uint8_t *) src->line2;
+    const uint8_t	     *up = (const uint8_t *) src->line3;
+    uint32_t		     *d = (uint32_t *) dst->line + dst->offset;
+    int32_t		     r, g, b;
+    int			     x;
+
+    for (x = src->offset; x < src->offset + width; x++)
+    {
+	r = YUV_R (t, yp[x], up[x >> 1], vp[x >> 1]);
+	g = YUV_G (t, yp[x], up[x >> 1], vp[x >> 1]);
+	b = YUV_B (t, yp[x], up[x >> 1], vp[x >> 1]);
 
-	if (mask & GLITZ_FORMAT_ALPHA_SIZE_MASK)
-	    if (format1->masks.alpha_mask != format2->masks.alpha_mask)
-		return 0;
-	break;
-    default:
-	return 1;
+	*d++ = (YUV_CLAMP_8 (r) << 16) | (YUV_CLAMP_8 (g) << 8) |
+	    YUV_CLAMP_8 (b) | or_mask;
     }
-
-    return 1;
 }
 
-static glitz_gl_pixel_format_t *
-_glitz_find_gl_pixel_format (glitz_pixel_format_t *format,
-			     unsigned long	  color_mask,
-			     unsigned long        feature_mask)
+static void
+_scanline_yuy2_to_32 (glitz_pixel_transform_op_t *src,
+		      glitz_pixel_transform_op_t *dst,
+		      int			 width,
+		      uint32_t			 and_mask,
+		      uint32_t			 or_mask)
 {
-    int i;
-
-    for (i = 0; i < N_RGB_FORMATS; i++)
+    const glitz_yuv_tables_t *t = src->yuv;
+    const uint8_t	     *s = (const uint8_t *) src->line;
+    const uint8_t	     *p;
+    uint32_t		     *d = (uint32_t *) dst->line + dst->offset;
+    int32_t		     r, g, b;
+    int			     x;
+
+    for (x = src->offset; x < src->offset + width; x++)
     {
-	if (_glitz_format_match (&_gl_rgb_pixel_formats[i].pixel,
-				 format, color_mask))
-	    return &_gl_rgb_pixel_formats[i];
+	p = &s[(x << 1) & -4];
+
+	r = YUV_R (t, s[x << 1], p[1], p[3]);
+	g = YUV_G (t, s[x << 1], p[1], p[3]);
+	b = YUV_B (t, s[x << 1], p[1], p[3]);
+
+	*d++ = (YUV_CLAMP_8 (r) << 16) | (YUV_CLAMP_8 (g) << 8) |
+	    YUV_CLAMP_8 (b) | or_mask;
     }
+}
 
-    if (feature_mask & GLITZ_FEATURE_PACKED_PIXELS_MASK)
+static void
+_scanline_32_to_yv12 (glitz_pixel_transform_op_t *src,
+		      glitz_pixel_transform_op_t *dst,
+		      int			 width,
+		      uint32_t			 and_mask,
+		      uint32_t			 or_mask)
+{
+    const glitz_yuv_tables_t *t = dst->yuv;
+    const uint32_t	     *s = (const uint32_t *) src->line + src->offset;
+    uint8_t		     *yp = (uint8_t *) dst->line;
+    uint8_t		     *vp = (uint8_t *) dst->line2;
+    uint8_t		     *up = (uint8_t *) dst->line3;
+    uint8_t		     r, g, b;
+    int16_t		     c;
+    int			     x;
+
+    for (x = dst->offset; x < dst->offset + width; x++, s++)
     {
-	for (i = 0; i < N_PACKED_RGB_FORMATS; i++)
+	r = *s >> 16;
+	g = *s >> 8;
+	b = *s;
+
+	c = RGB_Y (t, r, g, b);
+	yp[x] = YUV_CLAMP (c);
+
+	/* chroma is sampled from even pixels on even lines only */
+	if (vp && (x & 1) == 0)
 	{
-	    if (_glitz_format_match (&_gl_packed_rgb_pixel_formats[i].pixel,
-				     format, color_mask))
-		return &_gl_packed_rgb_pixel_formats[i];
+	    c = RGB_V (t, r, g, b);
+	    vp[x >> 1] = YUV_CLAMP (c);
+
+	    c = RGB_U (t, r, g, b);
+	    up[x >> 1] = YUV_CLAMP (c);
 	}
     }
+}
 
-    for (i = 0; i < N_YUV_FORMATS; i++)
+static void
+_scanline_32_to_yuy2 (glitz_pixel_transform_op_t *src,
+		      glitz_pixel_transform_op_t *dst,
+		      int			 width,
+		      uint32_t			 and_mask,
+		      uint32_t			 or_mask)
+{
+    const glitz_yuv_tables_t *t = dst->yuv;
+    const uint32_t	     *s = (const uint32_t *) src->line + src->offset;
+    uint8_t		     *d = (uint8_t *) dst->line;
+    uint8_t		     r, g, b;
+    int16_t		     c;
+    int			     x;
+
+    for (x = dst->offset; x < dst->offset + width; x++, s++)
     {
-	if (_glitz_format_match (&_gl_yuv_pixel_formats[i].pixel,
-				 format, color_mask))
-	    return &_gl_yuv_pixel_formats[i];
-    }
+	r = *s >> 16;
+	g = *s >> 8;
+	b = *s;
 
-    return NULL;
+	c = RGB_Y (t, r, g, b);
+	d[x << 1] = YUV_CLAMP (c);
+
+	if ((x & 1) == 0)
+	    c = RGB_U (t, r, g, b);
+	else
+	    c = RGB_V (t, r, g, b);
+
+	d[(x << 1) + 1] = YUV_CLAMP (c);
+    }
 }
 
-static int
-_component_size (unsigned long mask)
+/* Conversion between straight and premultiplied alpha. Pixels with
+ * 8 bit alpha in the top byte of a 32 bit word are converted in place
+ * after the scanline has been stored, all other formats are converted
+ * between fetch and store. */
+
+#define PIXEL_BUFFER_STRAIGHT(buffer, format)		 \
+    ((buffer)->alpha == GLITZ_PIXEL_ALPHA_STRAIGHT &&	 \
+     (format)->masks.alpha_mask)
+
+typedef void (*glitz_pixel_alpha_line_function_t) (uint32_t *line,
+						   int	    width);
+
+typedef void (*glitz_pixel_alpha_color_function_t)
+    (glitz_pixel_color_t       *color,
+     const glitz_pixel_color_t *bias);
+
+/* c * a / 255 rounded to nearest */
+static uint32_t
+_mul_un8 (uint32_t c,
+	  uint32_t a)
 {
-    unsigned long y;
+    uint32_t t = c * a + 0x80;
 
-    /* HACKMEM 169 */
-    y = (mask >> 1) & 033333333333;
-    y = mask - y - ((y >> 1) & 033333333333);
-    return (((y + (y >> 3)) & 030707070707) % 077);
+    return ((t >> 8) + t) >> 8;
 }
 
-static glitz_bool_t
-_glitz_rgb_format_diff (glitz_pixel_masks_t  *masks,
-			glitz_color_format_t *pixel_color,
-			glitz_color_format_t *internal_color,
-			int                  *diff)
+static void
+_premultiply_32 (uint32_t *line,
+		 int	  width)
 {
-    int size;
+    uint32_t p, a;
 
-    *diff = 0;
-
-    size = _component_size (masks->red_mask);
-    if (size < pixel_color->red_size && size < internal_color->red_size)
-	return 0;
+    while (width--)
+    {
+	p = *line;
+	a = p >> 24;
+	if (a != 0xff)
+	    *line = (p & 0xff000000)			   |
+		(_mul_un8 ((p >> 16) & 0xff, a) << 16) |
+		(_mul_un8 ((p >> 8) & 0xff, a) << 8)	   |
+		_mul_un8 (p & 0xff, a);
+	line++;
+    }
+}
 
-    *diff += abs (size - internal_color->red_size);
+#define DIV_UN8(c, a) (((c) >= (a))? 0xff: ((c) * 0xff + ((a) >> 1)) / (a))
 
-    size = _component_size (masks->green_mask);
-    if (size < pixel_color->green_size && size < internal_color->green_size)
-	return 0;
+static void
+_unpremultiply_32 (uint32_t *line,
+		   int	    width)
+{
+    uint32_t p, a;
 
-    *diff += abs (size - internal_color->green_size);
+    while (width--)
+    {
+	p = *line;
+	a = p >> 24;
+	if (a == 0)
+	    *line = 0;
+	else if (a != 0xff)
+	    *line = (p & 0xff000000)			 |
+		(DIV_UN8 ((p >> 16) & 0xff, a) << 16) |
+		(DIV_UN8 ((p >> 8) & 0xff, a) << 8)	 |
+		DIV_UN8 (p & 0xff, a);
+	line++;
+    }
+}
 
-    size = _component_size (masks->blue_mask);
-    if (size < pixel_color->blue_size && size < internal_color->blue_size)
+/* STORE truncates to the destination channel, adding half a step of
+   that channel first makes the result round to nearest like the 32-bit
+   line functions */
+static uint32_t
+_alpha_bias (uint32_t mask)
+{
+    if (!mask)
 	return 0;
 
-    *diff += abs (size - internal_color->blue_size);
+    while (!(mask & 1))
+	mask >>= 1;
 
-    size = _component_size (masks->alpha_mask);
-    if (size < pixel_color->alpha_size && size < internal_color->alpha_size)
-	return 0;
+    return (uint32_t) ((uint64_t) 0xffffffff / (2 * (uint64_t) mask));
+}
 
-    *diff += abs (size - internal_color->alpha_size);
+#define ADD_BIAS(c, bias)					\
+    (((c) > 0xffffffff - (bias))? 0xffffffff: (c) + (bias))
 
-    return 1;
+#define MUL_32(c, a)							\
+    ((uint32_t) (((uint64_t) (c) * (a) + 0x7fffffff) / 0xffffffff))
+
+static void
+_premultiply_color (glitz_pixel_color_t	      *color,
+		    const glitz_pixel_color_t *bias)
+{
+    if (color->a != 0xffffffff)
+    {
+	color->r = ADD_BIAS (MUL_32 (color->r, color->a), bias->r);
+	color->g = ADD_BIAS (MUL_32 (color->g, color->a), bias->g);
+	color->b = ADD_BIAS (MUL_32 (color->b, color->a), bias->b);
+    }
 }
 
-static glitz_gl_pixel_format_t *
-_glitz_find_best_gl_pixel_format (glitz_pixel_format_t *format,
-				  glitz_color_format_t *internal_color,
-				  unsigned long        feature_mask)
+#define DIV_32(c, a)							\
+    (((c) >= (a))? 0xffffffff:						\
+     (uint32_t) (((uint64_t) (c) * 0xffffffff + ((a) >> 1)) / (a)))
+
+static void
+_unpremultiply_color (glitz_pixel_color_t	*color,
+		      const glitz_pixel_color_t *bias)
 {
-    glitz_gl_pixel_format_t *best = _gl_rgb_pixel_formats;
-    glitz_color_format_t    color;
-    int			    i, diff, best_diff = MAXSHORT;
-    glitz_pixel_masks_t     *masks;
+    if (color->a == 0)
+    {
+	color->r = color->g = color->b = 0;
+    }
+    else if (color->a != 0xffffffff)
+    {
+	color->r = ADD_BIAS (DIV_32 (color->r, color->a), bias->r);
+	color->g = ADD_BIAS (DIV_32 (color->g, color->a), bias->g);
+	color->b = ADD_BIAS (DIV_32 (color->b, color->a), bias->b);
+    }
+}
 
-    switch (internal_color->fourcc) {
-    case GLITZ_FOURCC_YV12:
-    case GLITZ_FOURCC_YUY2:
-	for (i = 0; i < N_YUV_FORMATS; i++)
-	{
-	    glitz_fourcc_t fourcc;
+#ifdef USE_SSE2
 
-	    fourcc = internal_color->fourcc;
-	    if (_gl_yuv_pixel_formats[i].pixel.fourcc == fourcc)
-		return &_gl_yuv_pixel_formats[i];
-	}
-    default:
-	break;
+#include <emmintrin.h>
+
+/* continue a scanline with the scalar converter after 'n' pixels have
+ * been converted by a vector loop */
+#define SCANLINE_TAIL(func, src, dst, n, width, and_mask, or_mask) \
+    if ((n) < (width))						   \
+    {								   \
+	(src)->offset += (n);					   \
+	(dst)->offset += (n);					   \
+	func (src, dst, (width) - (n), and_mask, or_mask);	   \
     }
 
-    switch (format->fourcc) {
-    case GLITZ_FOURCC_RGB:
-	color.red_size   = _component_size (format->masks.red_mask);
-	color.green_size = _component_size (format->masks.green_mask);
-	color.blue_size  = _component_size (format->masks.blue_mask);
-	color.alpha_size = _component_size (format->masks.alpha_mask);
-	break;
-    case GLITZ_FOURCC_YV12:
-    case GLITZ_FOURCC_YUY2:
-	color.red_size = color.green_size = color.blue_size = 8;
-	color.alpha_size = 0;
-	break;
-    default:
-	color.red_size = color.green_size = color.blue_size =
-	    color.alpha_size = 8;
-	break;
+static SSE2_FUNCTION void
+_scanline_copy_32_sse2 (glitz_pixel_transform_op_t *src,
+			glitz_pixel_transform_op_t *dst,
+			int			   width,
+			uint32_t		   and_mask,
+			uint32_t		   or_mask)
+{
+    const uint32_t *s = (const uint32_t *) src->line + src->offset;
+    uint32_t	   *d = (uint32_t *) dst->line + dst->offset;
+    __m128i	   and = _mm_set1_epi32 ((int) and_mask);
+    __m128i	   or = _mm_set1_epi32 ((int) or_mask);
+    __m128i	   p;
+    int		   n;
+
+    for (n = 0; n + 4 <= width; n += 4)
+    {
+	p = _mm_loadu_si128 ((const __m128i *) (s + n));
+	p = _mm_or_si128 (_mm_and_si128 (p, and), or);
+	_mm_storeu_si128 ((__m128i *) (d + n), p);
     }
 
-    for (i = 0; best_diff > 0 && i < N_RGB_FORMATS; i++)
+    SCANLINE_TAIL (_scanline_copy_32, src, dst, n, width, and_mask, or_mask);
+}
+
+static SSE2_FUNCTION void
+_scanline_swap_32_sse2 (glitz_pixel_transform_op_t *src,
+			glitz_pixel_transform_op_t *dst,
+			int			   width,
+			uint32_t		   and_mask,
+			uint32_t		   or_mask)
+{
+    const uint32_t *s = (const uint32_t *) src->line + src->offset;
+    uint32_t	   *d = (uint32_t *) dst->line + dst->offset;
+    __m128i	   and = _mm_set1_epi32 ((int) and_mask);
+    __m128i	   or = _mm_set1_epi32 ((int) or_mask);
+    __m128i	   ag = _mm_set1_epi32 ((int) 0xff00ff00);
+    __m128i	   rb = _mm_set1_epi32 (0x00ff00ff);
+    __m128i	   p;
+    int		   n;
+
+    for (n = 0; n + 4 <= width; n += 4)
     {
-	masks = &_gl_rgb_pixel_formats[i].pixel.masks;
-	if (_glitz_rgb_format_diff (masks, &color, internal_color, &diff))
-	{
-	    if (diff < best_diff)
-	    {
-		best = &_gl_rgb_pixel_formats[i];
-		best_diff = diff;
-	    }
-	}
+	p = _mm_loadu_si128 ((const __m128i *) (s + n));
+	p = _mm_or_si128 (_mm_and_si128 (p, ag),
+			  _mm_and_si128 (_mm_or_si128 (_mm_slli_epi32 (p, 16),
+						       _mm_srli_epi32 (p, 16)),
+					 rb));
+	p = _mm_or_si128 (_mm_and_si128 (p, and), or);
+	_mm_storeu_si128 ((__m128i *) (d + n), p);
     }
 
-    if (!(feature_mask & GLITZ_FEATURE_PACKED_PIXELS_MASK))
-	return best;
+    SCANLINE_TAIL (_scanline_swap_32, src, dst, n, width, and_mask, or_mask);
+}
 
-    for (i = 0; best_diff > 0 && i < N_PACKED_RGB_FORMATS; i++)
+/* Division of small 16 bit products by 31, 63 and 255 is done with a
+ * multiply-high and a shift. The constants are chosen so that the
+ * result is exact for all products that can occur here. */
+#define DIV_16(v, m, s)						 \
+    _mm_srli_epi16 (_mm_mulhi_epu16 (v, _mm_set1_epi16 ((short) (m))), s)
+
+#define DIV_31(v)  DIV_16 (v, 33826, 4)
+#define DIV_63(v)  DIV_16 (v, 33289, 5)
+#define DIV_255(v) DIV_16 (v, 32897, 7)
+
+static SSE2_FUNCTION void
+_scanline_16_to_32_sse2 (glitz_pixel_transform_op_t *src,
+			 glitz_pixel_transform_op_t *dst,
+			 int			    width,
+			 uint32_t		    and_mask,
+			 uint32_t		    or_mask)
+{
+    const uint16_t *s = (const uint16_t *) src->line + src->offset;
+    uint32_t	   *d = (uint32_t *) dst->line + dst->offset;
+    __m128i	   or = _mm_set1_epi32 ((int) or_mask);
+    __m128i	   c255 = _mm_set1_epi16 (0xff);
+    __m128i	   p, r, g, b, lo, hi;
+    int		   n;
+
+    for (n = 0; n + 8 <= width; n += 8)
     {
-	masks = &_gl_packed_rgb_pixel_formats[i].pixel.masks;
-	if (_glitz_rgb_format_diff (masks, &color, internal_color, &diff))
-	{
-	    if (diff < best_diff)
-	    {
-		best = &_gl_packed_rgb_pixel_formats[i];
-		best_diff = diff;
-	    }
-	}
+	p = _mm_loadu_si128 ((const __m128i *) (s + n));
+
+	r = _mm_srli_epi16 (p, 11);
+	g = _mm_and_si128 (_mm_srli_epi16 (p, 5), _mm_set1_epi16 (0x3f));
+	b = _mm_and_si128 (p, _mm_set1_epi16 (0x1f));
+
+	r = DIV_31 (_mm_mullo_epi16 (r, c255));
+	g = DIV_63 (_mm_mullo_epi16 (g, c255));
+	b = DIV_31 (_mm_mullo_epi16 (b, c255));
+
+	lo = _mm_or_si128 (_mm_slli_epi16 (g, 8), b);
+	hi = r;
+
+	_mm_storeu_si128 ((__m128i *) (d + n),
+			  _mm_or_si128 (_mm_unpacklo_epi16 (lo, hi), or));
+	_mm_storeu_si128 ((__m128i *) (d + n + 4),
+			  _mm_or_si128 (_mm_unpackhi_epi16 (lo, hi), or));
     }
 
-    return best;
+    SCANLINE_TAIL (_scanline_16_to_32, src, dst, n, width, and_mask, or_mask);
 }
 
-void
-glitz_set_pixels (glitz_surface_t      *dst,
-		  int                  x_dst,
-		  int                  y_dst,
-		  int                  width,
-		  int                  height,
-		  glitz_pixel_format_t *format,
-		  glitz_buffer_t       *buffer)
+static SSE2_FUNCTION void
+_scanline_32_to_16_sse2 (glitz_pixel_transform_op_t *src,
+			 glitz_pixel_transform_op_t *dst,
+			 int			    width,
+			 uint32_t		    and_mask,
+			 uint32_t		    or_mask)
 {
-    glitz_box_t             *clip = dst->clip;
-    int                     n_clip = dst->n_clip;
-    glitz_texture_t         *texture;
-    char                    *pixels = NULL;
-    char                    *ptr = NULL;
-    char                    *data = NULL;
-    glitz_gl_pixel_format_t *gl_format = NULL;
-    unsigned long           transform = 0;
-    glitz_bool_t            bound = 0;
-    int                     bytes_per_line = 0, bytes_per_pixel = 0;
-    glitz_image_t           src_image, dst_image;
-    unsigned long           color_mask;
-    glitz_box_t             box;
-    glitz_surface_t         *surface;
-    glitz_bool_t            restore_state;
-    glitz_gl_int_t          unpackrowlength, unpackalignment;
-    glitz_gl_int_t          unpackskiprows, unpackskippixels;
-    glitz_gl_int_t          t2d, tbind2d, trect, tbindrect;
-
-    GLITZ_GL_SURFACE (dst);
+    const uint32_t *s = (const uint32_t *) src->line + src->offset;
+    uint16_t	   *d = (uint16_t *) dst->line + dst->offset;
+    __m128i	   c255 = _mm_set1_epi32 (0xff);
+    __m128i	   p0, p1, r, g, b;
+    int		   n;
 
-    if (x_dst < 0 || x_dst > (dst->box.x2 - width) ||
-	y_dst < 0 || y_dst > (dst->box.y2 - height))
+    for (n = 0; n + 8 <= width; n += 8)
     {
-	glitz_surface_status_add (dst, GLITZ_STATUS_BAD_COORDINATE_MASK);
-	return;
+	p0 = _mm_loadu_si128 ((const __m128i *) (s + n));
+	p1 = _mm_loadu_si128 ((const __m128i *) (s + n + 4));
+
+	r = _mm_packs_epi32 (_mm_and_si128 (_mm_srli_epi32 (p0, 16), c255),
+			     _mm_and_si128 (_mm_srli_epi32 (p1, 16), c255));
+	g = _mm_packs_epi32 (_mm_and_si128 (_mm_srli_epi32 (p0, 8), c255),
+			     _mm_and_si128 (_mm_srli_epi32 (p1, 8), c255));
+	b = _mm_packs_epi32 (_mm_and_si128 (p0, c255),
+			     _mm_and_si128 (p1, c255));
+
+	r = DIV_255 (_mm_mullo_epi16 (r, _mm_set1_epi16 (0x1f)));
+	g = DIV_255 (_mm_mullo_epi16 (g, _mm_set1_epi16 (0x3f)));
+	b = DIV_255 (_mm_mullo_epi16 (b, _mm_set1_epi16 (0x1f)));
+
+	_mm_storeu_si128 ((__m128i *) (d + n),
+			  _mm_or_si128 (_mm_or_si128 (_mm_slli_epi16 (r, 11),
+						      _mm_slli_epi16 (g, 5)),
+					b));
     }
 
-    if (SURFACE_SOLID (dst))
-    {
-	glitz_color_t old = dst->solid;
-
-	while (n_clip--)
-	{
-	    box.x1 = clip->x1 + dst->x_clip;
-	    box.y1 = clip->y1 + dst->y_clip;
-	    box.x2 = clip->x2 + dst->x_clip;
-	    box.y2 = clip->y2 + dst->y_clip;
-	    if (x_dst > box.x1)
-		box.x1 = x_dst;
-	    if (y_dst > box.y1)
-		box.y1 = y_dst;
-	    if (x_dst + width < box.x2)
-		box.x2 = x_dst + width;
-	    if (y_dst + height < box.y2)
-		box.y2 = y_dst + height;
-
-	    if (box.x1 < box.x2 && box.y1 < box.y2)
-	    {
-		dst_image.width = dst_image.height = 1;
-
-		src_image.data =
-		    glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_READ_ONLY);
-		src_image.format = format;
-		src_image.width = src_image.height = 1;
+    SCANLINE_TAIL (_scanline_32_to_16, src, dst, n, width, and_mask, or_mask);
+}
 
-		if (format->masks.alpha_mask && dst->format->color.alpha_size)
-		{
-		    dst_image.data = (void *) &dst->solid.alpha;
-		    dst_image.format = &_solid_format[SOLID_ALPHA];
+/* 32 bit products of 16 bit YUV values and the fixed point coefficients
+ * are computed exactly by splitting the coefficients in a high and a low
+ * part that both fit in 16 bits. */
+#define YUV_MADD(p, c)							\
+    _mm_add_epi32 (_mm_slli_epi32 (_mm_madd_epi16 (p, c##_hi), 8),	\
+		   _mm_madd_epi16 (p, c##_lo))
+
+#define YUV_COEFF(name, c0, c1)						\
+    __m128i name##_hi = _mm_set_epi16 ((c1) >> 8, (c0) >> 8,		\
+				       (c1) >> 8, (c0) >> 8,		\
+				       (c1) >> 8, (c0) >> 8,		\
+				       (c1) >> 8, (c0) >> 8);		\
+    __m128i name##_lo = _mm_set_epi16 ((c1) & 0xff, (c0) & 0xff,	\
+				       (c1) & 0xff, (c0) & 0xff,	\
+				       (c1) & 0xff, (c0) & 0xff,	\
+				       (c1) & 0xff, (c0) & 0xff)
+
+static SSE2_FUNCTION __m128i
+_yuv_clamp_8_sse2 (__m128i c)
+{
+    __m128i max = _mm_set1_epi32 (0x1000000);
 
-		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
-					    &src_image, &dst_image,
-					    format->xoffset,format->skip_lines,
-					    0, 0, 1, 1);
-		} else
-		    dst->solid.alpha = 0xffff;
+    /* clamp to [0, 0x1000000] and scale to [0, 0xff] */
+    c = _mm_and_si128 (c, _mm_cmpgt_epi32 (c, _mm_setzero_si128 ()));
+    c = _mm_or_si128 (_mm_and_si128 (_mm_cmpgt_epi32 (c, max), max),
+		      _mm_andnot_si128 (_mm_cmpgt_epi32 (c, max), c));
 
-		if (format->masks.red_mask && dst->format->color.red_size)
-		{
-		    dst_image.data = (void *) &dst->solid.red;
-		    dst_image.format = &_solid_format[SOLID_RED];
+    return _mm_srli_epi32 (_mm_sub_epi32 (_mm_slli_epi32 (c, 8), c), 24);
+}
 
-		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
-					    &src_image, &dst_image,
-					    format->xoffset,format->skip_lines,
-					    0, 0, 1, 1);
-		} else
-		    dst->solid.red = 0;
+static SSE2_FUNCTION void
+_scanline_yv12_to_32_sse2 (glitz_pixel_transform_op_t *src,
+			   glitz_pixel_transform_op_t *dst,
+			   int			      width,
+			   uint32_t		      and_mask,
+			   uint32_t		      or_mask)
+{
+    const glitz_yuv_matrix_coefficients_t *c;
+    const uint8_t *yp = (const uint8_t *) src->line + src->offset;
+    const uint8_t *vp = (const uint8_t *) src->line2 + (src->offset >> 1);
+    const uint8_t *up = (const uint8_t *) src->line3 + (src->offset >> 1);
+    uint32_t	  *d = (uint32_t *) dst->line + dst->offset;
+    __m128i	  zero = _mm_setzero_si128 ();
+    __m128i	  or = _mm_set1_epi32 ((int) or_mask);
+    __m128i	  y, u, v, yv, yu, r, g, b;
+    int32_t	  uv;
+    int		  n, i;
+
+    /* vector loop needs chroma aligned to the start of the run */
+    if (src->offset & 1)
+    {
+	_scanline_yv12_to_32 (src, dst, width, and_mask, or_mask);
+	return;
+    }
 
-		if (format->masks.green_mask && dst->format->color.green_size)
-		{
-		    dst_image.data = (void *) &dst->solid.green;
-		    dst_image.format = &_solid_format[SOLID_GREEN];
+    c = YUV_COEFFICIENTS (src->yuv);
 
-		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
-					    &src_image, &dst_image,
-					    format->xoffset,format->skip_lines,
-					    0, 0, 1, 1);
-		} else
-		    dst->solid.green = 0;
+    {
+	YUV_COEFF (cr, c->y, c->rv);
+	YUV_COEFF (cgv, c->y, -c->gv);
+	YUV_COEFF (cgu, 0, -c->gu);
+	YUV_COEFF (cb, c->y, c->bu);
 
-		if (format->masks.blue_mask && dst->format->color.blue_size)
-		{
-		    dst_image.data = (void *) &dst->solid.blue;
-		    dst_image.format = &_solid_format[SOLID_BLUE];
+	for (n = 0; n + 8 <= width; n += 8)
+	{
+	    y = _mm_loadl_epi64 ((const __m128i *) (yp + n));
+	    y = _mm_sub_epi16 (_mm_unpacklo_epi8 (y, zero),
+			       _mm_set1_epi16 (16));
 
-		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
-					    &src_image, &dst_image,
-					    format->xoffset,format->skip_lines,
-					    0, 0, 1, 1);
-		} else
-		    dst->solid.blue = 0;
+	    memcpy (&uv, vp + (n >> 1), sizeof (uv));
+	    v = _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (uv), zero);
+	    v = _mm_sub_epi16 (v, _mm_set1_epi16 (128));
+	    v = _mm_unpacklo_epi16 (v, v);
 
-		glitz_buffer_unmap (buffer);
+	    memcpy (&uv, up + (n >> 1), sizeof (uv));
+	    u = _mm_unpacklo_epi8 (_mm_cvtsi32_si128 (uv), zero);
+	    u = _mm_sub_epi16 (u, _mm_set1_epi16 (128));
+	    u = _mm_unpacklo_epi16 (u, u);
 
-		if (dst->flags & GLITZ_SURFACE_FLAG_SOLID_DAMAGE_MASK)
+	    for (i = 0; i < 2; i++)
+	    {
+		if (i == 0)
 		{
-		    dst->flags &= ~GLITZ_SURFACE_FLAG_SOLID_DAMAGE_MASK;
-		    glitz_surface_damage (dst, &box,
-					  GLITZ_DAMAGE_TEXTURE_MASK |
-					  GLITZ_DAMAGE_DRAWABLE_MASK);
+		    yv = _mm_unpacklo_epi16 (y, v);
+		    yu = _mm_unpacklo_epi16 (y, u);
 		}
 		else
 		{
-		    if (dst->solid.red   != old.red   ||
-			dst->solid.green != old.green ||
-			dst->solid.blue  != old.blue  ||
-			dst->solid.alpha != old.alpha)
-			glitz_surface_damage (dst, &box,
-					      GLITZ_DAMAGE_TEXTURE_MASK |
-					      GLITZ_DAMAGE_DRAWABLE_MASK);
+		    yv = _mm_unpackhi_epi16 (y, v);
+		    yu = _mm_unpackhi_epi16 (y, u);
 		}
-		break;
+
+		r = _yuv_clamp_8_sse2 (YUV_MADD (yv, cr));
+		g = _yuv_clamp_8_sse2 (_mm_add_epi32 (YUV_MADD (yv, cgv),
+						      YUV_MADD (yu, cgu)));
+		b = _yuv_clamp_8_sse2 (YUV_MADD (yu, cb));
+
+		r = _mm_or_si128 (_mm_slli_epi32 (r, 16),
+				  _mm_or_si128 (_mm_slli_epi32 (g, 8), b));
+
+		_mm_storeu_si128 ((__m128i *) (d + n + i * 4),
+				  _mm_or_si128 (r, or));
 	    }
-	    clip++;
 	}
-	return;
     }
 
-    color_mask = 0;
-    if (dst->format->color.red_size)
-	color_mask |= GLITZ_FORMAT_RED_SIZE_MASK;
-    if (dst->format->color.green_size)
-	color_mask |= GLITZ_FORMAT_GREEN_SIZE_MASK;
-    if (dst->format->color.blue_size)
-	color_mask |= GLITZ_FORMAT_BLUE_SIZE_MASK;
-    if (dst->format->color.alpha_size)
-	color_mask |= GLITZ_FORMAT_ALPHA_SIZE_MASK;
+    SCANLINE_TAIL (_scanline_yv12_to_32, src, dst, n, width,
+		   and_mask, or_mask);
+}
 
-    /* find direct format */
-    gl_format =
-	_glitz_find_gl_pixel_format (format, color_mask,
-				     dst->drawable->backend->feature_mask);
-    if (gl_format && gl_format->pixel.fourcc != dst->format->color.fourcc)
-	gl_format = NULL;
+static SSE2_FUNCTION void
+_premultiply_32_sse2 (uint32_t *line,
+		      int      width)
+{
+    __m128i zero = _mm_setzero_si128 ();
+    __m128i alpha_lanes = _mm_set_epi16 (0xff, 0, 0, 0, 0xff, 0, 0, 0);
+    __m128i half = _mm_set1_epi16 (0x80);
+    __m128i p, lo, hi, a;
+    int	    n;
 
-    if (gl_format == NULL)
+    for (n = 0; n + 4 <= width; n += 4)
     {
-	unsigned long feature_mask;
+	p = _mm_loadu_si128 ((const __m128i *) (line + n));
 
-	feature_mask = dst->drawable->backend->feature_mask;
-	transform |= GLITZ_TRANSFORM_PIXELS_MASK;
-	gl_format =
-	    _glitz_find_best_gl_pixel_format (format, &dst->format->color,
-					      feature_mask);
+	lo = _mm_unpacklo_epi8 (p, zero);
+	hi = _mm_unpackhi_epi8 (p, zero);
+
+	/* alpha is multiplied with 255 so that it is left unchanged */
+	a = _mm_shufflelo_epi16 (lo, _MM_SHUFFLE (3, 3, 3, 3));
+	a = _mm_or_si128 (_mm_shufflehi_epi16 (a, _MM_SHUFFLE (3, 3, 3, 3)),
+			  alpha_lanes);
+	lo = _mm_add_epi16 (_mm_mullo_epi16 (lo, a), half);
+	lo = _mm_srli_epi16 (_mm_add_epi16 (lo, _mm_srli_epi16 (lo, 8)), 8);
+
+	a = _mm_shufflelo_epi16 (hi, _MM_SHUFFLE (3, 3, 3, 3));
+	a = _mm_or_si128 (_mm_shufflehi_epi16 (a, _MM_SHUFFLE (3, 3, 3, 3)),
+			  alpha_lanes);
+	hi = _mm_add_epi16 (_mm_mullo_epi16 (hi, a), half);
+	hi = _mm_srli_epi16 (_mm_add_epi16 (hi, _mm_srli_epi16 (hi, 8)), 8);
+
+	_mm_storeu_si128 ((__m128i *) (line + n), _mm_packus_epi16 (lo, hi));
     }
 
-    /* avoid context switch in this case */
-    if (!dst->attached &&
-	TEXTURE_ALLOCATED (&dst->texture) &&
-	!GLITZ_REGION_NOTEMPTY (&dst->texture_damage))
-    {
-	dst->drawable->backend->push_current (dst->drawable, dst,
-					      GLITZ_ANY_CONTEXT_CURRENT,
-					      &restore_state);
-	texture = &dst->texture;
+    if (n < width)
+	_premultiply_32 (line + n, width - n);
+}
 
-	/* we are using a foreign context so we must restore all state when we
-	   are done */
-	if (restore_state)
-	{
-	    /* get pixel store state */
-	    gl->get_integer_v (GLITZ_GL_UNPACK_ROW_LENGTH,  &unpackrowlength);
-	    gl->get_integer_v (GLITZ_GL_UNPACK_ALIGNMENT,   &unpackalignment);
-	    gl->get_integer_v (GLITZ_GL_UNPACK_SKIP_ROWS,   &unpackskiprows);
-	    gl->get_integer_v (GLITZ_GL_UNPACK_SKIP_PIXELS, &unpackskippixels);
+#define SIMD(f) f ## _sse2
+#define _glitz_have_simd() glitz_have_sse2 ()
 
-	    /* get texture bindings */
-	    gl->get_integer_v (GLITZ_GL_TEXTURE_2D,                &t2d);
-	    gl->get_integer_v (GLITZ_GL_TEXTURE_BINDING_2D,        &tbind2d);
-	    gl->get_integer_v (GLITZ_GL_TEXTURE_RECTANGLE,         &trect);
-	    gl->get_integer_v (GLITZ_GL_TEXTURE_BINDING_RECTANGLE, &tbindrect);
+#else
 
-	    /* TODO: save PBO state */
-	}
+#define SIMD(f) NULL
+#define _glitz_have_simd() 0
 
-	surface = NULL;
-    }
-    else
+#endif
+
+/* Straight-line converters between the pixel formats used for GL
+ * transfers in _gl_rgb_pixel_formats and _gl_packed_rgb_pixel_formats
+ * and the common client formats that have no hand written scanline
+ * function above. They are instantiated from glitz_pixelimp.h. */
+
+#define A8R8G8B8_BPP 32
+#define A8R8G8B8_A   0xff000000
+#define A8R8G8B8_R   0x00ff0000
+#define A8R8G8B8_G   0x0000ff00
+#define A8R8G8B8_B   0x000000ff
+
+#define X8R8G8B8_BPP 32
+#define X8R8G8B8_A   0x00000000
+#define X8R8G8B8_R   0x00ff0000
+#define X8R8G8B8_G   0x0000ff00
+#define X8R8G8B8_B   0x000000ff
+
+#define A8B8G8R8_BPP 32
+#define A8B8G8R8_A   0xff000000
+#define A8B8G8R8_R   0x000000ff
+#define A8B8G8R8_G   0x0000ff00
+#define A8B8G8R8_B   0x00ff0000
+
+#define X8B8G8R8_BPP 32
+#define X8B8G8R8_A   0x00000000
+#define X8B8G8R8_R   0x000000ff
+#define X8B8G8R8_G   0x0000ff00
+#define X8B8G8R8_B   0x00ff0000
+
+#define R8G8B8_BPP   24
+#define R8G8B8_A     0x00000000
+#define R8G8B8_R     0x00ff0000
+#define R8G8B8_G     0x0000ff00
+#define R8G8B8_B     0x000000ff
+
+#define R5G6B5_BPP   16
+#define R5G6B5_A     0x00000000
+#define R5G6B5_R     0x0000f800
+#define R5G6B5_G     0x000007e0
+#define R5G6B5_B     0x0000001f
+
+#define A8_BPP       8
+#define A8_A         0x000000ff
+#define A8_R         0x00000000
+#define A8_G         0x00000000
+#define A8_B         0x00000000
+
+#define SRC A8R8G8B8
+#define DST X8B8G8R8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8R8G8B8
+#define DST A8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8
+#define DST A8R8G8B8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC X8R8G8B8
+#define DST A8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8
+#define DST X8R8G8B8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8B8G8R8
+#define DST A8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8
+#define DST A8B8G8R8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC X8B8G8R8
+#define DST A8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8
+#define DST X8B8G8R8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC R8G8B8
+#define DST A8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8
+#define DST R8G8B8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC R5G6B5
+#define DST A8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8
+#define DST R5G6B5
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC A8B8G8R8
+#define DST R5G6B5
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC R5G6B5
+#define DST A8B8G8R8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC X8B8G8R8
+#define DST R5G6B5
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC R5G6B5
+#define DST X8B8G8R8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC R8G8B8
+#define DST R5G6B5
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define SRC R5G6B5
+#define DST R8G8B8
+#include "glitz_pixelimp.h"
+#undef  DST
+#undef  SRC
+
+#define MASKS_A8R8G8B8 { 32, 0xff000000, 0x00ff0000, 0x0000ff00, 0x000000ff }
+#define MASKS_X8R8G8B8 { 32, 0x00000000, 0x00ff0000, 0x0000ff00, 0x000000ff }
+#define MASKS_A8B8G8R8 { 32, 0xff000000, 0x000000ff, 0x0000ff00, 0x00ff0000 }
+#define MASKS_X8B8G8R8 { 32, 0x00000000, 0x000000ff, 0x0000ff00, 0x00ff0000 }
+#define MASKS_R8G8B8   { 24, 0x00000000, 0x00ff0000, 0x0000ff00, 0x000000ff }
+#define MASKS_R5G6B5   { 16, 0x00000000, 0x0000f800, 0x000007e0, 0x0000001f }
+#define MASKS_A8       {  8, 0x000000ff, 0x00000000, 0x00000000, 0x00000000 }
+#define MASKS_A1       {  1, 0x00000001, 0x00000000, 0x00000000, 0x00000000 }
+#define MASKS_YUV      {  0, 0x00000000, 0x00000000, 0x00000000, 0x00000000 }
+
+#define RGB(masks)  GLITZ_FOURCC_RGB, MASKS_##masks
+#define YV12        GLITZ_FOURCC_YV12, MASKS_YUV
+#define YUY2        GLITZ_FOURCC_YUY2, MASKS_YUV
+
+static glitz_pixel_scanline_t _pixel_scanlines[] = {
     {
-	glitz_surface_push_current (dst, GLITZ_ANY_CONTEXT_CURRENT);
+	RGB (X8R8G8B8), RGB (A8R8G8B8), 0x00ffffff, 0xff000000,
+	_scanline_copy_32, SIMD (_scanline_copy_32)
+    }, {
+	RGB (A8R8G8B8), RGB (X8R8G8B8), 0x00ffffff, 0x00000000,
+	_scanline_copy_32, SIMD (_scanline_copy_32)
+    }, {
+	RGB (X8B8G8R8), RGB (A8B8G8R8), 0x00ffffff, 0xff000000,
+	_scanline_copy_32, SIMD (_scanline_copy_32)
+    }, {
+	RGB (A8B8G8R8), RGB (X8B8G8R8), 0x00ffffff, 0x00000000,
+	_scanline_copy_32, SIMD (_scanline_copy_32)
+    }, {
+	RGB (A8R8G8B8), RGB (A8B8G8R8), 0xffffffff, 0x00000000,
+	_scanline_swap_32, SIMD (_scanline_swap_32)
+    }, {
+	RGB (A8B8G8R8), RGB (A8R8G8B8), 0xffffffff, 0x00000000,
+	_scanline_swap_32, SIMD (_scanline_swap_32)
+    }, {
+	RGB (X8R8G8B8), RGB (A8B8G8R8), 0x00ffffff, 0xff000000,
+	_scanline_swap_32, SIMD (_scanline_swap_32)
+    }, {
+	RGB (X8B8G8R8), RGB (A8R8G8B8), 0x00ffffff, 0xff000000,
+	_scanline_swap_32, SIMD (_scanline_swap_32)
+    }, {
+	RGB (R5G6B5), RGB (A8R8G8B8), 0xffffffff, 0xff000000,
+	_scanline_16_to_32, SIMD (_scanline_16_to_32)
+    }, {
+	RGB (R5G6B5), RGB (X8R8G8B8), 0xffffffff, 0x00000000,
+	_scanline_16_to_32, SIMD (_scanline_16_to_32)
+    }, {
+	RGB (A8R8G8B8), RGB (R5G6B5), 0xffffffff, 0x00000000,
+	_scanline_32_to_16, SIMD (_scanline_32_to_16)
+    }, {
+	RGB (X8R8G8B8), RGB (R5G6B5), 0xffffffff, 0x00000000,
+	_scanline_32_to_16, SIMD (_scanline_32_to_16)
+    }, {
+	RGB (R8G8B8), RGB (A8R8G8B8), 0xffffffff, 0xff000000,
+	_scanline_24_to_32, NULL
+    }, {
+	RGB (R8G8B8), RGB (X8R8G8B8), 0xffffffff, 0x00000000,
+	_scanline_24_to_32, NULL
+    }, {
+	RGB (A8R8G8B8), RGB (R8G8B8), 0xffffffff, 0x00000000,
+	_scanline_32_to_24, NULL
+    }, {
+	RGB (X8R8G8B8), RGB (R8G8B8), 0xffffffff, 0x00000000,
+	_scanline_32_to_24, NULL
+    }, {
+	RGB (A1), RGB (A8), 0xffffffff, 0x00000000,
+	_scanline_1_to_8, NULL
+    }, {
+	RGB (A8), RGB (A1), 0xffffffff, 0x00000000,
+	_scanline_8_to_1, NULL
+    }, {
+	YV12, RGB (A8R8G8B8), 0xffffffff, 0xff000000,
+	_scanline_yv12_to_32, SIMD (_scanline_yv12_to_32)
+    }, {
+	YV12, RGB (X8R8G8B8), 0xffffffff, 0x00000000,
+	_scanline_yv12_to_32, SIMD (_scanline_yv12_to_32)
+    }, {
+	YUY2, RGB (A8R8G8B8), 0xffffffff, 0xff000000,
+	_scanline_yuy2_to_32, NULL
+    }, {
+	YUY2, RGB (X8R8G8B8), 0xffffffff, 0x00000000,
+	_scanline_yuy2_to_32, NULL
+    }, {
+	RGB (A8R8G8B8), YV12, 0xffffffff, 0x00000000,
+	_scanline_32_to_yv12, NULL
+    }, {
+	RGB (X8R8G8B8), YV12, 0xffffffff, 0x00000000,
+	_scanline_32_to_yv12, NULL
+    }, {
+	RGB (A8R8G8B8), YUY2, 0xffffffff, 0x00000000,
+	_scanline_32_to_yuy2, NULL
+    }, {
+	RGB (X8R8G8B8), YUY2, 0xffffffff, 0x00000000,
+	_scanline_32_to_yuy2, NULL
+    }, {
+	RGB (A8R8G8B8), RGB (X8B8G8R8), 0xffffffff, 0x00000000,
+	_convert_A8R8G8B8_to_X8B8G8R8, NULL
+    }, {
+	RGB (A8R8G8B8), RGB (A8), 0xffffffff, 0x00000000,
+	_convert_A8R8G8B8_to_A8, NULL
+    }, {
+	RGB (A8), RGB (A8R8G8B8), 0xffffffff, 0x00000000,
+	_convert_A8_to_A8R8G8B8, NULL
+    }, {
+	RGB (X8R8G8B8), RGB (A8), 0xffffffff, 0x00000000,
+	_convert_X8R8G8B8_to_A8, NULL
+    }, {
+	RGB (A8), RGB (X8R8G8B8), 0xffffffff, 0x00000000,
+	_convert_A8_to_X8R8G8B8, NULL
+    }, {
+	RGB (A8B8G8R8), RGB (A8), 0xffffffff, 0x00000000,
+	_convert_A8B8G8R8_to_A8, NULL
+    }, {
+	RGB (A8), RGB (A8B8G8R8), 0xffffffff, 0x00000000,
+	_convert_A8_to_A8B8G8R8, NULL
+    }, {
+	RGB (X8B8G8R8), RGB (A8), 0xffffffff, 0x00000000,
+	_convert_X8B8G8R8_to_A8, NULL
+    }, {
+	RGB (A8), RGB (X8B8G8R8), 0xffffffff, 0x00000000,
+	_convert_A8_to_X8B8G8R8, NULL
+    }, {
+	RGB (R8G8B8), RGB (A8), 0xffffffff, 0x00000000,
+	_convert_R8G8B8_to_A8, NULL
+    }, {
+	RGB (A8), RGB (R8G8B8), 0xffffffff, 0x00000000,
+	_convert_A8_to_R8G8B8, NULL
+    }, {
+	RGB (R5G6B5), RGB (A8), 0xffffffff, 0x00000000,
+	_convert_R5G6B5_to_A8, NULL
+    }, {
+	RGB (A8), RGB (R5G6B5), 0xffffffff, 0x00000000,
+	_convert_A8_to_R5G6B5, NULL
+    }, {
+	RGB (A8B8G8R8), RGB (R5G6B5), 0xffffffff, 0x00000000,
+	_convert_A8B8G8R8_to_R5G6B5, NULL
+    }, {
+	RGB (R5G6B5), RGB (A8B8G8R8), 0xffffffff, 0x00000000,
+	_convert_R5G6B5_to_A8B8G8R8, NULL
+    }, {
+	RGB (X8B8G8R8), RGB (R5G6B5), 0xffffffff, 0x00000000,
+	_convert_X8B8G8R8_to_R5G6B5, NULL
+    }, {
+	RGB (R5G6B5), RGB (X8B8G8R8), 0xffffffff, 0x00000000,
+	_convert_R5G6B5_to_X8B8G8R8, NULL
+    }, {
+	RGB (R8G8B8), RGB (R5G6B5), 0xffffffff, 0x00000000,
+	_convert_R8G8B8_to_R5G6B5, NULL
+    }, {
+	RGB (R5G6B5), RGB (R8G8B8), 0xffffffff, 0x00000000,
+	_convert_R5G6B5_to_R8G8B8, NULL
+    }
+};
 
-	texture = glitz_surface_get_texture (dst, 1);
-	if (!texture) {
-	    glitz_surface_pop_current (dst);
-	    return;
-	}
+#define N_PIXEL_SCANLINES						\
+    (sizeof (_pixel_scanlines) / sizeof (glitz_pixel_scanline_t))
 
-	restore_state = 0;
-	surface = dst;
-    }
+static glitz_bool_t
+_glitz_pixel_format_equal (glitz_fourcc_t	      fourcc,
+			   const glitz_pixel_masks_t  *masks,
+			   const glitz_pixel_format_t *format)
+{
+    if (fourcc != format->fourcc)
+	return 0;
 
-    if (height > 1) {
-	if (format->scanline_order != gl_format->pixel.scanline_order)
-	    transform |= GLITZ_TRANSFORM_SCANLINE_ORDER_MASK;
-    }
+    if (fourcc != GLITZ_FOURCC_RGB)
+	return 1;
 
-    glitz_texture_bind (gl, texture);
+    return (masks->bpp        == format->masks.bpp        &&
+	    masks->alpha_mask == format->masks.alpha_mask &&
+	    masks->red_mask   == format->masks.red_mask   &&
+	    masks->green_mask == format->masks.green_mask &&
+	    masks->blue_mask  == format->masks.blue_mask);
+}
 
-    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_PIXELS, 0);
-    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_ROWS, 0);
+static glitz_pixel_scanline_t *
+_glitz_find_pixel_scanline (glitz_pixel_format_t	     *src,
+			    glitz_pixel_format_t	     *dst,
+			    glitz_pixel_scanline_function_t *convert)
+{
+    glitz_pixel_scanline_t *scanline;
+    int			   i;
 
-    while (n_clip--)
+    for (i = 0; i < N_PIXEL_SCANLINES; i++)
     {
-	box.x1 = clip->x1 + dst->x_clip;
-	box.y1 = clip->y1 + dst->y_clip;
-	box.x2 = clip->x2 + dst->x_clip;
-	box.y2 = clip->y2 + dst->y_clip;
-	if (x_dst > box.x1)
-	    box.x1 = x_dst;
-	if (y_dst > box.y1)
-	    box.y1 = y_dst;
-	if (x_dst + width < box.x2)
-	    box.x2 = x_dst + width;
-	if (y_dst + height < box.y2)
-	    box.y2 = y_dst + height;
+	scanline = &_pixel_scanlines[i];
 
-	if (box.x1 < box.x2 && box.y1 < box.y2)
+	if (_glitz_pixel_format_equal (scanline->src_fourcc,
+				       &scanline->src, src) &&
+	    _glitz_pixel_format_equal (scanline->dst_fourcc,
+				       &scanline->dst, dst))
 	{
-	    if (transform)
-	    {
-		if (!data)
-		{
-		    int size;
+	    *convert = scanline->convert;
+	    if (scanline->convert_simd && _glitz_have_simd ())
+		*convert = scanline->convert_simd;
 
-		    switch (gl_format->pixel.fourcc) {
-		    case GLITZ_FOURCC_YV12:
-			bytes_per_line  = (width + 3) & -4;
-			bytes_per_pixel = 1;
-			size = bytes_per_line * height +
-			    bytes_per_line * ((height + 1) >> 1);
-			break;
-		    default:
-			bytes_per_line =
-			    (((width * gl_format->pixel.masks.bpp) / 8) + 3) &
-			    -4;
-			bytes_per_pixel = gl_format->pixel.masks.bpp / 8;
-			size = bytes_per_line * height;
-			break;
-		    }
+	    return scanline;
+	}
+    }
 
-		    data = malloc (size);
-		    if (!data)
-		    {
-			glitz_surface_status_add (dst,
-						  GLITZ_STATUS_NO_MEMORY_MASK);
-			goto BAIL;
-		    }
+    return NULL;
+}
 
-		    dst_image.data = pixels = data;
-		    dst_image.format = &gl_format->pixel;
+#define GLITZ_TRANSFORM_PIXELS_MASK         (1L << 0)
+#define GLITZ_TRANSFORM_SCANLINE_ORDER_MASK (1L << 1)
+#define GLITZ_TRANSFORM_COPY_BOX_MASK       (1L << 2)
+#define GLITZ_TRANSFORM_YUV_BT709_MASK      (1L << 3)
+#define GLITZ_TRANSFORM_PREMULTIPLY_MASK    (1L << 4)
+#define GLITZ_TRANSFORM_UNPREMULTIPLY_MASK  (1L << 5)
 
-		    ptr = glitz_buffer_map (buffer,
-					    GLITZ_BUFFER_ACCESS_READ_ONLY);
-		    src_image.format = format;
+typedef struct _glitz_image {
+    char		 *data;
+    glitz_pixel_format_t *format;
+    int			 width;
+    int			 height;
+} glitz_image_t;
 
-		    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 4);
-		    gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,
-				       bytes_per_line / bytes_per_pixel);
-		}
+typedef struct _glitz_pixel_transform_band {
+    unsigned long		    transform;
+    glitz_image_t		    *src;
+    glitz_image_t		    *dst;
+    int				    x_src, y_src;
+    int				    x_dst, y_dst;
+    int				    width;
+    int				    src_stride, dst_stride;
+    int				    src_planeoffset, dst_planeoffset;
+    int				    bytes_per_pixel;
+    glitz_pixel_fetch_function_t    fetch;
+    glitz_pixel_store_function_t    store;
+    glitz_pixel_scanline_t	    *scanline;
+    glitz_pixel_scanline_function_t convert;
+    const glitz_yuv_tables_t	    *yuv;
+    glitz_pixel_alpha_line_function_t  alpha_line;
+    glitz_pixel_alpha_color_function_t alpha_color;
+    glitz_pixel_color_t		    alpha_bias;
+} glitz_pixel_transform_band_t;
+
+/* Converts rows [y1, y2). Rows are independent of each other, except
+   that YV12 chroma is stored on even rows, so bands must start on an
+   even row. */
+static void
+_glitz_pixel_transform_rows (void *closure,
+			     int  y1,
+			     int  y2)
+{
+    glitz_pixel_transform_band_t *band = closure;
+    glitz_image_t		 *src = band->src;
+    glitz_image_t		 *dst = band->dst;
+    int				 src_stride = band->src_stride;
+    int				 dst_stride = band->dst_stride;
+    int				 src_planeoffset = band->src_planeoffset;
+    int				 dst_planeoffset = band->dst_planeoffset;
+    int				 x_src = band->x_src, y_src = band->y_src;
+    int				 x_dst = band->x_dst, y_dst = band->y_dst;
+    int				 width = band->width;
+    int				 bytes_per_pixel = band->bytes_per_pixel;
+    int				 x, y;
+    char			 *line;
+    glitz_pixel_color_t		 color;
+    glitz_pixel_transform_op_t	 src_op, dst_op;
 
-		dst_image.width  = box.x2 - box.x1;
-		dst_image.height = box.y2 - box.y1;
+    src_op.yuv = dst_op.yuv = band->yuv;
 
-		src_image.width  = box.x2 - box.x1;
-		src_image.height = box.y2 - box.y1;
+    src_op.format = src->format;
+    src_op.color = &color;
 
-		src_image.data = ptr;
+    dst_op.format = dst->format;
+    dst_op.color = &color;
 
-		_glitz_pixel_transform (transform,
-					&src_image,
-					&dst_image,
-					format->xoffset + box.x1 - x_dst,
-					format->skip_lines + box.y1 - y_dst,
-					0, 0,
-					box.x2 - box.x1, box.y2 - box.y1);
+    for (y = y1; y < y2; y++) {
+	if (src->format->scanline_order != dst->format->scanline_order)
+	{
+	    src_op.line = &src->data[(src->height + y_src - y - 1) *
+				     src_stride];
+	}
+	else
+	    src_op.line = &src->data[(y + y_src) * src_stride];
+
+	switch (src->format->fourcc) {
+	case GLITZ_FOURCC_YV12:
+	case GLITZ_FOURCC_I420:
+	    if (src->format->scanline_order != dst->format->scanline_order)
+	    {
+		src_op.line2 =
+		    &src->data[src_planeoffset +
+			       (((src->height + y_src - y - 1) >> 1))
+			       * (src_stride >> 1)];
+		src_op.line3 =
+		    &src->data[src_planeoffset +
+			       (src_planeoffset >> 2) +
+			       (((src->height + y_src - y - 1) >> 1))
+			       * (src_stride >> 1)];
 	    }
 	    else
 	    {
-		if (!bound)
-		{
-		    ptr = glitz_buffer_bind (buffer,
-					     GLITZ_GL_PIXEL_UNPACK_BUFFER);
-
-		    bytes_per_line = format->bytes_per_line;
-		    switch (format->fourcc) {
-		    case GLITZ_FOURCC_YV12:
-			bytes_per_pixel = 1;
-			break;
-		    default:
-			bytes_per_pixel = format->masks.bpp / 8;
-		    }
+		src_op.line2 =
+		    &src->data[src_planeoffset +
+			       ((y + y_src) >> 1) * (src_stride >> 1)];
+		src_op.line3 =
+		    &src->data[src_planeoffset +
+			       (src_planeoffset >> 2) +
+			       ((y + y_src) >> 1) * (src_stride >> 1)];
+	    }
+	    break;
+	case GLITZ_FOURCC_NV12:
+	case GLITZ_FOURCC_P010:
+	    if (src->format->scanline_order != dst->format->scanline_order)
+		src_op.line2 =
+		    &src->data[src_planeoffset +
+			       ((src->height + y_src - y - 1) >> 1) *
+			       src_stride];
+	    else
+		src_op.line2 =
+		    &src->data[src_planeoffset +
+			       ((y + y_src) >> 1) * src_stride];
+	    break;
+	}
 
-		    if (bytes_per_line)
-		    {
-			if ((bytes_per_line % 4) == 0)
-			    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 4);
-			else if ((bytes_per_line % 2) == 0)
-			    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 2);
-			else
-			    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
+	/* I420 has the U plane first */
+	if (src->format->fourcc == GLITZ_FOURCC_I420)
+	{
+	    line = src_op.line2;
+	    src_op.line2 = src_op.line3;
+	    src_op.line3 = line;
+	}
 
-			gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,
-					   bytes_per_line / bytes_per_pixel);
-		    }
-		    else
-		    {
-			gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
-			gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH, width);
-			bytes_per_line = width * bytes_per_pixel;
-		    }
-		    bound = 1;
-		}
+	dst_op.line  = &dst->data[(y + y_dst) * dst_stride];
+	dst_op.line2 = dst_op.line3 = NULL;
 
-		pixels = ptr +
-		    (format->skip_lines + y_dst + height - box.y2) *
-		    bytes_per_line +
-		    (format->xoffset + box.x1 - x_dst) * bytes_per_pixel;
+	switch (dst->format->fourcc) {
+	case GLITZ_FOURCC_YV12:
+	case GLITZ_FOURCC_I420:
+	    if ((y & 1) == 0)
+	    {
+		dst_op.line2 =
+		    &dst->data[dst_planeoffset +
+			       ((y + y_dst) >> 1) * (dst_stride >> 1)];
+		dst_op.line3 =
+		    &dst->data[dst_planeoffset + (dst_planeoffset >> 2) +
+			       ((y + y_dst) >> 1) * (dst_stride >> 1)];
 	    }
+	    break;
+	case GLITZ_FOURCC_NV12:
+	case GLITZ_FOURCC_P010:
+	    if ((y & 1) == 0)
+		dst_op.line2 =
+		    &dst->data[dst_planeoffset +
+			       ((y + y_dst) >> 1) * dst_stride];
+	    break;
+	}
 
-	    switch (gl_format->pixel.fourcc) {
-	    case GLITZ_FOURCC_YV12:
-		gl->tex_sub_image_2d (texture->target, 0,
-				      box.x1,
-				      texture->box.y2 - box.y2,
-				      box.x2 - box.x1, box.y2 - box.y1,
-				      gl_format->format, gl_format->type,
-				      pixels);
+	if (dst->format->fourcc == GLITZ_FOURCC_I420)
+	{
+	    line = dst_op.line2;
+	    dst_op.line2 = dst_op.line3;
+	    dst_op.line3 = line;
+	}
 
-		if ((bytes_per_line % 8) == 0)
-		    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 4);
-		else if ((bytes_per_line % 4) == 0)
-		    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 2);
-		else
-		    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
+	if (band->scanline)
+	{
+	    src_op.offset = x_src;
+	    dst_op.offset = x_dst;
 
-		gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,
-				   (bytes_per_line / bytes_per_pixel) >> 1);
+	    band->convert (&src_op, &dst_op, width,
+			   band->scanline->and_mask, band->scanline->or_mask);
+	}
+	else if (band->transform & GLITZ_TRANSFORM_PIXELS_MASK)
+	{
+	    for (x = 0; x < width; x++)
+	    {
+		src_op.offset = x_src + x;
+		dst_op.offset = x_dst + x;
 
-		gl->tex_sub_image_2d (texture->target, 0,
-				      (box.x1 >> 1),
-				      texture->height - ((box.y2 + 1) >> 1),
-				      (box.x2 - box.x1 + 1) >> 1,
-				      (box.y2 - box.y1 + 1) >> 1,
-				      gl_format->format, gl_format->type,
-				      pixels + bytes_per_line * height);
+		band->fetch (&src_op);
+		if (band->alpha_color)
+		    band->alpha_color (&color, &band->alpha_bias);
+		band->store (&dst_op);
+	    }
+	}
+	else
+	{
+	    memcpy (&dst_op.line[x_dst * bytes_per_pixel],
+		    &src_op.line[x_src * bytes_per_pixel],
+		    width * bytes_per_pixel);
 
-		gl->tex_sub_image_2d (texture->target, 0,
-				      (texture->width >> 1) + (box.x1 >> 1),
-				      texture->height - ((box.y2 + 1) >> 1),
-				      (box.x2 - box.x1 + 1) >> 1,
-				      (box.y2 - box.y1 + 1) >> 1,
-				      gl_format->format, gl_format->type,
-				      pixels + bytes_per_line * height +
-				      ((bytes_per_line * height) >> 2));
+	    switch (dst->format->fourcc) {
+	    case GLITZ_FOURCC_YV12:
+	    case GLITZ_FOURCC_I420:
+		/* Will overwrite color components of adjacent pixels for odd
+		 * image sizes or not update color on odd start lines -
+		 * who cares? */
+		if ((y & 1) == 0)
+		{
+		    memcpy (&dst_op.line2[x_dst >> 1],
+			    &src_op.line2[x_src >> 1],
+			    width >> 1);
+		    memcpy (&dst_op.line3[x_dst >> 1],
+			    &src_op.line3[x_src >> 1],
+			    width >> 1);
+		}
 		break;
-	    case GLITZ_FOURCC_YUY2:
-		gl->tex_sub_image_2d (texture->target, 0,
-				      texture->box.x1 + (box.x1 >> 1),
-				      texture->box.y2 - box.y2,
-				      (box.x2 - box.x1 + 1) >> 1,
-				      box.y2 - box.y1,
-				      gl_format->format, gl_format->type,
-				      pixels);
+	    case GLITZ_FOURCC_NV12:
+	    case GLITZ_FOURCC_P010:
+		/* interleaved chroma pairs */
+		if ((y & 1) == 0)
+		    memcpy (&dst_op.line2[(x_dst >> 1) * 2 * bytes_per_pixel],
+			    &src_op.line2[(x_src >> 1) * 2 * bytes_per_pixel],
+			    ((width + 1) >> 1) * 2 * bytes_per_pixel);
 		break;
-	    default:
-		gl->tex_sub_image_2d (texture->target, 0,
-				      texture->box.x1 + box.x1,
-				      texture->box.y2 - box.y2,
-				      box.x2 - box.x1, box.y2 - box.y1,
-				      gl_format->format, gl_format->type,
-				      pixels);
 	    }
+	}
 
-	    glitz_surface_damage (dst, &box,
-				  GLITZ_DAMAGE_DRAWABLE_MASK |
-				  GLITZ_DAMAGE_SOLID_MASK);
+	if (band->alpha_line)
+	    band->alpha_line ((uint32_t *) dst_op.line + x_dst, width);
+    }
+}
+
+/* 32 bit pixels with 8 bit channels and alpha in the top byte */
+static glitz_bool_t
+_glitz_pixel_format_argb_32 (glitz_pixel_format_t *format)
+{
+    unsigned long r = format->masks.red_mask;
+    unsigned long g = format->masks.green_mask;
+    unsigned long b = format->masks.blue_mask;
+
+#define BYTE_MASK(m) ((m) == 0xff || (m) == 0xff00 || (m) == 0xff0000)
+
+    return format->fourcc == GLITZ_FOURCC_RGB &&
+	format->masks.bpp == 32		   &&
+	format->masks.alpha_mask == 0xff000000 &&
+	BYTE_MASK (r) && BYTE_MASK (g) && BYTE_MASK (b) &&
+	(r | g | b) == 0xffffff;
+
+#undef BYTE_MASK
+}
+
+static void
+_glitz_pixel_transform (unsigned long transform,
+			glitz_image_t *src,
+			glitz_image_t *dst,
+			int           x_src,
+			int           y_src,
+			int           x_dst,
+			int           y_dst,
+			int           width,
+			int           height)
+{
+    glitz_pixel_transform_band_t band;
+    glitz_yuv_matrix_t		 yuv_matrix;
+
+    band.transform = transform;
+    band.src       = src;
+    band.dst       = dst;
+    band.x_src     = x_src;
+    band.y_src     = y_src;
+    band.x_dst     = x_dst;
+    band.y_dst     = y_dst;
+    band.width     = width;
+
+    band.src_planeoffset = band.dst_planeoffset = 0;
+    band.bytes_per_pixel = 0;
+    band.scanline = NULL;
+    band.convert  = NULL;
+    band.alpha_line  = NULL;
+    band.alpha_color = NULL;
+
+    if (transform & GLITZ_TRANSFORM_PIXELS_MASK)
+	band.scanline = _glitz_find_pixel_scanline (src->format, dst->format,
+						    &band.convert);
+
+    if (transform & GLITZ_TRANSFORM_PREMULTIPLY_MASK)
+    {
+	if (_glitz_pixel_format_argb_32 (dst->format))
+	{
+	    band.alpha_line = _premultiply_32;
+	    if (_glitz_have_simd ())
+		band.alpha_line = SIMD (_premultiply_32);
+	}
+	else
+	    band.alpha_color = _premultiply_color;
+    }
+    else if (transform & GLITZ_TRANSFORM_UNPREMULTIPLY_MASK)
+    {
+	if (_glitz_pixel_format_argb_32 (dst->format))
+	    band.alpha_line = _unpremultiply_32;
+	else
+	    band.alpha_color = _unpremultiply_color;
+    }
+
+    /* colors must be converted between fetch and store */
+    if (band.alpha_color)
+    {
+	band.alpha_bias.r = _alpha_bias (dst->format->masks.red_mask);
+	band.alpha_bias.g = _alpha_bias (dst->format->masks.green_mask);
+	band.alpha_bias.b = _alpha_bias (dst->format->masks.blue_mask);
+	band.alpha_bias.a = 0;
+
+	band.transform |= GLITZ_TRANSFORM_PIXELS_MASK;
+	band.scanline = NULL;
+    }
+
+    if (transform & GLITZ_TRANSFORM_YUV_BT709_MASK)
+	yuv_matrix = GLITZ_YUV_MATRIX_BT709;
+    else
+	yuv_matrix = GLITZ_YUV_MATRIX_BT601;
+
+    band.yuv = _glitz_get_yuv_tables (yuv_matrix);
+
+    switch (src->format->fourcc) {
+    case GLITZ_FOURCC_RGB:
+	switch (src->format->masks.bpp) {
+	case 1:
+	    band.fetch = _fetch_1;
+	    break;
+	case 8:
+	    band.fetch = _fetch_8;
+	    break;
+	case 16:
+	    band.fetch = _fetch_16;
+	    break;
+	case 24:
+	    band.fetch = _fetch_24;
+	    break;
+	case 32:
+	default:
+	    band.fetch = _fetch_32;
+	}
+	break;
+    case GLITZ_FOURCC_YV12:
+    case GLITZ_FOURCC_I420:
+	band.fetch = _fetch_yv12;
+	break;
+    case GLITZ_FOURCC_YUY2:
+	band.fetch = _fetch_yuy2;
+	break;
+    default:
+	band.fetch = _fetch_32;
+    }
+
+    switch (dst->format->fourcc) {
+    case GLITZ_FOURCC_RGB:
+	switch (dst->format->masks.bpp) {
+	case 1:
+	    band.store = _store_1;
+	    break;
+	case 8:
+	    band.store = _store_8;
+	    break;
+	case 16:
+	    band.store = _store_16;
+	    break;
+	case 24:
+	    band.store = _store_24;
+	    break;
+	case 32:
+	default:
+	    band.store = _store_32;
+	}
+	break;
+    case GLITZ_FOURCC_YV12:
+    case GLITZ_FOURCC_I420:
+	band.store = _store_yv12;
+	break;
+    case GLITZ_FOURCC_YUY2:
+	band.store = _store_yuy2;
+	break;
+    default:
+	band.store = _store_32;
+    }
+
+    switch (src->format->fourcc) {
+    case GLITZ_FOURCC_YV12:
+    case GLITZ_FOURCC_I420:
+    case GLITZ_FOURCC_NV12:
+	band.src_stride = (src->format->bytes_per_line) ?
+	    src->format->bytes_per_line: (src->width + 3) & -4;
+	band.src_planeoffset = band.src_stride * src->height;
+	band.bytes_per_pixel = 1;
+	break;
+    case GLITZ_FOURCC_P010:
+	band.src_stride = (src->format->bytes_per_line) ?
+	    src->format->bytes_per_line: ((src->width << 1) + 3) & -4;
+	band.src_planeoffset = band.src_stride * src->height;
+	band.bytes_per_pixel = 2;
+	break;
+    default:
+	band.src_stride = (src->format->bytes_per_line) ?
+	    src->format->bytes_per_line:
+	    (((src->width * src->format->masks.bpp) / 8) + 3) & -4;
+	/* This only works for bpp % 8 = 0, but it shouldn't be a problem as
+	 * it will never be used for bitmaps */
+	band.bytes_per_pixel = src->format->masks.bpp / 8;
+    }
+
+    if (band.src_stride == 0)
+	band.src_stride = 1;
+
+    switch (dst->format->fourcc) {
+    case GLITZ_FOURCC_YV12:
+    case GLITZ_FOURCC_I420:
+    case GLITZ_FOURCC_NV12:
+	band.dst_stride = (dst->format->bytes_per_line) ?
+	    dst->format->bytes_per_line: (dst->width + 3) & -4;
+	band.dst_planeoffset = band.dst_stride * dst->height;
+	break;
+    case GLITZ_FOURCC_P010:
+	band.dst_stride = (dst->format->bytes_per_line) ?
+	    dst->format->bytes_per_line: ((dst->width << 1) + 3) & -4;
+	band.dst_planeoffset = band.dst_stride * dst->height;
+	break;
+    default:
+	band.dst_stride = (dst->format->bytes_per_line) ?
+	    dst->format->bytes_per_line:
+	    (((dst->width * dst->format->masks.bpp) / 8) + 3) & -4;
+    }
+
+    if (band.dst_stride == 0)
+	band.dst_stride = 1;
+
+    /* with an odd height the last row of the first chroma plane of a
+       YV12 or I420 image overlaps the first row of the second one, so
+       rows must be stored in order */
+    if ((dst->format->fourcc == GLITZ_FOURCC_YV12 ||
+	 dst->format->fourcc == GLITZ_FOURCC_I420) && (dst->height & 1))
+	_glitz_pixel_transform_rows (&band, 0, height);
+    else
+	glitz_run_bands (_glitz_pixel_transform_rows, &band, height, 2,
+			 (unsigned long) width * height);
+}
+
+static glitz_bool_t
+_glitz_format_match (glitz_pixel_format_t *format1,
+		     glitz_pixel_format_t *format2,
+		     unsigned long	   mask)
+{
+    if (format1->fourcc != format2->fourcc)
+	return 0;
+
+    switch (format1->fourcc) {
+    case GLITZ_FOURCC_RGB:
+	if (format1->masks.bpp != format2->masks.bpp)
+	    return 0;
+
+	if (mask & GLITZ_FORMAT_RED_SIZE_MASK)
+	    if (format1->masks.red_mask != format2->masks.red_mask)
+		return 0;
+
+	if (mask & GLITZ_FORMAT_GREEN_SIZE_MASK)
+	    if (format1->masks.green_mask != format2->masks.green_mask)
+		return 0;
+
+	if (mask & GLITZ_FORMAT_BLUE_SIZE_MASK)
+	    if (format1->masks.blue_mask != format2->masks.blue_mask)
+		return 0;
+
+	if (mask & GLITZ_FORMAT_ALPHA_SIZE_MASK)
+	    if (format1->masks.alpha_mask != format2->masks.alpha_mask)
+		return 0;
+	break;
+    default:
+	return 1;
+    }
+
+    return 1;
+}
+
+static glitz_gl_pixel_format_t *
+_glitz_find_gl_pixel_format (glitz_pixel_format_t *format,
+			     unsigned long	  color_mask,
+			     unsigned long        feature_mask)
+{
+    int i;
+
+    for (i = 0; i < N_RGB_FORMATS; i++)
+    {
+	if (_glitz_format_match (&_gl_rgb_pixel_formats[i].pixel,
+				 format, color_mask))
+	    return &_gl_rgb_pixel_formats[i];
+    }
+
+    if (feature_mask & GLITZ_FEATURE_PACKED_PIXELS_MASK)
+    {
+	for (i = 0; i < N_PACKED_RGB_FORMATS; i++)
+	{
+	    if (_glitz_format_match (&_gl_packed_rgb_pixel_formats[i].pixel,
+				     format, color_mask))
+		return &_gl_packed_rgb_pixel_formats[i];
+	}
+    }
+
+    for (i = 0; i < N_YUV_FORMATS; i++)
+    {
+	if (_glitz_format_match (&_gl_yuv_pixel_formats[i].pixel,
+				 format, color_mask))
+	    return &_gl_yuv_pixel_formats[i];
+    }
+
+    return NULL;
+}
+
+static int
+_component_size (unsigned long mask)
+{
+    unsigned long y;
+
+    /* HACKMEM 169 */
+    y = (mask >> 1) & 033333333333;
+    y = mask - y - ((y >> 1) & 033333333333);
+    return (((y + (y >> 3)) & 030707070707) % 077);
+}
+
+static glitz_bool_t
+_glitz_rgb_format_diff (glitz_pixel_masks_t  *masks,
+			glitz_color_format_t *pixel_color,
+			glitz_color_format_t *internal_color,
+			int                  *diff)
+{
+    int size;
+
+    *diff = 0;
+
+    size = _component_size (masks->red_mask);
+    if (size < pixel_color->red_size && size < internal_color->red_size)
+	return 0;
+
+    *diff += abs (size - internal_color->red_size);
+
+    size = _component_size (masks->green_mask);
+    if (size < pixel_color->green_size && size < internal_color->green_size)
+	return 0;
+
+    *diff += abs (size - internal_color->green_size);
+
+    size = _component_size (masks->blue_mask);
+    if (size < pixel_color->blue_size && size < internal_color->blue_size)
+	return 0;
+
+    *diff += abs (size - internal_color->blue_size);
+
+    size = _component_size (masks->alpha_mask);
+    if (size < pixel_color->alpha_size && size < internal_color->alpha_size)
+	return 0;
+
+    *diff += abs (size - internal_color->alpha_size);
+
+    return 1;
+}
+
+static glitz_gl_pixel_format_t *
+_glitz_find_best_gl_pixel_format (glitz_pixel_format_t *format,
+				  glitz_color_format_t *internal_color,
+				  unsigned long        feature_mask)
+{
+    glitz_gl_pixel_format_t *best = _gl_rgb_pixel_formats;
+    glitz_color_format_t    color;
+    int			    i, diff, best_diff = MAXSHORT;
+    glitz_pixel_masks_t     *masks;
+
+    switch (internal_color->fourcc) {
+    case GLITZ_FOURCC_RGB:
+	break;
+    default:
+	for (i = 0; i < N_YUV_FORMATS; i++)
+	{
+	    glitz_fourcc_t fourcc;
+
+	    fourcc = internal_color->fourcc;
+	    if (_gl_yuv_pixel_formats[i].pixel.fourcc == fourcc)
+		return &_gl_yuv_pixel_formats[i];
+	}
+    }
+
+    switch (format->fourcc) {
+    case GLITZ_FOURCC_RGB:
+	color.red_size   = _component_size (format->masks.red_mask);
+	color.green_size = _component_size (format->masks.green_mask);
+	color.blue_size  = _component_size (format->masks.blue_mask);
+	color.alpha_size = _component_size (format->masks.alpha_mask);
+	break;
+    case GLITZ_FOURCC_YV12:
+    case GLITZ_FOURCC_I420:
+    case GLITZ_FOURCC_YUY2:
+	color.red_size = color.green_size = color.blue_size = 8;
+	color.alpha_size = 0;
+	break;
+    default:
+	color.red_size = color.green_size = color.blue_size =
+	    color.alpha_size = 8;
+	break;
+    }
+
+    for (i = 0; best_diff > 0 && i < N_RGB_FORMATS; i++)
+    {
+	masks = &_gl_rgb_pixel_formats[i].pixel.masks;
+	if (_glitz_rgb_format_diff (masks, &color, internal_color, &diff))
+	{
+	    if (diff < best_diff)
+	    {
+		best = &_gl_rgb_pixel_formats[i];
+		best_diff = diff;
+	    }
+	}
+    }
+
+    if (!(feature_mask & GLITZ_FEATURE_PACKED_PIXELS_MASK))
+	return best;
+
+    for (i = 0; best_diff > 0 && i < N_PACKED_RGB_FORMATS; i++)
+    {
+	masks = &_gl_packed_rgb_pixel_formats[i].pixel.masks;
+	if (_glitz_rgb_format_diff (masks, &color, internal_color, &diff))
+	{
+	    if (diff < best_diff)
+	    {
+		best = &_gl_packed_rgb_pixel_formats[i];
+		best_diff = diff;
+	    }
+	}
+    }
+
+    return best;
+}
+
+/* formats that _glitz_pixel_transform can fetch and store */
+static glitz_bool_t
+_glitz_fourcc_convertible (glitz_fourcc_t fourcc)
+{
+    switch (fourcc) {
+    case GLITZ_FOURCC_RGB:
+    case GLITZ_FOURCC_YV12:
+    case GLITZ_FOURCC_I420:
+    case GLITZ_FOURCC_YUY2:
+	return 1;
+    default:
+	return 0;
+    }
+}
+
+static void
+_glitz_set_unpack_stride (glitz_gl_proc_address_list_t *gl,
+			  int			       bytes_per_line,
+			  int			       bytes_per_texel)
+{
+    if ((bytes_per_line % 4) == 0)
+	gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 4);
+    else if ((bytes_per_line % 2) == 0)
+	gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 2);
+    else
+	gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
+
+    gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,
+		       bytes_per_line / bytes_per_texel);
+}
+
+/*
+ * Uploads the part of a YUV image that covers box. (x, y) is the
+ * position of the lower left pixel of the box in the image, rows is
+ * the number of luma rows in the image.
+ */
+static void
+_glitz_set_yuv_pixels (glitz_gl_proc_address_list_t *gl,
+		       glitz_texture_t		    *texture,
+		       glitz_gl_pixel_format_t	    *gl_format,
+		       glitz_box_t		    *box,
+		       char			    *image,
+		       int			    rows,
+		       int			    x,
+		       int			    y,
+		       int			    bytes_per_line)
+{
+    char *plane, *first, *second;
+    int  sample, cx, cy, cw, ch;
+
+    switch (gl_format->pixel.fourcc) {
+    case GLITZ_FOURCC_YUY2:
+    case GLITZ_FOURCC_UYVY:
+	_glitz_set_unpack_stride (gl, bytes_per_line, 4);
+	gl->tex_sub_image_2d (texture->target, 0,
+			      box->x1 >> 1,
+			      texture->box.y2 - box->y2,
+			      ((box->x2 + 1) >> 1) - (box->x1 >> 1),
+			      box->y2 - box->y1,
+			      gl_format->format, gl_format->type,
+			      image + y * bytes_per_line + (x >> 1) * 4);
+	return;
+    case GLITZ_FOURCC_P010:
+	sample = 2;
+	break;
+    default:
+	sample = 1;
+    }
+
+    _glitz_set_unpack_stride (gl, bytes_per_line, sample);
+    gl->tex_sub_image_2d (texture->target, 0,
+			  box->x1,
+			  texture->box.y2 - box->y2,
+			  box->x2 - box->x1, box->y2 - box->y1,
+			  gl_format->format, gl_format->type,
+			  image + y * bytes_per_line + x * sample);
+
+    /* chroma is stored above the luma plane */
+    cx = box->x1 >> 1;
+    cw = ((box->x2 + 1) >> 1) - cx;
+    cy = texture->height - ((box->y2 + 1) >> 1);
+    ch = ((box->y2 + 1) >> 1) - (box->y1 >> 1);
+
+    plane = image + rows * bytes_per_line;
+
+    switch (gl_format->pixel.fourcc) {
+    case GLITZ_FOURCC_NV12:
+    case GLITZ_FOURCC_P010:
+	gl->tex_sub_image_2d (texture->target, 0,
+			      cx << 1, cy, cw << 1, ch,
+			      gl_format->format, gl_format->type,
+			      plane + (y >> 1) * bytes_per_line +
+			      (x >> 1) * 2 * sample);
+	break;
+    default:
+	_glitz_set_unpack_stride (gl, bytes_per_line >> 1, 1);
+
+	first  = plane + (y >> 1) * (bytes_per_line >> 1) + (x >> 1);
+	second = first + ((bytes_per_line * rows) >> 2);
+
+	/* V goes to the left half and U to the right half */
+	if (gl_format->pixel.fourcc == GLITZ_FOURCC_I420)
+	{
+	    plane  = first;
+	    first  = second;
+	    second = plane;
+	}
+
+	gl->tex_sub_image_2d (texture->target, 0,
+			      cx, cy, cw, ch,
+			      gl_format->format, gl_format->type,
+			      first);
+	gl->tex_sub_image_2d (texture->target, 0,
+			      (texture->width >> 1) + cx, cy, cw, ch,
+			      gl_format->format, gl_format->type,
+			      second);
+    }
+}
+
+void
+glitz_set_pixels (glitz_surface_t      *dst,
+		  int                  x_dst,
+		  int                  y_dst,
+		  int                  width,
+		  int                  height,
+		  glitz_pixel_format_t *format,
+		  glitz_buffer_t       *buffer)
+{
+    glitz_box_t             *clip = dst->clip;
+    int                     n_clip = dst->n_clip;
+    glitz_texture_t         *texture;
+    char                    *pixels = NULL;
+    char                    *ptr = NULL;
+    char                    *data = NULL;
+    glitz_gl_pixel_format_t *gl_format = NULL;
+    unsigned long           transform = 0;
+    glitz_bool_t            bound = 0;
+    glitz_bool_t            use_ring = 0, ring_slot = 0;
+    int                     bytes_per_line = 0, bytes_per_pixel = 0;
+    glitz_image_t           src_image, dst_image;
+    glitz_pixel_format_t    dst_format;
+    unsigned long           color_mask;
+    glitz_box_t             box;
+    glitz_surface_t         *surface;
+    glitz_bool_t            restore_state;
+    glitz_gl_int_t          unpackrowlength, unpackalignment;
+    glitz_gl_int_t          unpackskiprows, unpackskippixels;
+    glitz_gl_int_t          t2d, tbind2d, trect, tbindrect;
+
+    GLITZ_GL_SURFACE (dst);
+
+    if (x_dst < 0 || x_dst > (dst->box.x2 - width) ||
+	y_dst < 0 || y_dst > (dst->box.y2 - height))
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_BAD_COORDINATE_MASK);
+	return;
+    }
+
+    glitz_surface_flush_batch (dst);
+
+    if (SURFACE_SOLID (dst))
+    {
+	glitz_color_t old = dst->solid;
+
+	if (!_glitz_fourcc_convertible (format->fourcc))
+	{
+	    glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	    return;
+	}
+
+	while (n_clip--)
+	{
+	    box.x1 = clip->x1 + dst->x_clip;
+	    box.y1 = clip->y1 + dst->y_clip;
+	    box.x2 = clip->x2 + dst->x_clip;
+	    box.y2 = clip->y2 + dst->y_clip;
+	    if (x_dst > box.x1)
+		box.x1 = x_dst;
+	    if (y_dst > box.y1)
+		box.y1 = y_dst;
+	    if (x_dst + width < box.x2)
+		box.x2 = x_dst + width;
+	    if (y_dst + height < box.y2)
+		box.y2 = y_dst + height;
+
+	    if (box.x1 < box.x2 && box.y1 < box.y2)
+	    {
+		dst_image.width = dst_image.height = 1;
+
+		src_image.data =
+		    glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_READ_ONLY);
+		src_image.format = format;
+		src_image.width = src_image.height = 1;
+
+		if (format->masks.alpha_mask && dst->format->color.alpha_size)
+		{
+		    dst_image.data = (void *) &dst->solid.alpha;
+		    dst_image.format = &_solid_format[SOLID_ALPHA];
+
+		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
+					    &src_image, &dst_image,
+					    format->xoffset,format->skip_lines,
+					    0, 0, 1, 1);
+		} else
+		    dst->solid.alpha = 0xffff;
+
+		if (format->masks.red_mask && dst->format->color.red_size)
+		{
+		    dst_image.data = (void *) &dst->solid.red;
+		    dst_image.format = &_solid_format[SOLID_RED];
+
+		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
+					    &src_image, &dst_image,
+					    format->xoffset,format->skip_lines,
+					    0, 0, 1, 1);
+		} else
+		    dst->solid.red = 0;
+
+		if (format->masks.green_mask && dst->format->color.green_size)
+		{
+		    dst_image.data = (void *) &dst->solid.green;
+		    dst_image.format = &_solid_format[SOLID_GREEN];
+
+		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
+					    &src_image, &dst_image,
+					    format->xoffset,format->skip_lines,
+					    0, 0, 1, 1);
+		} else
+		    dst->solid.green = 0;
+
+		if (format->masks.blue_mask && dst->format->color.blue_size)
+		{
+		    dst_image.data = (void *) &dst->solid.blue;
+		    dst_image.format = &_solid_format[SOLID_BLUE];
+
+		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
+					    &src_image, &dst_image,
+					    format->xoffset,format->skip_lines,
+					    0, 0, 1, 1);
+		} else
+		    dst->solid.blue = 0;
+
+		glitz_buffer_unmap (buffer);
+
+		if (dst->flags & GLITZ_SURFACE_FLAG_SOLID_DAMAGE_MASK)
+		{
+		    dst->flags &= ~GLITZ_SURFACE_FLAG_SOLID_DAMAGE_MASK;
+		    glitz_surface_damage (dst, &box,
+					  GLITZ_DAMAGE_TEXTURE_MASK |
+					  GLITZ_DAMAGE_DRAWABLE_MASK);
+		}
+		else
+		{
+		    if (dst->solid.red   != old.red   ||
+			dst->solid.green != old.green ||
+			dst->solid.blue  != old.blue  ||
+			dst->solid.alpha != old.alpha)
+			glitz_surface_damage (dst, &box,
+					      GLITZ_DAMAGE_TEXTURE_MASK |
+					      GLITZ_DAMAGE_DRAWABLE_MASK);
+		}
+		break;
+	    }
+	    clip++;
+	}
+	return;
+    }
+
+    color_mask = 0;
+    if (dst->format->color.red_size)
+	color_mask |= GLITZ_FORMAT_RED_SIZE_MASK;
+    if (dst->format->color.green_size)
+	color_mask |= GLITZ_FORMAT_GREEN_SIZE_MASK;
+    if (dst->format->color.blue_size)
+	color_mask |= GLITZ_FORMAT_BLUE_SIZE_MASK;
+    if (dst->format->color.alpha_size)
+	color_mask |= GLITZ_FORMAT_ALPHA_SIZE_MASK;
+
+    /* find direct format */
+    gl_format =
+	_glitz_find_gl_pixel_format (format, color_mask,
+				     dst->drawable->backend->feature_mask);
+    if (gl_format && gl_format->pixel.fourcc != dst->format->color.fourcc)
+	gl_format = NULL;
+
+    if (gl_format == NULL)
+    {
+	unsigned long feature_mask;
+
+	feature_mask = dst->drawable->backend->feature_mask;
+	transform |= GLITZ_TRANSFORM_PIXELS_MASK;
+	if (dst->yuv_matrix == GLITZ_YUV_MATRIX_BT709)
+	    transform |= GLITZ_TRANSFORM_YUV_BT709_MASK;
+	gl_format =
+	    _glitz_find_best_gl_pixel_format (format, &dst->format->color,
+					      feature_mask);
+    }
+
+    if (PIXEL_BUFFER_STRAIGHT (buffer, format))
+	transform |= GLITZ_TRANSFORM_PREMULTIPLY_MASK;
+
+    /* NV12, P010 and UYVY pixels are only uploaded as they are */
+    if ((transform & GLITZ_TRANSFORM_PIXELS_MASK) &&
+	(!_glitz_fourcc_convertible (format->fourcc) ||
+	 !_glitz_fourcc_convertible (gl_format->pixel.fourcc)))
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return;
+    }
+
+    /* avoid context switch in this case */
+    if (!dst->attached &&
+	TEXTURE_ALLOCATED (&dst->texture) &&
+	!GLITZ_REGION_NOTEMPTY (&dst->texture_damage))
+    {
+	dst->drawable->backend->push_current (dst->drawable, dst,
+					      GLITZ_ANY_CONTEXT_CURRENT,
+					      &restore_state);
+	texture = &dst->texture;
+
+	/* we are using a foreign context so we must restore all state when we
+	   are done, the state cache does not describe it */
+	if (restore_state)
+	{
+	    glitz_state_invalidate (gl);
+
+	    /* get pixel store state */
+	    gl->get_integer_v (GLITZ_GL_UNPACK_ROW_LENGTH,  &unpackrowlength);
+	    gl->get_integer_v (GLITZ_GL_UNPACK_ALIGNMENT,   &unpackalignment);
+	    gl->get_integer_v (GLITZ_GL_UNPACK_SKIP_ROWS,   &unpackskiprows);
+	    gl->get_integer_v (GLITZ_GL_UNPACK_SKIP_PIXELS, &unpackskippixels);
+
+	    /* get texture bindings */
+	    gl->get_integer_v (GLITZ_GL_TEXTURE_2D,                &t2d);
+	    gl->get_integer_v (GLITZ_GL_TEXTURE_BINDING_2D,        &tbind2d);
+	    gl->get_integer_v (GLITZ_GL_TEXTURE_RECTANGLE,         &trect);
+	    gl->get_integer_v (GLITZ_GL_TEXTURE_BINDING_RECTANGLE, &tbindrect);
+
+	    /* TODO: save PBO state */
+	}
+
+	surface = NULL;
+    }
+    else
+    {
+	glitz_surface_push_current (dst, GLITZ_ANY_CONTEXT_CURRENT);
+
+	texture = glitz_surface_get_texture (dst, 1);
+	if (!texture) {
+	    glitz_surface_pop_current (dst);
+	    return;
+	}
+
+	restore_state = 0;
+	surface = dst;
+    }
+
+    if (height > 1) {
+	if (format->scanline_order != gl_format->pixel.scanline_order)
+	    transform |= GLITZ_TRANSFORM_SCANLINE_ORDER_MASK;
+    }
+
+    /* converted pixels are written to the drawable's upload ring, not
+       when running in a foreign context as its unpack buffer binding
+       is not saved */
+    if (transform && !restore_state && !buffer->drawable &&
+	gl_format->pixel.fourcc == GLITZ_FOURCC_RGB)
+	use_ring = 1;
+
+    glitz_texture_bind (gl, texture);
+
+    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_PIXELS, 0);
+    gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_ROWS, 0);
+
+    while (n_clip--)
+    {
+	box.x1 = clip->x1 + dst->x_clip;
+	box.y1 = clip->y1 + dst->y_clip;
+	box.x2 = clip->x2 + dst->x_clip;
+	box.y2 = clip->y2 + dst->y_clip;
+	if (x_dst > box.x1)
+	    box.x1 = x_dst;
+	if (y_dst > box.y1)
+	    box.y1 = y_dst;
+	if (x_dst + width < box.x2)
+	    box.x2 = x_dst + width;
+	if (y_dst + height < box.y2)
+	    box.y2 = y_dst + height;
+
+	if (box.x1 < box.x2 && box.y1 < box.y2)
+	{
+	    if (transform)
+	    {
+		dst_image.width  = box.x2 - box.x1;
+		dst_image.height = box.y2 - box.y1;
+
+		pixels = NULL;
+
+		/* convert straight into mapped buffer memory if possible */
+		if (use_ring)
+		{
+		    bytes_per_pixel = gl_format->pixel.masks.bpp / 8;
+		    bytes_per_line =
+			(((dst_image.width * gl_format->pixel.masks.bpp) / 8) +
+			 3) & -4;
+
+		    pixels =
+			glitz_upload_ring_map (dst->drawable,
+					       bytes_per_line *
+					       dst_image.height);
+		    if (pixels)
+		    {
+			dst_format = gl_format->pixel;
+			dst_format.bytes_per_line = bytes_per_line;
+
+			dst_image.data = pixels;
+			dst_image.format = &dst_format;
+
+			gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 4);
+			gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,
+					   bytes_per_line / bytes_per_pixel);
+
+			/* data is allocated and unpack state set up
+			   again if a later box falls back */
+			if (data)
+			{
+			    free (data);
+			    data = NULL;
+			}
+		    }
+		}
+
+		if (!pixels && !data)
+		{
+		    int size;
+
+		    switch (gl_format->pixel.fourcc) {
+		    case GLITZ_FOURCC_YV12:
+		    case GLITZ_FOURCC_I420:
+		    case GLITZ_FOURCC_NV12:
+			bytes_per_line  = (width + 3) & -4;
+			bytes_per_pixel = 1;
+			size = bytes_per_line * height +
+			    bytes_per_line * ((height + 1) >> 1);
+			break;
+		    case GLITZ_FOURCC_P010:
+			bytes_per_line  = ((width << 1) + 3) & -4;
+			bytes_per_pixel = 2;
+			size = bytes_per_line * height +
+			    bytes_per_line * ((height + 1) >> 1);
+			break;
+		    default:
+			bytes_per_line =
+			    (((width * gl_format->pixel.masks.bpp) / 8) + 3) &
+			    -4;
+			bytes_per_pixel = gl_format->pixel.masks.bpp / 8;
+			size = bytes_per_line * height;
+			break;
+		    }
+
+		    data = malloc (size);
+		    if (!data)
+		    {
+			glitz_surface_status_add (dst,
+						  GLITZ_STATUS_NO_MEMORY_MASK);
+			if (ptr)
+			    glitz_buffer_unmap (buffer);
+			goto BAIL;
+		    }
+
+		    /* rows are as wide as the whole transfer, so that
+		       boxes can share the buffer */
+		    dst_format = gl_format->pixel;
+		    dst_format.bytes_per_line = bytes_per_line;
+		    dst_image.format = &dst_format;
+
+		    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 4);
+		    gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,
+				       bytes_per_line / bytes_per_pixel);
+		}
+
+		if (!pixels)
+		    dst_image.data = data;
+
+		if (!ptr)
+		{
+		    ptr = glitz_buffer_map (buffer,
+					    GLITZ_BUFFER_ACCESS_READ_ONLY);
+		    src_image.format = format;
+		}
+
+		src_image.width  = box.x2 - box.x1;
+		src_image.height = box.y2 - box.y1;
+
+		src_image.data = ptr;
+
+		_glitz_pixel_transform (transform,
+					&src_image,
+					&dst_image,
+					format->xoffset + box.x1 - x_dst,
+					format->skip_lines + box.y1 - y_dst,
+					0, 0,
+					box.x2 - box.x1, box.y2 - box.y1);
+
+		if (pixels)
+		{
+		    /* source the upload from the bound ring slot */
+		    glitz_upload_ring_unmap (dst->drawable);
+		    pixels = NULL;
+		    ring_slot = 1;
+		}
+		else
+		    pixels = data;
+	    }
+	    else
+	    {
+		if (!bound)
+		{
+		    ptr = glitz_buffer_bind (buffer,
+					     GLITZ_GL_PIXEL_UNPACK_BUFFER);
+
+		    bytes_per_line = format->bytes_per_line;
+		    switch (format->fourcc) {
+		    case GLITZ_FOURCC_YV12:
+		    case GLITZ_FOURCC_I420:
+		    case GLITZ_FOURCC_NV12:
+			bytes_per_pixel = 1;
+			break;
+		    case GLITZ_FOURCC_P010:
+			bytes_per_pixel = 2;
+			break;
+		    default:
+			bytes_per_pixel = format->masks.bpp / 8;
+		    }
+
+		    if (bytes_per_line)
+		    {
+			if ((bytes_per_line % 4) == 0)
+			    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 4);
+			else if ((bytes_per_line % 2) == 0)
+			    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 2);
+			else
+			    gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
+
+			gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,
+					   bytes_per_line / bytes_per_pixel);
+		    }
+		    else
+		    {
+			gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT, 1);
+			gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH, width);
+			bytes_per_line = width * bytes_per_pixel;
+		    }
+		    bound = 1;
+		}
+
+		pixels = ptr +
+		    (format->skip_lines + y_dst + height - box.y2) *
+		    bytes_per_line +
+		    (format->xoffset + box.x1 - x_dst) * bytes_per_pixel;
+	    }
+
+	    switch (gl_format->pixel.fourcc) {
+	    case GLITZ_FOURCC_RGB:
+		gl->tex_sub_image_2d (texture->target, 0,
+				      texture->box.x1 + box.x1,
+				      texture->box.y2 - box.y2,
+				      box.x2 - box.x1, box.y2 - box.y1,
+				      gl_format->format, gl_format->type,
+				      pixels);
+		break;
+	    default:
+		if (transform)
+		    _glitz_set_yuv_pixels (gl, texture, gl_format, &box,
+					   pixels, box.y2 - box.y1, 0, 0,
+					   bytes_per_line);
+		else
+		    _glitz_set_yuv_pixels (gl, texture, gl_format, &box,
+					   ptr, format->skip_lines + height,
+					   format->xoffset + box.x1 - x_dst,
+					   format->skip_lines + y_dst +
+					   height - box.y2,
+					   bytes_per_line);
+	    }
+
+	    if (ring_slot)
+	    {
+		glitz_upload_ring_release (dst->drawable);
+		ring_slot = 0;
+	    }
+
+	    glitz_surface_damage (dst, &box,
+				  GLITZ_DAMAGE_DRAWABLE_MASK |
+				  GLITZ_DAMAGE_SOLID_MASK);
+	}
+	clip++;
+    }
+
+    if (transform)
+    {
+	if (data)
+	    free (data);
+	if (ptr)
+	    glitz_buffer_unmap (buffer);
+    } else
+	glitz_buffer_unbind (buffer);
+
+BAIL:
+    glitz_texture_unbind (gl, texture);
+
+    if (surface)
+    {
+	glitz_surface_pop_current (surface);
+    }
+    else
+    {
+	dst->drawable->backend->pop_current (dst->drawable);
+    }
+
+    if (restore_state)
+    {
+	/* pixel store state */
+	gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,  unpackrowlength);
+	gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT,   unpackalignment);
+	gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_ROWS,   unpackskiprows);
+	gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_PIXELS, unpackskippixels);
+
+	/* get texture bindings */
+	if (t2d)
+	    glitz_state_enable (gl, GLITZ_GL_TEXTURE_2D);
+	else
+	    glitz_state_disable (gl, GLITZ_GL_TEXTURE_2D);
+
+	glitz_state_bind_texture (gl, GLITZ_GL_TEXTURE_2D, tbind2d);
+
+	if (trect)
+	    glitz_state_enable (gl, GLITZ_GL_TEXTURE_RECTANGLE);
+	else
+	    glitz_state_disable (gl, GLITZ_GL_TEXTURE_RECTANGLE);
+
+	glitz_state_bind_texture (gl, GLITZ_GL_TEXTURE_RECTANGLE, tbindrect);
+
+	/* keep the state of the foreign context out of the cache */
+	glitz_state_invalidate (gl);
+    }
+}
+
+/* Layout of the bytes packed into each RGBA texel of a YUV readback
+ * plane: the source pixel, relative to the first one of the texel, and
+ * the channel of each byte. */
+#define YUV_PACK_Y 0
+#define YUV_PACK_U 1
+#define YUV_PACK_V 2
+
+typedef struct _glitz_yuv_pack {
+    int x_step, y_step;
+    int x[4];
+    int channel[4];
+} glitz_yuv_pack_t;
+
+static const glitz_yuv_pack_t _yuv_pack_y = {
+    4, 1, { 0, 1, 2, 3 }, { YUV_PACK_Y, YUV_PACK_Y, YUV_PACK_Y, YUV_PACK_Y }
+};
+
+static const glitz_yuv_pack_t _yuv_pack_u = {
+    8, 2, { 0, 2, 4, 6 }, { YUV_PACK_U, YUV_PACK_U, YUV_PACK_U, YUV_PACK_U }
+};
+
+static const glitz_yuv_pack_t _yuv_pack_v = {
+    8, 2, { 0, 2, 4, 6 }, { YUV_PACK_V, YUV_PACK_V, YUV_PACK_V, YUV_PACK_V }
+};
+
+static const glitz_yuv_pack_t _yuv_pack_uv = {
+    4, 2, { 0, 0, 2, 2 }, { YUV_PACK_U, YUV_PACK_V, YUV_PACK_U, YUV_PACK_V }
+};
+
+static const glitz_yuv_pack_t _yuv_pack_yuy2 = {
+    2, 1, { 0, 0, 1, 1 }, { YUV_PACK_Y, YUV_PACK_U, YUV_PACK_Y, YUV_PACK_V }
+};
+
+static const glitz_yuv_pack_t _yuv_pack_uyvy = {
+    2, 1, { 0, 0, 1, 1 }, { YUV_PACK_U, YUV_PACK_Y, YUV_PACK_V, YUV_PACK_Y }
+};
+
+typedef struct _glitz_yuv_plane {
+    const glitz_yuv_pack_t *pack;
+    int                    width, height, y;
+    int                    offset, stride;
+} glitz_yuv_plane_t;
+
+struct _glitz_pixel_readback {
+    glitz_surface_t         *src;
+    glitz_drawable_t        *drawable;
+    glitz_buffer_t          *buffer;
+    glitz_buffer_t          *pack;
+    glitz_pixel_format_t    format;
+    glitz_gl_pixel_format_t *gl_format;
+    glitz_texture_t         *texture;
+    glitz_bool_t            from_drawable;
+    unsigned long           transform;
+    int                     x_src, y_src, width, height;
+    int                     src_x, src_y, src_w, src_h;
+    int                     bytes_per_line, bytes_per_pixel;
+    glitz_box_t             *clip;
+    int                     n_clip, x_clip, y_clip;
+    glitz_gl_sync_t         sync;
+    glitz_gl_uint_t         fence;
+    glitz_gl_uint_t         fb;
+    glitz_texture_t         yuv;
+    glitz_yuv_plane_t       planes[3];
+    int                     n_planes;
+    void                    *data;
+};
+
+static void
+_glitz_get_solid_pixels (glitz_surface_t      *src,
+			 int                  x_src,
+			 int                  y_src,
+			 int                  width,
+			 int                  height,
+			 glitz_pixel_format_t *format,
+			 glitz_buffer_t       *buffer)
+{
+    glitz_box_t		 *clip = src->clip;
+    int			 n_clip = src->n_clip;
+    glitz_image_t        src_image, dst_image;
+    glitz_pixel_format_t dst_format;
+    glitz_color_t        solid;
+    glitz_box_t          box;
+
+    if (!_glitz_fourcc_convertible (format->fourcc))
+    {
+	glitz_surface_status_add (src, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return;
+    }
+
+    while (n_clip--)
+    {
+	box.x1 = clip->x1 + src->x_clip;
+	box.y1 = clip->y1 + src->y_clip;
+	box.x2 = clip->x2 + src->x_clip;
+	box.y2 = clip->y2 + src->y_clip;
+	if (x_src > box.x1)
+	    box.x1 = x_src;
+	if (y_src > box.y1)
+	    box.y1 = y_src;
+	if (x_src + width < box.x2)
+	    box.x2 = x_src + width;
+	if (y_src + height < box.y2)
+	    box.y2 = y_src + height;
+
+	if (box.x1 < box.x2 && box.y1 < box.y2)
+	{
+	    if (SURFACE_SOLID_DAMAGE (src))
+	    {
+		glitz_surface_push_current (src, GLITZ_ANY_CONTEXT_CURRENT);
+		glitz_surface_sync_solid (src);
+		glitz_surface_pop_current (src);
+	    }
+
+	    solid = src->solid;
+
+	    /* channels are stored one at a time so straight alpha
+	       colors are computed here */
+	    if (PIXEL_BUFFER_STRAIGHT (buffer, format))
+	    {
+		if (solid.alpha == 0)
+		    solid.red = solid.green = solid.blue = 0;
+		else if (solid.alpha != 0xffff)
+		{
+
+#define DIV_UN16(c, a) (((c) >= (a))? 0xffff:				\
+			(((unsigned int) (c) * 0xffff + ((a) >> 1)) / (a)))
+
+		    solid.red   = DIV_UN16 (solid.red, solid.alpha);
+		    solid.green = DIV_UN16 (solid.green, solid.alpha);
+		    solid.blue  = DIV_UN16 (solid.blue, solid.alpha);
+
+#undef DIV_UN16
+
+		}
+	    }
+
+	    src_image.width = src_image.height = 1;
+
+	    dst_format = *format;
+
+	    dst_image.data =
+		glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+	    dst_image.data += format->skip_lines * format->bytes_per_line;
+	    dst_image.format = &dst_format;
+	    dst_image.width = dst_image.height = 1;
+
+	    if (format->masks.alpha_mask)
+	    {
+		src_image.data = (void *) &solid.alpha;
+		src_image.format = &_solid_format[SOLID_ALPHA];
+
+		dst_format.masks.alpha_mask = format->masks.alpha_mask;
+		dst_format.masks.red_mask = 0;
+		dst_format.masks.green_mask = 0;
+		dst_format.masks.blue_mask = 0;
+
+		_glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
+					&src_image, &dst_image,
+					0, 0, format->xoffset, 0, 1, 1);
+	    }
+
+	    if (format->masks.red_mask)
+	    {
+		src_image.data = (void *) &solid.red;
+		src_image.format = &_solid_format[SOLID_RED];
+
+		dst_format.masks.alpha_mask = 0;
+		dst_format.masks.red_mask = format->masks.red_mask;
+		dst_format.masks.green_mask = 0;
+		dst_format.masks.blue_mask = 0;
+
+		_glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
+					&src_image, &dst_image,
+					0, 0, format->xoffset, 0, 1, 1);
+	    }
+
+	    if (format->masks.green_mask)
+	    {
+		src_image.data = (void *) &solid.green;
+		src_image.format = &_solid_format[SOLID_GREEN];
+
+		dst_format.masks.alpha_mask = 0;
+		dst_format.masks.red_mask = 0;
+		dst_format.masks.green_mask = format->masks.green_mask;
+		dst_format.masks.blue_mask = 0;
+
+		_glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
+					&src_image, &dst_image,
+					0, 0, format->xoffset, 0, 1, 1);
+	    }
+
+	    if (format->masks.blue_mask)
+	    {
+		src_image.data = (void *) &solid.blue;
+		src_image.format = &_solid_format[SOLID_BLUE];
+
+		dst_format.masks.alpha_mask = 0;
+		dst_format.masks.red_mask = 0;
+		dst_format.masks.green_mask = 0;
+		dst_format.masks.blue_mask = format->masks.blue_mask;
+
+		_glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
+					&src_image, &dst_image,
+					0, 0, format->xoffset, 0, 1, 1);
+	    }
+
+	    glitz_buffer_unmap (buffer);
+
+	    break;
+	}
+	clip++;
+    }
+}
+
+static glitz_bool_t
+_glitz_readback_clip_box (glitz_pixel_readback_t *readback,
+			  glitz_box_t            *clip,
+			  glitz_box_t            *box)
+{
+    box->x1 = clip->x1 + readback->x_clip;
+    box->y1 = clip->y1 + readback->y_clip;
+    box->x2 = clip->x2 + readback->x_clip;
+    box->y2 = clip->y2 + readback->y_clip;
+    if (readback->x_src > box->x1)
+	box->x1 = readback->x_src;
+    if (readback->y_src > box->y1)
+	box->y1 = readback->y_src;
+    if (readback->x_src + readback->width < box->x2)
+	box->x2 = readback->x_src + readback->width;
+    if (readback->y_src + readback->height < box->y2)
+	box->y2 = readback->y_src + readback->height;
+
+    return (box->x1 < box->x2 && box->y1 < box->y2);
+}
+
+/*
+ * Attaches the texture to a temporary framebuffer object so that only
+ * the requested boxes have to be read instead of the whole texture.
+ * The framebuffer object is left bound when it can be used.
+ */
+static glitz_gl_uint_t
+_glitz_readback_framebuffer (glitz_surface_t *src,
+			     glitz_texture_t *texture)
+{
+    glitz_gl_uint_t fb = 0;
+
+    GLITZ_GL_SURFACE (src);
+
+    if (!(src->drawable->backend->feature_mask &
+	  GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK))
+	return 0;
+
+    if (texture->fourcc != GLITZ_FOURCC_RGB)
+	return 0;
+
+    gl->gen_framebuffers (1, &fb);
+    gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, fb);
+    gl->framebuffer_texture_2d (GLITZ_GL_FRAMEBUFFER,
+				GLITZ_GL_COLOR_ATTACHMENT0,
+				texture->target, texture->name, 0);
+
+    /* alpha-only textures are not color-renderable on most drivers */
+    if (gl->check_framebuffer_status (GLITZ_GL_FRAMEBUFFER) !=
+	GLITZ_GL_FRAMEBUFFER_COMPLETE)
+    {
+	gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, 0);
+	gl->delete_framebuffers (1, &fb);
+	return 0;
+    }
+
+    gl->read_buffer (GLITZ_GL_COLOR_ATTACHMENT0);
+
+    return fb;
+}
+
+static void
+_glitz_readback_release_framebuffer (glitz_pixel_readback_t *readback)
+{
+    GLITZ_GL_SURFACE (readback->src);
+
+    if (readback->fb)
+    {
+	gl->bind_framebuffer (GLITZ_GL_FRAMEBUFFER, 0);
+	gl->delete_framebuffers (1, &readback->fb);
+	readback->fb = 0;
+    }
+
+    if (readback->n_planes)
+    {
+	if (!glitz_pool_put_texture (readback->src->drawable, &readback->yuv))
+	    glitz_texture_fini (gl, &readback->yuv);
+
+	readback->n_planes = 0;
+    }
+}
+
+/*
+ * Fills in the planes of a YUV image as the client expects them. Returns
+ * the number of planes or 0 if the layout cannot be written in whole
+ * RGBA texels.
+ */
+static int
+_glitz_yuv_planes (glitz_pixel_format_t *format,
+		   int                  width,
+		   int                  height,
+		   glitz_yuv_plane_t    *planes)
+{
+    const glitz_yuv_pack_t *pack;
+    int                    stride, planeoffset, n, i, y;
+
+    switch (format->fourcc) {
+    case GLITZ_FOURCC_YV12:
+    case GLITZ_FOURCC_I420:
+	/* chroma planes overlap with an odd height */
+	if (height & 1)
+	    return 0;
+
+	stride = (format->bytes_per_line) ?
+	    format->bytes_per_line: (width + 3) & -4;
+	planeoffset = stride * height;
+
+	planes[0].pack = &_yuv_pack_y;
+	planes[0].offset = 0;
+	planes[0].stride = stride;
+	planes[1].pack = &_yuv_pack_v;
+	planes[1].offset = planeoffset;
+	planes[1].stride = stride >> 1;
+	planes[2].pack = &_yuv_pack_u;
+	planes[2].offset = planeoffset + (planeoffset >> 2);
+	planes[2].stride = stride >> 1;
+
+	/* I420 has the U plane first */
+	if (format->fourcc == GLITZ_FOURCC_I420)
+	{
+	    planes[1].offset = planes[2].offset;
+	    planes[2].offset = planeoffset;
+	}
+	n = 3;
+	break;
+    case GLITZ_FOURCC_NV12:
+	stride = (format->bytes_per_line) ?
+	    format->bytes_per_line: (width + 3) & -4;
+
+	planes[0].pack = &_yuv_pack_y;
+	planes[0].offset = 0;
+	planes[0].stride = stride;
+	planes[1].pack = &_yuv_pack_uv;
+	planes[1].offset = stride * height;
+	planes[1].stride = stride;
+	n = 2;
+	break;
+    case GLITZ_FOURCC_YUY2:
+    case GLITZ_FOURCC_UYVY:
+	stride = (format->bytes_per_line) ?
+	    format->bytes_per_line: ((width << 1) + 3) & -4;
+
+	if (format->fourcc == GLITZ_FOURCC_YUY2)
+	    planes[0].pack = &_yuv_pack_yuy2;
+	else
+	    planes[0].pack = &_yuv_pack_uyvy;
+	planes[0].offset = 0;
+	planes[0].stride = stride;
+	n = 1;
+	break;
+    default:
+	return 0;
+    }
+
+    for (i = 0, y = 0; i < n; i++)
+    {
+	pack = planes[i].pack;
+
+	planes[i].width  = (width + pack->x_step - 1) / pack->x_step;
+	planes[i].height = (height + pack->y_step - 1) / pack->y_step;
+	planes[i].y      = y;
+
+	/* the last texel of a row may run into the row padding but
+	   not past it */
+	if ((planes[i].stride & 3) || planes[i].width * 4 > planes[i].stride)
+	    return 0;
+
+	y += planes[i].height;
+    }
+
+    return n;
+}
+
+/*
+ * Renders the packed planes into the temporary texture, which must be
+ * bound to the current framebuffer object. Chroma is sampled from even
+ * pixels on even rows of the client image, like _store_yv12 and
+ * _store_yuy2 do.
+ */
+static void
+_glitz_readback_pack_yuv (glitz_pixel_readback_t *readback,
+			  glitz_gl_uint_t        fp)
+{
+    const glitz_yuv_matrix_coefficients_t *c;
+    glitz_surface_t            *src = readback->src;
+    glitz_texture_t            *texture = readback->texture;
+    glitz_texture_parameters_t param;
+    glitz_vec4_t               coeff[3], offset;
+    glitz_float_t              vertices[16], x1, x2, y1, y2;
+    glitz_yuv_plane_t          *plane;
+    const glitz_yuv_pack_t     *pack;
+    int                        i, j;
+
+    GLITZ_GL_SURFACE (src);
+
+    /* same weights as the conversion tables, for normalized colors */
+    c = &_yuv_matrix_coefficients[src->yuv_matrix];
+
+    coeff[YUV_PACK_Y].v[0] = (glitz_float_t) 0x01010101 / c->yr;
+    coeff[YUV_PACK_Y].v[1] = (glitz_float_t) 0x01010101 / c->yg;
+    coeff[YUV_PACK_Y].v[2] = (glitz_float_t) 0x01010101 / c->yb;
+    coeff[YUV_PACK_Y].v[3] = 16.0f / 255.0f;
+    coeff[YUV_PACK_U].v[0] = -(glitz_float_t) 0x01010101 / c->ur;
+    coeff[YUV_PACK_U].v[1] = -(glitz_float_t) 0x01010101 / c->ug;
+    coeff[YUV_PACK_U].v[2] = (glitz_float_t) 0x01010101 / c->ub;
+    coeff[YUV_PACK_U].v[3] = 128.0f / 255.0f;
+    coeff[YUV_PACK_V].v[0] = (glitz_float_t) 0x01010101 / c->vr;
+    coeff[YUV_PACK_V].v[1] = -(glitz_float_t) 0x01010101 / c->vg;
+    coeff[YUV_PACK_V].v[2] = -(glitz_float_t) 0x01010101 / c->vb;
+    coeff[YUV_PACK_V].v[3] = 128.0f / 255.0f;
+
+    gl->push_attrib (GLITZ_GL_TRANSFORM_BIT | GLITZ_GL_VIEWPORT_BIT);
+    glitz_state_matrix_mode (gl, GLITZ_GL_PROJECTION);
+    gl->push_matrix ();
+    gl->load_identity ();
+    gl->ortho (0.0, readback->yuv.width, 0.0, readback->yuv.height,
+	       -1.0, 1.0);
+    glitz_state_matrix_mode (gl, GLITZ_GL_MODELVIEW);
+    gl->push_matrix ();
+    gl->load_identity ();
+    gl->viewport (0, 0, readback->yuv.width, readback->yuv.height);
+
+    glitz_state_disable (gl, GLITZ_GL_SCISSOR_TEST);
+    glitz_state_disable (gl, GLITZ_GL_DITHER);
+    glitz_set_operator (gl, GLITZ_OPERATOR_SRC);
+
+    glitz_state_active_texture (gl, GLITZ_GL_TEXTURE0);
+    gl->client_active_texture (GLITZ_GL_TEXTURE0);
+
+    glitz_texture_bind (gl, texture);
+
+    param = texture->param;
+    param.filter[0] = param.filter[1] = GLITZ_GL_NEAREST;
+    glitz_texture_ensure_parameters (gl, texture, &param);
+
+    glitz_state_disable (gl, GLITZ_GL_TEXTURE_GEN_S);
+    glitz_state_disable (gl, GLITZ_GL_TEXTURE_GEN_T);
+
+    glitz_state_enable (gl, GLITZ_GL_FRAGMENT_PROGRAM);
+    glitz_state_bind_program (gl, GLITZ_GL_FRAGMENT_PROGRAM, fp);
+
+    gl->vertex_pointer (2, GLITZ_GL_FLOAT, 4 * sizeof (glitz_float_t),
+			vertices);
+    gl->tex_coord_pointer (2, GLITZ_GL_FLOAT, 4 * sizeof (glitz_float_t),
+			   vertices + 2);
+    gl->enable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+
+    for (i = 0; i < readback->n_planes; i++)
+    {
+	plane = &readback->planes[i];
+	pack = plane->pack;
+
+	for (j = 0; j < 4; j++)
+	{
+	    offset.v[j] = pack->x[j] * texture->texcoord_width_unit;
+	    gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, j + 1,
+					 coeff[pack->channel[j]].v);
+	}
+	gl->program_local_param_4fv (GLITZ_GL_FRAGMENT_PROGRAM, 0, offset.v);
+
+	/* centers of the first pixels sampled at the edges of the
+	   plane, extended to the edges of the quad */
+	x1 = readback->x_src + 0.5f - 0.5f * pack->x_step;
+	x2 = x1 + plane->width * pack->x_step;
+
+	if (readback->format.scanline_order ==
+	    GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN)
+	{
+	    y1 = readback->y_src + 0.5f - 0.5f * pack->y_step;
+	    y2 = y1 + plane->height * pack->y_step;
+	}
+	else
+	{
+	    y1 = readback->y_src + readback->height - 0.5f +
+		0.5f * pack->y_step;
+	    y2 = y1 - plane->height * pack->y_step;
+	}
+
+	x1 = (texture->box.x1 + x1) * texture->texcoord_width_unit;
+	x2 = (texture->box.x1 + x2) * texture->texcoord_width_unit;
+	y1 = (texture->box.y2 - y1) * texture->texcoord_height_unit;
+	y2 = (texture->box.y2 - y2) * texture->texcoord_height_unit;
+
+	vertices[0]  = 0.0f;
+	vertices[1]  = plane->y;
+	vertices[2]  = x1;
+	vertices[3]  = y1;
+	vertices[4]  = plane->width;
+	vertices[5]  = plane->y;
+	vertices[6]  = x2;
+	vertices[7]  = y1;
+	vertices[8]  = plane->width;
+	vertices[9]  = plane->y + plane->height;
+	vertices[10] = x2;
+	vertices[11] = y2;
+	vertices[12] = 0.0f;
+	vertices[13] = plane->y + plane->height;
+	vertices[14] = x1;
+	vertices[15] = y2;
+
+	gl->draw_arrays (GLITZ_GL_QUADS, 0, 4);
+    }
+
+    gl->disable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+
+    glitz_state_bind_program (gl, GLITZ_GL_FRAGMENT_PROGRAM, 0);
+    glitz_state_disable (gl, GLITZ_GL_FRAGMENT_PROGRAM);
+
+    glitz_texture_unbind (gl, texture);
+
+    glitz_state_enable (gl, GLITZ_GL_SCISSOR_TEST);
+
+    gl->pop_matrix ();
+    glitz_state_matrix_mode (gl, GLITZ_GL_PROJECTION);
+    gl->pop_matrix ();
+    glitz_state_pop_attrib (gl);
+}
+
+/*
+ * Converts RGB sources to YUV on the GPU so that only the planes cross
+ * the bus. Returns 0 when the CPU converters have to be used instead.
+ */
+static glitz_bool_t
+_glitz_readback_yuv_begin (glitz_pixel_readback_t *readback,
+			   glitz_pixel_format_t   *format)
+{
+    glitz_surface_t *src = readback->src;
+    glitz_box_t     *clip = src->clip;
+    glitz_backend_t *backend = src->drawable->backend;
+    glitz_texture_t *texture;
+    glitz_gl_uint_t fp;
+    unsigned long   mask;
+    int             width, height, n, i;
+
+    GLITZ_GL_SURFACE (src);
+
+    mask = GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK |
+	GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK;
+    if ((backend->feature_mask & mask) != mask)
+	return 0;
+
+    if (src->format->color.fourcc != GLITZ_FOURCC_RGB)
+	return 0;
+
+    /* planes are only packed for whole, unclipped images */
+    if (format->xoffset || format->skip_lines)
+	return 0;
+
+    if (src->n_clip > 1						||
+	clip->x1 + src->x_clip > readback->x_src			||
+	clip->y1 + src->y_clip > readback->y_src			||
+	clip->x2 + src->x_clip < readback->x_src + readback->width	||
+	clip->y2 + src->y_clip < readback->y_src + readback->height)
+	return 0;
+
+    n = _glitz_yuv_planes (format, readback->width, readback->height,
+			   readback->planes);
+    if (!n)
+	return 0;
+
+    texture = glitz_surface_get_texture (src, 0);
+    if (!texture)
+	return 0;
+
+    fp = glitz_get_rgb_to_yuv_fragment_program (src, texture);
+    if (!fp)
+	return 0;
+
+    width = height = 0;
+    for (i = 0; i < n; i++)
+    {
+	width = MAX (width, readback->planes[i].width);
+	height += readback->planes[i].height;
+    }
+
+    glitz_texture_init (&readback->yuv, width, height, GLITZ_GL_RGBA8,
+			GLITZ_FOURCC_RGB, backend->feature_mask, 0);
+
+    if (!glitz_pool_get_texture (src->drawable, &readback->yuv))
+    {
+	glitz_texture_size_check (gl, &readback->yuv,
+				  backend->max_texture_2d_size,
+				  backend->max_texture_rect_size);
+	if (TEXTURE_INVALID_SIZE (&readback->yuv))
+	    return 0;
+
+	glitz_texture_allocate (gl, &readback->yuv);
+    }
+
+    readback->n_planes = n;
+    readback->fb = _glitz_readback_framebuffer (src, &readback->yuv);
+    if (!readback->fb)
+    {
+	_glitz_readback_release_framebuffer (readback);
+	return 0;
+    }
+
+    readback->texture = texture;
+
+    _glitz_readback_pack_yuv (readback, fp);
+
+    return 1;
+}
+
+/*
+ * Makes the source current and picks the GL format to read in. Returns
+ * 0 with the surface popped if there is nothing that can be read.
+ */
+static glitz_bool_t
+_glitz_readback_begin (glitz_pixel_readback_t *readback,
+		       glitz_surface_t        *src,
+		       int                    x_src,
+		       int                    y_src,
+		       int                    width,
+		       int                    height,
+		       glitz_pixel_format_t   *format,
+		       glitz_buffer_t         *buffer)
+{
+    glitz_gl_pixel_format_t *gl_format;
+    glitz_texture_t         *texture = NULL;
+    glitz_color_format_t    *color;
+    unsigned long           color_mask, transform = 0;
+    glitz_box_t             *clip = src->clip;
+
+    readback->src    = src;
+    readback->buffer = buffer;
+    readback->format = *format;
+    readback->x_src  = readback->src_x = x_src;
+    readback->y_src  = readback->src_y = y_src;
+    readback->width  = readback->src_w = width;
+    readback->height = readback->src_h = height;
+    readback->clip   = src->clip;
+    readback->n_clip = src->n_clip;
+    readback->x_clip = src->x_clip;
+    readback->y_clip = src->y_clip;
+    readback->fb     = 0;
+    readback->n_planes = 0;
+
+    if (!_glitz_fourcc_convertible (src->format->color.fourcc))
+    {
+	glitz_surface_status_add (src, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return 0;
+    }
+
+    color = &src->format->color;
+    readback->from_drawable =
+	glitz_surface_push_current (src, GLITZ_DRAWABLE_CURRENT);
+
+    if (_glitz_readback_yuv_begin (readback, format))
+    {
+	readback->transform = 0;
+	readback->gl_format = NULL;
+	readback->bytes_per_pixel = 4;
+	readback->bytes_per_line = readback->planes[0].stride;
+
+	return 1;
+    }
+
+    if (readback->from_drawable)
+    {
+	if (src->attached)
+	    color = &src->attached->format->d.color;
+    }
+    else
+    {
+	texture = glitz_surface_get_texture (src, 0);
+	if (!texture)
+	{
+	    glitz_surface_pop_current (src);
+	    return 0;
+	}
+
+	readback->fb = _glitz_readback_framebuffer (src, texture);
+	if (!readback->fb)
+	{
+	    if (texture->width > width || texture->height > height)
+		transform |= GLITZ_TRANSFORM_COPY_BOX_MASK;
+
+	    if (src->n_clip > 1			       ||
+		clip->x1 + src->x_clip > x_src	       ||
+		clip->y1 + src->y_clip > y_src	       ||
+		clip->x2 + src->x_clip < x_src + width ||
+		clip->y2 + src->y_clip < y_src + height)
+		transform |= GLITZ_TRANSFORM_COPY_BOX_MASK;
+	}
+    }
+
+    readback->texture = texture;
+
+    if (PIXEL_BUFFER_STRAIGHT (buffer, format))
+	transform |= GLITZ_TRANSFORM_UNPREMULTIPLY_MASK;
+
+    if (transform || height > 1)
+    {
+	if (format->scanline_order == GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN)
+	    transform |= GLITZ_TRANSFORM_SCANLINE_ORDER_MASK;
+    }
+
+    color_mask = 0;
+    if (format->masks.red_mask)
+	color_mask |= GLITZ_FORMAT_RED_SIZE_MASK;
+    if (format->masks.green_mask)
+	color_mask |= GLITZ_FORMAT_GREEN_SIZE_MASK;
+    if (format->masks.blue_mask)
+	color_mask |= GLITZ_FORMAT_BLUE_SIZE_MASK;
+    if (format->masks.alpha_mask)
+	color_mask |= GLITZ_FORMAT_ALPHA_SIZE_MASK;
+
+    /* find direct format */
+    gl_format =
+	_glitz_find_gl_pixel_format (format, color_mask,
+				     src->drawable->backend->feature_mask);
+    if (gl_format && gl_format->pixel.fourcc != color->fourcc)
+	gl_format = NULL;
+
+    if (gl_format == NULL)
+    {
+	unsigned int features;
+
+	transform |= GLITZ_TRANSFORM_PIXELS_MASK;
+	if (src->yuv_matrix == GLITZ_YUV_MATRIX_BT709)
+	    transform |= GLITZ_TRANSFORM_YUV_BT709_MASK;
+
+	features = src->drawable->backend->feature_mask;
+
+	gl_format = _glitz_find_best_gl_pixel_format (format, color, features);
+    }
+
+    /* should not happen */
+    if (gl_format == NULL)
+    {
+	_glitz_readback_release_framebuffer (readback);
+	glitz_surface_pop_current (src);
+	return 0;
+    }
+
+    if ((transform & GLITZ_TRANSFORM_PIXELS_MASK) &&
+	!_glitz_fourcc_convertible (format->fourcc))
+    {
+	glitz_surface_status_add (src, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	_glitz_readback_release_framebuffer (readback);
+	glitz_surface_pop_current (src);
+	return 0;
+    }
+
+    readback->gl_format = gl_format;
+    readback->transform = transform;
+
+    if (transform)
+    {
+	if (transform & GLITZ_TRANSFORM_COPY_BOX_MASK)
+	{
+	    if (texture)
+	    {
+		readback->src_w = texture->width;
+		readback->src_h = texture->height;
+		readback->src_x = src->texture.box.x1;
+		readback->src_y = src->texture.box.y1;
+	    }
+	}
+
+	readback->bytes_per_pixel = gl_format->pixel.masks.bpp / 8;
+	readback->bytes_per_line =
+	    (((readback->src_w * gl_format->pixel.masks.bpp) / 8) + 3) & -4;
+    }
+    else
+    {
+	readback->bytes_per_pixel = format->masks.bpp / 8;
+	readback->bytes_per_line = format->bytes_per_line;
+	if (!readback->bytes_per_line)
+	    readback->bytes_per_line = width * readback->bytes_per_pixel;
+    }
+
+    return 1;
+}
+
+static void
+_glitz_readback_count (glitz_pixel_readback_t *readback,
+		       int                    width,
+		       int                    height,
+		       int                    bytes_per_pixel)
+{
+    glitz_drawable_t *drawable = readback->src->drawable;
+
+    drawable->read_calls++;
+    drawable->read_bytes += (unsigned long) width * height * bytes_per_pixel;
+}
+
+/*
+ * Reads into pixels, which is either client memory or an offset into
+ * the buffer bound as GL_PIXEL_PACK_BUFFER.
+ */
+static void
+_glitz_readback_read (glitz_pixel_readback_t *readback,
+		      char                   *pixels)
+{
+    glitz_surface_t         *src = readback->src;
+    glitz_gl_pixel_format_t *gl_format = readback->gl_format;
+    int                     bytes_per_line = readback->bytes_per_line;
+    int                     bytes_per_pixel = readback->bytes_per_pixel;
+    glitz_box_t             *clip = readback->clip;
+    int                     n_clip = readback->n_clip;
+    glitz_box_t             box;
+
+    GLITZ_GL_SURFACE (src);
+
+    gl->pixel_store_i (GLITZ_GL_PACK_SKIP_ROWS, 0);
+    gl->pixel_store_i (GLITZ_GL_PACK_SKIP_PIXELS, 0);
+
+    if ((bytes_per_line % 4) == 0)
+	gl->pixel_store_i (GLITZ_GL_PACK_ALIGNMENT, 4);
+    else if ((bytes_per_line % 2) == 0)
+	gl->pixel_store_i (GLITZ_GL_PACK_ALIGNMENT, 2);
+    else
+	gl->pixel_store_i (GLITZ_GL_PACK_ALIGNMENT, 1);
+
+    gl->pixel_store_i (GLITZ_GL_PACK_ROW_LENGTH,
+		       bytes_per_line / bytes_per_pixel);
+
+    if (readback->n_planes)
+    {
+	glitz_yuv_plane_t *plane = readback->planes;
+
+	for (; plane < readback->planes + readback->n_planes; plane++)
+	{
+	    gl->pixel_store_i (GLITZ_GL_PACK_ROW_LENGTH, plane->stride / 4);
+	    gl->read_pixels (0, plane->y, plane->width, plane->height,
+			     GLITZ_GL_RGBA, GLITZ_GL_UNSIGNED_BYTE,
+			     pixels + plane->offset);
+	    _glitz_readback_count (readback, plane->width, plane->height, 4);
+	}
+
+	_glitz_readback_release_framebuffer (readback);
+    }
+    else if (readback->from_drawable)
+    {
+	src->drawable->backend->read_buffer (src->drawable, src->buffer);
+	_glitz_fbo_resolve (src);
+
+	glitz_state_disable (gl, GLITZ_GL_SCISSOR_TEST);
+
+	while (n_clip--)
+	{
+	    if (_glitz_readback_clip_box (readback, clip, &box))
+	    {
+		gl->read_pixels (box.x1 + src->x,
+				 src->attached->height - (box.y2 + src->y),
+				 box.x2 - box.x1, box.y2 - box.y1,
+				 gl_format->format, gl_format->type,
+				 pixels +
+				 (readback->y_src + readback->height -
+				  box.y2) * bytes_per_line +
+				 (box.x1 - readback->x_src) * bytes_per_pixel);
+		_glitz_readback_count (readback, box.x2 - box.x1,
+				       box.y2 - box.y1, bytes_per_pixel);
+	    }
+	    clip++;
+	}
+
+	glitz_state_enable (gl, GLITZ_GL_SCISSOR_TEST);
+    }
+    else if (readback->fb)
+    {
+	glitz_texture_t *texture = readback->texture;
+
+	while (n_clip--)
+	{
+	    if (_glitz_readback_clip_box (readback, clip, &box))
+	    {
+		gl->read_pixels (texture->box.x1 + box.x1,
+				 texture->box.y2 - box.y2,
+				 box.x2 - box.x1, box.y2 - box.y1,
+				 gl_format->format, gl_format->type,
+				 pixels +
+				 (readback->y_src + readback->height -
+				  box.y2) * bytes_per_line +
+				 (box.x1 - readback->x_src) * bytes_per_pixel);
+		_glitz_readback_count (readback, box.x2 - box.x1,
+				       box.y2 - box.y1, bytes_per_pixel);
+	    }
+	    clip++;
+	}
+
+	_glitz_readback_release_framebuffer (readback);
+    }
+    else
+    {
+	glitz_texture_bind (gl, readback->texture);
+	gl->get_tex_image (readback->texture->target, 0,
+			   gl_format->format, gl_format->type,
+			   pixels);
+	glitz_texture_unbind (gl, readback->texture);
+	_glitz_readback_count (readback, readback->texture->width,
+			       readback->texture->height, bytes_per_pixel);
+    }
+}
+
+/* Converts data, as read in the GL format, into the destination buffer */
+static void
+_glitz_readback_transform (glitz_pixel_readback_t *readback,
+			   char                   *data)
+{
+    glitz_pixel_format_t *format = &readback->format;
+    glitz_image_t        src_image, dst_image;
+    glitz_box_t          *clip = readback->clip;
+    int                  n_clip = readback->n_clip;
+    glitz_box_t          box;
+    int                  y;
+
+    src_image.data   = data;
+    src_image.format = &readback->gl_format->pixel;
+    src_image.width  = readback->src_w;
+    src_image.height = readback->src_h;
+
+    dst_image.data = glitz_buffer_map (readback->buffer,
+				       GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+    dst_image.format = format;
+    dst_image.width  = readback->width;
+    dst_image.height = readback->height;
+
+    while (n_clip--)
+    {
+	if (_glitz_readback_clip_box (readback, clip, &box))
+	{
+	    if (format->scanline_order == GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP)
+	    {
+		src_image.data = data + readback->bytes_per_line *
+		    (readback->src_h - box.y2);
+		y = readback->height - box.y2 + readback->y_src;
+	    }
+	    else
+	    {
+		src_image.data = data - readback->bytes_per_line *
+		    (box.y1 - readback->src_y);
+		y = box.y1 - readback->y_src;
+	    }
+
+	    _glitz_pixel_transform (readback->transform,
+				    &src_image,
+				    &dst_image,
+				    box.x1 - readback->src_x,
+				    0,
+				    format->xoffset + (box.x1 - readback->x_src),
+				    format->skip_lines + y,
+				    box.x2 - box.x1, box.y2 - box.y1);
 	}
 	clip++;
     }
 
-    if (transform)
-    {
-	free (data);
-	glitz_buffer_unmap (buffer);
-    } else
-	glitz_buffer_unbind (buffer);
-
-BAIL:
-    glitz_texture_unbind (gl, texture);
+    glitz_buffer_unmap (readback->buffer);
+}
 
-    if (surface)
+/* Copies data, as read without conversion, into the destination buffer */
+static void
+_glitz_readback_copy (glitz_pixel_readback_t *readback,
+		      char                   *data)
+{
+    int         bytes_per_line = readback->bytes_per_line;
+    int         bytes_per_pixel = readback->bytes_per_pixel;
+    glitz_box_t *clip = readback->clip;
+    int         n_clip = readback->n_clip;
+    glitz_box_t box;
+    char        *pixels;
+    int         offset, size, y;
+
+    pixels = glitz_buffer_map (readback->buffer,
+			       GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+    pixels += readback->format.skip_lines * bytes_per_line;
+    pixels += readback->format.xoffset * bytes_per_pixel;
+
+    if (readback->n_planes)
     {
-	glitz_surface_pop_current (surface);
+	glitz_yuv_plane_t *plane = readback->planes;
+
+	for (; plane < readback->planes + readback->n_planes; plane++)
+	{
+	    offset = plane->offset;
+	    for (y = 0; y < plane->height; y++)
+	    {
+		memcpy (pixels + offset, data + offset, plane->width * 4);
+		offset += plane->stride;
+	    }
+	}
     }
     else
     {
-	dst->drawable->backend->pop_current (dst->drawable);
-    }
+	/* same layout as _glitz_readback_read leaves in client memory */
+	while (n_clip--)
+	{
+	    if (_glitz_readback_clip_box (readback, clip, &box))
+	    {
+		offset =
+		    (readback->y_src + readback->height - box.y2) *
+		    bytes_per_line +
+		    (box.x1 - readback->x_src) * bytes_per_pixel;
+		size = (box.x2 - box.x1) * bytes_per_pixel;
 
-    if (restore_state)
-    {
-	/* pixel store state */
-	gl->pixel_store_i (GLITZ_GL_UNPACK_ROW_LENGTH,  unpackrowlength);
-	gl->pixel_store_i (GLITZ_GL_UNPACK_ALIGNMENT,   unpackalignment);
-	gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_ROWS,   unpackskiprows);
-	gl->pixel_store_i (GLITZ_GL_UNPACK_SKIP_PIXELS, unpackskippixels);
+		for (y = box.y1; y < box.y2; y++)
+		{
+		    memcpy (pixels + offset, data + offset, size);
+		    offset += bytes_per_line;
+		}
+	    }
+	    clip++;
+	}
+    }
 
-	/* get texture bindings */
-	if (t2d)
-	    gl->enable (GLITZ_GL_TEXTURE_2D);
-	else
-	    gl->disable (GLITZ_GL_TEXTURE_2D);
+    glitz_buffer_unmap (readback->buffer);
+}
 
-	gl->bind_texture (GLITZ_GL_TEXTURE_2D, tbind2d);
+static char *
+_glitz_readback_bind_buffer (glitz_pixel_readback_t *readback)
+{
+    char *pixels;
 
-	if (trect)
-	    gl->enable (GLITZ_GL_TEXTURE_RECTANGLE);
-	else
-	    gl->disable (GLITZ_GL_TEXTURE_RECTANGLE);
+    pixels = glitz_buffer_bind (readback->buffer, GLITZ_GL_PIXEL_PACK_BUFFER);
+    pixels += readback->format.skip_lines * readback->bytes_per_line;
+    pixels += readback->format.xoffset * readback->bytes_per_pixel;
 
-	gl->bind_texture (GLITZ_GL_TEXTURE_RECTANGLE, tbindrect);
-    }
+    return pixels;
 }
 
 void
@@ -1333,21 +4080,8 @@ glitz_get_pixels (glitz_surface_t      *src,
 		  glitz_pixel_format_t *format,
 		  glitz_buffer_t       *buffer)
 {
-    glitz_box_t		    *clip = src->clip;
-    int			    n_clip = src->n_clip;
-    glitz_bool_t	    from_drawable;
-    glitz_texture_t	    *texture = NULL;
-    char		    *pixels, *data = NULL;
-    glitz_gl_pixel_format_t *gl_format = NULL;
-    unsigned long	    transform = 0;
-    int			    src_x = x_src, src_y = y_src;
-    int			    src_w = width, src_h = height;
-    int			    bytes_per_line, bytes_per_pixel;
-    glitz_color_format_t    *color;
-    unsigned long           color_mask;
-    glitz_box_t             box;
-
-    GLITZ_GL_SURFACE (src);
+    glitz_pixel_readback_t readback;
+    char		   *pixels, *data = NULL;
 
     if (x_src < 0 || x_src > (src->box.x2 - width) ||
 	y_src < 0 || y_src > (src->box.y2 - height))
@@ -1356,343 +4090,319 @@ glitz_get_pixels (glitz_surface_t      *src,
 	return;
     }
 
+    glitz_surface_flush_batch (src);
+
     if (SURFACE_SOLID (src))
     {
-	glitz_image_t src_image, dst_image;
-	glitz_pixel_format_t dst_format;
+	_glitz_get_solid_pixels (src, x_src, y_src, width, height,
+				 format, buffer);
+	return;
+    }
 
-	while (n_clip--)
+    if (!_glitz_readback_begin (&readback, src, x_src, y_src, width, height,
+				format, buffer))
+	return;
+
+    if (readback.transform)
+    {
+	data = malloc (readback.bytes_per_line * readback.src_h);
+	if (!data)
 	{
-	    box.x1 = clip->x1 + src->x_clip;
-	    box.y1 = clip->y1 + src->y_clip;
-	    box.x2 = clip->x2 + src->x_clip;
-	    box.y2 = clip->y2 + src->y_clip;
-	    if (x_src > box.x1)
-		box.x1 = x_src;
-	    if (y_src > box.y1)
-		box.y1 = y_src;
-	    if (x_src + width < box.x2)
-		box.x2 = x_src + width;
-	    if (y_src + height < box.y2)
-		box.y2 = y_src + height;
+	    glitz_surface_status_add (src, GLITZ_STATUS_NO_MEMORY_MASK);
+	    _glitz_readback_release_framebuffer (&readback);
+	    glitz_surface_pop_current (src);
+	    return;
+	}
 
-	    if (box.x1 < box.x2 && box.y1 < box.y2)
-	    {
-		if (SURFACE_SOLID_DAMAGE (src))
-		{
-		    glitz_surface_push_current (src,
-						GLITZ_ANY_CONTEXT_CURRENT);
-		    glitz_surface_sync_solid (src);
-		    glitz_surface_pop_current (src);
-		}
+	pixels = data;
+    }
+    else
+	pixels = _glitz_readback_bind_buffer (&readback);
 
-		src_image.width = src_image.height = 1;
+    _glitz_readback_read (&readback, pixels);
 
-		dst_format = *format;
+    if (readback.transform)
+	_glitz_readback_transform (&readback, data);
+    else
+	glitz_buffer_unbind (buffer);
 
-		dst_image.data =
-		    glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_WRITE_ONLY);
-		dst_image.data += format->skip_lines * format->bytes_per_line;
-		dst_image.format = &dst_format;
-		dst_image.width = dst_image.height = 1;
+    glitz_surface_pop_current (src);
 
-		if (format->masks.alpha_mask)
-		{
-		    src_image.data = (void *) &src->solid.alpha;
-		    src_image.format = &_solid_format[SOLID_ALPHA];
+    if (data)
+	free (data);
+}
 
-		    dst_format.masks.alpha_mask = format->masks.alpha_mask;
-		    dst_format.masks.red_mask = 0;
-		    dst_format.masks.green_mask = 0;
-		    dst_format.masks.blue_mask = 0;
+/*
+ * Starts reading back pixels into a pixel buffer object without waiting
+ * for the GPU. When a conversion is needed, or the destination is client
+ * memory, the pixels are read into a stream read buffer of our own and
+ * converted or copied when the readback is mapped. Readbacks that cannot
+ * be done asynchronously are completed right away.
+ */
+glitz_pixel_readback_t *
+glitz_get_pixels_async (glitz_surface_t      *src,
+			int                  x_src,
+			int                  y_src,
+			int                  width,
+			int                  height,
+			glitz_pixel_format_t *format,
+			glitz_buffer_t       *buffer)
+{
+    glitz_pixel_readback_t *readback;
+    glitz_drawable_t       *drawable;
+    glitz_buffer_t         *pack;
+    unsigned long          feature_mask;
+    unsigned int           size;
+    char                   *pixels;
+    int                    i;
 
-		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
-					    &src_image, &dst_image,
-					    0, 0, format->xoffset, 0, 1, 1);
-		}
+    if (x_src < 0 || x_src > (src->box.x2 - width) ||
+	y_src < 0 || y_src > (src->box.y2 - height))
+    {
+	glitz_surface_status_add (src, GLITZ_STATUS_BAD_COORDINATE_MASK);
+	return NULL;
+    }
 
-		if (format->masks.red_mask)
-		{
-		    src_image.data = (void *) &src->solid.red;
-		    src_image.format = &_solid_format[SOLID_RED];
+    readback = calloc (1, sizeof (glitz_pixel_readback_t));
+    if (!readback)
+    {
+	glitz_surface_status_add (src, GLITZ_STATUS_NO_MEMORY_MASK);
+	return NULL;
+    }
 
-		    dst_format.masks.alpha_mask = 0;
-		    dst_format.masks.red_mask = format->masks.red_mask;
-		    dst_format.masks.green_mask = 0;
-		    dst_format.masks.blue_mask = 0;
+    glitz_surface_reference (src);
+    glitz_buffer_reference (buffer);
 
-		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
-					    &src_image, &dst_image,
-					    0, 0, format->xoffset, 0, 1, 1);
-		}
+    readback->src = src;
+    readback->buffer = buffer;
 
-		if (format->masks.green_mask)
-		{
-		    src_image.data = (void *) &src->solid.green;
-		    src_image.format = &_solid_format[SOLID_GREEN];
+    feature_mask = src->drawable->backend->feature_mask;
 
-		    dst_format.masks.alpha_mask = 0;
-		    dst_format.masks.red_mask = 0;
-		    dst_format.masks.green_mask = format->masks.green_mask;
-		    dst_format.masks.blue_mask = 0;
+    if (SURFACE_SOLID (src) ||
+	!(feature_mask & GLITZ_FEATURE_PIXEL_BUFFER_OBJECT_MASK))
+    {
+	glitz_get_pixels (src, x_src, y_src, width, height, format, buffer);
+	return readback;
+    }
 
-		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
-					    &src_image, &dst_image,
-					    0, 0, format->xoffset, 0, 1, 1);
-		}
+    glitz_surface_flush_batch (src);
 
-		if (format->masks.blue_mask)
-		{
-		    src_image.data = (void *) &src->solid.blue;
-		    src_image.format = &_solid_format[SOLID_BLUE];
+    /* fences are only valid in the context that set them, so pixels
+       are read in the context of this drawable and it is made current
+       again whenever the fence is used */
+    drawable = (src->attached) ? src->attached : src->drawable;
+    glitz_drawable_reference (drawable);
+    readback->drawable = drawable;
 
-		    dst_format.masks.alpha_mask = 0;
-		    dst_format.masks.red_mask = 0;
-		    dst_format.masks.green_mask = 0;
-		    dst_format.masks.blue_mask = format->masks.blue_mask;
+    drawable->backend->push_current (drawable, NULL, GLITZ_CONTEXT_CURRENT,
+				     NULL);
 
-		    _glitz_pixel_transform (GLITZ_TRANSFORM_PIXELS_MASK,
-					    &src_image, &dst_image,
-					    0, 0, format->xoffset, 0, 1, 1);
-		}
+    if (!_glitz_readback_begin (readback, src, x_src, y_src, width, height,
+				format, buffer))
+    {
+	drawable->backend->pop_current (drawable);
+	readback->clip = NULL;
+	return readback;
+    }
 
-		glitz_buffer_unmap (buffer);
+    if (readback->transform || !buffer->drawable)
+    {
+	size = readback->bytes_per_line * readback->src_h;
+	for (i = 0; i < readback->n_planes; i++)
+	{
+	    glitz_yuv_plane_t *plane = &readback->planes[i];
 
-		break;
-	    }
-	    clip++;
+	    size = MAX (size, plane->offset + plane->stride * plane->height);
 	}
 
-	return;
-    }
-
-    color = &src->format->color;
-    from_drawable = glitz_surface_push_current (src, GLITZ_DRAWABLE_CURRENT);
-    if (from_drawable)
-    {
-	if (src->attached)
-	    color = &src->attached->format->d.color;
-    }
-    else
-    {
-	texture = glitz_surface_get_texture (src, 0);
-	if (!texture)
+	pack = glitz_pixel_buffer_create (drawable, NULL, size,
+					  GLITZ_BUFFER_HINT_STREAM_READ);
+	readback->clip = malloc (readback->n_clip * sizeof (glitz_box_t));
+	if (!pack || !readback->clip)
 	{
+	    glitz_surface_status_add (src, GLITZ_STATUS_NO_MEMORY_MASK);
+	    _glitz_readback_release_framebuffer (readback);
 	    glitz_surface_pop_current (src);
-	    return;
+	    drawable->backend->pop_current (drawable);
+	    glitz_buffer_destroy (pack);
+	    glitz_pixel_readback_destroy (readback);
+	    return NULL;
 	}
 
-	if (texture->width > width || texture->height > height)
-	    transform |= GLITZ_TRANSFORM_COPY_BOX_MASK;
+	memcpy (readback->clip, src->clip,
+		readback->n_clip * sizeof (glitz_box_t));
 
-	if (src->n_clip > 1			   ||
-	    clip->x1 + src->x_clip > x_src	   ||
-	    clip->y1 + src->y_clip > y_src	   ||
-	    clip->x2 + src->x_clip < x_src + width ||
-	    clip->y2 + src->y_clip < y_src + height)
-	    transform |= GLITZ_TRANSFORM_COPY_BOX_MASK;
+	readback->pack = pack;
+	pixels = glitz_buffer_bind (pack, GLITZ_GL_PIXEL_PACK_BUFFER);
     }
-
-    if (transform || height > 1)
+    else
     {
-	if (format->scanline_order == GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN)
-	    transform |= GLITZ_TRANSFORM_SCANLINE_ORDER_MASK;
+	pack = buffer;
+	pixels = _glitz_readback_bind_buffer (readback);
     }
 
-    color_mask = 0;
-    if (format->masks.red_mask)
-	color_mask |= GLITZ_FORMAT_RED_SIZE_MASK;
-    if (format->masks.green_mask)
-	color_mask |= GLITZ_FORMAT_GREEN_SIZE_MASK;
-    if (format->masks.blue_mask)
-	color_mask |= GLITZ_FORMAT_BLUE_SIZE_MASK;
-    if (format->masks.alpha_mask)
-	color_mask |= GLITZ_FORMAT_ALPHA_SIZE_MASK;
+    _glitz_readback_read (readback, pixels);
+
+    if (!readback->pack)
+	readback->clip = NULL;
+
+    glitz_buffer_unbind (pack);
+
+    glitz_surface_pop_current (src);
 
-    /* find direct format */
-    gl_format =
-	_glitz_find_gl_pixel_format (format, color_mask,
-				     src->drawable->backend->feature_mask);
-    if (gl_format == NULL)
     {
-	unsigned int features;
+	GLITZ_GL_DRAWABLE (drawable);
 
-	transform |= GLITZ_TRANSFORM_PIXELS_MASK;
-	features = src->drawable->backend->feature_mask;
+	if (feature_mask & GLITZ_FEATURE_SYNC_MASK)
+	{
+	    readback->sync =
+		gl->fence_sync (GLITZ_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	else if (feature_mask & GLITZ_FEATURE_FENCE_MASK)
+	{
+	    gl->gen_fences (1, &readback->fence);
+	    gl->set_fence (readback->fence, GLITZ_GL_ALL_COMPLETED_NV);
+	}
 
-	gl_format = _glitz_find_best_gl_pixel_format (format, color, features);
+	gl->flush ();
     }
 
-    /* should not happen */
-    if (gl_format == NULL)
+    drawable->backend->pop_current (drawable);
+
+    return readback;
+}
+
+static void
+_glitz_readback_release_fence (glitz_pixel_readback_t *readback)
+{
+    GLITZ_GL_DRAWABLE (readback->drawable);
+
+    if (readback->sync)
     {
-	glitz_surface_pop_current (src);
-	return;
+	gl->delete_sync (readback->sync);
+	readback->sync = NULL;
     }
 
-    if (transform)
+    if (readback->fence)
     {
-	int stride;
+	gl->delete_fences (1, &readback->fence);
+	readback->fence = 0;
+    }
+}
 
-	if (transform & GLITZ_TRANSFORM_COPY_BOX_MASK)
-	{
-	    if (texture)
-	    {
-		src_w = texture->width;
-		src_h = texture->height;
-		src_x = src->texture.box.x1;
-		src_y = src->texture.box.y1;
-	    }
-	}
+glitz_bool_t
+glitz_pixel_readback_is_done (glitz_pixel_readback_t *readback)
+{
+    glitz_drawable_t *drawable = readback->drawable;
+    glitz_bool_t     done = 1;
 
-	stride = (((src_w * gl_format->pixel.masks.bpp) / 8) + 3) & -4;
+    if (!readback->sync && !readback->fence)
+	return 1;
 
-	data = malloc (stride * src_h);
-	if (!data)
-	{
-	    glitz_surface_status_add (src, GLITZ_STATUS_NO_MEMORY_MASK);
-	    return;
-	}
+    drawable->backend->push_current (drawable, NULL, GLITZ_CONTEXT_CURRENT,
+				     NULL);
 
-	pixels = data;
-	bytes_per_pixel = gl_format->pixel.masks.bpp / 8;
-	bytes_per_line = stride;
-    }
-    else
     {
-	bytes_per_pixel = format->masks.bpp / 8;
-	bytes_per_line = format->bytes_per_line;
-	if (!bytes_per_line)
-	    bytes_per_line = width * bytes_per_pixel;
+	GLITZ_GL_DRAWABLE (drawable);
 
-	pixels = glitz_buffer_bind (buffer, GLITZ_GL_PIXEL_PACK_BUFFER);
-	pixels += format->skip_lines * bytes_per_line;
-	pixels += format->xoffset * bytes_per_pixel;
+	if (readback->sync)
+	{
+	    if (gl->client_wait_sync (readback->sync, 0, 0) ==
+		GLITZ_GL_TIMEOUT_EXPIRED)
+		done = 0;
+	}
+	else
+	    done = gl->test_fence (readback->fence);
     }
 
-    gl->pixel_store_i (GLITZ_GL_PACK_SKIP_ROWS, 0);
-    gl->pixel_store_i (GLITZ_GL_PACK_SKIP_PIXELS, 0);
+    if (done)
+	_glitz_readback_release_fence (readback);
 
-    if ((bytes_per_line % 4) == 0)
-	gl->pixel_store_i (GLITZ_GL_PACK_ALIGNMENT, 4);
-    else if ((bytes_per_line % 2) == 0)
-	gl->pixel_store_i (GLITZ_GL_PACK_ALIGNMENT, 2);
-    else
-	gl->pixel_store_i (GLITZ_GL_PACK_ALIGNMENT, 1);
+    drawable->backend->pop_current (drawable);
 
-    gl->pixel_store_i (GLITZ_GL_PACK_ROW_LENGTH,
-		       bytes_per_line / bytes_per_pixel);
+    return done;
+}
+
+void *
+glitz_pixel_readback_map (glitz_pixel_readback_t *readback)
+{
+    glitz_drawable_t *drawable = readback->drawable;
 
-    if (from_drawable)
+    if (readback->data)
+	return readback->data;
+
+    if (readback->sync || readback->fence || readback->pack)
     {
-	src->drawable->backend->read_buffer (src->drawable, src->buffer);
+	GLITZ_GL_DRAWABLE (drawable);
 
-	gl->disable (GLITZ_GL_SCISSOR_TEST);
+	drawable->backend->push_current (drawable, NULL,
+					 GLITZ_CONTEXT_CURRENT, NULL);
 
-	while (n_clip--)
+	if (readback->sync)
+	{
+	    while (gl->client_wait_sync (readback->sync,
+					 GLITZ_GL_SYNC_FLUSH_COMMANDS_BIT,
+					 1000000000) ==
+		   GLITZ_GL_TIMEOUT_EXPIRED)
+		;
+	}
+	else if (readback->fence)
+	    gl->finish_fence (readback->fence);
+
+	_glitz_readback_release_fence (readback);
+
+	if (readback->pack)
 	{
-	    box.x1 = clip->x1 + src->x_clip;
-	    box.y1 = clip->y1 + src->y_clip;
-	    box.x2 = clip->x2 + src->x_clip;
-	    box.y2 = clip->y2 + src->y_clip;
-	    if (x_src > box.x1)
-		box.x1 = x_src;
-	    if (y_src > box.y1)
-		box.y1 = y_src;
-	    if (x_src + width < box.x2)
-		box.x2 = x_src + width;
-	    if (y_src + height < box.y2)
-		box.y2 = y_src + height;
+	    char *data;
 
-	    if (box.x1 < box.x2 && box.y1 < box.y2)
-	    {
-		gl->read_pixels (box.x1 + src->x,
-				 src->attached->height - (box.y2 + src->y),
-				 box.x2 - box.x1, box.y2 - box.y1,
-				 gl_format->format, gl_format->type,
-				 pixels +
-				 (y_src + height - box.y2) * bytes_per_line +
-				 (box.x1 - x_src) * bytes_per_pixel);
-	    }
-	    clip++;
+	    data = glitz_buffer_map (readback->pack,
+				     GLITZ_BUFFER_ACCESS_READ_ONLY);
+	    if (readback->transform)
+		_glitz_readback_transform (readback, data);
+	    else
+		_glitz_readback_copy (readback, data);
+	    glitz_buffer_unmap (readback->pack);
+
+	    glitz_buffer_destroy (readback->pack);
+	    readback->pack = NULL;
 	}
 
-	gl->enable (GLITZ_GL_SCISSOR_TEST);
-    }
-    else
-    {
-	glitz_texture_bind (gl, texture);
-	gl->get_tex_image (texture->target, 0,
-			   gl_format->format, gl_format->type,
-			   pixels);
-	glitz_texture_unbind (gl, texture);
+	drawable->backend->pop_current (drawable);
     }
 
-    if (transform)
-    {
-	glitz_image_t src_image, dst_image;
-	int           y;
+    readback->data = glitz_buffer_map (readback->buffer,
+				       GLITZ_BUFFER_ACCESS_READ_ONLY);
 
-	src_image.data   = data;
-	src_image.format = &gl_format->pixel;
-	src_image.width  = src_w;
-	src_image.height = src_h;
+    return readback->data;
+}
 
-	dst_image.data = glitz_buffer_map (buffer,
-					   GLITZ_BUFFER_ACCESS_WRITE_ONLY);
-	dst_image.format = format;
-	dst_image.width  = width;
-	dst_image.height = height;
+void
+glitz_pixel_readback_destroy (glitz_pixel_readback_t *readback)
+{
+    glitz_drawable_t *drawable = readback->drawable;
 
-	clip   = src->clip;
-	n_clip = src->n_clip;
+    if (readback->data)
+	glitz_buffer_unmap (readback->buffer);
 
-	while (n_clip--)
-	{
-	    box.x1 = clip->x1 + src->x_clip;
-	    box.y1 = clip->y1 + src->y_clip;
-	    box.x2 = clip->x2 + src->x_clip;
-	    box.y2 = clip->y2 + src->y_clip;
-	    if (x_src > box.x1)
-		box.x1 = x_src;
-	    if (y_src > box.y1)
-		box.y1 = y_src;
-	    if (x_src + width < box.x2)
-		box.x2 = x_src + width;
-	    if (y_src + height < box.y2)
-		box.y2 = y_src + height;
+    if (readback->sync || readback->fence)
+    {
+	drawable->backend->push_current (drawable, NULL,
+					 GLITZ_CONTEXT_CURRENT, NULL);
+	_glitz_readback_release_fence (readback);
+	drawable->backend->pop_current (drawable);
+    }
 
-	    if (format->scanline_order == GLITZ_PIXEL_SCANLINE_ORDER_BOTTOM_UP)
-	    {
-		src_image.data = data + bytes_per_line * (src_h - box.y2);
-		y =  height - box.y2 + y_src;
-	    }
-	    else
-	    {
-		src_image.data = data - bytes_per_line * (box.y1 - src_y);
-		y = box.y1 - y_src;
-	    }
+    if (readback->pack)
+	glitz_buffer_destroy (readback->pack);
 
-	    if (box.x1 < box.x2 && box.y1 < box.y2)
-	    {
-		_glitz_pixel_transform (transform,
-					&src_image,
-					&dst_image,
-					box.x1 - src_x,
-					0,
-					format->xoffset + (box.x1 - x_src),
-					format->skip_lines + y,
-					box.x2 - box.x1, box.y2 - box.y1);
-	    }
-	    clip++;
-	}
+    if (readback->clip)
+	free (readback->clip);
 
-	glitz_buffer_unmap (buffer);
-    } else
-	glitz_buffer_unbind (buffer);
+    if (drawable)
+	glitz_drawable_destroy (drawable);
 
-    glitz_surface_pop_current (src);
+    glitz_buffer_destroy (readback->buffer);
+    glitz_surface_destroy (readback->src);
 
-    if (data)
-	free (data);
+    free (readback);
 }
@@ -0,0 +1,124 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+  Define the following before including this file:
+
+  SRC  name of source pixel format
+  DST  name of destination pixel format
+
+  For each format name FMT, FMT_BPP (8, 16, 24 or 32) and the channel
+  masks FMT_A, FMT_R, FMT_G and FMT_B must be defined. The converter is
+  named _convert_SRC_to_DST and produces exactly the same result as the
+  generic fetch/store path, with all masks known at compile time.
+*/
+
+#define PIXELIMP_PASTE(a, b) a ## b
+#define PIXELIMP_FMT(f, c) PIXELIMP_PASTE (f, c)
+#define PIXELIMP_NAME3(a, b, c) a ## b ## _to_ ## c
+#define PIXELIMP_NAME(a, b, c) PIXELIMP_NAME3 (a, b, c)
+
+#define S_BPP PIXELIMP_FMT (SRC, _BPP)
+#define S_A   PIXELIMP_FMT (SRC, _A)
+#define S_R   PIXELIMP_FMT (SRC, _R)
+#define S_G   PIXELIMP_FMT (SRC, _G)
+#define S_B   PIXELIMP_FMT (SRC, _B)
+
+#define D_BPP PIXELIMP_FMT (DST, _BPP)
+#define D_A   PIXELIMP_FMT (DST, _A)
+#define D_R   PIXELIMP_FMT (DST, _R)
+#define D_G   PIXELIMP_FMT (DST, _G)
+#define D_B   PIXELIMP_FMT (DST, _B)
+
+static void
+PIXELIMP_NAME (_convert_, SRC, DST) (glitz_pixel_transform_op_t *src,
+				     glitz_pixel_transform_op_t *dst,
+				     int			width,
+				     uint32_t			and_mask,
+				     uint32_t			or_mask)
+{
+    const uint8_t *s = (const uint8_t *) src->line + src->offset * (S_BPP / 8);
+    uint8_t	  *d = (uint8_t *) dst->line + dst->offset * (D_BPP / 8);
+    uint32_t	  p, a, r, g, b;
+
+    while (width--)
+    {
+
+#if S_BPP == 32
+	p = *((const uint32_t *) s);
+#elif S_BPP == 24
+#  if IMAGE_BYTE_ORDER == MSBFirst
+	p = 0xff000000 | (s[2] << 16) | (s[1] << 8) | (s[0]);
+#  else
+	p = 0xff000000 | (s[0] << 16) | (s[1] << 8) | (s[2]);
+#  endif
+#elif S_BPP == 16
+	p = *((const uint16_t *) s);
+#else
+	p = *s;
+#endif
+
+	a = FETCH_A (p, S_A);
+	r = FETCH (p, S_R);
+	g = FETCH (p, S_G);
+	b = FETCH (p, S_B);
+
+	p = STORE (a, D_A) | STORE (r, D_R) | STORE (g, D_G) | STORE (b, D_B);
+
+#if D_BPP == 32
+	*((uint32_t *) d) = p;
+#elif D_BPP == 24
+#  if IMAGE_BYTE_ORDER == MSBFirst
+	d[2] = p >> 16;
+	d[1] = p >> 8;
+	d[0] = p;
+#  else
+	d[0] = p >> 16;
+	d[1] = p >> 8;
+	d[2] = p;
+#  endif
+#elif D_BPP == 16
+	*((uint16_t *) d) = (uint16_t) p;
+#else
+	*d = (uint8_t) p;
+#endif
+
+	s += S_BPP / 8;
+	d += D_BPP / 8;
+    }
+}
+
+#undef S_BPP
+#undef S_A
+#undef S_R
+#undef S_G
+#undef S_B
+#undef D_BPP
+#undef D_A
+#undef D_R
+#undef D_G
+#undef D_B
+#undef PIXELIMP_PASTE
+#undef PIXELIMP_FMT
+#undef PIXELIMP_NAME3
+#undef PIXELIMP_NAME
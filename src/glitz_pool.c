@@ -0,0 +1,346 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+/* Released texture names and framebuffer object drawables are kept
+   here, most recently released first, so that surfaces and drawables
+   of the same size and format can be created without going through
+   the driver again. */
+
+typedef enum {
+    GLITZ_POOL_ENTRY_TEXTURE,
+    GLITZ_POOL_ENTRY_DRAWABLE
+} glitz_pool_entry_type_t;
+
+struct _glitz_pool_entry {
+    glitz_pool_entry_type_t type;
+    unsigned long           size;
+    int                     width, height;
+
+    union {
+	struct {
+	    glitz_gl_uint_t            name;
+	    glitz_gl_enum_t            target;
+	    glitz_gl_int_t             format;
+	    glitz_texture_parameters_t param;
+	} texture;
+	struct {
+	    glitz_drawable_t            *drawable;
+	    glitz_int_drawable_format_t *format;
+	} drawable;
+    } u;
+
+    glitz_pool_entry_t *prev, *next;
+};
+
+void
+glitz_pool_init (glitz_pool_t *pool)
+{
+    pool->head   = pool->tail = NULL;
+    pool->size   = 0;
+    pool->budget = GLITZ_POOL_BUDGET_DEFAULT;
+    pool->hits   = 0;
+    pool->misses = 0;
+}
+
+static void
+_glitz_pool_unlink (glitz_pool_t       *pool,
+		    glitz_pool_entry_t *entry)
+{
+    if (entry->prev)
+	entry->prev->next = entry->next;
+    else
+	pool->head = entry->next;
+
+    if (entry->next)
+	entry->next->prev = entry->prev;
+    else
+	pool->tail = entry->prev;
+
+    pool->size -= entry->size;
+}
+
+static void
+_glitz_pool_push (glitz_pool_t       *pool,
+		  glitz_pool_entry_t *entry)
+{
+    entry->prev = NULL;
+    entry->next = pool->head;
+
+    if (pool->head)
+	pool->head->prev = entry;
+    else
+	pool->tail = entry;
+
+    pool->head = entry;
+    pool->size += entry->size;
+}
+
+/* must be called with a context of the drawable current */
+static void
+_glitz_pool_entry_destroy (glitz_drawable_t   *drawable,
+			   glitz_pool_entry_t *entry)
+{
+    GLITZ_GL_DRAWABLE (drawable);
+
+    if (entry->type == GLITZ_POOL_ENTRY_TEXTURE)
+	glitz_state_delete_textures (gl, 1, &entry->u.texture.name);
+    else
+	_glitz_fbo_drawable_free (entry->u.drawable.drawable);
+
+    free (entry);
+}
+
+static void
+_glitz_pool_shrink (glitz_drawable_t *drawable,
+		    unsigned long    size)
+{
+    glitz_pool_t       *pool = &drawable->pool;
+    glitz_pool_entry_t *entry;
+
+    if (pool->size <= size)
+	return;
+
+    drawable->backend->push_current (drawable, NULL,
+				     GLITZ_ANY_CONTEXT_CURRENT, NULL);
+
+    while (pool->size > size && pool->tail)
+    {
+	entry = pool->tail;
+	_glitz_pool_unlink (pool, entry);
+	_glitz_pool_entry_destroy (drawable, entry);
+    }
+
+    drawable->backend->pop_current (drawable);
+}
+
+void
+glitz_pool_trim (glitz_drawable_t *drawable)
+{
+    _glitz_pool_shrink (drawable, drawable->pool.budget);
+}
+
+void
+glitz_pool_fini (glitz_drawable_t *drawable)
+{
+    glitz_pool_t *pool = &drawable->pool;
+
+    if (pool->head)
+    {
+	drawable->backend->push_current (drawable, NULL,
+					 GLITZ_ANY_CONTEXT_CURRENT, NULL);
+
+	while (pool->head)
+	{
+	    glitz_pool_entry_t *entry = pool->head;
+
+	    _glitz_pool_unlink (pool, entry);
+	    _glitz_pool_entry_destroy (drawable, entry);
+	}
+
+	drawable->backend->pop_current (drawable);
+    }
+}
+
+static unsigned long
+_glitz_pool_texture_size (glitz_texture_t *texture)
+{
+    unsigned long size = (unsigned long) texture->width * texture->height;
+
+    switch (texture->format) {
+    case GLITZ_GL_ALPHA4:
+    case GLITZ_GL_ALPHA8:
+    case GLITZ_GL_LUMINANCE8:
+    case GLITZ_GL_R3_G3_B2:
+    case GLITZ_GL_RGBA2:
+	return size;
+    case GLITZ_GL_ALPHA12:
+    case GLITZ_GL_ALPHA16:
+    case GLITZ_GL_LUMINANCE16:
+    case GLITZ_GL_RGB4:
+    case GLITZ_GL_RGB5:
+    case GLITZ_GL_RGB5_A1:
+    case GLITZ_GL_RGBA4:
+	return size * 2;
+    case GLITZ_GL_RGB12:
+    case GLITZ_GL_RGB16:
+    case GLITZ_GL_RGBA12:
+    case GLITZ_GL_RGBA16:
+	return size * 8;
+    default:
+	return size * 4;
+    }
+}
+
+/* textures that need their padding cleared on allocation are not
+   recycled */
+#define TEXTURE_POOLABLE(texture)                               \
+    (!(TEXTURE_CLAMPABLE (texture) &&                           \
+       ((texture)->box.x2 > (texture)->width ||                 \
+	(texture)->box.y2 > (texture)->height)))
+
+glitz_bool_t
+glitz_pool_get_texture (glitz_drawable_t *drawable,
+			glitz_texture_t  *texture)
+{
+    glitz_pool_t       *pool = &drawable->pool;
+    glitz_pool_entry_t *entry;
+
+    if (!pool->budget || !TEXTURE_POOLABLE (texture))
+	return 0;
+
+    for (entry = pool->head; entry; entry = entry->next)
+    {
+	if (entry->type   == GLITZ_POOL_ENTRY_TEXTURE  &&
+	    entry->width  == texture->width            &&
+	    entry->height == texture->height           &&
+	    entry->u.texture.target == texture->target &&
+	    entry->u.texture.format == texture->format)
+	{
+	    _glitz_pool_unlink (pool, entry);
+
+	    texture->name   = entry->u.texture.name;
+	    texture->param  = entry->u.texture.param;
+	    texture->flags |= GLITZ_TEXTURE_FLAG_ALLOCATED_MASK;
+
+	    free (entry);
+	    pool->hits++;
+
+	    return 1;
+	}
+    }
+
+    pool->misses++;
+
+    return 0;
+}
+
+glitz_bool_t
+glitz_pool_put_texture (glitz_drawable_t *drawable,
+			glitz_texture_t  *texture)
+{
+    glitz_pool_t       *pool = &drawable->pool;
+    glitz_pool_entry_t *entry;
+    unsigned long      size;
+
+    if (!texture->name || !TEXTURE_ALLOCATED (texture) ||
+	!TEXTURE_POOLABLE (texture))
+	return 0;
+
+    size = _glitz_pool_texture_size (texture);
+    if (size > pool->budget)
+	return 0;
+
+    entry = malloc (sizeof (glitz_pool_entry_t));
+    if (!entry)
+	return 0;
+
+    _glitz_pool_shrink (drawable, pool->budget - size);
+
+    entry->type   = GLITZ_POOL_ENTRY_TEXTURE;
+    entry->size   = size;
+    entry->width  = texture->width;
+    entry->height = texture->height;
+
+    entry->u.texture.name   = texture->name;
+    entry->u.texture.target = texture->target;
+    entry->u.texture.format = texture->format;
+    entry->u.texture.param  = texture->param;
+
+    _glitz_pool_push (pool, entry);
+
+    texture->name = 0;
+
+    return 1;
+}
+
+glitz_drawable_t *
+glitz_pool_get_drawable (glitz_drawable_t            *drawable,
+			 glitz_int_drawable_format_t *format,
+			 int                         width,
+			 int                         height)
+{
+    glitz_pool_t       *pool = &drawable->pool;
+    glitz_pool_entry_t *entry;
+    glitz_drawable_t   *fbo;
+
+    if (!pool->budget)
+	return NULL;
+
+    for (entry = pool->head; entry; entry = entry->next)
+    {
+	if (entry->type   == GLITZ_POOL_ENTRY_DRAWABLE &&
+	    entry->width  == width                     &&
+	    entry->height == height                    &&
+	    entry->u.drawable.format == format)
+	{
+	    _glitz_pool_unlink (pool, entry);
+
+	    fbo = entry->u.drawable.drawable;
+
+	    free (entry);
+	    pool->hits++;
+
+	    return fbo;
+	}
+    }
+
+    pool->misses++;
+
+    return NULL;
+}
+
+glitz_bool_t
+glitz_pool_put_drawable (glitz_drawable_t *drawable,
+			 glitz_drawable_t *fbo,
+			 unsigned long    size)
+{
+    glitz_pool_t       *pool = &drawable->pool;
+    glitz_pool_entry_t *entry;
+
+    if (size > pool->budget)
+	return 0;
+
+    entry = malloc (sizeof (glitz_pool_entry_t));
+    if (!entry)
+	return 0;
+
+    _glitz_pool_shrink (drawable, pool->budget - size);
+
+    entry->type   = GLITZ_POOL_ENTRY_DRAWABLE;
+    entry->size   = size;
+    entry->width  = fbo->width;
+    entry->height = fbo->height;
+
+    entry->u.drawable.drawable = fbo;
+    entry->u.drawable.format   = fbo->format;
+
+    _glitz_pool_push (pool, entry);
+
+    return 1;
+}
@@ -278,6 +278,8 @@ static const char *_gradient_fetch_and_interpolate[] = {
 static const char *_colorspace_yv12_header[] = {
     "PARAM offset = program.local[0];",
     "PARAM minmax = program.local[1];",
+    "PARAM vcoeff = program.local[2];",
+    "PARAM ucoeff = program.local[3];",
     "ATTRIB pos = fragment.texcoord[%s];",
     "TEMP color, tmp, position;",
 
@@ -295,8 +297,330 @@ static const char *_colorspace_yv12[] = {
     "ADD position.x, position.x, offset.z;",
     "TEX tmp.y, position, texture[%s], %s;",
     "SUB tmp, tmp, { .5, .5 };",
-    "MAD color.xyz, { 1.596, -.813, 0 }, tmp.xxxw, color;",
-    "MAD color.xyz, { 0, -.391, 2.018 }, tmp.yyyw, color;", NULL
+    "MAD color.xyz, vcoeff, tmp.xxxw, color;",
+    "MAD color.xyz, ucoeff, tmp.yyyw, color;", NULL
+};
+
+/* interleaved chroma, offset.z is one texel and offset.w its inverse */
+static const char *_colorspace_nv12[] = {
+    "MAX position, position, minmax;",
+    "MIN position, position, minmax.zwww;",
+    "TEX color, position, texture[%s], %s;",
+    "MAD position.xy, position, .5, offset;",
+    "MUL tmp.x, position.x, offset.w;",
+    "FLR tmp.x, tmp.x;",
+    "MAD tmp.x, tmp.x, 2, .5;",
+    "MUL position.x, tmp.x, offset.z;",
+    "TEX tmp.y, position, texture[%s], %s;",
+    "ADD position.x, position.x, offset.z;",
+    "TEX tmp.x, position, texture[%s], %s;",
+    "MAD color, color, 1.164, -0.073;",		/* -1.164 * 16 / 255 */
+    "SUB tmp, tmp, { .5, .5 };",
+    "MAD color.xyz, vcoeff, tmp.xxxw, color;",
+    "MAD color.xyz, ucoeff, tmp.yyyw, color;", NULL
+};
+
+static const char *_colorspace_packed_header[] = {
+    "PARAM offset = program.local[0];",
+    "PARAM minmax = program.local[1];",
+    "PARAM vcoeff = program.local[2];",
+    "PARAM ucoeff = program.local[3];",
+    "ATTRIB pos = fragment.texcoord[%s];",
+    "TEMP color, tmp, position, pair;",
+
+    /* extra declarations */
+    "%s", NULL
+};
+
+/* one texel holds two pixels, offset.x is the width of a texel and
+   offset.y its inverse */
+static const char *_colorspace_packed[] = {
+    "MAX position, position, minmax;",
+    "MIN position, position, minmax.zwww;",
+    "MUL tmp.x, position.x, offset.y;",
+    "FLR tmp.y, tmp.x;",
+    "SUB tmp.x, tmp.x, tmp.y;",
+    "ADD tmp.y, tmp.y, .5;",
+    "MUL position.x, tmp.y, offset.x;",
+    "SGE tmp.x, tmp.x, .5;",
+    "TEX pair, position, texture[%s], %s;",
+    "LRP color, tmp.x, pair.%s, pair.%s;",
+    "MOV tmp.x, pair.%s;",
+    "MOV tmp.y, pair.%s;",
+    "MAD color, color, 1.164, -0.073;",		/* -1.164 * 16 / 255 */
+    "MOV color.w, 1.0;",
+    "SUB tmp, tmp, { .5, .5 };",
+    "MAD color.xyz, vcoeff, tmp.xxxw, color;",
+    "MAD color.xyz, ucoeff, tmp.yyyw, color;", NULL
+};
+
+/*
+ * trapezoid coverage
+ *
+ * texcoord[0] holds the pixel position and the top and bottom of the
+ * trapezoid, texcoord[1] and texcoord[2] hold the normalized line
+ * equations of the left and right edges.
+ */
+static const char *_trapezoid_coverage[] = {
+    "!!ARBfp1.0",
+    "ATTRIB pos = fragment.texcoord[0];",
+    "ATTRIB left = fragment.texcoord[1];",
+    "ATTRIB right = fragment.texcoord[2];",
+    "TEMP span, cover;",
+
+    /* vertical coverage of the pixel row */
+    "ADD span.x, pos.y, 0.5;",
+    "MIN span.x, span.x, pos.w;",
+    "ADD span.y, pos.y, -0.5;",
+    "MAX span.y, span.y, pos.z;",
+    "SUB_SAT cover.y, span.x, span.y;",
+
+    /* horizontal coverage from the distance to each edge, the covered
+       part of the pixel is where the parts inside each edge overlap */
+    "DPH span.x, pos.xyyy, left;",
+    "DPH span.y, pos.xyyy, right;",
+    "ADD_SAT span, span, 0.5;",
+    "ADD cover.x, span.x, span.y;",
+    "SUB_SAT cover.x, cover.x, 1.0;",
+
+    "MUL result.color, cover.x, cover.y;",
+    "END", NULL
+};
+
+/*
+ * RGB to YUV packing
+ *
+ * Four 8 bit samples are packed into each RGBA fragment. offset holds
+ * the horizontal texture coordinate offset of the pixel each sample is
+ * taken from and coeff0-3 the weights and bias of the stored channel.
+ */
+static const char *_rgb_to_yuv[] = {
+    "!!ARBfp1.0",
+    "PARAM offset = program.local[0];",
+    "PARAM coeff0 = program.local[1];",
+    "PARAM coeff1 = program.local[2];",
+    "PARAM coeff2 = program.local[3];",
+    "PARAM coeff3 = program.local[4];",
+    "ATTRIB pos = fragment.texcoord[0];",
+    "TEMP position, color0, color1, color2, color3;",
+    "MOV position, pos;",
+    "ADD position.x, pos.x, offset.x;",
+    "TEX color0, position, texture[0], %s;",
+    "ADD position.x, pos.x, offset.y;",
+    "TEX color1, position, texture[0], %s;",
+    "ADD position.x, pos.x, offset.z;",
+    "TEX color2, position, texture[0], %s;",
+    "ADD position.x, pos.x, offset.w;",
+    "TEX color3, position, texture[0], %s;",
+    "DPH result.color.x, color0, coeff0;",
+    "DPH result.color.y, color1, coeff1;",
+    "DPH result.color.z, color2, coeff2;",
+    "DPH result.color.w, color3, coeff3;",
+    "END", NULL
+};
+
+/*
+ * Vertex programs
+ *
+ * Replace texgen and the texture matrices of the fixed function
+ * pipeline. The object position is offset by program.env[0] and, with
+ * GLITZ_VP_OFFSET_ATTRIB, by vertex attribute 6. The texture
+ * coordinates of each unit are taken from the vertex or, where the
+ * texgen mask says so, generated from the planes in program.env, and
+ * then transformed by the matrix rows that follow the planes.
+ */
+static const char *_vertex_header[] = {
+    "!!ARBvp1.0",
+    "PARAM mvp[4] = { state.matrix.mvp };",
+    "TEMP obj, tc;",
+    "ADD obj.xy, vertex.position, program.env[0];",
+    "MOV obj.zw, vertex.position;", NULL
+};
+
+static const char *_vertex_offset[] = {
+    "ADD obj.xy, obj, vertex.attrib[6];", NULL
+};
+
+static const char *_vertex_position[] = {
+    "DP4 result.position.x, mvp[0], obj;",
+    "DP4 result.position.y, mvp[1], obj;",
+    "DP4 result.position.z, mvp[2], obj;",
+    "DP4 result.position.w, mvp[3], obj;",
+    "MOV result.color, vertex.color;", NULL
+};
+
+static const char *_vertex_texcoord =
+    "MOV tc, vertex.texcoord[%d];";
+
+static const char *_vertex_tex_gen =
+    "DP4 tc.%c, program.env[%d], obj;";
+
+static const char *_vertex_tex_matrix =
+    "DP4 result.texcoord[%d].%c, program.env[%d], tc;";
+
+/*
+ * GLSL fragment shaders
+ *
+ * Built from the same pieces as the fragment programs: fetch from the
+ * filtered texture, filter or colorspace conversion, then the IN
+ * operation with the other operand and the per-component dot product.
+ * Parameters are in a uniform array laid out like program.local, and
+ * convolution samples and gradient stops are loops over the first n
+ * entries, so the array only needs to be sized to a power of two.
+ */
+static const char *_glsl_header =
+    "#version 110\n"
+    "%s"
+    "uniform vec4 local[%d];\n"
+    "uniform int n;\n";
+
+static const char *_glsl_rect_extension =
+    "#extension GL_ARB_texture_rectangle : require\n";
+
+static const char *_glsl_sampler =
+    "uniform %s texture%d;\n";
+
+static const char *_glsl_fetch =
+    "vec4 fetch (vec2 c)\n"
+    "{\n"
+    "    return %s (texture%d, c);\n"
+    "}\n";
+
+static const char *_glsl_main =
+    "void main ()\n"
+    "{\n"
+    "    vec4 pos = gl_TexCoord[%d];\n"
+    "    vec4 position, color, tmp;\n";
+
+static const struct _glitz_glsl_texture {
+    const char *sampler;
+    const char *lookup;
+    const char *lookup_proj;
+} _glsl_texture[GLITZ_TEXTURE_LAST] = {
+    { NULL, NULL, NULL },
+    { "sampler2D", "texture2D", "texture2DProj" },
+    { "sampler2DRect", "texture2DRect", "texture2DRectProj" }
+};
+
+static const char *_glsl_perspective_divide[] = {
+    "    position = pos / pos.w;\n", NULL
+};
+
+static const char *_glsl_no_perspective_divide[] = {
+    "    position = pos;\n", NULL
+};
+
+static const char *_glsl_convolution[] = {
+    "    color = vec4 (0.0);\n",
+    "    for (int i = 0; i < n; i++)\n",
+    "        color += fetch (position.xy + local[i].xy) * local[i].z;\n",
+    NULL
+};
+
+static const char *_glsl_linear_gradient[] = {
+    "    position.z = dot (local[0].xy, position.xy) + local[0].z;\n",
+    NULL
+};
+
+static const char *_glsl_radial_gradient[] = {
+    "    tmp.xy = position.xy - local[0].xy;\n",
+    "    tmp.w = dot (tmp.xy, local[0].zw);\n",
+    "    tmp.z = sqrt (dot (tmp.xy, tmp.xy) * local[1].z + tmp.w * tmp.w);\n",
+    "    position.z = (tmp.z - tmp.w) * local[1].w * local[1].x + "
+    "local[1].y;\n", NULL
+};
+
+static const char *_glsl_gradient_repeat[] = {
+    "    position.z = fract (position.z);\n", NULL
+};
+
+static const char *_glsl_gradient_reflect[] = {
+    "    position.z = 1.0 - abs (1.0 - 2.0 * fract (position.z * 0.5));\n",
+    NULL
+};
+
+/* the stops start at local[%d] */
+static const char *_glsl_gradient_stops[] = {
+    "    vec4 stop0 = local[%d];\n",
+    "    vec4 stop1 = local[%d + n - 1];\n",
+    "    for (int i = 1; i < n - 1; i++)\n",
+    "    {\n",
+    "        if (local[%d + i].z < position.z)\n",
+    "            stop0 = local[%d + i];\n",
+    "        if (position.z < local[%d + n - 1 - i].z)\n",
+    "            stop1 = local[%d + n - 1 - i];\n",
+    "    }\n",
+    "    color = fetch (stop0.xy);\n",
+    "    tmp = fetch (stop1.xy);\n",
+    "    position.z = clamp ((position.z - stop0.z) * stop0.w, 0.0, 1.0);\n",
+    "    color = mix (color, tmp, position.z);\n",
+    "    color.rgb *= color.a;\n", NULL
+};
+
+static const char *_glsl_colorspace_clamp[] = {
+    "    position = min (max (position, local[1]), local[1].zwww);\n", NULL
+};
+
+static const char *_glsl_colorspace_yv12[] = {
+    "    color = fetch (position.xy);\n",
+    "    position = position * 0.5 + local[0].xyww;\n",
+    "    tmp.x = fetch (position.xy).x;\n",
+    "    position.x += local[0].z;\n",
+    "    tmp.y = fetch (position.xy).y;\n",
+    "    color = color * 1.164 - 0.073;\n", NULL
+};
+
+static const char *_glsl_colorspace_nv12[] = {
+    "    color = fetch (position.xy);\n",
+    "    position.xy = position.xy * 0.5 + local[0].xy;\n",
+    "    position.x = (floor (position.x * local[0].w) * 2.0 + 0.5) * "
+    "local[0].z;\n",
+    "    tmp.y = fetch (position.xy).y;\n",
+    "    position.x += local[0].z;\n",
+    "    tmp.x = fetch (position.xy).x;\n",
+    "    color = color * 1.164 - 0.073;\n", NULL
+};
+
+/* first luma, second luma, V and U components of a texel */
+static const char *_glsl_colorspace_packed[] = {
+    "    tmp.x = position.x * local[0].y;\n",
+    "    tmp.y = floor (tmp.x);\n",
+    "    position.x = (tmp.y + 0.5) * local[0].x;\n",
+    "    tmp.x = step (0.5, tmp.x - tmp.y);\n",
+    "    vec4 pair = fetch (position.xy);\n",
+    "    color = vec4 (mix (pair.%c, pair.%c, tmp.x));\n",
+    "    tmp.x = pair.%c;\n",
+    "    tmp.y = pair.%c;\n",
+    "    color = color * 1.164 - 0.073;\n",
+    "    color.w = 1.0;\n", NULL
+};
+
+static const char *_glsl_colorspace_convert[] = {
+    "    tmp.xy -= 0.5;\n",
+    "    color.xyz += local[2].xyz * tmp.x + local[3].xyz * tmp.y;\n", NULL
+};
+
+static const char *_glsl_x_in_solid[] = {
+    "    gl_FragColor = color * gl_Color.a;\n", NULL
+};
+
+static const char *_glsl_solid_in_x[] = {
+    "    gl_FragColor = gl_Color * color.a;\n", NULL
+};
+
+static const char *_glsl_fetch_in =
+    "    tmp = %s (texture%d, gl_TexCoord[%d]);\n";
+
+static const char *_glsl_mask_in[2][3] = {
+    { "    gl_FragColor = color * tmp.a;\n", NULL, NULL },
+    { "    tmp.a = dot (tmp, gl_Color);\n",
+      "    gl_FragColor = color * tmp.a;\n", NULL }
+};
+
+static const char *_glsl_src_in[2][3] = {
+    { "    gl_FragColor = tmp * color.a;\n", NULL, NULL },
+    { "    color.a = dot (color, gl_Color);\n",
+      "    gl_FragColor = tmp * color.a;\n", NULL }
 };
 
 static struct _glitz_program_query {
@@ -364,7 +688,7 @@ _glitz_compile_arb_fragment_program (glitz_gl_proc_address_list_t *gl,
     while (gl->get_error () != GLITZ_GL_NO_ERROR);
 
     gl->gen_programs (1, &program);
-    gl->bind_program (GLITZ_GL_FRAGMENT_PROGRAM, program);
+    glitz_state_bind_program (gl, GLITZ_GL_FRAGMENT_PROGRAM, program);
     gl->program_string (GLITZ_GL_FRAGMENT_PROGRAM,
 			GLITZ_GL_PROGRAM_FORMAT_ASCII,
 			strlen (string), string);
@@ -399,9 +723,54 @@ _glitz_compile_arb_fragment_program (glitz_gl_proc_address_list_t *gl,
 #endif
 
     if (pid == -1) {
-	gl->bind_program (GLITZ_GL_FRAGMENT_PROGRAM, 0);
-	gl->delete_programs (1, &program);
+	glitz_state_bind_program (gl, GLITZ_GL_FRAGMENT_PROGRAM, 0);
+	glitz_state_delete_programs (gl, 1, &program);
+    }
+
+    return pid;
+}
+
+static glitz_gl_int_t
+_glitz_compile_arb_vertex_program (glitz_gl_proc_address_list_t *gl,
+				   char				*string)
+{
+    glitz_gl_int_t  error = 0, pid = -1;
+    glitz_gl_uint_t program;
+
+    /* clear error flags */
+    while (gl->get_error () != GLITZ_GL_NO_ERROR);
+
+    gl->gen_programs (1, &program);
+    glitz_state_bind_program (gl, GLITZ_GL_VERTEX_PROGRAM, program);
+    gl->program_string (GLITZ_GL_VERTEX_PROGRAM,
+			GLITZ_GL_PROGRAM_FORMAT_ASCII,
+			strlen (string), string);
+    if (gl->get_error () == GLITZ_GL_NO_ERROR) {
+	gl->get_integer_v (GLITZ_GL_PROGRAM_ERROR_POSITION, &error);
+	if (error == -1) {
+	    glitz_gl_int_t value;
+
+	    gl->get_program_iv (GLITZ_GL_VERTEX_PROGRAM,
+				GLITZ_GL_PROGRAM_UNDER_NATIVE_LIMITS,
+				&value);
+
+	    if (value == GLITZ_GL_TRUE)
+		pid = program;
+	}
+    }
+#ifdef DEBUG
+    else {
+	gl->get_integer_v (GLITZ_GL_PROGRAM_ERROR_POSITION, &error);
     }
+    if (error != -1)
+	fprintf (stderr, "vp error at pos %d beginning with '%.40s'\n",
+		 error, string+error);
+#endif
+
+    glitz_state_bind_program (gl, GLITZ_GL_VERTEX_PROGRAM, 0);
+
+    if (pid == -1)
+	glitz_state_delete_programs (gl, 1, &program);
 
     return pid;
 }
@@ -420,6 +789,37 @@ _string_array_to_char_array (char	*dst,
     *dst = '\0';
 }
 
+/* Which operand is filtered, 0 for source and 1 for mask, and the
+   texture unit it is bound to. */
+static glitz_bool_t
+_glitz_fragment_operand (glitz_combine_type_t type,
+			 int                  *operand,
+			 int                  *unit)
+{
+    switch (type) {
+    case GLITZ_COMBINE_TYPE_ARGBF:
+    case GLITZ_COMBINE_TYPE_ARGBF_SOLID:
+    case GLITZ_COMBINE_TYPE_ARGBF_SOLIDC:
+	*operand = 0;
+	*unit = 0;
+	break;
+    case GLITZ_COMBINE_TYPE_ARGB_ARGBF:
+    case GLITZ_COMBINE_TYPE_SOLID_ARGBF:
+	*operand = 1;
+	*unit = 0;
+	break;
+    case GLITZ_COMBINE_TYPE_ARGBF_ARGB:
+    case GLITZ_COMBINE_TYPE_ARGBF_ARGBC:
+	*operand = 0;
+	*unit = 1;
+	break;
+    default:
+	return 0;
+    }
+
+    return 1;
+}
+
 /* these should be more than enough */
 #define CONVOLUTION_BASE_SIZE   2048
 #define CONVOLUTION_SAMPLE_SIZE 256
@@ -441,33 +841,17 @@ _glitz_create_fragment_program (glitz_composite_op_t         *op,
     const char		**pos_to_position;
     const glitz_in_op_t *in;
     glitz_gl_uint_t	fp;
-    int			i;
+    int			i, unit;
 
     if (p_divide)
 	pos_to_position = _perspective_divide;
     else
 	pos_to_position = _no_perspective_divide;
 
-    switch (op->type) {
-    case GLITZ_COMBINE_TYPE_ARGBF:
-    case GLITZ_COMBINE_TYPE_ARGBF_SOLID:
-    case GLITZ_COMBINE_TYPE_ARGBF_SOLIDC:
-	i = 0;
-	tex = "0";
-	break;
-    case GLITZ_COMBINE_TYPE_ARGB_ARGBF:
-    case GLITZ_COMBINE_TYPE_SOLID_ARGBF:
-	i = 1;
-	tex = "0";
-	break;
-    case GLITZ_COMBINE_TYPE_ARGBF_ARGB:
-    case GLITZ_COMBINE_TYPE_ARGBF_ARGBC:
-	i = 0;
-	tex = "1";
-	break;
-    default:
+    if (!_glitz_fragment_operand (op->type, &i, &unit))
 	return 0;
-    }
+
+    tex = (unit)? "1": "0";
 
     texture_type       = expand[i].texture;
     extra_declarations = expand[i].declarations;
@@ -595,6 +979,48 @@ _glitz_create_fragment_program (glitz_composite_op_t         *op,
 	p += sprintf (p, buffer, tex, texture_type, tex, texture_type,
 		      tex, texture_type);
 	break;
+    case GLITZ_FP_COLORSPACE_NV12:
+	program = malloc (COLORSPACE_BASE_SIZE);
+	if (program == NULL)
+	    return 0;
+
+	p = program;
+
+	p += sprintf (p, "!!ARBfp1.0");
+
+	_string_array_to_char_array (buffer, _colorspace_yv12_header);
+	p += sprintf (p, buffer, tex, extra_declarations);
+
+	_string_array_to_char_array (buffer, pos_to_position);
+	p += sprintf (p, buffer);
+
+	_string_array_to_char_array (buffer, _colorspace_nv12);
+	p += sprintf (p, buffer, tex, texture_type, tex, texture_type,
+		      tex, texture_type);
+	break;
+    case GLITZ_FP_COLORSPACE_YUY2:
+    case GLITZ_FP_COLORSPACE_UYVY:
+	program = malloc (COLORSPACE_BASE_SIZE);
+	if (program == NULL)
+	    return 0;
+
+	p = program;
+
+	p += sprintf (p, "!!ARBfp1.0");
+
+	_string_array_to_char_array (buffer, _colorspace_packed_header);
+	p += sprintf (p, buffer, tex, extra_declarations);
+
+	_string_array_to_char_array (buffer, pos_to_position);
+	p += sprintf (p, buffer);
+
+	/* second luma, first luma, V and U components of a texel */
+	_string_array_to_char_array (buffer, _colorspace_packed);
+	if (fp_type == GLITZ_FP_COLORSPACE_YUY2)
+	    p += sprintf (p, buffer, tex, texture_type, "z", "x", "w", "y");
+	else
+	    p += sprintf (p, buffer, tex, texture_type, "w", "y", "z", "x");
+	break;
     default:
 	return 0;
     }
@@ -619,6 +1045,121 @@ _glitz_create_fragment_program (glitz_composite_op_t         *op,
     return fp;
 }
 
+glitz_gl_uint_t
+glitz_get_trapezoid_fragment_program (glitz_surface_t *surface)
+{
+    glitz_program_map_t *map = surface->drawable->backend->program_map;
+    char		buffer[1024];
+
+    GLITZ_GL_SURFACE (surface);
+
+    if (map->trapezoid == 0)
+    {
+	_string_array_to_char_array (buffer, _trapezoid_coverage);
+	map->trapezoid = _glitz_compile_arb_fragment_program (gl, buffer, 0);
+    }
+
+    if (map->trapezoid > 0)
+	return map->trapezoid;
+    else
+	return 0;
+}
+
+glitz_gl_uint_t
+glitz_get_rgb_to_yuv_fragment_program (glitz_surface_t *surface,
+				       glitz_texture_t *texture)
+{
+    glitz_program_map_t *map = surface->drawable->backend->program_map;
+    char		buffer[1024], program[1024];
+    char		*type;
+    int			i;
+
+    GLITZ_GL_SURFACE (surface);
+
+    if (texture->target == GLITZ_GL_TEXTURE_2D)
+    {
+	i = 0;
+	type = EXPAND_2D;
+    }
+    else
+    {
+	i = 1;
+	type = EXPAND_RECT;
+    }
+
+    if (map->rgb_to_yuv[i] == 0)
+    {
+	_string_array_to_char_array (buffer, _rgb_to_yuv);
+	sprintf (program, buffer, type, type, type, type);
+	map->rgb_to_yuv[i] = _glitz_compile_arb_fragment_program (gl, program,
+								  5);
+    }
+
+    if (map->rgb_to_yuv[i] > 0)
+	return map->rgb_to_yuv[i];
+    else
+	return 0;
+}
+
+glitz_gl_uint_t
+glitz_get_vertex_program (glitz_surface_t *surface,
+			  int             type)
+{
+    glitz_program_map_t *map = surface->drawable->backend->program_map;
+    char		buffer[1024], program[4096];
+    char		*p;
+    int			i, j, env, gen;
+
+    GLITZ_GL_SURFACE (surface);
+
+    if (type < 0 || type >= GLITZ_VP_TYPES)
+	return 0;
+
+    if (map->vertex[type] == 0)
+    {
+	p = program;
+
+	_string_array_to_char_array (buffer, _vertex_header);
+	p += sprintf (p, "%s", buffer);
+
+	if (type & GLITZ_VP_OFFSET_ATTRIB)
+	{
+	    _string_array_to_char_array (buffer, _vertex_offset);
+	    p += sprintf (p, "%s", buffer);
+	}
+
+	_string_array_to_char_array (buffer, _vertex_position);
+	p += sprintf (p, "%s", buffer);
+
+	for (i = 0; i < GLITZ_GL_STATE_TEXTURE_UNITS; i++)
+	{
+	    gen = type >> (2 * i);
+	    env = GLITZ_VP_ENV_UNIT (i);
+
+	    p += sprintf (p, _vertex_texcoord, i);
+
+	    if (gen & 1)
+		p += sprintf (p, _vertex_tex_gen, 'x', env);
+
+	    if (gen & 2)
+		p += sprintf (p, _vertex_tex_gen, 'y', env + 1);
+
+	    for (j = 0; j < 4; j++)
+		p += sprintf (p, _vertex_tex_matrix, i, "xyzw"[j],
+			      env + 2 + j);
+	}
+
+	sprintf (p, "END");
+
+	map->vertex[type] = _glitz_compile_arb_vertex_program (gl, program);
+    }
+
+    if (map->vertex[type] > 0)
+	return map->vertex[type];
+    else
+	return 0;
+}
+
 void
 glitz_program_map_init (glitz_program_map_t *map)
 {
@@ -643,7 +1184,8 @@ glitz_program_map_fini (glitz_gl_proc_address_list_t *gl,
 			    for (k = 0; k < p->size; k++)
 				if (p->name[k] > 0) {
 				    program = p->name[k];
-				    gl->delete_programs (1, &program);
+				    glitz_state_delete_programs (gl, 1,
+								 &program);
 				}
 
 			    free (p->name);
@@ -653,6 +1195,357 @@ glitz_program_map_fini (glitz_gl_proc_address_list_t *gl,
 	    }
 	}
     }
+
+    if (map->trapezoid > 0)
+    {
+	program = map->trapezoid;
+	glitz_state_delete_programs (gl, 1, &program);
+    }
+
+    for (i = 0; i < 2; i++)
+    {
+	if (map->rgb_to_yuv[i] > 0)
+	{
+	    program = map->rgb_to_yuv[i];
+	    glitz_state_delete_programs (gl, 1, &program);
+	}
+    }
+
+    for (i = 0; i < GLITZ_VP_TYPES; i++)
+    {
+	if (map->vertex[i] > 0)
+	{
+	    program = map->vertex[i];
+	    glitz_state_delete_programs (gl, 1, &program);
+	}
+    }
+
+    for (i = 0; i < GLITZ_SHADER_HASH_SIZE; i++)
+    {
+	glitz_shader_t *shader, *next;
+
+	for (shader = map->shaders[i]; shader; shader = next)
+	{
+	    next = shader->next;
+
+	    if (shader->program)
+		gl->delete_program (shader->program);
+
+	    free (shader);
+	}
+
+	map->shaders[i] = NULL;
+    }
+}
+
+#define GLSL_SOURCE_SIZE 4096
+
+/* largest parameter array of a fragment shader */
+#define GLSL_MAX_LOCAL 256
+
+static char *
+_glitz_glsl_append (char       *p,
+		    const char *src[])
+{
+    _string_array_to_char_array (p, src);
+
+    return p + strlen (p);
+}
+
+static glitz_gl_uint_t
+_glitz_compile_glsl_program (glitz_gl_proc_address_list_t *gl,
+			     const char                   *source)
+{
+    glitz_gl_uint_t shader, program = 0;
+    glitz_gl_int_t  status;
+
+    shader = gl->create_shader (GLITZ_GL_FRAGMENT_SHADER);
+    if (!shader)
+	return 0;
+
+    gl->shader_source (shader, 1, &source, NULL);
+    gl->compile_shader (shader);
+    gl->get_shader_iv (shader, GLITZ_GL_COMPILE_STATUS, &status);
+    if (status)
+    {
+	program = gl->create_program ();
+	gl->attach_shader (program, shader);
+	gl->link_program (program);
+	gl->get_program_object_iv (program, GLITZ_GL_LINK_STATUS, &status);
+	if (!status)
+	{
+	    gl->delete_program (program);
+	    program = 0;
+	}
+    }
+#ifdef DEBUG
+    if (!program)
+	fprintf (stderr, "glsl error in:\n%s\n", source);
+#endif
+
+    /* freed with the program */
+    gl->delete_shader (shader);
+
+    return program;
+}
+
+/* Number of vec4 parameters of a fragment shader, rounded up to a
+   power of two. */
+static int
+_glitz_fragment_shader_size (int fp_type,
+			     int id)
+{
+    int n, size;
+
+    switch (fp_type) {
+    case GLITZ_FP_CONVOLUTION:
+	n = id;
+	break;
+    case GLITZ_FP_LINEAR_GRADIENT_TRANSPARENT:
+	n = 1 + id + 2;
+	break;
+    case GLITZ_FP_RADIAL_GRADIENT_TRANSPARENT:
+	n = 2 + id + 2;
+	break;
+    case GLITZ_FP_LINEAR_GRADIENT_NEAREST:
+    case GLITZ_FP_LINEAR_GRADIENT_REPEAT:
+    case GLITZ_FP_LINEAR_GRADIENT_REFLECT:
+	n = 1 + id;
+	break;
+    case GLITZ_FP_RADIAL_GRADIENT_NEAREST:
+    case GLITZ_FP_RADIAL_GRADIENT_REPEAT:
+    case GLITZ_FP_RADIAL_GRADIENT_REFLECT:
+	n = 2 + id;
+	break;
+    case GLITZ_FP_COLORSPACE_YV12:
+    case GLITZ_FP_COLORSPACE_NV12:
+    case GLITZ_FP_COLORSPACE_YUY2:
+    case GLITZ_FP_COLORSPACE_UYVY:
+	n = 4;
+	break;
+    default:
+	return 0;
+    }
+
+    for (size = 4; size < n; size <<= 1);
+
+    if (size > GLSL_MAX_LOCAL)
+	return 0;
+
+    return size;
+}
+
+static glitz_gl_uint_t
+_glitz_create_fragment_shader (glitz_composite_op_t *op,
+			       int                  fp_type,
+			       int                  size,
+			       int                  p_divide,
+			       int                  t0,
+			       int                  t1)
+{
+    const struct _glitz_glsl_texture *texture, *other;
+    char			     source[GLSL_SOURCE_SIZE], buffer[1024];
+    char			     *p = source;
+    int				     i, unit, stops;
+
+    if (!_glitz_fragment_operand (op->type, &i, &unit))
+	return 0;
+
+    if (i)
+    {
+	texture = &_glsl_texture[t1];
+	other   = &_glsl_texture[t0];
+    }
+    else
+    {
+	texture = &_glsl_texture[t0];
+	other   = &_glsl_texture[t1];
+    }
+
+    if (!texture->sampler)
+	return 0;
+
+    p += sprintf (p, _glsl_header,
+		  (t0 == GLITZ_TEXTURE_RECT || t1 == GLITZ_TEXTURE_RECT)?
+		  _glsl_rect_extension: "", size);
+
+    p += sprintf (p, _glsl_sampler, texture->sampler, unit);
+    if (other->sampler)
+	p += sprintf (p, _glsl_sampler, other->sampler, !unit);
+
+    p += sprintf (p, _glsl_fetch, texture->lookup, unit);
+    p += sprintf (p, _glsl_main, unit);
+
+    if (p_divide)
+	p = _glitz_glsl_append (p, _glsl_perspective_divide);
+    else
+	p = _glitz_glsl_append (p, _glsl_no_perspective_divide);
+
+    switch (fp_type) {
+    case GLITZ_FP_CONVOLUTION:
+	p = _glitz_glsl_append (p, _glsl_convolution);
+	break;
+    case GLITZ_FP_LINEAR_GRADIENT_TRANSPARENT:
+    case GLITZ_FP_LINEAR_GRADIENT_NEAREST:
+    case GLITZ_FP_LINEAR_GRADIENT_REPEAT:
+    case GLITZ_FP_LINEAR_GRADIENT_REFLECT:
+    case GLITZ_FP_RADIAL_GRADIENT_TRANSPARENT:
+    case GLITZ_FP_RADIAL_GRADIENT_NEAREST:
+    case GLITZ_FP_RADIAL_GRADIENT_REPEAT:
+    case GLITZ_FP_RADIAL_GRADIENT_REFLECT:
+	switch (fp_type) {
+	case GLITZ_FP_LINEAR_GRADIENT_TRANSPARENT:
+	case GLITZ_FP_LINEAR_GRADIENT_NEAREST:
+	case GLITZ_FP_LINEAR_GRADIENT_REPEAT:
+	case GLITZ_FP_LINEAR_GRADIENT_REFLECT:
+	    p = _glitz_glsl_append (p, _glsl_linear_gradient);
+	    stops = 1;
+	    break;
+	default:
+	    p = _glitz_glsl_append (p, _glsl_radial_gradient);
+	    stops = 2;
+	    break;
+	}
+
+	switch (fp_type) {
+	case GLITZ_FP_LINEAR_GRADIENT_REPEAT:
+	case GLITZ_FP_RADIAL_GRADIENT_REPEAT:
+	    p = _glitz_glsl_append (p, _glsl_gradient_repeat);
+	    break;
+	case GLITZ_FP_LINEAR_GRADIENT_REFLECT:
+	case GLITZ_FP_RADIAL_GRADIENT_REFLECT:
+	    p = _glitz_glsl_append (p, _glsl_gradient_reflect);
+	    break;
+	default:
+	    break;
+	}
+
+	_string_array_to_char_array (buffer, _glsl_gradient_stops);
+	p += sprintf (p, buffer, stops, stops, stops, stops, stops, stops);
+	break;
+    case GLITZ_FP_COLORSPACE_YV12:
+	p = _glitz_glsl_append (p, _glsl_colorspace_clamp);
+	p = _glitz_glsl_append (p, _glsl_colorspace_yv12);
+	p = _glitz_glsl_append (p, _glsl_colorspace_convert);
+	break;
+    case GLITZ_FP_COLORSPACE_NV12:
+	p = _glitz_glsl_append (p, _glsl_colorspace_clamp);
+	p = _glitz_glsl_append (p, _glsl_colorspace_nv12);
+	p = _glitz_glsl_append (p, _glsl_colorspace_convert);
+	break;
+    case GLITZ_FP_COLORSPACE_YUY2:
+    case GLITZ_FP_COLORSPACE_UYVY:
+	p = _glitz_glsl_append (p, _glsl_colorspace_clamp);
+
+	_string_array_to_char_array (buffer, _glsl_colorspace_packed);
+	if (fp_type == GLITZ_FP_COLORSPACE_YUY2)
+	    p += sprintf (p, buffer, 'x', 'z', 'w', 'y');
+	else
+	    p += sprintf (p, buffer, 'y', 'w', 'z', 'x');
+
+	p = _glitz_glsl_append (p, _glsl_colorspace_convert);
+	break;
+    default:
+	return 0;
+    }
+
+    if (!other->sampler)
+    {
+	if (i)
+	    p = _glitz_glsl_append (p, _glsl_solid_in_x);
+	else
+	    p = _glitz_glsl_append (p, _glsl_x_in_solid);
+    }
+    else
+    {
+	p += sprintf (p, _glsl_fetch_in, other->lookup_proj, !unit, !unit);
+
+	if (i)
+	    p = _glitz_glsl_append (p, _glsl_src_in[op->per_component]);
+	else
+	    p = _glitz_glsl_append (p, _glsl_mask_in[op->per_component]);
+    }
+
+    sprintf (p, "}\n");
+
+    return _glitz_compile_glsl_program (op->gl, source);
+}
+
+/* Looks up the fragment shader for an operation in the shader cache
+   and builds it when it is not there. Failures are cached too, so the
+   fragment program is used without compiling again. */
+static glitz_shader_t *
+_glitz_get_fragment_shader (glitz_composite_op_t *op,
+			    int                  fp_type,
+			    int                  id,
+			    int                  p_divide,
+			    int                  t0,
+			    int                  t1)
+{
+    glitz_program_map_t *map = op->dst->drawable->backend->program_map;
+    glitz_shader_t	*shader;
+    unsigned long	key;
+    int			size, hash;
+
+    GLITZ_GL_SURFACE (op->dst);
+
+    size = _glitz_fragment_shader_size (fp_type, id);
+    if (!size)
+	return NULL;
+
+    key = (unsigned long) fp_type |
+	(t0 << 4) | (t1 << 6) | (op->type << 8) |
+	((op->per_component)? (1L << 13): 0) |
+	((p_divide)? (1L << 14): 0) |
+	((unsigned long) size << 15);
+
+    hash = (key ^ (key >> 6) ^ (key >> 15)) & (GLITZ_SHADER_HASH_SIZE - 1);
+
+    for (shader = map->shaders[hash]; shader; shader = shader->next)
+	if (shader->key == key)
+	    break;
+
+    if (!shader)
+    {
+	shader = malloc (sizeof (glitz_shader_t));
+	if (!shader)
+	{
+	    glitz_surface_status_add (op->dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	    return NULL;
+	}
+
+	shader->key   = key;
+	shader->local = shader->n = -1;
+
+	glitz_surface_push_current (op->dst, GLITZ_CONTEXT_CURRENT);
+
+	shader->program = _glitz_create_fragment_shader (op, fp_type, size,
+							 p_divide, t0, t1);
+	if (shader->program)
+	{
+	    shader->local = gl->get_uniform_location (shader->program,
+						      "local");
+	    shader->n = gl->get_uniform_location (shader->program, "n");
+
+	    /* samplers stay bound to the same texture units */
+	    gl->use_program (shader->program);
+	    gl->uniform_1i (gl->get_uniform_location (shader->program,
+						      "texture0"), 0);
+	    gl->uniform_1i (gl->get_uniform_location (shader->program,
+						      "texture1"), 1);
+	    gl->use_program (0);
+	}
+
+	glitz_surface_pop_current (op->dst);
+
+	shader->next = map->shaders[hash];
+	map->shaders[hash] = shader;
+    }
+
+    if (shader->program)
+	return shader;
+    else
+	return NULL;
 }
 
 #define TEXTURE_INDEX(surface)                            \
@@ -671,6 +1564,7 @@ glitz_get_fragment_program (glitz_composite_op_t *op,
 {
     glitz_program_map_t *map;
     glitz_program_t	*program;
+    unsigned long	feature_mask;
     int			t0 = TEXTURE_INDEX (op->src);
     int			t1 = TEXTURE_INDEX (op->mask);
     int			p_divide = 1;
@@ -693,6 +1587,19 @@ glitz_get_fragment_program (glitz_composite_op_t *op,
     }
 
     map = op->dst->drawable->backend->program_map;
+    feature_mask = op->dst->drawable->backend->feature_mask;
+
+    if (feature_mask & GLITZ_FEATURE_FRAGMENT_SHADER_MASK)
+    {
+	op->shader = _glitz_get_fragment_shader (op, fp_type, id, p_divide,
+						 t0, t1);
+	if (op->shader)
+	    return op->shader->program;
+    }
+
+    if (!(feature_mask & GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK))
+	return 0;
+
     program = &map->filters[op->type][fp_type].fp[t0][t1][p_divide];
 
     if (program->size < id) {
@@ -84,6 +84,8 @@ glitz_set_rectangles (glitz_surface_t         *dst,
     if (n_rects < 1)
 	return;
 
+    glitz_surface_flush_batch (dst);
+
     if (SURFACE_SOLID (dst))
     {
 	glitz_color_t old = dst->solid;
@@ -210,10 +212,10 @@ glitz_set_rectangles (glitz_surface_t         *dst,
 
 		    if (box.x1 < box.x2 && box.y1 < box.y2)
 		    {
-			gl->scissor (box.x1,
-				     dst->attached->height - dst->y - box.y2,
-				     box.x2 - box.x1,
-				     box.y2 - box.y1);
+			glitz_state_scissor (gl, box.x1,
+					     dst->attached->height -
+					     dst->y - box.y2,
+					     box.x2 - box.x1, box.y2 - box.y1);
 
 			gl->clear (GLITZ_GL_COLOR_BUFFER_BIT);
 
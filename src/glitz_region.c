@@ -43,21 +43,11 @@
      (b1)->y1 < (b2)->y2 &&                     \
      (b1)->y2 > (b2)->y1)
 
-#define BOX_CLOSE_TO_BOX(b1, b2)                \
-    ((b1)->x1 < ((b2)->x2 + 1) &&               \
-     (b1)->x2 > ((b2)->x1 - 1) &&               \
-     (b1)->y1 < ((b2)->y2 + 1) &&               \
-     (b1)->y2 > ((b2)->y1 - 1))
-
-#define BOX_NEXT_TO_BOX(b1, b2)                 \
-    ((((b1)->x1 == (b2)->x2 ||                  \
-       (b1)->x2 == (b2)->x1) &&                 \
-      (b1)->y1 == (b2)->y1 &&                   \
-      (b1)->y2 == (b2)->y2) ||                  \
-     (((b1)->y1 == (b2)->y2 ||                  \
-       (b1)->y2 == (b2)->y1) &&                 \
-      (b1)->x1 == (b2)->x1 &&                   \
-      (b1)->x2 == (b2)->x2))
+#define BOX_EMPTY(b)                            \
+    ((b)->x1 >= (b)->x2 || (b)->y1 >= (b)->y2)
+
+#define BOX_AREA(b)                             \
+    (((b)->x2 - (b)->x1) * ((b)->y2 - (b)->y1))
 
 #define MERGE_BOXES(d, b1, b2)                  \
     {                                           \
@@ -68,100 +58,831 @@
     }
 
 /*
- * No real union, boxes that intersect are just joined into bigger boxes.
- * This is OK for our needs and it keeps the number of boxes down to a
- * minimum and makes it faster.
+ * Regions are kept in y-x banded form: boxes never overlap, are sorted
+ * by y1 and then x1, and all boxes in a band share the same y1 and y2.
+ * The band walking below follows the classic X11/pixman region code.
  */
-glitz_status_t
-glitz_region_union (glitz_region_t *region,
-		    glitz_box_t    *ubox)
+
+#define FIND_BAND(r, r_band_end, r_end, ry1)                     \
+    {                                                            \
+	ry1 = (r)->y1;                                           \
+	r_band_end = (r) + 1;                                    \
+	while (r_band_end != (r_end) && r_band_end->y1 == ry1)   \
+	    r_band_end++;                                        \
+    }
+
+#define COALESCE(region, prev_band, cur_band)                      \
+    if ((cur_band) != (region)->n_box)                             \
+	prev_band = _glitz_region_coalesce (region, prev_band, cur_band)
+
+typedef glitz_status_t (*glitz_region_overlap_func_t) (glitz_region_t *,
+						       glitz_box_t *,
+						       glitz_box_t *,
+						       glitz_box_t *,
+						       glitz_box_t *,
+						       int,
+						       int);
+
+static glitz_status_t
+_glitz_region_grow (glitz_region_t *region,
+		    int            n)
 {
-    if (region->n_box == 0) {
-	region->extents = *ubox;
-	region->box = &region->extents;
-	region->n_box = 1;
+    void *data;
+    int  size;
+
+    if (region->n_box + n <= region->size)
+	return GLITZ_STATUS_SUCCESS;
+
+    size = region->size << 1;
+    if (size < region->n_box + n)
+	size = region->n_box + n + GLITZ_REGION_ALLOC_CHUNK;
+
+    data = realloc (region->data, sizeof (glitz_box_t) * size);
+    if (!data)
+	return GLITZ_STATUS_NO_MEMORY;
+
+    region->data = data;
+    region->size = size;
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+static glitz_status_t
+_glitz_region_append (glitz_region_t *region,
+		      int            x1,
+		      int            y1,
+		      int            x2,
+		      int            y2)
+{
+    glitz_box_t *box;
+
+    if (_glitz_region_grow (region, 1))
+	return GLITZ_STATUS_NO_MEMORY;
+
+    box = (glitz_box_t *) region->data + region->n_box++;
+    box->x1 = (short) x1;
+    box->y1 = (short) y1;
+    box->x2 = (short) x2;
+    box->y2 = (short) y2;
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+static glitz_status_t
+_glitz_region_append_band (glitz_region_t *region,
+			   glitz_box_t    *r,
+			   glitz_box_t    *r_end,
+			   int            y1,
+			   int            y2)
+{
+    glitz_box_t *box;
+
+    if (_glitz_region_grow (region, r_end - r))
+	return GLITZ_STATUS_NO_MEMORY;
+
+    box = (glitz_box_t *) region->data + region->n_box;
+    region->n_box += r_end - r;
+
+    while (r != r_end)
+    {
+	box->x1 = r->x1;
+	box->y1 = (short) y1;
+	box->x2 = r->x2;
+	box->y2 = (short) y2;
+
+	box++;
+	r++;
+    }
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+/*
+ * Merges the band starting at cur_band into the band starting at
+ * prev_band when the two are vertically adjacent and have identical x
+ * spans. Returns the start of the last band in the region.
+ */
+static int
+_glitz_region_coalesce (glitz_region_t *region,
+			int            prev_band,
+			int            cur_band)
+{
+    glitz_box_t *prev, *cur;
+    int         n, i;
+
+    n = cur_band - prev_band;
+    if (n == 0 || n != region->n_box - cur_band)
+	return cur_band;
+
+    prev = (glitz_box_t *) region->data + prev_band;
+    cur = (glitz_box_t *) region->data + cur_band;
+
+    if (prev->y2 != cur->y1)
+	return cur_band;
+
+    for (i = 0; i < n; i++)
+	if (prev[i].x1 != cur[i].x1 || prev[i].x2 != cur[i].x2)
+	    return cur_band;
+
+    for (i = 0; i < n; i++)
+	prev[i].y2 = cur[i].y2;
+
+    region->n_box -= n;
+
+    return prev_band;
+}
+
+static void
+_glitz_region_set_extents (glitz_region_t *region)
+{
+    glitz_box_t *box, *end;
+
+    region->area = 0;
+
+    if (region->n_box == 0)
+    {
+	GLITZ_REGION_EMPTY (region);
+	return;
+    }
+
+    box = region->box;
+    end = box + region->n_box;
+
+    region->extents.x1 = box->x1;
+    region->extents.y1 = box->y1;
+    region->extents.x2 = box->x2;
+    region->extents.y2 = end[-1].y2;
+
+    while (box != end)
+    {
+	if (box->x1 < region->extents.x1)
+	    region->extents.x1 = box->x1;
+	if (box->x2 > region->extents.x2)
+	    region->extents.x2 = box->x2;
+
+	region->area += BOX_AREA (box);
+	box++;
+    }
+}
+
+static void
+_glitz_region_set_box (glitz_region_t *region,
+		       glitz_box_t    *box)
+{
+    region->extents = *box;
+    region->box = &region->extents;
+    region->n_box = 1;
+    region->area = BOX_AREA (box);
+}
+
+/*
+ * Takes over the boxes built in tmp. The source regions of an operation
+ * may alias dst, so this must only be called once they are no longer
+ * read.
+ */
+static void
+_glitz_region_replace (glitz_region_t *dst,
+		       glitz_region_t *tmp)
+{
+    if (dst->data)
+	free (dst->data);
+
+    dst->data = tmp->data;
+    dst->size = tmp->size;
+    dst->n_box = tmp->n_box;
+
+    if (dst->n_box == 1)
+	_glitz_region_set_box (dst, (glitz_box_t *) dst->data);
+    else
+    {
+	dst->box = (glitz_box_t *) dst->data;
+	_glitz_region_set_extents (dst);
+    }
+}
+
+static glitz_status_t
+_glitz_region_copy (glitz_region_t *dst,
+		    glitz_region_t *src)
+{
+    if (dst == src)
+	return GLITZ_STATUS_SUCCESS;
+
+    if (src->n_box < 2)
+    {
+	if (src->n_box)
+	    _glitz_region_set_box (dst, &src->extents);
+	else
+	    GLITZ_REGION_EMPTY (dst);
 
 	return GLITZ_STATUS_SUCCESS;
     }
 
-    if (BOX_CLOSE_TO_BOX (ubox, &region->extents)) {
-	glitz_box_t *box, *new_box, *dst_box;
-	int         n_box;
+    dst->n_box = 0;
+    if (_glitz_region_grow (dst, src->n_box))
+	return GLITZ_STATUS_NO_MEMORY;
+
+    memcpy (dst->data, src->box, src->n_box * sizeof (glitz_box_t));
+
+    dst->box = (glitz_box_t *) dst->data;
+    dst->n_box = src->n_box;
+    dst->extents = src->extents;
+    dst->area = src->area;
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+/*
+ * Walks the bands of src1 and src2 in parallel. Parts of a band that
+ * only one region covers are copied when append_non1/append_non2 is set,
+ * y ranges covered by both are handed to the overlap function. Both
+ * regions must be non-empty.
+ */
+static glitz_status_t
+_glitz_region_op (glitz_region_t              *dst,
+		  glitz_region_t              *src1,
+		  glitz_region_t              *src2,
+		  glitz_region_overlap_func_t overlap,
+		  glitz_bool_t                append_non1,
+		  glitz_bool_t                append_non2)
+{
+    glitz_region_t tmp;
+    glitz_box_t    *r1, *r1_end, *r1_band_end;
+    glitz_box_t    *r2, *r2_end, *r2_band_end;
+    int            r1y1, r2y1, ytop, ybot, top, bot;
+    int            prev_band, cur_band;
+
+    r1 = src1->box;
+    r1_end = r1 + src1->n_box;
+    r2 = src2->box;
+    r2_end = r2 + src2->n_box;
 
-	box = region->box;
-	n_box = region->n_box;
+    tmp.data = NULL;
+    tmp.size = 0;
+    tmp.n_box = 0;
 
-	while (n_box--) {
-	    if (BOX_SUBSUMS_BOX (box, ubox))
-		return GLITZ_STATUS_SUCCESS;
+    if (_glitz_region_grow (&tmp, MAX (src1->n_box, src2->n_box) << 1))
+	return GLITZ_STATUS_NO_MEMORY;
 
-	    box++;
+    ybot = MIN (r1->y1, r2->y1);
+    prev_band = 0;
+
+    do {
+	FIND_BAND (r1, r1_band_end, r1_end, r1y1);
+	FIND_BAND (r2, r2_band_end, r2_end, r2y1);
+
+	if (r1y1 < r2y1)
+	{
+	    if (append_non1)
+	    {
+		top = MAX (r1y1, ybot);
+		bot = MIN (r1->y2, r2y1);
+		if (top != bot)
+		{
+		    cur_band = tmp.n_box;
+		    if (_glitz_region_append_band (&tmp, r1, r1_band_end,
+						   top, bot))
+			goto BAIL;
+
+		    COALESCE (&tmp, prev_band, cur_band);
+		}
+	    }
+	    ytop = r2y1;
 	}
+	else if (r2y1 < r1y1)
+	{
+	    if (append_non2)
+	    {
+		top = MAX (r2y1, ybot);
+		bot = MIN (r2->y2, r1y1);
+		if (top != bot)
+		{
+		    cur_band = tmp.n_box;
+		    if (_glitz_region_append_band (&tmp, r2, r2_band_end,
+						   top, bot))
+			goto BAIL;
 
-	box = region->box;
-	n_box = region->n_box;
-
-	new_box = ubox;
-	dst_box = NULL;
-	while (n_box--) {
-
-	    if (BOX_INTERSECTS_BOX (box, new_box) ||
-		BOX_NEXT_TO_BOX (box, new_box)) {
-
-		if (dst_box) {
-		    /*
-		     * Remove box from region
-		     */
-		    region->n_box--;
-		    if (region->n_box == 1) {
-			MERGE_BOXES (&region->extents, box, new_box);
-			region->box = &region->extents;
-
-			return GLITZ_STATUS_SUCCESS;
-		    } else {
-			MERGE_BOXES (dst_box, box, new_box);
-			if (n_box)
-			    memmove (box, box + 1,
-				     n_box * sizeof (glitz_box_t));
-		    }
-		    continue;
-		} else {
-		    dst_box = box;
-		    MERGE_BOXES (dst_box, box, new_box);
-		    new_box = dst_box;
+		    COALESCE (&tmp, prev_band, cur_band);
 		}
 	    }
-	    box++;
+	    ytop = r1y1;
+	}
+	else
+	    ytop = r1y1;
+
+	ybot = MIN (r1->y2, r2->y2);
+	if (ybot > ytop)
+	{
+	    cur_band = tmp.n_box;
+	    if ((*overlap) (&tmp, r1, r1_band_end, r2, r2_band_end,
+			    ytop, ybot))
+		goto BAIL;
+
+	    COALESCE (&tmp, prev_band, cur_band);
+	}
+
+	if (r1->y2 == ybot)
+	    r1 = r1_band_end;
+
+	if (r2->y2 == ybot)
+	    r2 = r2_band_end;
+
+    } while (r1 != r1_end && r2 != r2_end);
+
+    if (r1 != r1_end && append_non1)
+    {
+	FIND_BAND (r1, r1_band_end, r1_end, r1y1);
+
+	cur_band = tmp.n_box;
+	if (_glitz_region_append_band (&tmp, r1, r1_band_end,
+				       MAX (r1y1, ybot), r1->y2))
+	    goto BAIL;
+
+	COALESCE (&tmp, prev_band, cur_band);
+
+	if (_glitz_region_grow (&tmp, r1_end - r1_band_end))
+	    goto BAIL;
+
+	memcpy ((glitz_box_t *) tmp.data + tmp.n_box, r1_band_end,
+		(r1_end - r1_band_end) * sizeof (glitz_box_t));
+	tmp.n_box += r1_end - r1_band_end;
+    }
+    else if (r2 != r2_end && append_non2)
+    {
+	FIND_BAND (r2, r2_band_end, r2_end, r2y1);
+
+	cur_band = tmp.n_box;
+	if (_glitz_region_append_band (&tmp, r2, r2_band_end,
+				       MAX (r2y1, ybot), r2->y2))
+	    goto BAIL;
+
+	COALESCE (&tmp, prev_band, cur_band);
+
+	if (_glitz_region_grow (&tmp, r2_end - r2_band_end))
+	    goto BAIL;
+
+	memcpy ((glitz_box_t *) tmp.data + tmp.n_box, r2_band_end,
+		(r2_end - r2_band_end) * sizeof (glitz_box_t));
+	tmp.n_box += r2_end - r2_band_end;
+    }
+
+    _glitz_region_replace (dst, &tmp);
+
+    return GLITZ_STATUS_SUCCESS;
+
+BAIL:
+    free (tmp.data);
+
+    return GLITZ_STATUS_NO_MEMORY;
+}
+
+#define MERGE_SPAN(r)                                                \
+    {                                                                \
+	if ((r)->x1 <= x2)                                           \
+	{                                                            \
+	    if (x2 < (r)->x2)                                        \
+		x2 = (r)->x2;                                        \
+	}                                                            \
+	else                                                         \
+	{                                                            \
+	    if (_glitz_region_append (region, x1, y1, x2, y2))       \
+		return GLITZ_STATUS_NO_MEMORY;                       \
+								     \
+	    x1 = (r)->x1;                                            \
+	    x2 = (r)->x2;                                            \
+	}                                                            \
+	(r)++;                                                       \
+    }
+
+static glitz_status_t
+_glitz_region_union_o (glitz_region_t *region,
+		       glitz_box_t    *r1,
+		       glitz_box_t    *r1_end,
+		       glitz_box_t    *r2,
+		       glitz_box_t    *r2_end,
+		       int            y1,
+		       int            y2)
+{
+    int x1, x2;
+
+    if (r1->x1 < r2->x1)
+    {
+	x1 = r1->x1;
+	x2 = r1->x2;
+	r1++;
+    }
+    else
+    {
+	x1 = r2->x1;
+	x2 = r2->x2;
+	r2++;
+    }
+
+    while (r1 != r1_end && r2 != r2_end)
+    {
+	if (r1->x1 < r2->x1)
+	    MERGE_SPAN (r1)
+	else
+	    MERGE_SPAN (r2)
+    }
+
+    while (r1 != r1_end)
+	MERGE_SPAN (r1)
+
+    while (r2 != r2_end)
+	MERGE_SPAN (r2)
+
+    return _glitz_region_append (region, x1, y1, x2, y2);
+}
+
+static glitz_status_t
+_glitz_region_intersect_o (glitz_region_t *region,
+			   glitz_box_t    *r1,
+			   glitz_box_t    *r1_end,
+			   glitz_box_t    *r2,
+			   glitz_box_t    *r2_end,
+			   int            y1,
+			   int            y2)
+{
+    int x1, x2;
+
+    while (r1 != r1_end && r2 != r2_end)
+    {
+	x1 = MAX (r1->x1, r2->x1);
+	x2 = MIN (r1->x2, r2->x2);
+
+	if (x1 < x2)
+	    if (_glitz_region_append (region, x1, y1, x2, y2))
+		return GLITZ_STATUS_NO_MEMORY;
+
+	if (r1->x2 == x2)
+	    r1++;
+
+	if (r2->x2 == x2)
+	    r2++;
+    }
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+static glitz_status_t
+_glitz_region_subtract_o (glitz_region_t *region,
+			  glitz_box_t    *r1,
+			  glitz_box_t    *r1_end,
+			  glitz_box_t    *r2,
+			  glitz_box_t    *r2_end,
+			  int            y1,
+			  int            y2)
+{
+    int x1;
+
+    x1 = r1->x1;
+
+    while (r1 != r1_end && r2 != r2_end)
+    {
+	if (r2->x2 <= x1)
+	{
+	    /* subtrahend entirely to the left */
+	    r2++;
+	}
+	else if (r2->x1 <= x1)
+	{
+	    /* subtrahend covers the left part of the minuend */
+	    x1 = r2->x2;
+	    if (x1 >= r1->x2)
+	    {
+		if (++r1 != r1_end)
+		    x1 = r1->x1;
+	    }
+	    else
+		r2++;
 	}
+	else if (r2->x1 < r1->x2)
+	{
+	    /* subtrahend splits the minuend */
+	    if (_glitz_region_append (region, x1, y1, r2->x1, y2))
+		return GLITZ_STATUS_NO_MEMORY;
 
-	if (dst_box) {
-	    if (region->n_box > 1)
-		MERGE_BOXES (&region->extents, &region->extents, ubox);
+	    x1 = r2->x2;
+	    if (x1 >= r1->x2)
+	    {
+		if (++r1 != r1_end)
+		    x1 = r1->x1;
+	    }
+	    else
+		r2++;
+	}
+	else
+	{
+	    /* minuend entirely to the left */
+	    if (r1->x2 > x1)
+		if (_glitz_region_append (region, x1, y1, r1->x2, y2))
+		    return GLITZ_STATUS_NO_MEMORY;
 
-	    return GLITZ_STATUS_SUCCESS;
+	    if (++r1 != r1_end)
+		x1 = r1->x1;
 	}
     }
 
-    /*
-     * Add box to region
-     */
-    if (region->size < (region->n_box + 1)) {
-	region->size += GLITZ_REGION_ALLOC_CHUNK;
-	region->data = (void *) realloc (region->data,
-					 sizeof (glitz_box_t) * region->size);
-	if (!region->data)
+    while (r1 != r1_end)
+    {
+	if (_glitz_region_append (region, x1, y1, r1->x2, y2))
 	    return GLITZ_STATUS_NO_MEMORY;
+
+	if (++r1 != r1_end)
+	    x1 = r1->x1;
     }
 
-    region->box = (glitz_box_t *) region->data;
+    return GLITZ_STATUS_SUCCESS;
+}
 
-    region->box[region->n_box] = *ubox;
-    if (region->n_box == 1)
-	region->box[0] = region->extents;
+glitz_status_t
+glitz_region_union_region (glitz_region_t *dst,
+			   glitz_region_t *src1,
+			   glitz_region_t *src2)
+{
+    if (!src2->n_box)
+	return _glitz_region_copy (dst, src1);
+
+    if (!src1->n_box)
+	return _glitz_region_copy (dst, src2);
+
+    if (src1->n_box == 1 && BOX_SUBSUMS_BOX (&src1->extents, &src2->extents))
+	return _glitz_region_copy (dst, src1);
+
+    if (src2->n_box == 1 && BOX_SUBSUMS_BOX (&src2->extents, &src1->extents))
+	return _glitz_region_copy (dst, src2);
+
+    return _glitz_region_op (dst, src1, src2, _glitz_region_union_o,
+			     1, 1);
+}
+
+glitz_status_t
+glitz_region_intersect (glitz_region_t *dst,
+			glitz_region_t *src1,
+			glitz_region_t *src2)
+{
+    if (!src1->n_box || !src2->n_box ||
+	!BOX_INTERSECTS_BOX (&src1->extents, &src2->extents))
+    {
+	GLITZ_REGION_EMPTY (dst);
+	return GLITZ_STATUS_SUCCESS;
+    }
 
+    if (src1->n_box == 1 && src2->n_box == 1)
+    {
+	glitz_box_t box;
+
+	box.x1 = MAX (src1->extents.x1, src2->extents.x1);
+	box.y1 = MAX (src1->extents.y1, src2->extents.y1);
+	box.x2 = MIN (src1->extents.x2, src2->extents.x2);
+	box.y2 = MIN (src1->extents.y2, src2->extents.y2);
+
+	_glitz_region_set_box (dst, &box);
+
+	return GLITZ_STATUS_SUCCESS;
+    }
+
+    return _glitz_region_op (dst, src1, src2, _glitz_region_intersect_o,
+			     0, 0);
+}
+
+glitz_status_t
+glitz_region_subtract (glitz_region_t *dst,
+		       glitz_region_t *src1,
+		       glitz_region_t *src2)
+{
+    if (!src1->n_box || !src2->n_box ||
+	!BOX_INTERSECTS_BOX (&src1->extents, &src2->extents))
+	return _glitz_region_copy (dst, src1);
+
+    return _glitz_region_op (dst, src1, src2, _glitz_region_subtract_o,
+			     1, 0);
+}
+
+/*
+ * Every box in a damage region costs a separate copy or quad when the
+ * region is synced. Once that per box overhead, expressed in pixels by
+ * region->coalesce, outweighs the pixels saved by not touching the
+ * whole bounding box, the region is replaced by its extents. Sparse
+ * damage is never collapsed into more than twice its own area, so many
+ * small boxes spread over a large surface do not turn into a sync of
+ * the whole surface.
+ */
+static void
+_glitz_region_apply_coalesce (glitz_region_t *region)
+{
+    int area;
+
+    if (!region->coalesce || region->n_box < 2)
+	return;
+
+    area = BOX_AREA (&region->extents);
+    if (area - region->area > region->area)
+	return;
+
+    if (region->area + (region->n_box - 1) * region->coalesce >= area)
+    {
+	region->box = &region->extents;
+	region->n_box = 1;
+	region->area = area;
+    }
+}
+
+/*
+ * Fast path for the common case of damage arriving top to bottom, the
+ * box is added as a new band below all existing bands.
+ */
+static glitz_status_t
+_glitz_region_append_box (glitz_region_t *region,
+			  glitz_box_t    *ubox)
+{
+    glitz_box_t *box;
+    int         n_box, prev_band;
+
+    n_box = region->n_box;
+    if (_glitz_region_grow (region, 1))
+	return GLITZ_STATUS_NO_MEMORY;
+
+    box = (glitz_box_t *) region->data;
+    if (region->box == &region->extents)
+	box[0] = region->extents;
+
+    box[n_box] = *ubox;
+    region->box = box;
     region->n_box++;
 
+    prev_band = n_box - 1;
+    while (prev_band > 0 && box[prev_band - 1].y1 == box[n_box - 1].y1)
+	prev_band--;
+
+    _glitz_region_coalesce (region, prev_band, n_box);
+
     MERGE_BOXES (&region->extents, &region->extents, ubox);
+    region->area += BOX_AREA (ubox);
+
+    if (region->n_box == 1)
+	region->box = &region->extents;
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+/*
+ * Merges the band starting at cur into the band above it when the two
+ * are vertically adjacent and have identical x spans.
+ */
+static void
+_glitz_region_coalesce_at (glitz_region_t *region,
+			   int            cur)
+{
+    glitz_box_t *box = region->box;
+    int         prev, end, n, i;
+
+    if (cur <= 0 || cur >= region->n_box)
+	return;
+
+    prev = cur - 1;
+    while (prev > 0 && box[prev - 1].y1 == box[cur - 1].y1)
+	prev--;
+
+    end = cur + 1;
+    while (end < region->n_box && box[end].y1 == box[cur].y1)
+	end++;
+
+    n = cur - prev;
+    if (n != end - cur || box[prev].y2 != box[cur].y1)
+	return;
+
+    for (i = 0; i < n; i++)
+	if (box[prev + i].x1 != box[cur + i].x1 ||
+	    box[prev + i].x2 != box[cur + i].x2)
+	    return;
+
+    for (i = 0; i < n; i++)
+	box[prev + i].y2 = box[cur + i].y2;
+
+    memmove (box + cur, box + end,
+	     (region->n_box - end) * sizeof (glitz_box_t));
+    region->n_box -= n;
+}
+
+/*
+ * Only the bands that overlap the box vertically can change. They are
+ * combined with the box and the result is spliced into the region in
+ * place, so the rest of the region is moved but not walked.
+ */
+static glitz_status_t
+_glitz_region_union_box (glitz_region_t *region,
+			 glitz_box_t    *ubox)
+{
+    glitz_region_t part, tmp;
+    glitz_box_t    *box;
+    int            start, end, lo, hi, mid, n, i, area = 0;
+
+    box = region->box;
+
+    /* y2 and y1 never decrease from one box to the next */
+    lo = 0;
+    hi = region->n_box;
+    while (lo < hi)
+    {
+	mid = (lo + hi) >> 1;
+	if (box[mid].y2 <= ubox->y1)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    start = lo;
+
+    hi = region->n_box;
+    while (lo < hi)
+    {
+	mid = (lo + hi) >> 1;
+	if (box[mid].y1 < ubox->y2)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    end = lo;
+
+    tmp.data = NULL;
+    tmp.size = 0;
+    _glitz_region_set_box (&tmp, ubox);
+
+    if (start < end)
+    {
+	part.box = box + start;
+	part.n_box = end - start;
+
+	for (i = start; i < end; i++)
+	    area -= BOX_AREA (&box[i]);
+
+	if (_glitz_region_op (&tmp, &part, &tmp, _glitz_region_union_o,
+			      1, 1))
+	    return GLITZ_STATUS_NO_MEMORY;
+    }
+
+    for (i = 0; i < tmp.n_box; i++)
+	area += BOX_AREA (&tmp.box[i]);
+
+    n = tmp.n_box - (end - start);
+    if (_glitz_region_grow (region, MAX (n, 0) + 1))
+    {
+	free (tmp.data);
+	return GLITZ_STATUS_NO_MEMORY;
+    }
+
+    box = (glitz_box_t *) region->data;
+    if (region->box == &region->extents)
+	box[0] = region->extents;
+
+    memmove (box + end + n, box + end,
+	     (region->n_box - end) * sizeof (glitz_box_t));
+    memcpy (box + start, tmp.box, tmp.n_box * sizeof (glitz_box_t));
+
+    free (tmp.data);
+
+    region->box = box;
+    region->n_box += n;
+
+    _glitz_region_coalesce_at (region, start + tmp.n_box);
+    _glitz_region_coalesce_at (region, start);
+
+    MERGE_BOXES (&region->extents, &region->extents, ubox);
+    region->area += area;
+
+    if (region->n_box == 1)
+	region->box = &region->extents;
+
+    return GLITZ_STATUS_SUCCESS;
+}
+
+glitz_status_t
+glitz_region_union (glitz_region_t *region,
+		    glitz_box_t    *ubox)
+{
+    glitz_status_t status;
+
+    if (BOX_EMPTY (ubox))
+	return GLITZ_STATUS_SUCCESS;
+
+    if (region->n_box == 0 || BOX_SUBSUMS_BOX (ubox, &region->extents))
+    {
+	_glitz_region_set_box (region, ubox);
+	return GLITZ_STATUS_SUCCESS;
+    }
+
+    if (region->n_box == 1 && BOX_SUBSUMS_BOX (&region->extents, ubox))
+	return GLITZ_STATUS_SUCCESS;
+
+    if (ubox->y1 >= region->extents.y2)
+	status = _glitz_region_append_box (region, ubox);
+    else
+	status = _glitz_region_union_box (region, ubox);
+
+    if (status)
+	return status;
+
+    _glitz_region_apply_coalesce (region);
 
     return GLITZ_STATUS_SUCCESS;
 }
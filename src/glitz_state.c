@@ -0,0 +1,527 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+/* Every GL context has its own copy of the proc address list and with
+   that its own state cache. State that glitz changes through these
+   functions is only sent to GL when it differs from what was last set.
+   Anything not tracked here is passed straight through. */
+
+#define STATE_BLEND_FUNC_MASK     (1L << 0)
+#define STATE_ACTIVE_TEXTURE_MASK (1L << 1)
+#define STATE_PROGRAM_MASK        (1L << 2)
+#define STATE_SCISSOR_MASK        (1L << 3)
+#define STATE_COLOR_MASK_MASK     (1L << 4)
+#define STATE_MATRIX_MODE_MASK    (1L << 5)
+
+#define UNIT_BINDING_MASK(i) (1L << (i))
+#define UNIT_ENV_MASK(i)     (1L << (2 + (i)))
+
+#define ISSUE(state)   ((state)->issued++)
+#define SKIP(state)    ((state)->skipped++)
+
+static int
+_glitz_state_cap (glitz_gl_enum_t cap,
+		  glitz_bool_t    *per_unit)
+{
+    *per_unit = 0;
+
+    switch (cap) {
+    case GLITZ_GL_BLEND:
+	return 0;
+    case GLITZ_GL_SCISSOR_TEST:
+	return 1;
+    case GLITZ_GL_DITHER:
+	return 2;
+    case GLITZ_GL_FRAGMENT_PROGRAM:
+	return 3;
+    case GLITZ_GL_STENCIL_TEST:
+	return 4;
+    case GLITZ_GL_DEPTH_TEST:
+	return 5;
+    case GLITZ_GL_CULL_FACE:
+	return 6;
+    case GLITZ_GL_POLYGON_SMOOTH:
+	return 7;
+    case GLITZ_GL_LINE_SMOOTH:
+	return 8;
+    case GLITZ_GL_POINT_SMOOTH:
+	return 9;
+    }
+
+    *per_unit = 1;
+
+    switch (cap) {
+    case GLITZ_GL_TEXTURE_2D:
+	return 0;
+    case GLITZ_GL_TEXTURE_RECTANGLE:
+	return 1;
+    case GLITZ_GL_TEXTURE_GEN_S:
+	return 2;
+    case GLITZ_GL_TEXTURE_GEN_T:
+	return 3;
+    }
+
+    return -1;
+}
+
+static int
+_glitz_state_tex_env (glitz_gl_enum_t pname)
+{
+    switch (pname) {
+    case GLITZ_GL_TEXTURE_ENV_MODE:
+	return 0;
+    case GLITZ_GL_COMBINE_RGB:
+	return 1;
+    case GLITZ_GL_COMBINE_ALPHA:
+	return 2;
+    case GLITZ_GL_SOURCE0_RGB:
+	return 3;
+    case GLITZ_GL_SOURCE1_RGB:
+	return 4;
+    case GLITZ_GL_SOURCE2_RGB:
+	return 5;
+    case GLITZ_GL_SOURCE0_ALPHA:
+	return 6;
+    case GLITZ_GL_SOURCE1_ALPHA:
+	return 7;
+    case GLITZ_GL_SOURCE2_ALPHA:
+	return 8;
+    case GLITZ_GL_OPERAND0_RGB:
+	return 9;
+    case GLITZ_GL_OPERAND1_RGB:
+	return 10;
+    case GLITZ_GL_OPERAND2_RGB:
+	return 11;
+    case GLITZ_GL_OPERAND0_ALPHA:
+	return 12;
+    case GLITZ_GL_OPERAND1_ALPHA:
+	return 13;
+    case GLITZ_GL_OPERAND2_ALPHA:
+	return 14;
+    }
+
+    return -1;
+}
+
+static glitz_gl_texture_unit_state_t *
+_glitz_state_unit (glitz_gl_state_t *state)
+{
+    if (state->known & STATE_ACTIVE_TEXTURE_MASK)
+	return &state->unit[state->active_texture];
+
+    return NULL;
+}
+
+/* names deleted in another context of the share group may have been
+   reused since they were bound here */
+static void
+_glitz_state_check_names (glitz_gl_state_t *state)
+{
+    int i;
+
+    if (state->generation == *state->share_generation)
+	return;
+
+    for (i = 0; i < GLITZ_GL_STATE_TEXTURE_UNITS; i++)
+	state->unit[i].known &= ~(UNIT_BINDING_MASK (0) |
+				  UNIT_BINDING_MASK (1));
+
+    state->known &= ~STATE_PROGRAM_MASK;
+    state->generation = *state->share_generation;
+}
+
+static void
+_glitz_state_names_deleted (glitz_gl_state_t *state)
+{
+    state->generation = ++*state->share_generation;
+}
+
+void
+glitz_state_invalidate (glitz_gl_proc_address_list_t *gl)
+{
+    glitz_gl_state_t *state = &gl->state;
+    int              i;
+
+    state->known      = 0;
+    state->caps_known = 0;
+
+    for (i = 0; i < GLITZ_GL_STATE_TEXTURE_UNITS; i++)
+    {
+	state->unit[i].known      = 0;
+	state->unit[i].caps_known = 0;
+    }
+}
+
+static void
+_glitz_state_set_cap (glitz_gl_proc_address_list_t *gl,
+		      glitz_gl_enum_t              cap,
+		      glitz_bool_t                 enable)
+{
+    glitz_gl_state_t              *state = &gl->state;
+    glitz_gl_texture_unit_state_t *unit = NULL;
+    unsigned long                 *caps, *known, bit;
+    glitz_bool_t                  per_unit;
+    int                           i;
+
+    i = _glitz_state_cap (cap, &per_unit);
+    if (per_unit && i >= 0)
+    {
+	unit = _glitz_state_unit (state);
+	if (!unit)
+	    i = -1;
+    }
+
+    if (i < 0)
+    {
+	ISSUE (state);
+	if (enable)
+	    gl->enable (cap);
+	else
+	    gl->disable (cap);
+
+	return;
+    }
+
+    if (unit)
+    {
+	caps  = &unit->caps;
+	known = &unit->caps_known;
+    }
+    else
+    {
+	caps  = &state->caps;
+	known = &state->caps_known;
+    }
+
+    bit = 1L << i;
+    if ((*known & bit) && (!(*caps & bit)) == (!enable))
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    if (enable)
+    {
+	gl->enable (cap);
+	*caps |= bit;
+    }
+    else
+    {
+	gl->disable (cap);
+	*caps &= ~bit;
+    }
+
+    *known |= bit;
+}
+
+void
+glitz_state_enable (glitz_gl_proc_address_list_t *gl,
+		    glitz_gl_enum_t              cap)
+{
+    _glitz_state_set_cap (gl, cap, 1);
+}
+
+void
+glitz_state_disable (glitz_gl_proc_address_list_t *gl,
+		     glitz_gl_enum_t              cap)
+{
+    _glitz_state_set_cap (gl, cap, 0);
+}
+
+void
+glitz_state_blend_func (glitz_gl_proc_address_list_t *gl,
+			glitz_gl_enum_t              sfactor,
+			glitz_gl_enum_t              dfactor)
+{
+    glitz_gl_state_t *state = &gl->state;
+
+    if ((state->known & STATE_BLEND_FUNC_MASK) &&
+	state->blend_func[0] == sfactor &&
+	state->blend_func[1] == dfactor)
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    gl->blend_func (sfactor, dfactor);
+
+    state->blend_func[0] = sfactor;
+    state->blend_func[1] = dfactor;
+    state->known |= STATE_BLEND_FUNC_MASK;
+}
+
+void
+glitz_state_active_texture (glitz_gl_proc_address_list_t *gl,
+			    glitz_gl_enum_t              texture)
+{
+    glitz_gl_state_t *state = &gl->state;
+    int              i = texture - GLITZ_GL_TEXTURE0;
+
+    if ((state->known & STATE_ACTIVE_TEXTURE_MASK) &&
+	state->active_texture == i)
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    gl->active_texture (texture);
+
+    if (i >= 0 && i < GLITZ_GL_STATE_TEXTURE_UNITS)
+    {
+	state->active_texture = i;
+	state->known |= STATE_ACTIVE_TEXTURE_MASK;
+    }
+    else
+	state->known &= ~STATE_ACTIVE_TEXTURE_MASK;
+}
+
+void
+glitz_state_bind_texture (glitz_gl_proc_address_list_t *gl,
+			  glitz_gl_enum_t              target,
+			  glitz_gl_uint_t              texture)
+{
+    glitz_gl_state_t              *state = &gl->state;
+    glitz_gl_texture_unit_state_t *unit = _glitz_state_unit (state);
+    int                           i = 0;
+
+    if (target == GLITZ_GL_TEXTURE_2D)
+	i = 0;
+    else if (target == GLITZ_GL_TEXTURE_RECTANGLE)
+	i = 1;
+    else
+	unit = NULL;
+
+    if (!unit)
+    {
+	ISSUE (state);
+	gl->bind_texture (target, texture);
+	return;
+    }
+
+    _glitz_state_check_names (state);
+
+    if ((unit->known & UNIT_BINDING_MASK (i)) && unit->binding[i] == texture)
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    gl->bind_texture (target, texture);
+
+    unit->binding[i] = texture;
+    unit->known |= UNIT_BINDING_MASK (i);
+}
+
+void
+glitz_state_delete_textures (glitz_gl_proc_address_list_t *gl,
+			     glitz_gl_sizei_t             n,
+			     const glitz_gl_uint_t        *textures)
+{
+    glitz_gl_state_t *state = &gl->state;
+    int              i;
+
+    _glitz_state_check_names (state);
+
+    ISSUE (state);
+    gl->delete_textures (n, textures);
+
+    /* deleted textures are unbound and their names can be reused */
+    for (i = 0; i < GLITZ_GL_STATE_TEXTURE_UNITS; i++)
+	state->unit[i].known &= ~(UNIT_BINDING_MASK (0) |
+				  UNIT_BINDING_MASK (1));
+
+    _glitz_state_names_deleted (state);
+}
+
+void
+glitz_state_tex_env_f (glitz_gl_proc_address_list_t *gl,
+		       glitz_gl_enum_t              target,
+		       glitz_gl_enum_t              pname,
+		       glitz_gl_float_t             param)
+{
+    glitz_gl_state_t              *state = &gl->state;
+    glitz_gl_texture_unit_state_t *unit = _glitz_state_unit (state);
+    int                           i = _glitz_state_tex_env (pname);
+
+    if (!unit || i < 0 || target != GLITZ_GL_TEXTURE_ENV)
+    {
+	ISSUE (state);
+	gl->tex_env_f (target, pname, param);
+	return;
+    }
+
+    if ((unit->known & UNIT_ENV_MASK (i)) && unit->env[i] == param)
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    gl->tex_env_f (target, pname, param);
+
+    unit->env[i] = param;
+    unit->known |= UNIT_ENV_MASK (i);
+}
+
+void
+glitz_state_bind_program (glitz_gl_proc_address_list_t *gl,
+			  glitz_gl_enum_t              target,
+			  glitz_gl_uint_t              program)
+{
+    glitz_gl_state_t *state = &gl->state;
+
+    if (target != GLITZ_GL_FRAGMENT_PROGRAM)
+    {
+	ISSUE (state);
+	gl->bind_program (target, program);
+	return;
+    }
+
+    _glitz_state_check_names (state);
+
+    if ((state->known & STATE_PROGRAM_MASK) && state->program == program)
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    gl->bind_program (target, program);
+
+    state->program = program;
+    state->known |= STATE_PROGRAM_MASK;
+}
+
+void
+glitz_state_delete_programs (glitz_gl_proc_address_list_t *gl,
+			     glitz_gl_sizei_t             n,
+			     const glitz_gl_uint_t        *programs)
+{
+    glitz_gl_state_t *state = &gl->state;
+
+    _glitz_state_check_names (state);
+
+    ISSUE (state);
+    gl->delete_programs (n, programs);
+
+    state->known &= ~STATE_PROGRAM_MASK;
+
+    _glitz_state_names_deleted (state);
+}
+
+void
+glitz_state_scissor (glitz_gl_proc_address_list_t *gl,
+		     glitz_gl_int_t               x,
+		     glitz_gl_int_t               y,
+		     glitz_gl_sizei_t             width,
+		     glitz_gl_sizei_t             height)
+{
+    glitz_gl_state_t *state = &gl->state;
+
+    if ((state->known & STATE_SCISSOR_MASK) &&
+	state->scissor[0] == x     &&
+	state->scissor[1] == y     &&
+	state->scissor[2] == width &&
+	state->scissor[3] == height)
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    gl->scissor (x, y, width, height);
+
+    state->scissor[0] = x;
+    state->scissor[1] = y;
+    state->scissor[2] = width;
+    state->scissor[3] = height;
+    state->known |= STATE_SCISSOR_MASK;
+}
+
+void
+glitz_state_color_mask (glitz_gl_proc_address_list_t *gl,
+			glitz_gl_boolean_t           red,
+			glitz_gl_boolean_t           green,
+			glitz_gl_boolean_t           blue,
+			glitz_gl_boolean_t           alpha)
+{
+    glitz_gl_state_t *state = &gl->state;
+
+    if ((state->known & STATE_COLOR_MASK_MASK) &&
+	state->color_mask[0] == red   &&
+	state->color_mask[1] == green &&
+	state->color_mask[2] == blue  &&
+	state->color_mask[3] == alpha)
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    gl->color_mask (red, green, blue, alpha);
+
+    state->color_mask[0] = red;
+    state->color_mask[1] = green;
+    state->color_mask[2] = blue;
+    state->color_mask[3] = alpha;
+    state->known |= STATE_COLOR_MASK_MASK;
+}
+
+void
+glitz_state_matrix_mode (glitz_gl_proc_address_list_t *gl,
+			 glitz_gl_enum_t              mode)
+{
+    glitz_gl_state_t *state = &gl->state;
+
+    if ((state->known & STATE_MATRIX_MODE_MASK) && state->matrix_mode == mode)
+    {
+	SKIP (state);
+	return;
+    }
+
+    ISSUE (state);
+    gl->matrix_mode (mode);
+
+    state->matrix_mode = mode;
+    state->known |= STATE_MATRIX_MODE_MASK;
+}
+
+void
+glitz_state_pop_attrib (glitz_gl_proc_address_list_t *gl)
+{
+    ISSUE (&gl->state);
+    gl->pop_attrib ();
+
+    /* glitz only pushes transform and viewport state */
+    gl->state.known &= ~STATE_MATRIX_MODE_MASK;
+}
@@ -43,6 +43,8 @@ glitz_status_to_status_mask (glitz_status_t status)
 	return GLITZ_STATUS_NOT_SUPPORTED_MASK;
     case GLITZ_STATUS_CONTENT_DESTROYED:
 	return GLITZ_STATUS_CONTENT_DESTROYED_MASK;
+    case GLITZ_STATUS_BAD_ARGUMENT:
+	return GLITZ_STATUS_BAD_ARGUMENT_MASK;
     case GLITZ_STATUS_SUCCESS:
 	break;
     }
@@ -65,6 +67,9 @@ glitz_status_pop_from_mask (unsigned long *mask)
     } else if (*mask & GLITZ_STATUS_CONTENT_DESTROYED_MASK) {
 	*mask &= ~GLITZ_STATUS_CONTENT_DESTROYED_MASK;
 	return GLITZ_STATUS_CONTENT_DESTROYED;
+    } else if (*mask & GLITZ_STATUS_BAD_ARGUMENT_MASK) {
+	*mask &= ~GLITZ_STATUS_BAD_ARGUMENT_MASK;
+	return GLITZ_STATUS_BAD_ARGUMENT;
     }
 
     return GLITZ_STATUS_SUCCESS;
@@ -84,6 +89,8 @@ glitz_status_string (glitz_status_t status)
 	return "not supported";
     case GLITZ_STATUS_CONTENT_DESTROYED:
 	return "content destroyed";
+    case GLITZ_STATUS_BAD_ARGUMENT:
+	return "bad argument";
     }
 
     return "<unknown error status>";
@@ -72,6 +72,7 @@ glitz_surface_create (glitz_drawable_t           *drawable,
     surface->box.y2    = (short) height;
     surface->buffer    = GLITZ_GL_FRONT;
     surface->clip      = NULL;
+    surface->geometry.tex_gen = -1;
     glitz_surface_set_clip_region (surface, 0, 0, NULL, 0);
     
     if (width == 1 && height == 1)
@@ -88,6 +89,11 @@ glitz_surface_create (glitz_drawable_t           *drawable,
 	GLITZ_REGION_INIT (&surface->drawable_damage, GLITZ_NULL_BOX);
     }
 
+    GLITZ_REGION_SET_COALESCE (&surface->texture_damage,
+			       GLITZ_REGION_COALESCE_DEFAULT);
+    GLITZ_REGION_SET_COALESCE (&surface->drawable_damage,
+			       GLITZ_REGION_COALESCE_DEFAULT);
+
     glitz_texture_init (&surface->texture, width, height,
 			drawable->backend->texture_formats[format->id],
 			surface->format->color.fourcc,
@@ -95,6 +101,10 @@ glitz_surface_create (glitz_drawable_t           *drawable,
 
     glitz_surface_set_filter (surface, GLITZ_FILTER_NEAREST, NULL, 0);
 
+    /* a recycled texture is known to have a valid size */
+    if (glitz_pool_get_texture (drawable, &surface->texture))
+	return surface;
+
     if (width > 64 || height > 64)
     {
 	glitz_surface_push_current (surface, GLITZ_CONTEXT_CURRENT);
@@ -123,6 +133,12 @@ glitz_surface_destroy (glitz_surface_t *surface)
     if (surface->ref_count)
 	return;
 
+    if (surface->batch)
+    {
+	surface->batch->level = 1;
+	glitz_surface_end_batch (surface);
+    }
+
     if (surface->attached)
     {
 	surface->attached->backend->detach_notify (surface->attached, surface);
@@ -137,7 +153,9 @@ glitz_surface_destroy (glitz_surface_t *surface)
 
     if (surface->texture.name) {
 	glitz_surface_push_current (surface, GLITZ_ANY_CONTEXT_CURRENT);
-	glitz_texture_fini (surface->drawable->backend->gl, &surface->texture);
+	if (!glitz_pool_put_texture (surface->drawable, &surface->texture))
+	    glitz_texture_fini (surface->drawable->backend->gl,
+				&surface->texture);
 	glitz_surface_pop_current (surface);
     }
 
@@ -150,6 +168,9 @@ glitz_surface_destroy (glitz_surface_t *surface)
     if (surface->geometry.array)
 	glitz_multi_array_destroy (surface->geometry.array);
 
+    if (surface->geometry.indices)
+	glitz_buffer_destroy (surface->geometry.indices);
+
     if (surface->transform)
 	free (surface->transform);
 
@@ -209,12 +230,21 @@ _glitz_surface_sync_texture (glitz_surface_t *surface)
 	    return;
 	}
 
+	/* the texture is the resolve target of the multisampled buffer */
+	if (DRAWABLE_IS_MULTISAMPLE_FBO (surface->attached))
+	{
+	    glitz_surface_push_current (surface, GLITZ_DRAWABLE_CURRENT);
+	    _glitz_fbo_resolve (surface);
+	    glitz_surface_pop_current (surface);
+	    return;
+	}
+
 	glitz_surface_push_current (surface, GLITZ_DRAWABLE_CURRENT);
 
 	surface->drawable->backend->read_buffer (surface->drawable,
 						 surface->buffer);
 
-	gl->disable (GLITZ_GL_SCISSOR_TEST);
+	glitz_state_disable (gl, GLITZ_GL_SCISSOR_TEST);
 
 	glitz_texture_bind (gl, &surface->texture);
 
@@ -240,7 +270,7 @@ _glitz_surface_sync_texture (glitz_surface_t *surface)
 
 	glitz_texture_unbind (gl, &surface->texture);
 
-	gl->enable (GLITZ_GL_SCISSOR_TEST);
+	glitz_state_enable (gl, GLITZ_GL_SCISSOR_TEST);
 
 	glitz_surface_pop_current (surface);
     }
@@ -273,8 +303,8 @@ glitz_surface_sync_drawable (glitz_surface_t *surface)
 				   GLITZ_SURFACE_FLAGS_GEN_COORDS_MASK,
 				   NULL);
 
-	gl->tex_env_f (GLITZ_GL_TEXTURE_ENV, GLITZ_GL_TEXTURE_ENV_MODE,
-		       GLITZ_GL_REPLACE);
+	glitz_state_tex_env_f (gl, GLITZ_GL_TEXTURE_ENV,
+			       GLITZ_GL_TEXTURE_ENV_MODE, GLITZ_GL_REPLACE);
 	gl->color_4us (0x0, 0x0, 0x0, 0xffff);
 
 	param.filter[0] = param.filter[1] = GLITZ_GL_NEAREST;
@@ -284,10 +314,9 @@ glitz_surface_sync_drawable (glitz_surface_t *surface)
 
 	glitz_set_operator (gl, GLITZ_OPERATOR_SRC);
 
-	gl->scissor (surface->x + ext->x1,
-		     surface->attached->height - surface->y - ext->y2,
-		     ext->x2 - ext->x1,
-		     ext->y2 - ext->y1);
+	glitz_state_scissor (gl, surface->x + ext->x1,
+			     surface->attached->height - surface->y - ext->y2,
+			     ext->x2 - ext->x1, ext->y2 - ext->y1);
 
 	if (n_box > 1)
 	{
@@ -398,7 +427,8 @@ glitz_surface_damage (glitz_surface_t *surface,
 		      glitz_box_t     *box,
 		      int             what)
 {
-    if (surface->attached && !DRAWABLE_IS_FBO (surface->attached))
+    if (surface->attached && (!DRAWABLE_IS_FBO (surface->attached) ||
+			      DRAWABLE_IS_MULTISAMPLE_FBO (surface->attached)))
     {
 	if (box)
 	{
@@ -457,14 +487,14 @@ _glitz_surface_update_state (glitz_surface_t *surface)
 		      height - surface->y - surface->box.y2,
 		      surface->box.x2,
 		      surface->box.y2);
-	gl->matrix_mode (GLITZ_GL_PROJECTION);
+	glitz_state_matrix_mode (gl, GLITZ_GL_PROJECTION);
 	gl->load_identity ();
 	gl->ortho (0.0,
 		   surface->box.x2,
 		   height - surface->box.y2,
 		   height,
 		   -1.0, 1.0);
-	gl->matrix_mode (GLITZ_GL_MODELVIEW);
+	glitz_state_matrix_mode (gl, GLITZ_GL_MODELVIEW);
 	gl->load_identity ();
 	gl->scale_f (1.0f, -1.0f, 1.0f);
 	gl->translate_f (0.0f, -height, 0.0f);
@@ -480,9 +510,9 @@ _glitz_surface_update_state (glitz_surface_t *surface)
     drawable->backend->draw_buffer (drawable, surface->buffer);
 
     if (SURFACE_DITHER (surface))
-	gl->enable (GLITZ_GL_DITHER);
+	glitz_state_enable (gl, GLITZ_GL_DITHER);
     else
-	gl->disable (GLITZ_GL_DITHER);
+	glitz_state_disable (gl, GLITZ_GL_DITHER);
 }
 
 void
@@ -490,6 +520,8 @@ glitz_surface_attach (glitz_surface_t         *surface,
 		      glitz_drawable_t        *drawable,
 		      glitz_drawable_buffer_t buffer)
 {
+    glitz_surface_flush_batch (surface);
+
     if (drawable)
     {
 	if (buffer == GLITZ_DRAWABLE_BUFFER_FRONT_COLOR)
@@ -554,6 +586,8 @@ glitz_surface_attach (glitz_surface_t         *surface,
 void
 glitz_surface_detach (glitz_surface_t *surface)
 {
+    glitz_surface_flush_batch (surface);
+
     if (!surface->attached)
 	return;
 
@@ -623,6 +657,8 @@ glitz_surface_push_current (glitz_surface_t    *surface,
 		    else
 		    {
 			_glitz_surface_update_state (surface);
+			if (DRAWABLE_IS_MULTISAMPLE_FBO (drawable))
+			    glitz_surface_sync_drawable (surface);
 		    }
 		}
 		else
@@ -687,6 +723,8 @@ glitz_surface_set_transform (glitz_surface_t   *surface,
 	}
     };
 
+    glitz_surface_flush_batch (surface);
+
     if (transform &&
 	memcmp (transform, &identity, sizeof (glitz_transform_t)) == 0)
 	transform = NULL;
@@ -801,6 +839,8 @@ void
 glitz_surface_set_fill (glitz_surface_t *surface,
 			glitz_fill_t    fill)
 {
+    glitz_surface_flush_batch (surface);
+
     switch (fill) {
     case GLITZ_FILL_TRANSPARENT:
 	surface->flags &= ~GLITZ_SURFACE_FLAG_REPEAT_MASK;
@@ -832,6 +872,8 @@ void
 glitz_surface_set_component_alpha (glitz_surface_t *surface,
 				   glitz_bool_t    component_alpha)
 {
+    glitz_surface_flush_batch (surface);
+
     if (component_alpha && surface->format->color.red_size)
 	surface->flags |= GLITZ_SURFACE_FLAG_COMPONENT_ALPHA_MASK;
     else
@@ -847,6 +889,8 @@ glitz_surface_set_filter (glitz_surface_t    *surface,
 {
     glitz_status_t status;
 
+    glitz_surface_flush_batch (surface);
+
     status = glitz_filter_set_params (surface, filter, params, n_params);
     if (status) {
 	glitz_surface_status_add (surface,
@@ -856,6 +900,11 @@ glitz_surface_set_filter (glitz_surface_t    *surface,
 	case GLITZ_FILTER_NEAREST:
 	    switch (surface->format->color.fourcc) {
 	    case GLITZ_FOURCC_YV12:
+	    case GLITZ_FOURCC_I420:
+	    case GLITZ_FOURCC_NV12:
+	    case GLITZ_FOURCC_P010:
+	    case GLITZ_FOURCC_YUY2:
+	    case GLITZ_FOURCC_UYVY:
 		surface->flags |= GLITZ_SURFACE_FLAG_FRAGMENT_FILTER_MASK;
 		break;
 	    default:
@@ -868,6 +917,11 @@ glitz_surface_set_filter (glitz_surface_t    *surface,
 	case GLITZ_FILTER_BILINEAR:
 	    switch (surface->format->color.fourcc) {
 	    case GLITZ_FOURCC_YV12:
+	    case GLITZ_FOURCC_I420:
+	    case GLITZ_FOURCC_NV12:
+	    case GLITZ_FOURCC_P010:
+	    case GLITZ_FOURCC_YUY2:
+	    case GLITZ_FOURCC_UYVY:
 		surface->flags |= GLITZ_SURFACE_FLAG_FRAGMENT_FILTER_MASK;
 		break;
 	    default:
@@ -901,6 +955,8 @@ void
 glitz_surface_set_dither (glitz_surface_t *surface,
 			  glitz_bool_t    dither)
 {
+    glitz_surface_flush_batch (surface);
+
     if (dither)
 	surface->flags |= GLITZ_SURFACE_FLAG_DITHER_MASK;
     else
@@ -908,13 +964,32 @@ glitz_surface_set_dither (glitz_surface_t *surface,
 }
 slim_hidden_def(glitz_surface_set_dither);
 
+void
+glitz_surface_set_yuv_matrix (glitz_surface_t    *surface,
+			      glitz_yuv_matrix_t matrix)
+{
+    if (matrix > GLITZ_YUV_MATRIX_BT709)
+    {
+	glitz_surface_status_add (surface, GLITZ_STATUS_BAD_ARGUMENT_MASK);
+	return;
+    }
+
+    glitz_surface_flush_batch (surface);
+
+    surface->yuv_matrix = matrix;
+}
+slim_hidden_def(glitz_surface_set_yuv_matrix);
+
 void
 glitz_surface_flush (glitz_surface_t *surface)
 {
+    glitz_surface_flush_batch (surface);
+
     if (!surface->attached)
 	return;
 
-    if (!DRAWABLE_IS_FBO (surface->attached))
+    if (!DRAWABLE_IS_FBO (surface->attached) ||
+	DRAWABLE_IS_MULTISAMPLE_FBO (surface->attached))
     {
 	if (GLITZ_REGION_NOTEMPTY (&surface->drawable_damage))
 	{
@@ -974,6 +1049,9 @@ glitz_surface_translate_point (glitz_surface_t     *surface,
 }
 slim_hidden_def(glitz_surface_translate_point);
 
+/* identifies a clip region in a drawable's stencil buffer */
+static unsigned int _glitz_clip_serial = 0;
+
 void
 glitz_surface_set_clip_region (glitz_surface_t *surface,
 			       int             x_origin,
@@ -981,6 +1059,8 @@ glitz_surface_set_clip_region (glitz_surface_t *surface,
 			       glitz_box_t     *box,
 			       int             n_box)
 {
+    glitz_surface_flush_batch (surface);
+
     if (surface->clip)
 	free(surface->clip);
     
@@ -999,5 +1079,10 @@ glitz_surface_set_clip_region (glitz_surface_t *surface,
 	surface->n_clip = 1;
 	surface->x_clip = surface->y_clip = 0;
     }
+
+    if (++_glitz_clip_serial == 0)
+	++_glitz_clip_serial;
+
+    surface->clip_serial = _glitz_clip_serial;
 }
 slim_hidden_def(glitz_surface_set_clip_region);
@@ -50,7 +50,10 @@ glitz_texture_init (glitz_texture_t *texture,
 
     switch (fourcc) {
     case GLITZ_FOURCC_YV12:
-	/* U and V plane added below */
+    case GLITZ_FOURCC_I420:
+    case GLITZ_FOURCC_NV12:
+    case GLITZ_FOURCC_P010:
+	/* chroma planes added below */
 	texture->box.x1 = texture->box.y1 = 0;
 	texture->box.x2 = width;
 	texture->box.y2 = height;
@@ -60,13 +63,14 @@ glitz_texture_init (glitz_texture_t *texture,
 	texture->flags  = GLITZ_TEXTURE_FLAG_PADABLE_MASK;
 	break;
     case GLITZ_FOURCC_YUY2:
-	/* 1 RGBA texel for 2 YUY2 pixels */
+    case GLITZ_FOURCC_UYVY:
+	/* 1 RGBA texel for 2 pixels, the box stays in pixels and the
+	   width unit is halved below */
 	texture->box.x1 = texture->box.y1 = 0;
-	texture->box.x2 = texture->width  = width >> 1;
+	texture->box.x2 = width;
 	texture->box.y2 = texture->height = height;
-	texture->flags  = GLITZ_TEXTURE_FLAG_CLAMPABLE_MASK |
-	    GLITZ_TEXTURE_FLAG_REPEATABLE_MASK |
-	    GLITZ_TEXTURE_FLAG_PADABLE_MASK;
+	texture->width  = (width + 1) >> 1;
+	texture->flags  = GLITZ_TEXTURE_FLAG_PADABLE_MASK;
 	break;
     default:
 	texture->box.x1 = texture->box.y1 = 0;
@@ -117,6 +121,14 @@ glitz_texture_init (glitz_texture_t *texture,
 	texture->texcoord_width_unit = 1.0f;
 	texture->texcoord_height_unit = 1.0f;
     }
+
+    switch (fourcc) {
+    case GLITZ_FOURCC_YUY2:
+    case GLITZ_FOURCC_UYVY:
+	texture->texcoord_width_unit *= 0.5f;
+    default:
+	break;
+    }
 }
 
 void
@@ -207,29 +219,29 @@ glitz_texture_fini (glitz_gl_proc_address_list_t *gl,
 		    glitz_texture_t              *texture)
 {
     if (texture->name)
-	gl->delete_textures (1, &texture->name);
+	glitz_state_delete_textures (gl, 1, &texture->name);
 }
 
 void
 glitz_texture_bind (glitz_gl_proc_address_list_t *gl,
 		    glitz_texture_t              *texture)
 {
-    gl->disable (GLITZ_GL_TEXTURE_RECTANGLE);
-    gl->disable (GLITZ_GL_TEXTURE_2D);
+    glitz_state_disable (gl, GLITZ_GL_TEXTURE_RECTANGLE);
+    glitz_state_disable (gl, GLITZ_GL_TEXTURE_2D);
 
     if (!texture->name)
 	return;
 
-    gl->enable (texture->target);
-    gl->bind_texture (texture->target, texture->name);
+    glitz_state_enable (gl, texture->target);
+    glitz_state_bind_texture (gl, texture->target, texture->name);
 }
 
 void
 glitz_texture_unbind (glitz_gl_proc_address_list_t *gl,
 		      glitz_texture_t              *texture)
 {
-    gl->bind_texture (texture->target, 0);
-    gl->disable (texture->target);
+    glitz_state_bind_texture (gl, texture->target, 0);
+    glitz_state_disable (gl, texture->target);
 }
 
 void
@@ -251,6 +263,73 @@ glitz_texture_copy_drawable (glitz_gl_proc_address_list_t *gl,
 			       width, height);
 }
 
+static void
+_glitz_texture_tex_gen_planes (glitz_texture_t *texture,
+			       int             x_src,
+			       int             y_src,
+			       unsigned long   flags,
+			       glitz_vec4_t    *plane)
+{
+    plane[0].v[1] = plane[0].v[2] = 0.0f;
+
+    if (flags & GLITZ_SURFACE_FLAG_EYE_COORDS_MASK)
+    {
+	plane[0].v[0] = 1.0f;
+	plane[0].v[3] = -x_src;
+    }
+    else
+    {
+	plane[0].v[0] = texture->texcoord_width_unit;
+
+	if (flags & GLITZ_SURFACE_FLAG_TRANSFORM_MASK)
+	    plane[0].v[3] = -(x_src) * texture->texcoord_width_unit;
+	else
+	    plane[0].v[3] = -(x_src - texture->box.x1) *
+		texture->texcoord_width_unit;
+    }
+
+    plane[1].v[0] = plane[1].v[2] = 0.0f;
+
+    if (flags & GLITZ_SURFACE_FLAG_EYE_COORDS_MASK)
+    {
+	plane[1].v[1] = 1.0f;
+	plane[1].v[3] = -y_src;
+    }
+    else
+    {
+	plane[1].v[1] = -texture->texcoord_height_unit;
+	if (flags & GLITZ_SURFACE_FLAG_TRANSFORM_MASK)
+	    plane[1].v[3] = (y_src + texture->box.y2 - texture->box.y1) *
+		texture->texcoord_height_unit;
+	else
+	    plane[1].v[3] = (y_src + texture->box.y2) *
+		texture->texcoord_height_unit;
+    }
+}
+
+static void
+_glitz_texture_set_tex_coords (glitz_gl_proc_address_list_t *gl,
+			       glitz_geometry_t             *geometry,
+			       unsigned long                flags,
+			       glitz_int_coordinate_t       *coord)
+{
+    if (!(flags & GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK))
+    {
+	unsigned char *ptr;
+
+	gl->enable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+
+	ptr = glitz_buffer_bind (geometry->buffer, GLITZ_GL_ARRAY_BUFFER);
+	ptr += coord->offset;
+
+	gl->tex_coord_pointer (coord->size,
+			       coord->type,
+			       geometry->stride,
+			       (void *) ptr);
+    } else
+	gl->disable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+}
+
 void
 glitz_texture_set_tex_gen (glitz_gl_proc_address_list_t *gl,
 			   glitz_texture_t              *texture,
@@ -260,81 +339,77 @@ glitz_texture_set_tex_gen (glitz_gl_proc_address_list_t *gl,
 			   unsigned long                flags,
 			   glitz_int_coordinate_t       *coord)
 {
-    glitz_vec4_t plane;
+    glitz_vec4_t plane[2];
+
+    _glitz_texture_tex_gen_planes (texture, x_src, y_src, flags, plane);
 
     if (flags & GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK)
     {
-	plane.v[1] = plane.v[2] = 0.0f;
-
-	if (flags & GLITZ_SURFACE_FLAG_EYE_COORDS_MASK)
-	{
-	    plane.v[0] = 1.0f;
-	    plane.v[3] = -x_src;
-	}
-	else
-	{
-	    plane.v[0] = texture->texcoord_width_unit;
-
-	    if (flags & GLITZ_SURFACE_FLAG_TRANSFORM_MASK)
-		plane.v[3] = -(x_src) * texture->texcoord_width_unit;
-	    else
-		plane.v[3] = -(x_src - texture->box.x1) *
-		    texture->texcoord_width_unit;
-	}
-
 	gl->tex_gen_i (GLITZ_GL_S, GLITZ_GL_TEXTURE_GEN_MODE,
 		       GLITZ_GL_EYE_LINEAR);
-	gl->tex_gen_fv (GLITZ_GL_S, GLITZ_GL_EYE_PLANE, plane.v);
+	gl->tex_gen_fv (GLITZ_GL_S, GLITZ_GL_EYE_PLANE, plane[0].v);
 
-	gl->enable (GLITZ_GL_TEXTURE_GEN_S);
+	glitz_state_enable (gl, GLITZ_GL_TEXTURE_GEN_S);
     }
     else
-	gl->disable (GLITZ_GL_TEXTURE_GEN_S);
+	glitz_state_disable (gl, GLITZ_GL_TEXTURE_GEN_S);
 
     if (flags & GLITZ_SURFACE_FLAG_GEN_T_COORDS_MASK)
     {
-	plane.v[0] = plane.v[2] = 0.0f;
-
-	if (flags & GLITZ_SURFACE_FLAG_EYE_COORDS_MASK)
-	{
-	    plane.v[1] = 1.0f;
-	    plane.v[3] = -y_src;
-	}
-	else
-	{
-	    plane.v[1] = -texture->texcoord_height_unit;
-	    if (flags & GLITZ_SURFACE_FLAG_TRANSFORM_MASK)
-		plane.v[3] = (y_src + texture->box.y2 - texture->box.y1) *
-		    texture->texcoord_height_unit;
-	    else
-		plane.v[3] = (y_src + texture->box.y2) *
-		    texture->texcoord_height_unit;
-	}
-
 	gl->tex_gen_i (GLITZ_GL_T, GLITZ_GL_TEXTURE_GEN_MODE,
 		       GLITZ_GL_EYE_LINEAR);
-	gl->tex_gen_fv (GLITZ_GL_T, GLITZ_GL_EYE_PLANE, plane.v);
+	gl->tex_gen_fv (GLITZ_GL_T, GLITZ_GL_EYE_PLANE, plane[1].v);
 
-	gl->enable (GLITZ_GL_TEXTURE_GEN_T);
+	glitz_state_enable (gl, GLITZ_GL_TEXTURE_GEN_T);
     }
     else
-	gl->disable (GLITZ_GL_TEXTURE_GEN_T);
+	glitz_state_disable (gl, GLITZ_GL_TEXTURE_GEN_T);
 
-    if (!(flags & GLITZ_SURFACE_FLAG_GEN_S_COORDS_MASK))
-    {
-	unsigned char *ptr;
+    _glitz_texture_set_tex_coords (gl, geometry, flags, coord);
+}
 
-	gl->enable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+/* Same as glitz_texture_set_tex_gen for the vertex program, which
+   reads the planes and the texture matrix of each unit from program
+   environment parameters. A NULL matrix is the identity. */
+void
+glitz_texture_set_tex_gen_env (glitz_gl_proc_address_list_t *gl,
+			       glitz_texture_t              *texture,
+			       glitz_geometry_t             *geometry,
+			       int                          x_src,
+			       int                          y_src,
+			       unsigned long                flags,
+			       glitz_int_coordinate_t       *coord,
+			       int                          unit,
+			       glitz_float_t                *matrix)
+{
+    glitz_vec4_t plane[2], row;
+    int          i, env = GLITZ_VP_ENV_UNIT (unit);
 
-	ptr = glitz_buffer_bind (geometry->buffer, GLITZ_GL_ARRAY_BUFFER);
-	ptr += coord->offset;
+    _glitz_texture_tex_gen_planes (texture, x_src, y_src, flags, plane);
 
-	gl->tex_coord_pointer (coord->size,
-			       coord->type,
-			       geometry->stride,
-			       (void *) ptr);
-    } else
-	gl->disable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+    gl->program_env_param_4fv (GLITZ_GL_VERTEX_PROGRAM, env, plane[0].v);
+    gl->program_env_param_4fv (GLITZ_GL_VERTEX_PROGRAM, env + 1, plane[1].v);
+
+    for (i = 0; i < 4; i++)
+    {
+	if (matrix)
+	{
+	    row.v[0] = matrix[i];
+	    row.v[1] = matrix[i + 4];
+	    row.v[2] = matrix[i + 8];
+	    row.v[3] = matrix[i + 12];
+	}
+	else
+	{
+	    row.v[0] = row.v[1] = row.v[2] = row.v[3] = 0.0f;
+	    row.v[i] = 1.0f;
+	}
+
+	gl->program_env_param_4fv (GLITZ_GL_VERTEX_PROGRAM, env + 2 + i,
+				   row.v);
+    }
+
+    _glitz_texture_set_tex_coords (gl, geometry, flags, coord);
 }
 
 glitz_texture_object_t *
@@ -240,6 +240,179 @@ _glitz_pixel_area (glitz_float_t pixel_x,
     return area;
 }
 
+/* longest run of edge pixels evaluated by one _glitz_pixel_area_run call */
+#define PIXEL_RUN 4
+
+#ifdef USE_SSE2
+
+#include <emmintrin.h>
+
+#define SELECT_PS(m, a, b) \
+    _mm_or_ps (_mm_and_ps (m, a), _mm_andnot_ps (m, b))
+
+/*
+  Coverage to the left of a non-vertical edge between relative
+  heights 'top' and 'bottom' for four pixels. Both clamps of the
+  scalar code above are expressed as min/max and mask selects.
+*/
+static SSE2_FUNCTION __m128
+_glitz_edge_area_sse2 (__m128       pixel_x,
+		       __m128       pixel_y,
+		       __m128       top,
+		       __m128       bottom,
+		       glitz_edge_t *edge)
+{
+    const __m128 zero = _mm_setzero_ps ();
+    const __m128 one = _mm_set1_ps (1.0f);
+    const __m128 half = _mm_set1_ps (0.5f);
+    __m128 kx = _mm_set1_ps (edge->kx);
+    __m128 ky = _mm_set1_ps (edge->ky);
+    __m128 x0 = _mm_set1_ps (edge->x0);
+    __m128 y0 = _mm_set1_ps (edge->y0);
+    __m128 pixel_x_1 = _mm_add_ps (pixel_x, one);
+    __m128 upper_x, lower_x, left_y, right_y, falling;
+    __m128 x1, y1, x2, y2, x2h, y2h, above[2], h, m;
+    int i;
+
+    upper_x = _mm_add_ps (_mm_mul_ps (kx, pixel_y), x0);
+    lower_x = _mm_add_ps (_mm_mul_ps (kx, _mm_add_ps (pixel_y, one)), x0);
+
+    left_y  = _mm_sub_ps (_mm_add_ps (_mm_mul_ps (ky, pixel_x), y0),
+			  pixel_y);
+    right_y = _mm_sub_ps (_mm_add_ps (_mm_mul_ps (ky, pixel_x_1), y0),
+			  pixel_y);
+
+    x1 = _mm_min_ps (_mm_max_ps (_mm_sub_ps (upper_x, pixel_x), zero), one);
+    y1 = SELECT_PS (_mm_cmplt_ps (upper_x, pixel_x), left_y,
+		    SELECT_PS (_mm_cmpgt_ps (upper_x, pixel_x_1), right_y,
+			       zero));
+
+    x2 = _mm_min_ps (_mm_max_ps (_mm_sub_ps (lower_x, pixel_x), zero), one);
+    y2 = SELECT_PS (_mm_cmplt_ps (lower_x, pixel_x), left_y,
+		    SELECT_PS (_mm_cmpgt_ps (lower_x, pixel_x_1), right_y,
+			       one));
+
+    falling = _mm_cmpgt_ps (left_y, right_y);
+
+    for (i = 0; i < 2; i++)
+    {
+	h = (i) ? top : bottom;
+
+	x2h = _mm_sub_ps (x2, _mm_mul_ps (kx, _mm_max_ps (_mm_sub_ps (y2, h),
+							  zero)));
+	y2h = _mm_min_ps (y2, h);
+
+	/* AREA_ABOVE_LEFT (x1, y1, x2h, y2h, h) */
+	m = _mm_add_ps (_mm_mul_ps (x1, y1),
+			_mm_mul_ps (_mm_mul_ps (_mm_add_ps (x1, x2h), half),
+				    _mm_sub_ps (y2h, y1)));
+	m = _mm_add_ps (m, _mm_mul_ps (x2h, _mm_sub_ps (h, y2h)));
+
+	above[i] = SELECT_PS (_mm_cmple_ps (h, y1), _mm_and_ps (falling, h), m);
+    }
+
+    return _mm_sub_ps (above[0], above[1]);
+}
+
+static SSE2_FUNCTION void
+_glitz_pixel_area_run_sse2 (glitz_float_t *area,
+			    int           n,
+			    glitz_float_t pixel_x,
+			    glitz_float_t pixel_y,
+			    glitz_float_t step_x,
+			    glitz_float_t step_y,
+			    glitz_float_t top,
+			    glitz_float_t bottom,
+			    glitz_edge_t  *left,
+			    glitz_edge_t  *right)
+{
+    const __m128 zero = _mm_setzero_ps ();
+    const __m128 one = _mm_set1_ps (1.0f);
+    const __m128 steps = _mm_set_ps (3.0f, 2.0f, 1.0f, 0.0f);
+    __m128 px, py, t, b, height, a, x0;
+    glitz_float_t out[4];
+    int i;
+
+    px = _mm_add_ps (_mm_set1_ps (pixel_x),
+		     _mm_mul_ps (steps, _mm_set1_ps (step_x)));
+    py = _mm_add_ps (_mm_set1_ps (pixel_y),
+		     _mm_mul_ps (steps, _mm_set1_ps (step_y)));
+
+    b = _mm_set1_ps (bottom);
+    b = SELECT_PS (_mm_cmpge_ps (b, _mm_add_ps (py, one)), one,
+		   _mm_sub_ps (b, py));
+
+    t = _mm_set1_ps (top);
+    t = SELECT_PS (_mm_cmple_ps (t, py), zero, _mm_sub_ps (t, py));
+
+    height = _mm_sub_ps (b, t);
+
+    if (right->ky)
+    {
+	a = _glitz_edge_area_sse2 (px, py, t, b, right);
+    }
+    else
+    {
+	/* Vertical Edge */
+	x0 = _mm_set1_ps (right->x0);
+	a = SELECT_PS (_mm_cmplt_ps (x0, _mm_add_ps (px, one)),
+		       _mm_mul_ps (_mm_sub_ps (x0, px), height), height);
+    }
+
+    if (left->kx)
+    {
+	a = _mm_sub_ps (a, _glitz_edge_area_sse2 (px, py, t, b, left));
+    }
+    else
+    {
+	/* Vertical Edge */
+	x0 = _mm_set1_ps (left->x0);
+	a = _mm_sub_ps (a, _mm_mul_ps (_mm_max_ps (_mm_sub_ps (x0, px), zero),
+				       height));
+    }
+
+    _mm_storeu_ps (out, a);
+    for (i = 0; i < n; i++)
+	area[i] = out[i];
+}
+
+#undef SELECT_PS
+
+#endif
+
+/*
+  Calculates coverage of 'n' (at most PIXEL_RUN) pixels starting at
+  'pixel_x', 'pixel_y' and stepping by 'step_x', 'step_y'.
+*/
+static void
+_glitz_pixel_area_run (glitz_float_t *area,
+		       int           n,
+		       glitz_float_t pixel_x,
+		       glitz_float_t pixel_y,
+		       glitz_float_t step_x,
+		       glitz_float_t step_y,
+		       glitz_float_t top,
+		       glitz_float_t bottom,
+		       glitz_edge_t  *left,
+		       glitz_edge_t  *right)
+{
+    int i;
+
+#ifdef USE_SSE2
+    if (glitz_have_sse2 ())
+    {
+	_glitz_pixel_area_run_sse2 (area, n, pixel_x, pixel_y, step_x, step_y,
+				    top, bottom, left, right);
+	return;
+    }
+#endif
+
+    for (i = 0; i < n; i++)
+	area[i] = _glitz_pixel_area (pixel_x + i * step_x,
+				     pixel_y + i * step_y,
+				     top, bottom, left, right);
+}
+
 #define TRAPINIT(trap, _top, _bottom, _left, _right)    \
     if (!TRAPEZOID_VALID (trap))                        \
 	continue;                                       \
@@ -444,3 +617,1040 @@ glitz_add_traps (glitz_buffer_t    *buffer,
 
     return count;
 }
+
+/*
+  Parallel tessellation.
+
+  The trapezoids are split into chunks that are tessellated on worker
+  threads, each into its own part of the buffer range. Every chunk
+  becomes one array of the multi array so the parts can be drawn
+  without being copied together. When a chunk runs out of space, the
+  output of the chunks before it and its own is packed to the start of
+  the range and the remaining trapezoids are added sequentially after
+  it. The chunks after it are dropped, so that the added trapezoids
+  stay a prefix of the input and the buffer is filled exactly as it
+  would be by glitz_add_trapezoids.
+*/
+
+#define TRAP_CHUNKS_MAX   32
+#define TRAP_CHUNK_MIN    256
+
+/* rough cost of one trapezoid in pixel conversions */
+#define TRAP_WORKER_COST  64
+
+typedef struct _glitz_trap_chunk {
+    uint8_t      *ptr;
+    unsigned int size, count;
+    void         *traps;
+    int          n_traps, n_left;
+} glitz_trap_chunk_t;
+
+typedef struct _glitz_trap_job {
+    glitz_data_type_t  type;
+    glitz_surface_t    *mask;
+    glitz_bool_t       trapezoids;
+    glitz_trap_chunk_t chunk[TRAP_CHUNKS_MAX];
+} glitz_trap_job_t;
+
+static void
+_glitz_add_trap_chunks (void *closure,
+			int  y1,
+			int  y2)
+{
+    glitz_trap_job_t   *job = (glitz_trap_job_t *) closure;
+    glitz_trap_chunk_t *chunk;
+
+    for (chunk = &job->chunk[y1]; chunk < &job->chunk[y2]; chunk++)
+    {
+	chunk->n_left = chunk->n_traps;
+
+	if (job->trapezoids)
+	{
+	    glitz_trapezoid_t *traps = (glitz_trapezoid_t *) chunk->traps;
+
+	    switch (job->type) {
+	    case GLITZ_DATA_TYPE_SHORT:
+		chunk->count = _glitz_add_trapezoids_short (chunk->ptr,
+							    chunk->size,
+							    job->mask, traps,
+							    &chunk->n_left);
+		break;
+	    case GLITZ_DATA_TYPE_INT:
+		chunk->count = _glitz_add_trapezoids_int (chunk->ptr,
+							  chunk->size,
+							  job->mask, traps,
+							  &chunk->n_left);
+		break;
+	    case GLITZ_DATA_TYPE_DOUBLE:
+		chunk->count = _glitz_add_trapezoids_double (chunk->ptr,
+							     chunk->size,
+							     job->mask, traps,
+							     &chunk->n_left);
+		break;
+	    default:
+		chunk->count = _glitz_add_trapezoids_float (chunk->ptr,
+							    chunk->size,
+							    job->mask, traps,
+							    &chunk->n_left);
+		break;
+	    }
+	}
+	else
+	{
+	    glitz_trap_t *traps = (glitz_trap_t *) chunk->traps;
+
+	    switch (job->type) {
+	    case GLITZ_DATA_TYPE_SHORT:
+		chunk->count = _glitz_add_traps_short (chunk->ptr, chunk->size,
+						       job->mask, traps,
+						       &chunk->n_left);
+		break;
+	    case GLITZ_DATA_TYPE_INT:
+		chunk->count = _glitz_add_traps_int (chunk->ptr, chunk->size,
+						     job->mask, traps,
+						     &chunk->n_left);
+		break;
+	    case GLITZ_DATA_TYPE_DOUBLE:
+		chunk->count = _glitz_add_traps_double (chunk->ptr, chunk->size,
+							job->mask, traps,
+							&chunk->n_left);
+		break;
+	    default:
+		chunk->count = _glitz_add_traps_float (chunk->ptr, chunk->size,
+						       job->mask, traps,
+						       &chunk->n_left);
+		break;
+	    }
+	}
+    }
+}
+
+static int
+_glitz_add_traps_multi (glitz_buffer_t      *buffer,
+			int                 offset,
+			unsigned int        size,
+			glitz_data_type_t   type,
+			glitz_surface_t     *mask,
+			glitz_bool_t        trapezoids,
+			void                *traps,
+			int                 n_traps,
+			glitz_multi_array_t *array,
+			int                 *n_added)
+{
+    glitz_trap_job_t   job;
+    glitz_trap_chunk_t *chunk;
+    unsigned int       bytes_per_vertex, n_quads, quad, count = 0;
+    unsigned int       trap_size, done;
+    int                n_chunks, n_done, i, j, trap;
+    uint8_t            *ptr;
+
+    *n_added = 0;
+
+    switch (type) {
+    case GLITZ_DATA_TYPE_SHORT:
+	bytes_per_vertex = 2 * sizeof (glitz_short_t);
+	break;
+    case GLITZ_DATA_TYPE_INT:
+	bytes_per_vertex = 2 * sizeof (glitz_int_t);
+	break;
+    case GLITZ_DATA_TYPE_DOUBLE:
+	bytes_per_vertex = 2 * sizeof (glitz_double_t);
+	break;
+    default:
+	bytes_per_vertex = 2 * sizeof (glitz_float_t);
+	break;
+    }
+    bytes_per_vertex += sizeof (glitz_float_t);
+
+    n_chunks = MIN (n_traps / TRAP_CHUNK_MIN, TRAP_CHUNKS_MAX);
+    n_chunks = MIN (n_chunks, array->size - array->n_arrays);
+    if (n_chunks < 1)
+    {
+	if (array->size == array->n_arrays || n_traps < 1)
+	    return 0;
+
+	n_chunks = 1;
+    }
+
+    ptr = glitz_buffer_map (buffer, GLITZ_BUFFER_ACCESS_WRITE_ONLY);
+    if (!ptr)
+	return 0;
+
+    ptr += offset;
+
+    job.type       = type;
+    job.mask       = mask;
+    job.trapezoids = trapezoids;
+
+    if (trapezoids)
+	trap_size = sizeof (glitz_trapezoid_t);
+    else
+	trap_size = sizeof (glitz_trap_t);
+
+    /* equal shares of trapezoids and whole quads of the buffer */
+    n_quads = size / (4 * bytes_per_vertex);
+    for (i = 0; i < n_chunks; i++)
+    {
+	chunk = &job.chunk[i];
+
+	trap = n_traps / n_chunks * i + MIN (n_traps % n_chunks, i);
+	quad = n_quads / n_chunks * i + MIN (n_quads % n_chunks, i);
+
+	chunk->ptr     = ptr + quad * 4 * bytes_per_vertex;
+	chunk->n_traps = n_traps / n_chunks + (i < n_traps % n_chunks);
+	chunk->size    = (n_quads / n_chunks + (i < n_quads % n_chunks)) *
+	    4 * bytes_per_vertex;
+
+	chunk->traps   = (uint8_t *) traps + trap * trap_size;
+    }
+
+    glitz_run_bands (_glitz_add_trap_chunks, &job, n_chunks, 1,
+		     (unsigned long) n_traps * TRAP_WORKER_COST);
+
+    for (i = 0; i < n_chunks; i++)
+	if (job.chunk[i].n_left)
+	    break;
+
+    if (i < n_chunks)
+    {
+	chunk  = &job.chunk[0];
+	n_done = chunk->n_traps - chunk->n_left;
+
+	for (j = 1; j <= i; j++)
+	{
+	    memmove (chunk->ptr + chunk->count, job.chunk[j].ptr,
+		     job.chunk[j].count);
+
+	    chunk->count += job.chunk[j].count;
+	    n_done       += job.chunk[j].n_traps - job.chunk[j].n_left;
+	}
+
+	done = chunk->count;
+
+	chunk->ptr    += done;
+	chunk->size    = (ptr + n_quads * 4 * bytes_per_vertex) - chunk->ptr;
+	chunk->traps   = (uint8_t *) traps + n_done * trap_size;
+	chunk->n_traps = n_traps - n_done;
+
+	_glitz_add_trap_chunks (&job, 0, 1);
+
+	chunk->ptr     -= done;
+	chunk->count   += done;
+	chunk->n_traps  = n_traps;
+	n_chunks        = 1;
+    }
+
+    if (glitz_buffer_unmap (buffer))
+	return 0;
+
+    for (i = 0; i < n_chunks; i++)
+    {
+	chunk = &job.chunk[i];
+
+	if (chunk->count)
+	    glitz_multi_array_add (array,
+				   (offset + (chunk->ptr - ptr)) /
+				   bytes_per_vertex, 0,
+				   chunk->count / bytes_per_vertex, 0, 0);
+
+	count    += chunk->count;
+	*n_added += chunk->n_traps - chunk->n_left;
+    }
+
+    return count;
+}
+
+int
+glitz_add_trapezoids_multi (glitz_buffer_t      *buffer,
+			    int                 offset,
+			    unsigned int        size,
+			    glitz_data_type_t   type,
+			    glitz_surface_t     *mask,
+			    glitz_trapezoid_t   *traps,
+			    int                 n_traps,
+			    glitz_multi_array_t *array,
+			    int                 *n_added)
+{
+    return _glitz_add_traps_multi (buffer, offset, size, type, mask, 1,
+				   traps, n_traps, array, n_added);
+}
+
+int
+glitz_add_traps_multi (glitz_buffer_t      *buffer,
+		       int                 offset,
+		       unsigned int        size,
+		       glitz_data_type_t   type,
+		       glitz_surface_t     *mask,
+		       glitz_trap_t        *traps,
+		       int                 n_traps,
+		       glitz_multi_array_t *array,
+		       int                 *n_added)
+{
+    return _glitz_add_traps_multi (buffer, offset, size, type, mask, 0,
+				   traps, n_traps, array, n_added);
+}
+
+/*
+  GPU trapezoid rasterization.
+
+  Each trapezoid is drawn as a single quad covering its bounds. The
+  quad carries the top and bottom of the trapezoid and the normalized
+  line equations of its edges as texture coordinates, and a fragment
+  program computes pixel coverage from them. Coverage is accumulated
+  into the destination with the ADD operator.
+
+  Vertex format:
+
+  x, y, top, bottom       texcoord[0] (x, y also used as position)
+  a, b, 0, c              texcoord[1], left edge, inside is positive
+  a, b, 0, c              texcoord[2], right edge, inside is positive
+*/
+
+#define COVERAGE_FLOATS_PER_VERTEX 12
+#define COVERAGE_FLOATS_PER_QUAD   (4 * COVERAGE_FLOATS_PER_VERTEX)
+#define COVERAGE_MAX_QUADS         256
+
+#define COVERAGE_EDGE(e, p1x, p1y, p2x, p2y, sign)                      \
+    {                                                                   \
+	glitz_float_t _dx = (p2x) - (p1x);                              \
+	glitz_float_t _dy = (p2y) - (p1y);                              \
+	glitz_float_t _len = sqrtf (_dx * _dx + _dy * _dy);             \
+									\
+	if (_dy < 0.0f)                                                 \
+	    _len = -_len;                                               \
+									\
+	(e)[0] = (sign) * _dy / _len;                                   \
+	(e)[1] = (sign) * -_dx / _len;                                  \
+	(e)[2] = 0.0f;                                                  \
+	(e)[3] = -((e)[0] * (p1x) + (e)[1] * (p1y));                    \
+    }
+
+#define COVERAGE_VERTEX(v, _x, _y, top, bottom, l, r) \
+    (v)[0]  = (_x);                                   \
+    (v)[1]  = (_y);                                   \
+    (v)[2]  = (top);                                  \
+    (v)[3]  = (bottom);                               \
+    (v)[4]  = (l)[0];                                 \
+    (v)[5]  = (l)[1];                                 \
+    (v)[6]  = (l)[2];                                 \
+    (v)[7]  = (l)[3];                                 \
+    (v)[8]  = (r)[0];                                 \
+    (v)[9]  = (r)[1];                                 \
+    (v)[10] = (r)[2];                                 \
+    (v)[11] = (r)[3];                                 \
+    (v) += COVERAGE_FLOATS_PER_VERTEX
+
+static void
+_glitz_coverage_add_quad (glitz_float_t **vptr,
+			  glitz_box_t   *bounds,
+			  glitz_float_t top,
+			  glitz_float_t bottom,
+			  glitz_float_t lx1,
+			  glitz_float_t ly1,
+			  glitz_float_t lx2,
+			  glitz_float_t ly2,
+			  glitz_float_t rx1,
+			  glitz_float_t ry1,
+			  glitz_float_t rx2,
+			  glitz_float_t ry2)
+{
+    glitz_float_t l[4], r[4];
+    glitz_float_t x1, x2, y1, y2;
+    glitz_float_t *v = *vptr;
+
+    COVERAGE_EDGE (l, lx1, ly1, lx2, ly2, 1.0f);
+    COVERAGE_EDGE (r, rx1, ry1, rx2, ry2, -1.0f);
+
+    /* x extents of the edges between top and bottom, plus one pixel
+       for the anti-aliased fringe */
+    if (lx1 == lx2)
+	x1 = lx1;
+    else
+	x1 = MIN (lx1 + (top - ly1) * (lx2 - lx1) / (ly2 - ly1),
+		  lx1 + (bottom - ly1) * (lx2 - lx1) / (ly2 - ly1));
+
+    if (rx1 == rx2)
+	x2 = rx1;
+    else
+	x2 = MAX (rx1 + (top - ry1) * (rx2 - rx1) / (ry2 - ry1),
+		  rx1 + (bottom - ry1) * (rx2 - rx1) / (ry2 - ry1));
+
+    x1 = floorf (x1) - 1.0f;
+    x2 = ceilf (x2) + 1.0f;
+    y1 = floorf (top);
+    y2 = ceilf (bottom);
+
+    if (x1 >= x2)
+	return;
+
+    COVERAGE_VERTEX (v, x1, y1, top, bottom, l, r);
+    COVERAGE_VERTEX (v, x2, y1, top, bottom, l, r);
+    COVERAGE_VERTEX (v, x2, y2, top, bottom, l, r);
+    COVERAGE_VERTEX (v, x1, y2, top, bottom, l, r);
+
+    if ((int) x1 < bounds->x1)
+	bounds->x1 = (int) x1;
+    if ((int) y1 < bounds->y1)
+	bounds->y1 = (int) y1;
+    if ((int) x2 > bounds->x2)
+	bounds->x2 = (int) x2;
+    if ((int) y2 > bounds->y2)
+	bounds->y2 = (int) y2;
+
+    *vptr = v;
+}
+
+static glitz_bool_t
+_glitz_coverage_begin (glitz_surface_t *dst)
+{
+    glitz_gl_uint_t fp;
+
+    GLITZ_GL_SURFACE (dst);
+
+    glitz_surface_flush_batch (dst);
+
+    if (!(dst->drawable->backend->feature_mask &
+	  GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK))
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return 0;
+    }
+
+    if (!glitz_surface_push_current (dst, GLITZ_DRAWABLE_CURRENT))
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	glitz_surface_pop_current (dst);
+	return 0;
+    }
+
+    fp = glitz_get_trapezoid_fragment_program (dst);
+    if (!fp)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	glitz_surface_pop_current (dst);
+	return 0;
+    }
+
+    glitz_set_operator (gl, GLITZ_OPERATOR_ADD);
+
+    glitz_state_enable (gl, GLITZ_GL_FRAGMENT_PROGRAM);
+    glitz_state_bind_program (gl, GLITZ_GL_FRAGMENT_PROGRAM, fp);
+
+    return 1;
+}
+
+static void
+_glitz_coverage_draw (glitz_surface_t *dst,
+		      glitz_float_t   *vertices,
+		      int             n_quads,
+		      glitz_box_t     *bounds)
+{
+    glitz_gl_sizei_t stride = COVERAGE_FLOATS_PER_VERTEX *
+	sizeof (glitz_float_t);
+    glitz_box_t	     *clip = dst->clip;
+    int		     n_clip = dst->n_clip;
+    glitz_box_t	     box;
+    int		     i;
+
+    GLITZ_GL_SURFACE (dst);
+
+    if (!n_quads)
+	return;
+
+    gl->vertex_pointer (2, GLITZ_GL_FLOAT, stride, vertices);
+
+    for (i = 0; i < 3; i++)
+    {
+	gl->client_active_texture (GLITZ_GL_TEXTURE0 + i);
+	gl->tex_coord_pointer (4, GLITZ_GL_FLOAT, stride, vertices + i * 4);
+	gl->enable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+    }
+
+    for (; n_clip; clip++, n_clip--)
+    {
+	box.x1 = MAX (clip->x1 + dst->x_clip, bounds->x1);
+	box.y1 = MAX (clip->y1 + dst->y_clip, bounds->y1);
+	box.x2 = MIN (clip->x2 + dst->x_clip, bounds->x2);
+	box.y2 = MIN (clip->y2 + dst->y_clip, bounds->y2);
+
+	box.x1 = MAX (box.x1, dst->box.x1);
+	box.y1 = MAX (box.y1, dst->box.y1);
+	box.x2 = MIN (box.x2, dst->box.x2);
+	box.y2 = MIN (box.y2, dst->box.y2);
+
+	if (box.x1 >= box.x2 || box.y1 >= box.y2)
+	    continue;
+
+	glitz_state_scissor (gl, box.x1 + dst->x,
+			     dst->attached->height - dst->y - box.y2,
+			     box.x2 - box.x1, box.y2 - box.y1);
+
+	gl->draw_arrays (GLITZ_GL_QUADS, 0, n_quads * 4);
+
+	glitz_surface_damage (dst, &box,
+			      GLITZ_DAMAGE_TEXTURE_MASK |
+			      GLITZ_DAMAGE_SOLID_MASK);
+    }
+
+    for (i = 2; i >= 0; i--)
+    {
+	gl->client_active_texture (GLITZ_GL_TEXTURE0 + i);
+	gl->disable_client_state (GLITZ_GL_TEXTURE_COORD_ARRAY);
+    }
+}
+
+static void
+_glitz_coverage_end (glitz_surface_t *dst)
+{
+    GLITZ_GL_SURFACE (dst);
+
+    glitz_state_bind_program (gl, GLITZ_GL_FRAGMENT_PROGRAM, 0);
+    glitz_state_disable (gl, GLITZ_GL_FRAGMENT_PROGRAM);
+
+    glitz_surface_pop_current (dst);
+}
+
+/*
+  CPU scanline rasterization.
+
+  Trapezoid edges are kept in an active edge table sorted by top and
+  scan converted one pixel row at a time with exact area coverage.
+  Each edge adds the signed area of the row to its right into the
+  cells it crosses and the height it covers to a running sum starting
+  in the next cell; left edges add, right edges subtract. The result
+  is written to an A8 buffer covering only the bounds of the
+  trapezoids, uploaded and added to the destination like any other
+  surface.
+*/
+
+/* the raster path is preferred when there are many trapezoids for the
+   area they cover, as the GPU path draws the bounds of every one */
+#define RASTER_MIN_TRAPS     32
+#define RASTER_AREA_PER_TRAP 256
+
+typedef struct _glitz_raster_edge {
+    glitz_float_t top, bottom;
+    glitz_float_t x, dxdy;
+    glitz_float_t sign;
+} glitz_raster_edge_t;
+
+#define RASTER_EDGE_INIT(e, _top, _bottom, p1x, p1y, p2x, p2y, _sign) \
+    (e)->top    = (_top);                                           \
+    (e)->bottom = (_bottom);                                        \
+    (e)->dxdy   = ((p2x) - (p1x)) / ((p2y) - (p1y));                \
+    (e)->x      = (p1x) + ((_top) - (p1y)) * (e)->dxdy;             \
+    (e)->sign   = (_sign)
+
+#define RASTER_EXTENTS(box, e)                                       \
+    if ((e)->top < (box)->y1)                                        \
+	(box)->y1 = (int) floorf ((e)->top);                         \
+    if ((e)->bottom > (box)->y2)                                     \
+	(box)->y2 = (int) ceilf ((e)->bottom);                       \
+    if (MIN ((e)->x, EDGE_BOTTOM_X (e)) < (box)->x1)                 \
+	(box)->x1 = (int) floorf (MIN ((e)->x, EDGE_BOTTOM_X (e)));  \
+    if (MAX ((e)->x, EDGE_BOTTOM_X (e)) > (box)->x2)                 \
+	(box)->x2 = (int) ceilf (MAX ((e)->x, EDGE_BOTTOM_X (e)))
+
+#define EDGE_BOTTOM_X(e) ((e)->x + ((e)->bottom - (e)->top) * (e)->dxdy)
+
+static int
+_glitz_raster_edge_compare (const void *a,
+			    const void *b)
+{
+    const glitz_raster_edge_t *ea = *((glitz_raster_edge_t **) a);
+    const glitz_raster_edge_t *eb = *((glitz_raster_edge_t **) b);
+
+    if (ea->top < eb->top)
+	return -1;
+
+    return (ea->top > eb->top);
+}
+
+/*
+  Adds the coverage of the part of an edge between 'ya' and 'yb' in the
+  current row. 'xa' and 'xb' are relative to the first cell.
+*/
+static void
+_glitz_raster_segment (glitz_float_t *area,
+		       glitz_float_t *cover,
+		       int           width,
+		       glitz_float_t xa,
+		       glitz_float_t xb,
+		       glitz_float_t h,
+		       glitz_float_t sign)
+{
+    glitz_float_t x, next, dh, hi;
+    int           c;
+
+    if (xa > xb)
+    {
+	x = xa;
+	xa = xb;
+	xb = x;
+    }
+
+    if (xa >= (glitz_float_t) width)
+	return;
+
+    if (xa == xb)
+    {
+	if (xa < 0.0f)
+	{
+	    cover[0] += sign * h;
+	}
+	else
+	{
+	    c = (int) xa;
+	    area[c] += sign * h * ((glitz_float_t) (c + 1) - xa);
+	    cover[c + 1] += sign * h;
+	}
+	return;
+    }
+
+    dh = h / (xb - xa);
+
+    /* left of the first cell everything ends up in the running sum */
+    if (xa < 0.0f)
+    {
+	if (xb <= 0.0f)
+	{
+	    cover[0] += sign * h;
+	    return;
+	}
+
+	cover[0] += sign * dh * -xa;
+	xa = 0.0f;
+    }
+
+    /* nothing right of the last cell is visible */
+    if (xb > (glitz_float_t) width)
+	xb = (glitz_float_t) width;
+
+    c = (int) xa;
+    for (x = xa; x < xb; x = next, c++)
+    {
+	next = MIN ((glitz_float_t) (c + 1), xb);
+	hi = sign * dh * (next - x);
+
+	area[c] += hi * ((glitz_float_t) (c + 1) - (x + next) * 0.5f);
+	cover[c + 1] += hi;
+    }
+}
+
+static void
+_glitz_raster_edges (glitz_raster_edge_t **edges,
+		     int                 n_edges,
+		     glitz_box_t         *box,
+		     unsigned char       *data,
+		     int                 stride)
+{
+    glitz_raster_edge_t **active = edges;
+    glitz_raster_edge_t *e;
+    glitz_float_t       *area, *cover;
+    glitz_float_t       y0, y1, ya, yb, run, v;
+    int                 width = box->x2 - box->x1;
+    int                 n_active = 0, i, j, x, y;
+
+    area  = (glitz_float_t *) (data + stride * (box->y2 - box->y1));
+    cover = area + width + 1;
+
+    qsort (edges, n_edges, sizeof (glitz_raster_edge_t *),
+	   _glitz_raster_edge_compare);
+
+    memset (area, 0, (2 * width + 3) * sizeof (glitz_float_t));
+
+    for (y = box->y1; y < box->y2; y++, data += stride)
+    {
+	y0 = (glitz_float_t) y;
+	y1 = y0 + 1.0f;
+
+	/* the active edges are kept at the front of the sorted array */
+	while (n_edges && active[n_active]->top < y1)
+	{
+	    n_active++;
+	    n_edges--;
+	}
+
+	for (i = 0, j = 0; i < n_active; i++)
+	{
+	    e = active[i];
+
+	    ya = MAX (e->top, y0);
+	    yb = MIN (e->bottom, y1);
+	    if (yb > ya)
+		_glitz_raster_segment (area, cover, width,
+				       e->x + (ya - e->top) * e->dxdy -
+				       (glitz_float_t) box->x1,
+				       e->x + (yb - e->top) * e->dxdy -
+				       (glitz_float_t) box->x1,
+				       yb - ya, e->sign);
+
+	    if (e->bottom > y1)
+		active[j++] = e;
+	}
+
+	/* move finished edges out of the active part */
+	if (j < n_active)
+	{
+	    active += n_active - j;
+	    for (i = j - 1; i >= 0; i--)
+		active[i] = active[i - (n_active - j)];
+
+	    n_active = j;
+	}
+
+	for (run = 0.0f, x = 0; x < width; x++)
+	{
+	    run += cover[x];
+	    v = run + area[x];
+
+	    if (v <= 0.0f)
+		data[x] = 0;
+	    else if (v >= 1.0f)
+		data[x] = 0xff;
+	    else
+		data[x] = (unsigned char) (v * 255.0f + 0.5f);
+	}
+
+	memset (area, 0, (2 * width + 3) * sizeof (glitz_float_t));
+    }
+}
+
+static glitz_bool_t
+_glitz_raster_prefer (glitz_surface_t *dst,
+		      int             n_traps,
+		      glitz_box_t     *box)
+{
+    if (!(dst->drawable->backend->feature_mask &
+	  GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK))
+	return 1;
+
+    if (n_traps < RASTER_MIN_TRAPS)
+	return 0;
+
+    return ((box->x2 - box->x1) * (box->y2 - box->y1) <=
+	    n_traps * RASTER_AREA_PER_TRAP);
+}
+
+/*
+  Rasterizes edges into an A8 mask covering 'box' and adds it to 'dst'.
+*/
+static void
+_glitz_raster_draw (glitz_surface_t     *dst,
+		    glitz_raster_edge_t **edges,
+		    int                 n_edges,
+		    glitz_box_t         *box)
+{
+    glitz_pixel_format_t pf;
+    glitz_format_t       *format;
+    glitz_surface_t      *mask;
+    glitz_buffer_t       *buffer;
+    unsigned char        *data;
+    int                  width = box->x2 - box->x1;
+    int                  height = box->y2 - box->y1;
+    int                  stride = (width + 3) & ~3;
+
+    format = glitz_find_standard_format (dst->drawable, GLITZ_STANDARD_A8);
+    if (!format)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NOT_SUPPORTED_MASK);
+	return;
+    }
+
+    /* row accumulation buffers follow the mask data */
+    data = malloc (stride * height +
+		   (2 * width + 3) * sizeof (glitz_float_t));
+    if (!data)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
+
+    _glitz_raster_edges (edges, n_edges, box, data, stride);
+
+    mask = glitz_surface_create (dst->drawable, format, width, height,
+				 0, NULL);
+    if (!mask)
+    {
+	free (data);
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
+
+    buffer = glitz_buffer_create_for_data (data);
+    if (!buffer)
+    {
+	glitz_surface_destroy (mask);
+	free (data);
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
+
+    pf.fourcc           = GLITZ_FOURCC_RGB;
+    pf.masks.bpp        = 8;
+    pf.masks.alpha_mask = 0xff;
+    pf.masks.red_mask   = 0;
+    pf.masks.green_mask = 0;
+    pf.masks.blue_mask  = 0;
+    pf.xoffset          = 0;
+    pf.skip_lines       = 0;
+    pf.bytes_per_line   = stride;
+    pf.scanline_order   = GLITZ_PIXEL_SCANLINE_ORDER_TOP_DOWN;
+
+    glitz_set_pixels (mask, 0, 0, width, height, &pf, buffer);
+
+    glitz_composite (GLITZ_OPERATOR_ADD, mask, NULL, dst,
+		     0, 0, 0, 0, box->x1, box->y1, width, height);
+
+    glitz_buffer_destroy (buffer);
+    glitz_surface_destroy (mask);
+    free (data);
+}
+
+/*
+  Chooses between the GPU and raster paths once the edges of all
+  trapezoids are known. Returns 0 if the caller should use the GPU
+  path.
+*/
+static glitz_bool_t
+_glitz_raster_trapezoids (glitz_surface_t     *dst,
+			  glitz_raster_edge_t *edge,
+			  int                 n_edges,
+			  glitz_box_t         *box)
+{
+    glitz_raster_edge_t **edges;
+    int                 i;
+
+    box->x1 = MAX (box->x1, dst->box.x1);
+    box->y1 = MAX (box->y1, dst->box.y1);
+    box->x2 = MIN (box->x2, dst->box.x2);
+    box->y2 = MIN (box->y2, dst->box.y2);
+
+    if (box->x1 >= box->x2 || box->y1 >= box->y2)
+	return 1;
+
+    if (!_glitz_raster_prefer (dst, n_edges / 2, box))
+	return 0;
+
+    edges = malloc (n_edges * sizeof (glitz_raster_edge_t *));
+    if (!edges)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return 1;
+    }
+
+    for (i = 0; i < n_edges; i++)
+	edges[i] = &edge[i];
+
+    _glitz_raster_draw (dst, edges, n_edges, box);
+
+    free (edges);
+
+    return 1;
+}
+
+#define COVERAGE_BOUNDS_INIT(bounds)      \
+    (bounds).x1 = (bounds).y1 = MAXSHORT; \
+    (bounds).x2 = (bounds).y2 = MINSHORT
+
+void
+glitz_rasterize_trapezoids (glitz_surface_t   *dst,
+			    glitz_trapezoid_t *traps,
+			    int               n_traps)
+{
+    glitz_raster_edge_t *edges, *e;
+    glitz_float_t       *vertices, *v;
+    glitz_box_t         bounds;
+    int                 n;
+
+    if (n_traps < 1)
+	return;
+
+    edges = malloc (2 * n_traps * sizeof (glitz_raster_edge_t));
+    if (!edges)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
+
+    COVERAGE_BOUNDS_INIT (bounds);
+
+    for (e = edges, n = 0; n < n_traps; n++)
+    {
+	if (!TRAPEZOID_VALID (&traps[n]))
+	    continue;
+
+	RASTER_EDGE_INIT (e, FIXED_TO_FLOAT (traps[n].top),
+			  FIXED_TO_FLOAT (traps[n].bottom),
+			  FIXED_TO_FLOAT (traps[n].left.p1.x),
+			  FIXED_TO_FLOAT (traps[n].left.p1.y),
+			  FIXED_TO_FLOAT (traps[n].left.p2.x),
+			  FIXED_TO_FLOAT (traps[n].left.p2.y), 1.0f);
+	RASTER_EXTENTS (&bounds, e);
+	e++;
+
+	RASTER_EDGE_INIT (e, FIXED_TO_FLOAT (traps[n].top),
+			  FIXED_TO_FLOAT (traps[n].bottom),
+			  FIXED_TO_FLOAT (traps[n].right.p1.x),
+			  FIXED_TO_FLOAT (traps[n].right.p1.y),
+			  FIXED_TO_FLOAT (traps[n].right.p2.x),
+			  FIXED_TO_FLOAT (traps[n].right.p2.y), -1.0f);
+	RASTER_EXTENTS (&bounds, e);
+	e++;
+    }
+
+    if (_glitz_raster_trapezoids (dst, edges, e - edges, &bounds))
+    {
+	free (edges);
+	return;
+    }
+
+    free (edges);
+
+    vertices = malloc (MIN (n_traps, COVERAGE_MAX_QUADS) *
+		       COVERAGE_FLOATS_PER_QUAD * sizeof (glitz_float_t));
+    if (!vertices)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
+
+    if (!_glitz_coverage_begin (dst))
+    {
+	free (vertices);
+	return;
+    }
+
+    while (n_traps)
+    {
+	v = vertices;
+	COVERAGE_BOUNDS_INIT (bounds);
+
+	for (n = 0; n_traps && n < COVERAGE_MAX_QUADS; n_traps--, traps++)
+	{
+	    if (!TRAPEZOID_VALID (traps))
+		continue;
+
+	    _glitz_coverage_add_quad (&v, &bounds,
+				      FIXED_TO_FLOAT (traps->top),
+				      FIXED_TO_FLOAT (traps->bottom),
+				      FIXED_TO_FLOAT (traps->left.p1.x),
+				      FIXED_TO_FLOAT (traps->left.p1.y),
+				      FIXED_TO_FLOAT (traps->left.p2.x),
+				      FIXED_TO_FLOAT (traps->left.p2.y),
+				      FIXED_TO_FLOAT (traps->right.p1.x),
+				      FIXED_TO_FLOAT (traps->right.p1.y),
+				      FIXED_TO_FLOAT (traps->right.p2.x),
+				      FIXED_TO_FLOAT (traps->right.p2.y));
+	    n++;
+	}
+
+	_glitz_coverage_draw (dst, vertices,
+			      (v - vertices) / COVERAGE_FLOATS_PER_QUAD,
+			      &bounds);
+    }
+
+    _glitz_coverage_end (dst);
+
+    free (vertices);
+}
+
+void
+glitz_rasterize_traps (glitz_surface_t *dst,
+		       glitz_trap_t    *traps,
+		       int             n_traps)
+{
+    glitz_raster_edge_t *edges, *e;
+    glitz_float_t       *vertices, *v;
+    glitz_float_t       top, bottom;
+    glitz_box_t         bounds;
+    int                 n;
+
+    if (n_traps < 1)
+	return;
+
+    edges = malloc (2 * n_traps * sizeof (glitz_raster_edge_t));
+    if (!edges)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
+
+    COVERAGE_BOUNDS_INIT (bounds);
+
+    for (e = edges, n = 0; n < n_traps; n++)
+    {
+	if (!TRAP_VALID (&traps[n]))
+	    continue;
+
+	top    = FIXED_TO_FLOAT (traps[n].top.y);
+	bottom = FIXED_TO_FLOAT (traps[n].bottom.y);
+
+	RASTER_EDGE_INIT (e, top, bottom,
+			  FIXED_TO_FLOAT (traps[n].top.left), top,
+			  FIXED_TO_FLOAT (traps[n].bottom.left), bottom, 1.0f);
+	RASTER_EXTENTS (&bounds, e);
+	e++;
+
+	RASTER_EDGE_INIT (e, top, bottom,
+			  FIXED_TO_FLOAT (traps[n].top.right), top,
+			  FIXED_TO_FLOAT (traps[n].bottom.right), bottom,
+			  -1.0f);
+	RASTER_EXTENTS (&bounds, e);
+	e++;
+    }
+
+    if (_glitz_raster_trapezoids (dst, edges, e - edges, &bounds))
+    {
+	free (edges);
+	return;
+    }
+
+    free (edges);
+
+    vertices = malloc (MIN (n_traps, COVERAGE_MAX_QUADS) *
+		       COVERAGE_FLOATS_PER_QUAD * sizeof (glitz_float_t));
+    if (!vertices)
+    {
+	glitz_surface_status_add (dst, GLITZ_STATUS_NO_MEMORY_MASK);
+	return;
+    }
+
+    if (!_glitz_coverage_begin (dst))
+    {
+	free (vertices);
+	return;
+    }
+
+    while (n_traps)
+    {
+	v = vertices;
+	COVERAGE_BOUNDS_INIT (bounds);
+
+	for (n = 0; n_traps && n < COVERAGE_MAX_QUADS; n_traps--, traps++)
+	{
+	    if (!TRAP_VALID (traps))
+		continue;
+
+	    top    = FIXED_TO_FLOAT (traps->top.y);
+	    bottom = FIXED_TO_FLOAT (traps->bottom.y);
+
+	    _glitz_coverage_add_quad (&v, &bounds, top, bottom,
+				      FIXED_TO_FLOAT (traps->top.left), top,
+				      FIXED_TO_FLOAT (traps->bottom.left),
+				      bottom,
+				      FIXED_TO_FLOAT (traps->top.right), top,
+				      FIXED_TO_FLOAT (traps->bottom.right),
+				      bottom);
+	    n++;
+	}
+
+	_glitz_coverage_draw (dst, vertices,
+			      (v - vertices) / COVERAGE_FLOATS_PER_QUAD,
+			      &bounds);
+    }
+
+    _glitz_coverage_end (dst);
+
+    free (vertices);
+}
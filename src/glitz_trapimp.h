@@ -220,7 +220,8 @@ TRAPS (void            *ptr,
     glitz_float_t x1, x2, lx, rx;
     glitz_float_t y, y0, y1, y2, y3;
     glitz_float_t y1lx, y2lx, y1rx, y2rx;
-    glitz_float_t area;
+    glitz_float_t area, run_area[PIXEL_RUN];
+    int           i, n;
 
     size -= size % BYTES_PER_QUAD;
 
@@ -383,17 +384,24 @@ TRAPS (void            *ptr,
 	    {
 		if (l < lspan || l >= rspan)
 		{
-		    area = _glitz_pixel_area (l, y0,
-					      top, bottom,
-					      &left, &right);
+		    n = (int) (((l < lspan && lspan < rspan) ? lspan : r) - l);
+		    if (n > PIXEL_RUN)
+			n = PIXEL_RUN;
 
-		    tmpx = l++;
+		    _glitz_pixel_area_run (run_area, n, l, y0, 1.0f, 0.0f,
+					   top, bottom,
+					   &left, &right);
 
-		    ADD_PIXEL (vptr, tptr, offset, size,
-			       tmp0,
-			       tbase, tsize,
-			       tmpx, y0, l, y1,
-			       area);
+		    for (i = 0; i < n; i++)
+		    {
+			tmpx = l++;
+
+			ADD_PIXEL (vptr, tptr, offset, size,
+				   tmp0,
+				   tbase, tsize,
+				   tmpx, y0, l, y1,
+				   run_area[i]);
+		    }
 		}
 		else
 		{
@@ -538,17 +546,24 @@ TRAPS (void            *ptr,
 	    {
 		if (l < lspan || l >= rspan)
 		{
-		    area = _glitz_pixel_area (l, y2,
-					      top, bottom,
-					      &left, &right);
+		    n = (int) (((l < lspan && lspan < rspan) ? lspan : r) - l);
+		    if (n > PIXEL_RUN)
+			n = PIXEL_RUN;
 
-		    tmpx = l++;
+		    _glitz_pixel_area_run (run_area, n, l, y2, 1.0f, 0.0f,
+					   top, bottom,
+					   &left, &right);
 
-		    ADD_PIXEL (vptr, tptr, offset, size,
-			       tmp0,
-			       tbase, tsize,
-			       tmpx, y2, l, y3,
-			       area);
+		    for (i = 0; i < n; i++)
+		    {
+			tmpx = l++;
+
+			ADD_PIXEL (vptr, tptr, offset, size,
+				   tmp0,
+				   tbase, tsize,
+				   tmpx, y2, l, y3,
+				   run_area[i]);
+		    }
 		}
 		else
 		{
@@ -683,16 +698,25 @@ TRAPS (void            *ptr,
 
 		    while (tmpy < y)
 		    {
-			y0 = tmpy++;
-			area = _glitz_pixel_area (tmpx, y0,
-						  y0, y2,
-						  &left, &right);
+			n = (int) (y - tmpy);
+			if (n > PIXEL_RUN)
+			    n = PIXEL_RUN;
 
-			ADD_PIXEL (vptr, tptr, offset, size,
-				   tmp0,
-				   tbase, tsize,
-				   tmpx, y0, lx, tmpy,
-				   area);
+			/* top clamps to zero for every pixel of the column */
+			_glitz_pixel_area_run (run_area, n, tmpx, tmpy,
+					       0.0f, 1.0f, tmpy, y2,
+					       &left, &right);
+
+			for (i = 0; i < n; i++)
+			{
+			    y0 = tmpy++;
+
+			    ADD_PIXEL (vptr, tptr, offset, size,
+				       tmp0,
+				       tbase, tsize,
+				       tmpx, y0, lx, tmpy,
+				       run_area[i]);
+			}
 		    }
 		}
 
@@ -54,6 +54,8 @@ static glitz_extension_map gl_extensions[] = {
     { 0.0, "GL_ARB_multitexture", GLITZ_FEATURE_MULTITEXTURE_MASK },
     { 0.0, "GL_EXT_multi_draw_arrays", GLITZ_FEATURE_MULTI_DRAW_ARRAYS_MASK },
     { 0.0, "GL_ARB_fragment_program", GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK },
+    { 0.0, "GL_ARB_vertex_program", GLITZ_FEATURE_VERTEX_PROGRAM_MASK },
+    { 2.0, "GL_ARB_fragment_shader", GLITZ_FEATURE_FRAGMENT_SHADER_MASK },
     { 0.0, "GL_ARB_vertex_buffer_object",
       GLITZ_FEATURE_VERTEX_BUFFER_OBJECT_MASK },
     { 0.0, "GL_ARB_pixel_buffer_object",
@@ -65,6 +67,10 @@ static glitz_extension_map gl_extensions[] = {
     { 0.0, "GL_APPLE_packed_pixels", GLITZ_FEATURE_PACKED_PIXELS_MASK },
     { 0.0, "GL_EXT_framebuffer_object",
       GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK },
+    { 3.2, "GL_ARB_sync", GLITZ_FEATURE_SYNC_MASK },
+    { 0.0, "GL_NV_fence", GLITZ_FEATURE_FENCE_MASK },
+    { 0.0, "GL_EXT_framebuffer_multisample",
+      GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK },
     { 0.0, NULL, 0 }
 };
 
@@ -204,12 +210,16 @@ _glitz_gl_proc_address_lookup (glitz_backend_t               *backend,
     if (backend->feature_mask & GLITZ_FEATURE_MULTI_DRAW_ARRAYS_MASK) {
 	backend->gl->multi_draw_arrays = (glitz_gl_multi_draw_arrays_t)
 	    get_proc_address ("glMultiDrawArraysEXT", closure);
+	backend->gl->multi_draw_elements = (glitz_gl_multi_draw_elements_t)
+	    get_proc_address ("glMultiDrawElementsEXT", closure);
 
-	if (!backend->gl->multi_draw_arrays)
+	if ((!backend->gl->multi_draw_arrays) ||
+	    (!backend->gl->multi_draw_elements))
 	    backend->feature_mask &= ~GLITZ_FEATURE_MULTI_DRAW_ARRAYS_MASK;
     }
 
-    if (backend->feature_mask & GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK) {
+    if (backend->feature_mask & (GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK |
+				  GLITZ_FEATURE_VERTEX_PROGRAM_MASK)) {
 	backend->gl->gen_programs = (glitz_gl_gen_programs_t)
 	    get_proc_address ("glGenProgramsARB", closure);
 	backend->gl->delete_programs = (glitz_gl_delete_programs_t)
@@ -229,7 +239,83 @@ _glitz_gl_proc_address_lookup (glitz_backend_t               *backend,
 	    (!backend->gl->program_string) ||
 	    (!backend->gl->bind_program) ||
 	    (!backend->gl->program_local_param_4fv))
-	    backend->feature_mask &= ~GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK;
+	    backend->feature_mask &= ~(GLITZ_FEATURE_FRAGMENT_PROGRAM_MASK |
+				       GLITZ_FEATURE_VERTEX_PROGRAM_MASK);
+    }
+
+    if (backend->feature_mask & GLITZ_FEATURE_VERTEX_PROGRAM_MASK) {
+	backend->gl->program_env_param_4fv =
+	    (glitz_gl_program_env_param_4fv_t)
+	    get_proc_address ("glProgramEnvParameter4fvARB", closure);
+	backend->gl->vertex_attrib_pointer =
+	    (glitz_gl_vertex_attrib_pointer_t)
+	    get_proc_address ("glVertexAttribPointerARB", closure);
+	backend->gl->enable_vertex_attrib_array =
+	    (glitz_gl_enable_vertex_attrib_array_t)
+	    get_proc_address ("glEnableVertexAttribArrayARB", closure);
+	backend->gl->disable_vertex_attrib_array =
+	    (glitz_gl_disable_vertex_attrib_array_t)
+	    get_proc_address ("glDisableVertexAttribArrayARB", closure);
+
+	if ((!backend->gl->vertex_attrib_pointer) ||
+	    (!backend->gl->enable_vertex_attrib_array) ||
+	    (!backend->gl->disable_vertex_attrib_array) ||
+	    (!backend->gl->program_env_param_4fv) ||
+	    (!backend->gl->get_program_iv))
+	    backend->feature_mask &= ~GLITZ_FEATURE_VERTEX_PROGRAM_MASK;
+    }
+
+    /* only the OpenGL 2.0 entry points, the ARB_shader_objects ones
+       take handles instead of names */
+    if (backend->feature_mask & GLITZ_FEATURE_FRAGMENT_SHADER_MASK) {
+	if (backend->gl_version >= 2.0f) {
+	    backend->gl->create_shader = (glitz_gl_create_shader_t)
+		get_proc_address ("glCreateShader", closure);
+	    backend->gl->shader_source = (glitz_gl_shader_source_t)
+		get_proc_address ("glShaderSource", closure);
+	    backend->gl->compile_shader = (glitz_gl_compile_shader_t)
+		get_proc_address ("glCompileShader", closure);
+	    backend->gl->get_shader_iv = (glitz_gl_get_shader_iv_t)
+		get_proc_address ("glGetShaderiv", closure);
+	    backend->gl->delete_shader = (glitz_gl_delete_shader_t)
+		get_proc_address ("glDeleteShader", closure);
+	    backend->gl->create_program = (glitz_gl_create_program_t)
+		get_proc_address ("glCreateProgram", closure);
+	    backend->gl->attach_shader = (glitz_gl_attach_shader_t)
+		get_proc_address ("glAttachShader", closure);
+	    backend->gl->link_program = (glitz_gl_link_program_t)
+		get_proc_address ("glLinkProgram", closure);
+	    backend->gl->get_program_object_iv =
+		(glitz_gl_get_program_object_iv_t)
+		get_proc_address ("glGetProgramiv", closure);
+	    backend->gl->use_program = (glitz_gl_use_program_t)
+		get_proc_address ("glUseProgram", closure);
+	    backend->gl->delete_program = (glitz_gl_delete_program_t)
+		get_proc_address ("glDeleteProgram", closure);
+	    backend->gl->get_uniform_location =
+		(glitz_gl_get_uniform_location_t)
+		get_proc_address ("glGetUniformLocation", closure);
+	    backend->gl->uniform_1i = (glitz_gl_uniform_1i_t)
+		get_proc_address ("glUniform1i", closure);
+	    backend->gl->uniform_4fv = (glitz_gl_uniform_4fv_t)
+		get_proc_address ("glUniform4fv", closure);
+	}
+
+	if ((!backend->gl->create_shader) ||
+	    (!backend->gl->shader_source) ||
+	    (!backend->gl->compile_shader) ||
+	    (!backend->gl->get_shader_iv) ||
+	    (!backend->gl->delete_shader) ||
+	    (!backend->gl->create_program) ||
+	    (!backend->gl->attach_shader) ||
+	    (!backend->gl->link_program) ||
+	    (!backend->gl->get_program_object_iv) ||
+	    (!backend->gl->use_program) ||
+	    (!backend->gl->delete_program) ||
+	    (!backend->gl->get_uniform_location) ||
+	    (!backend->gl->uniform_1i) ||
+	    (!backend->gl->uniform_4fv))
+	    backend->feature_mask &= ~GLITZ_FEATURE_FRAGMENT_SHADER_MASK;
     }
 
     if ((backend->feature_mask & GLITZ_FEATURE_VERTEX_BUFFER_OBJECT_MASK) ||
@@ -324,6 +410,57 @@ _glitz_gl_proc_address_lookup (glitz_backend_t               *backend,
 	    (!backend->gl->get_renderbuffer_parameter_iv))
 	    backend->feature_mask &= ~GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK;
     }
+
+    if (!(backend->feature_mask & GLITZ_FEATURE_FRAMEBUFFER_OBJECT_MASK))
+	backend->feature_mask &= ~GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK;
+
+    /* resolving multisampled renderbuffers needs EXT_framebuffer_blit */
+    if (backend->feature_mask & GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK) {
+	backend->gl->renderbuffer_storage_multisample =
+	    (glitz_gl_renderbuffer_storage_multisample_t)
+	    get_proc_address ("glRenderbufferStorageMultisampleEXT", closure);
+	backend->gl->blit_framebuffer = (glitz_gl_blit_framebuffer_t)
+	    get_proc_address ("glBlitFramebufferEXT", closure);
+
+	if ((!backend->gl->renderbuffer_storage_multisample) ||
+	    (!backend->gl->blit_framebuffer))
+	    backend->feature_mask &=
+		~GLITZ_FEATURE_FRAMEBUFFER_MULTISAMPLE_MASK;
+    }
+
+    if (backend->feature_mask & GLITZ_FEATURE_SYNC_MASK) {
+	backend->gl->fence_sync = (glitz_gl_fence_sync_t)
+	    get_proc_address ("glFenceSync", closure);
+	backend->gl->delete_sync = (glitz_gl_delete_sync_t)
+	    get_proc_address ("glDeleteSync", closure);
+	backend->gl->client_wait_sync = (glitz_gl_client_wait_sync_t)
+	    get_proc_address ("glClientWaitSync", closure);
+
+	if ((!backend->gl->fence_sync) ||
+	    (!backend->gl->delete_sync) ||
+	    (!backend->gl->client_wait_sync))
+	    backend->feature_mask &= ~GLITZ_FEATURE_SYNC_MASK;
+    }
+
+    if (backend->feature_mask & GLITZ_FEATURE_FENCE_MASK) {
+	backend->gl->gen_fences = (glitz_gl_gen_fences_t)
+	    get_proc_address ("glGenFencesNV", closure);
+	backend->gl->delete_fences = (glitz_gl_delete_fences_t)
+	    get_proc_address ("glDeleteFencesNV", closure);
+	backend->gl->set_fence = (glitz_gl_set_fence_t)
+	    get_proc_address ("glSetFenceNV", closure);
+	backend->gl->test_fence = (glitz_gl_test_fence_t)
+	    get_proc_address ("glTestFenceNV", closure);
+	backend->gl->finish_fence = (glitz_gl_finish_fence_t)
+	    get_proc_address ("glFinishFenceNV", closure);
+
+	if ((!backend->gl->gen_fences) ||
+	    (!backend->gl->delete_fences) ||
+	    (!backend->gl->set_fence) ||
+	    (!backend->gl->test_fence) ||
+	    (!backend->gl->finish_fence))
+	    backend->feature_mask &= ~GLITZ_FEATURE_FENCE_MASK;
+    }
 }
 
 void
@@ -377,10 +514,10 @@ glitz_set_raster_pos (glitz_gl_proc_address_list_t *gl,
 		      glitz_float_t                y)
 {
     gl->push_attrib (GLITZ_GL_TRANSFORM_BIT | GLITZ_GL_VIEWPORT_BIT);
-    gl->matrix_mode (GLITZ_GL_PROJECTION);
+    glitz_state_matrix_mode (gl, GLITZ_GL_PROJECTION);
     gl->push_matrix ();
     gl->load_identity ();
-    gl->matrix_mode (GLITZ_GL_MODELVIEW);
+    glitz_state_matrix_mode (gl, GLITZ_GL_MODELVIEW);
     gl->push_matrix ();
     gl->load_identity ();
     gl->depth_range (0, 1);
@@ -390,9 +527,9 @@ glitz_set_raster_pos (glitz_gl_proc_address_list_t *gl,
     gl->bitmap (0, 0, 1, 1, x, y, NULL);
 
     gl->pop_matrix ();
-    gl->matrix_mode (GLITZ_GL_PROJECTION);
+    glitz_state_matrix_mode (gl, GLITZ_GL_PROJECTION);
     gl->pop_matrix ();
-    gl->pop_attrib ();
+    glitz_state_pop_attrib (gl);
 }
 
 void
@@ -405,21 +542,43 @@ glitz_clamp_value (glitz_float_t *value,
 	*value = max;
 }
 
+#ifdef USE_SSE2
+glitz_bool_t
+glitz_have_sse2 (void)
+{
+    static int have_sse2 = -1;
+
+    if (have_sse2 < 0)
+    {
+	__builtin_cpu_init ();
+	have_sse2 = __builtin_cpu_supports ("sse2") ? 1 : 0;
+    }
+
+    return have_sse2;
+}
+#endif
+
 void
-glitz_initiate_state (glitz_gl_proc_address_list_t *gl)
+glitz_initiate_state (glitz_gl_proc_address_list_t *gl,
+		      unsigned long                *share_generation)
 {
+    gl->state.share_generation = share_generation;
+    gl->state.generation = *share_generation;
+
+    glitz_state_invalidate (gl);
+
     gl->hint (GLITZ_GL_PERSPECTIVE_CORRECTION_HINT, GLITZ_GL_FASTEST);
-    gl->disable (GLITZ_GL_CULL_FACE);
+    glitz_state_disable (gl, GLITZ_GL_CULL_FACE);
     gl->depth_mask (GLITZ_GL_FALSE);
     gl->polygon_mode (GLITZ_GL_FRONT_AND_BACK, GLITZ_GL_FILL);
-    gl->disable (GLITZ_GL_POLYGON_SMOOTH);
-    gl->disable (GLITZ_GL_LINE_SMOOTH);
-    gl->disable (GLITZ_GL_POINT_SMOOTH);
+    glitz_state_disable (gl, GLITZ_GL_POLYGON_SMOOTH);
+    glitz_state_disable (gl, GLITZ_GL_LINE_SMOOTH);
+    glitz_state_disable (gl, GLITZ_GL_POINT_SMOOTH);
     gl->shade_model (GLITZ_GL_FLAT);
-    gl->color_mask (GLITZ_GL_TRUE, GLITZ_GL_TRUE,
-		    GLITZ_GL_TRUE, GLITZ_GL_TRUE);
-    gl->enable (GLITZ_GL_SCISSOR_TEST);
-    gl->disable (GLITZ_GL_STENCIL_TEST);
+    glitz_state_color_mask (gl, GLITZ_GL_TRUE, GLITZ_GL_TRUE, GLITZ_GL_TRUE,
+			    GLITZ_GL_TRUE);
+    glitz_state_enable (gl, GLITZ_GL_SCISSOR_TEST);
+    glitz_state_disable (gl, GLITZ_GL_STENCIL_TEST);
     gl->enable_client_state (GLITZ_GL_VERTEX_ARRAY);
-    gl->disable (GLITZ_GL_DEPTH_TEST);
+    glitz_state_disable (gl, GLITZ_GL_DEPTH_TEST);
 }
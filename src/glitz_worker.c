@@ -0,0 +1,215 @@
+/*
+ * Copyright © 2026 agent
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of the
+ * copyright holders not be used in advertising or publicity pertaining to
+ * distribution of the software without specific, written prior permission.
+ * The copyright holders make no representations about the suitability of
+ * this software for any purpose. It is provided "as is" without express or
+ * implied warranty.
+ *
+ * THE COPYRIGHT HOLDERS DISCLAIM ALL WARRANTIES WITH REGARD TO THIS
+ * SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF MERCHANTABILITY AND
+ * FITNESS, IN NO EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * SPECIAL, INDIRECT OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES WHATSOEVER
+ * RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF
+ * CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN
+ * CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "../config.h"
+#endif
+
+#include "glitzint.h"
+
+#ifdef GLITZ_THREADS
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+/* Splits row loops into bands that are run by a small pool of worker
+   threads. The calling thread takes bands too and returns once all
+   of them are done. */
+
+#define GLITZ_WORKERS_MAX 16
+
+static unsigned int  _glitz_worker_threads   = 0;
+static unsigned long _glitz_worker_threshold = GLITZ_WORKER_THRESHOLD_DEFAULT;
+
+#ifdef GLITZ_THREADS
+
+typedef struct _glitz_worker_job {
+    glitz_band_function_t func;
+    void                  *closure;
+    int                   height;
+    int                   band_height;
+    int                   n_bands;
+    int                   next_band;
+    int                   pending;
+} glitz_worker_job_t;
+
+static pthread_mutex_t    _glitz_worker_run_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t    _glitz_worker_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t     _glitz_worker_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t     _glitz_worker_done_cond = PTHREAD_COND_INITIALIZER;
+static glitz_worker_job_t _glitz_worker_job;
+static int                _glitz_worker_n_threads = 0;
+
+/* called with _glitz_worker_mutex held, returns with it held */
+static void
+_glitz_worker_do_bands (glitz_worker_job_t *job)
+{
+    int band, y1, y2;
+
+    while (job->next_band < job->n_bands)
+    {
+	band = job->next_band++;
+
+	pthread_mutex_unlock (&_glitz_worker_mutex);
+
+	y1 = band * job->band_height;
+	y2 = y1 + job->band_height;
+	if (y2 > job->height)
+	    y2 = job->height;
+
+	job->func (job->closure, y1, y2);
+
+	pthread_mutex_lock (&_glitz_worker_mutex);
+
+	if (--job->pending == 0)
+	    pthread_cond_signal (&_glitz_worker_done_cond);
+    }
+}
+
+static void *
+_glitz_worker_main (void *data)
+{
+    glitz_worker_job_t *job = &_glitz_worker_job;
+
+    pthread_mutex_lock (&_glitz_worker_mutex);
+
+    for (;;)
+    {
+	while (job->next_band >= job->n_bands)
+	    pthread_cond_wait (&_glitz_worker_cond, &_glitz_worker_mutex);
+
+	_glitz_worker_do_bands (job);
+    }
+
+    return NULL;
+}
+
+static int
+_glitz_worker_default_threads (void)
+{
+    long n = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    n = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+    if (n < 1)
+	n = 1;
+
+    return (n > GLITZ_WORKERS_MAX)? GLITZ_WORKERS_MAX: (int) n;
+}
+
+/* called with _glitz_worker_mutex held */
+static int
+_glitz_worker_start_threads (int n_threads)
+{
+    pthread_attr_t attr;
+    pthread_t      thread;
+
+    pthread_attr_init (&attr);
+    pthread_attr_setdetachstate (&attr, PTHREAD_CREATE_DETACHED);
+
+    /* the calling thread is one of the workers */
+    while (_glitz_worker_n_threads < n_threads - 1)
+    {
+	if (pthread_create (&thread, &attr, _glitz_worker_main, NULL))
+	    break;
+
+	_glitz_worker_n_threads++;
+    }
+
+    pthread_attr_destroy (&attr);
+
+    return _glitz_worker_n_threads + 1;
+}
+
+#endif
+
+void
+glitz_run_bands (glitz_band_function_t func,
+		 void                  *closure,
+		 int                   height,
+		 int                   align,
+		 unsigned long         size)
+{
+
+#ifdef GLITZ_THREADS
+    glitz_worker_job_t *job = &_glitz_worker_job;
+    int                n_threads;
+
+    n_threads = _glitz_worker_threads;
+    if (!n_threads)
+	n_threads = _glitz_worker_default_threads ();
+    else if (n_threads > GLITZ_WORKERS_MAX)
+	n_threads = GLITZ_WORKERS_MAX;
+
+    if (n_threads > 1 && size >= _glitz_worker_threshold &&
+	height >= 2 * align)
+    {
+	pthread_mutex_lock (&_glitz_worker_run_mutex);
+	pthread_mutex_lock (&_glitz_worker_mutex);
+
+	n_threads = _glitz_worker_start_threads (n_threads);
+	if (n_threads > 1)
+	{
+	    job->func        = func;
+	    job->closure     = closure;
+	    job->height      = height;
+	    job->band_height = (height + n_threads - 1) / n_threads;
+	    job->band_height = ((job->band_height + align - 1) / align) *
+		align;
+	    job->n_bands     = (height + job->band_height - 1) /
+		job->band_height;
+	    job->pending     = job->n_bands;
+	    job->next_band   = 0;
+
+	    pthread_cond_broadcast (&_glitz_worker_cond);
+
+	    _glitz_worker_do_bands (job);
+
+	    while (job->pending)
+		pthread_cond_wait (&_glitz_worker_done_cond,
+				   &_glitz_worker_mutex);
+
+	    pthread_mutex_unlock (&_glitz_worker_mutex);
+	    pthread_mutex_unlock (&_glitz_worker_run_mutex);
+
+	    return;
+	}
+
+	pthread_mutex_unlock (&_glitz_worker_mutex);
+	pthread_mutex_unlock (&_glitz_worker_run_mutex);
+    }
+#endif
+
+    func (closure, 0, height);
+}
+
+void
+glitz_pixel_set_threads (unsigned int  n_threads,
+			 unsigned long threshold)
+{
+    _glitz_worker_threads   = n_threads;
+    _glitz_worker_threshold = threshold;
+}
+slim_hidden_def(glitz_pixel_set_threads);
@@ -99,17 +99,57 @@
 #define __attribute__(x)
 #endif
 
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#  define USE_SSE2 1
+#  define SSE2_FUNCTION __attribute__ ((target ("sse2")))
+#endif
+
 typedef enum {
   GLITZ_STATUS_NO_MEMORY_MASK         = (1L << 0),
   GLITZ_STATUS_BAD_COORDINATE_MASK    = (1L << 1),
   GLITZ_STATUS_NOT_SUPPORTED_MASK     = (1L << 2),
-  GLITZ_STATUS_CONTENT_DESTROYED_MASK = (1L << 3)
+  GLITZ_STATUS_CONTENT_DESTROYED_MASK = (1L << 3),
+  GLITZ_STATUS_BAD_ARGUMENT_MASK      = (1L << 4)
 } glitz_status_mask_t;
 
 #include "glitz_gl.h"
 
 #define GLITZ_CONTEXT_STACK_SIZE 16
 
+#define GLITZ_GL_STATE_TEXTURE_UNITS 4
+#define GLITZ_GL_STATE_TEX_ENV       15
+
+typedef struct _glitz_gl_texture_unit_state_t {
+  unsigned long    caps;
+  unsigned long    caps_known;
+  unsigned long    known;
+  glitz_gl_uint_t  binding[2];
+  glitz_gl_float_t env[GLITZ_GL_STATE_TEX_ENV];
+} glitz_gl_texture_unit_state_t;
+
+/* Shadow of the GL state glitz changes most often. A value is only used
+   to skip a call when the matching bit in a known mask is set. Texture
+   and program names are shared by all contexts created from the same
+   root context, share_generation counts deletes in that share group and
+   cached bindings are dropped when it no longer matches generation. */
+typedef struct _glitz_gl_state_t {
+  unsigned long                 caps;
+  unsigned long                 caps_known;
+  unsigned long                 known;
+  glitz_gl_enum_t               blend_func[2];
+  int                           active_texture;
+  glitz_gl_uint_t               program;
+  glitz_gl_int_t                scissor[4];
+  glitz_gl_boolean_t            color_mask[4];
+  glitz_gl_enum_t               matrix_mode;
+  glitz_gl_texture_unit_state_t unit[GLITZ_GL_STATE_TEXTURE_UNITS];
+  unsigned long                 *share_generation;
+  unsigned long                 generation;
+  unsigned long                 issued;
+  unsigned long                 skipped;
+} glitz_gl_state_t;
+
 typedef struct _glitz_gl_proc_address_list_t {
 
   /* core */
@@ -122,6 +162,7 @@ typedef struct _glitz_gl_proc_address_list_t {
   glitz_gl_vertex_pointer_t             vertex_pointer;
   glitz_gl_tex_coord_pointer_t          tex_coord_pointer;
   glitz_gl_draw_arrays_t                draw_arrays;
+  glitz_gl_draw_elements_t              draw_elements;
   glitz_gl_tex_env_f_t                  tex_env_f;
   glitz_gl_tex_env_fv_t                 tex_env_fv;
   glitz_gl_tex_gen_i_t                  tex_gen_i;
@@ -178,12 +219,31 @@ typedef struct _glitz_gl_proc_address_list_t {
   glitz_gl_active_texture_t             active_texture;
   glitz_gl_client_active_texture_t      client_active_texture;
   glitz_gl_multi_draw_arrays_t          multi_draw_arrays;
+  glitz_gl_multi_draw_elements_t        multi_draw_elements;
   glitz_gl_gen_programs_t               gen_programs;
   glitz_gl_delete_programs_t            delete_programs;
   glitz_gl_program_string_t             program_string;
   glitz_gl_bind_program_t               bind_program;
   glitz_gl_program_local_param_4fv_t    program_local_param_4fv;
+  glitz_gl_program_env_param_4fv_t      program_env_param_4fv;
   glitz_gl_get_program_iv_t             get_program_iv;
+  glitz_gl_vertex_attrib_pointer_t      vertex_attrib_pointer;
+  glitz_gl_enable_vertex_attrib_array_t enable_vertex_attrib_array;
+  glitz_gl_disable_vertex_attrib_array_t disable_vertex_attrib_array;
+  glitz_gl_create_shader_t              create_shader;
+  glitz_gl_shader_source_t              shader_source;
+  glitz_gl_compile_shader_t             compile_shader;
+  glitz_gl_get_shader_iv_t              get_shader_iv;
+  glitz_gl_delete_shader_t              delete_shader;
+  glitz_gl_create_program_t             create_program;
+  glitz_gl_attach_shader_t              attach_shader;
+  glitz_gl_link_program_t               link_program;
+  glitz_gl_get_program_object_iv_t      get_program_object_iv;
+  glitz_gl_use_program_t                use_program;
+  glitz_gl_delete_program_t             delete_program;
+  glitz_gl_get_uniform_location_t       get_uniform_location;
+  glitz_gl_uniform_1i_t                 uniform_1i;
+  glitz_gl_uniform_4fv_t                uniform_4fv;
   glitz_gl_gen_buffers_t                gen_buffers;
   glitz_gl_delete_buffers_t             delete_buffers;
   glitz_gl_bind_buffer_t                bind_buffer;
@@ -203,6 +263,20 @@ typedef struct _glitz_gl_proc_address_list_t {
   glitz_gl_bind_renderbuffer_t          bind_renderbuffer;
   glitz_gl_renderbuffer_storage_t       renderbuffer_storage;
   glitz_gl_get_renderbuffer_parameter_iv_t get_renderbuffer_parameter_iv;
+  glitz_gl_renderbuffer_storage_multisample_t
+  renderbuffer_storage_multisample;
+  glitz_gl_blit_framebuffer_t           blit_framebuffer;
+  glitz_gl_fence_sync_t                 fence_sync;
+  glitz_gl_delete_sync_t                delete_sync;
+  glitz_gl_client_wait_sync_t           client_wait_sync;
+  glitz_gl_gen_fences_t                 gen_fences;
+  glitz_gl_delete_fences_t              delete_fences;
+  glitz_gl_set_fence_t                  set_fence;
+  glitz_gl_test_fence_t                 test_fence;
+  glitz_gl_finish_fence_t               finish_fence;
+
+  /* per context state cache, see glitz_state.c */
+  glitz_gl_state_t                      state;
 } glitz_gl_proc_address_list_t;
 
 typedef enum {
@@ -257,6 +331,9 @@ typedef enum {
   GLITZ_FP_RADIAL_GRADIENT_REPEAT,
   GLITZ_FP_RADIAL_GRADIENT_REFLECT,
   GLITZ_FP_COLORSPACE_YV12,
+  GLITZ_FP_COLORSPACE_NV12,
+  GLITZ_FP_COLORSPACE_YUY2,
+  GLITZ_FP_COLORSPACE_UYVY,
   GLITZ_FP_UNSUPPORTED,
   GLITZ_FP_TYPES,
 } glitz_fp_type_t;
@@ -270,8 +347,36 @@ typedef struct _glitz_filter_map_t {
   glitz_program_t fp[GLITZ_TEXTURE_LAST][GLITZ_TEXTURE_LAST][2];
 } glitz_filter_map_t;
 
+/* one vertex program for each texgen mask, with and without
+   per-vertex offsets */
+#define GLITZ_VP_OFFSET_ATTRIB (1 << (2 * GLITZ_GL_STATE_TEXTURE_UNITS))
+#define GLITZ_VP_TYPES         (GLITZ_VP_OFFSET_ATTRIB << 1)
+
+/* vertex program environment: the geometry offset followed by texgen
+   planes and texture matrix rows for each unit */
+#define GLITZ_VP_ENV_OFFSET    0
+#define GLITZ_VP_ENV_UNIT(unit) (1 + (unit) * 6)
+
+/* GLSL fragment shaders, hashed by a bitmask of the features they
+   are built from */
+#define GLITZ_SHADER_HASH_SIZE 64
+
+typedef struct _glitz_shader glitz_shader_t;
+
+struct _glitz_shader {
+  unsigned long   key;
+  glitz_gl_uint_t program;
+  glitz_gl_int_t  local;
+  glitz_gl_int_t  n;
+  glitz_shader_t  *next;
+};
+
 typedef struct _glitz_program_map_t {
   glitz_filter_map_t filters[GLITZ_COMBINE_TYPES][GLITZ_FP_TYPES];
+  glitz_gl_int_t     trapezoid;
+  glitz_gl_int_t     rgb_to_yuv[2];
+  glitz_gl_int_t     vertex[GLITZ_VP_TYPES];
+  glitz_shader_t     *shaders[GLITZ_SHADER_HASH_SIZE];
 } glitz_program_map_t;
 
 typedef enum {
@@ -287,16 +392,23 @@ typedef struct _glitz_region_t {
   int         n_box;
   void        *data;
   int         size;
+  int         area;
+  int         coalesce;
 } glitz_region_t;
 
 #define GLITZ_NULL_BOX ((glitz_box_t *) 0)
 
+/* per box overhead of a damage region in pixels, see glitz_region.c */
+#define GLITZ_REGION_COALESCE_DEFAULT 1024
+
 #define GLITZ_REGION_INIT(region, __box) \
   { \
     if (__box) { \
       (region)->extents = *(__box); \
       (region)->box = &(region)->extents; \
       (region)->n_box = 1; \
+      (region)->area = ((__box)->x2 - (__box)->x1) * \
+	((__box)->y2 - (__box)->y1); \
     } else { \
       (region)->extents.x1 = 0; \
       (region)->extents.y1 = 0; \
@@ -304,6 +416,7 @@ typedef struct _glitz_region_t {
       (region)->extents.y2 = 0; \
       (region)->box = NULL; \
       (region)->n_box = 0; \
+      (region)->area = 0; \
     } \
   }
 
@@ -315,6 +428,7 @@ typedef struct _glitz_region_t {
     (region)->extents.y2 = 0; \
     (region)->box = NULL; \
     (region)->n_box = 0; \
+    (region)->area = 0; \
   }
 
 #define GLITZ_REGION_UNINIT(region) \
@@ -341,10 +455,28 @@ typedef struct _glitz_region_t {
 #define GLITZ_REGION_UNION(region, box) \
   glitz_region_union (region, box)
 
+#define GLITZ_REGION_SET_COALESCE(region, overhead) \
+  ((region)->coalesce = (overhead))
+
 extern glitz_status_t __internal_linkage
 glitz_region_union (glitz_region_t *region,
 		    glitz_box_t    *box);
 
+extern glitz_status_t __internal_linkage
+glitz_region_union_region (glitz_region_t *dst,
+			   glitz_region_t *src1,
+			   glitz_region_t *src2);
+
+extern glitz_status_t __internal_linkage
+glitz_region_intersect (glitz_region_t *dst,
+			glitz_region_t *src1,
+			glitz_region_t *src2);
+
+extern glitz_status_t __internal_linkage
+glitz_region_subtract (glitz_region_t *dst,
+		       glitz_region_t *src1,
+		       glitz_region_t *src2);
+
 typedef enum {
   GLITZ_DRAWABLE_TYPE_WINDOW_MASK  = (1L << 0),
   GLITZ_DRAWABLE_TYPE_PBUFFER_MASK = (1L << 1),
@@ -452,6 +584,32 @@ typedef struct glitz_backend {
   glitz_program_map_t          *program_map;
 } glitz_backend_t;
 
+#define GLITZ_UPLOAD_RING_SLOTS     4
+#define GLITZ_UPLOAD_RING_SLOT_SIZE (256 * 1024)
+
+typedef struct _glitz_upload_slot {
+  glitz_gl_uint_t name;
+  glitz_gl_sync_t sync;
+  glitz_gl_uint_t fence;
+} glitz_upload_slot_t;
+
+typedef struct _glitz_upload_ring {
+  glitz_upload_slot_t slot[GLITZ_UPLOAD_RING_SLOTS];
+  int                 current;
+} glitz_upload_ring_t;
+
+#define GLITZ_POOL_BUDGET_DEFAULT (16 * 1024 * 1024)
+
+typedef struct _glitz_pool_entry glitz_pool_entry_t;
+
+typedef struct _glitz_pool {
+  glitz_pool_entry_t *head, *tail;
+  unsigned long      size;
+  unsigned long      budget;
+  unsigned long      hits;
+  unsigned long      misses;
+} glitz_pool_t;
+
 struct _glitz_drawable {
   glitz_backend_t             *backend;
   int                         ref_count;
@@ -463,6 +621,11 @@ struct _glitz_drawable {
   glitz_bool_t                finished;
   glitz_surface_t             *front;
   glitz_surface_t             *back;
+  glitz_upload_ring_t         upload_ring;
+  glitz_pool_t                pool;
+  unsigned long               read_calls;
+  unsigned long               read_bytes;
+  unsigned int                stencil_clip;
 };
 
 #define GLITZ_GL_DRAWABLE(drawable) \
@@ -471,6 +634,9 @@ struct _glitz_drawable {
 #define DRAWABLE_IS_FBO(drawable) \
   ((drawable)->format->types == GLITZ_DRAWABLE_TYPE_FBO_MASK)
 
+#define DRAWABLE_IS_MULTISAMPLE_FBO(drawable) \
+  (DRAWABLE_IS_FBO (drawable) && (drawable)->format->d.samples > 1)
+
 typedef struct _glitz_vec2_t {
   glitz_float_t v[2];
 } glitz_vec2_t;
@@ -538,6 +704,7 @@ struct _glitz_buffer {
   void             *data;
   int              owns_data;
   int              ref_count;
+  glitz_pixel_alpha_t alpha;
   glitz_surface_t  *front_surface;
   glitz_surface_t  *back_surface;
   glitz_drawable_t *drawable;
@@ -562,6 +729,7 @@ typedef struct _glitz_int_coordinate {
 typedef struct _glitz_vertex_info {
   glitz_gl_enum_t        prim;
   glitz_gl_enum_t        type;
+  glitz_gl_enum_t        index_type;
   glitz_int_coordinate_t src;
   glitz_int_coordinate_t mask;
 } glitz_vertex_info_t;
@@ -582,7 +750,10 @@ typedef struct _glitz_geometry {
   glitz_gl_sizei_t      count;
   glitz_vec2_t          off;
   glitz_multi_array_t   *array;
+  glitz_buffer_t        *indices;
   unsigned long         attributes;
+  int                   tex_gen; /* -1 without vertex program */
+  glitz_vec4_t          vp_off;
   union {
     glitz_vertex_info_t v;
     glitz_bitmap_info_t b;
@@ -664,6 +835,25 @@ typedef enum {
   GLITZ_DAMAGE_SOLID_MASK    = (1 << 2)
 } glitz_surface_damage_mask_t;
 
+typedef struct _glitz_batch_rect {
+  glitz_box_t box;
+  int         x_src, y_src;
+  int         x_mask, y_mask;
+} glitz_batch_rect_t;
+
+typedef struct _glitz_composite_batch {
+  int                level;
+  glitz_operator_t   op;
+  glitz_surface_t    *src;
+  glitz_surface_t    *mask;
+  glitz_box_t        bounds;
+  glitz_batch_rect_t *rects;
+  int                n_rects;
+  int                size;
+  glitz_float_t      *vertices;
+  int                n_vertices;
+} glitz_composite_batch_t;
+
 struct _glitz_surface {
   int                   ref_count;
   glitz_format_t        *format;
@@ -679,6 +869,7 @@ struct _glitz_surface {
   short                 x_clip, y_clip;
   glitz_box_t           *clip;
   int                   n_clip;
+  unsigned int          clip_serial;
   glitz_gl_enum_t       buffer;
   unsigned long         flags;
   glitz_color_t         solid;
@@ -696,6 +887,9 @@ struct _glitz_surface {
   glitz_region_t        drawable_damage;
   unsigned int          flip_count;
   glitz_gl_int_t        fb;
+  glitz_yuv_matrix_t    yuv_matrix;
+  glitz_composite_batch_t *batch;
+  glitz_surface_t       *batch_owner;
 };
 
 #define GLITZ_GL_SURFACE(surface) \
@@ -731,6 +925,7 @@ struct _glitz_composite_op_t {
   glitz_color_t                alpha_mask;
   int                          per_component;
   glitz_gl_uint_t              fp;
+  glitz_shader_t               *shader;
   int                          count;
 };
 
@@ -770,8 +965,81 @@ glitz_clamp_value (glitz_float_t *value,
 		   glitz_float_t min,
 		   glitz_float_t max);
 
+#ifdef USE_SSE2
+extern glitz_bool_t __internal_linkage
+glitz_have_sse2 (void);
+#endif
+
 void
-glitz_initiate_state (glitz_gl_proc_address_list_t *gl);
+glitz_initiate_state (glitz_gl_proc_address_list_t *gl,
+		      unsigned long                *share_generation);
+
+extern void __internal_linkage
+glitz_state_invalidate (glitz_gl_proc_address_list_t *gl);
+
+extern void __internal_linkage
+glitz_state_enable (glitz_gl_proc_address_list_t *gl,
+		    glitz_gl_enum_t              cap);
+
+extern void __internal_linkage
+glitz_state_disable (glitz_gl_proc_address_list_t *gl,
+		     glitz_gl_enum_t              cap);
+
+extern void __internal_linkage
+glitz_state_blend_func (glitz_gl_proc_address_list_t *gl,
+			glitz_gl_enum_t              sfactor,
+			glitz_gl_enum_t              dfactor);
+
+extern void __internal_linkage
+glitz_state_active_texture (glitz_gl_proc_address_list_t *gl,
+			    glitz_gl_enum_t              texture);
+
+extern void __internal_linkage
+glitz_state_bind_texture (glitz_gl_proc_address_list_t *gl,
+			  glitz_gl_enum_t              target,
+			  glitz_gl_uint_t              texture);
+
+extern void __internal_linkage
+glitz_state_delete_textures (glitz_gl_proc_address_list_t *gl,
+			     glitz_gl_sizei_t             n,
+			     const glitz_gl_uint_t        *textures);
+
+extern void __internal_linkage
+glitz_state_tex_env_f (glitz_gl_proc_address_list_t *gl,
+		       glitz_gl_enum_t              target,
+		       glitz_gl_enum_t              pname,
+		       glitz_gl_float_t             param);
+
+extern void __internal_linkage
+glitz_state_bind_program (glitz_gl_proc_address_list_t *gl,
+			  glitz_gl_enum_t              target,
+			  glitz_gl_uint_t              program);
+
+extern void __internal_linkage
+glitz_state_delete_programs (glitz_gl_proc_address_list_t *gl,
+			     glitz_gl_sizei_t             n,
+			     const glitz_gl_uint_t        *programs);
+
+extern void __internal_linkage
+glitz_state_scissor (glitz_gl_proc_address_list_t *gl,
+		     glitz_gl_int_t               x,
+		     glitz_gl_int_t               y,
+		     glitz_gl_sizei_t             width,
+		     glitz_gl_sizei_t             height);
+
+extern void __internal_linkage
+glitz_state_color_mask (glitz_gl_proc_address_list_t *gl,
+			glitz_gl_boolean_t           red,
+			glitz_gl_boolean_t           green,
+			glitz_gl_boolean_t           blue,
+			glitz_gl_boolean_t           alpha);
+
+extern void __internal_linkage
+glitz_state_matrix_mode (glitz_gl_proc_address_list_t *gl,
+			 glitz_gl_enum_t              mode);
+
+extern void __internal_linkage
+glitz_state_pop_attrib (glitz_gl_proc_address_list_t *gl);
 
 void
 glitz_create_surface_formats (glitz_gl_proc_address_list_t *gl,
@@ -854,6 +1122,17 @@ glitz_texture_set_tex_gen (glitz_gl_proc_address_list_t *gl,
 			   unsigned long                flags,
 			   glitz_int_coordinate_t       *coord);
 
+void
+glitz_texture_set_tex_gen_env (glitz_gl_proc_address_list_t *gl,
+			       glitz_texture_t              *texture,
+			       glitz_geometry_t             *geometry,
+			       int                          x_src,
+			       int                          y_src,
+			       unsigned long                flags,
+			       glitz_int_coordinate_t       *coord,
+			       int                          unit,
+			       glitz_float_t                *matrix);
+
 extern void __internal_linkage
 _glitz_surface_sync_texture (glitz_surface_t *surface);
 
@@ -871,6 +1150,9 @@ glitz_surface_push_current (glitz_surface_t    *surface,
 extern void __internal_linkage
 glitz_surface_pop_current (glitz_surface_t *surface);
 
+extern void __internal_linkage
+glitz_surface_flush_batch (glitz_surface_t *surface);
+
 extern void __internal_linkage
 glitz_surface_damage (glitz_surface_t *surface,
 		      glitz_box_t     *box,
@@ -901,6 +1183,17 @@ glitz_get_fragment_program (glitz_composite_op_t *op,
 			    int                  fp_type,
 			    int                  id);
 
+extern glitz_gl_uint_t __internal_linkage
+glitz_get_trapezoid_fragment_program (glitz_surface_t *surface);
+
+extern glitz_gl_uint_t __internal_linkage
+glitz_get_rgb_to_yuv_fragment_program (glitz_surface_t *surface,
+				       glitz_texture_t *texture);
+
+extern glitz_gl_uint_t __internal_linkage
+glitz_get_vertex_program (glitz_surface_t *surface,
+			  int             type);
+
 extern void __internal_linkage
 glitz_composite_op_init (glitz_composite_op_t *op,
 			 glitz_operator_t     render_op,
@@ -921,6 +1214,60 @@ glitz_buffer_bind (glitz_buffer_t  *buffer,
 extern void __internal_linkage
 glitz_buffer_unbind (glitz_buffer_t *buffer);
 
+extern void __internal_linkage *
+glitz_upload_ring_map (glitz_drawable_t *drawable,
+		       int              size);
+
+extern void __internal_linkage
+glitz_upload_ring_unmap (glitz_drawable_t *drawable);
+
+extern void __internal_linkage
+glitz_upload_ring_release (glitz_drawable_t *drawable);
+
+extern void __internal_linkage
+glitz_upload_ring_fini (glitz_drawable_t *drawable);
+
+#define GLITZ_WORKER_THRESHOLD_DEFAULT (256 * 256)
+
+typedef void (*glitz_band_function_t) (void *closure,
+				       int  y1,
+				       int  y2);
+
+extern void __internal_linkage
+glitz_run_bands (glitz_band_function_t func,
+		 void                  *closure,
+		 int                   height,
+		 int                   align,
+		 unsigned long         size);
+
+extern void __internal_linkage
+glitz_pool_init (glitz_pool_t *pool);
+
+extern void __internal_linkage
+glitz_pool_fini (glitz_drawable_t *drawable);
+
+extern void __internal_linkage
+glitz_pool_trim (glitz_drawable_t *drawable);
+
+extern glitz_bool_t __internal_linkage
+glitz_pool_get_texture (glitz_drawable_t *drawable,
+			glitz_texture_t  *texture);
+
+extern glitz_bool_t __internal_linkage
+glitz_pool_put_texture (glitz_drawable_t *drawable,
+			glitz_texture_t  *texture);
+
+extern glitz_drawable_t __internal_linkage *
+glitz_pool_get_drawable (glitz_drawable_t            *drawable,
+			 glitz_int_drawable_format_t *format,
+			 int                         width,
+			 int                         height);
+
+extern glitz_bool_t __internal_linkage
+glitz_pool_put_drawable (glitz_drawable_t *drawable,
+			 glitz_drawable_t *fbo,
+			 unsigned long    size);
+
 extern glitz_status_t __internal_linkage
 glitz_filter_set_params (glitz_surface_t    *surface,
 			 glitz_filter_t     filter,
@@ -984,6 +1331,12 @@ _glitz_fbo_drawable_create (glitz_drawable_t	        *other,
 			    int	                        width,
 			    int	                        height);
 
+extern void __internal_linkage
+_glitz_fbo_drawable_free (glitz_drawable_t *drawable);
+
+extern void __internal_linkage
+_glitz_fbo_resolve (glitz_surface_t *surface);
+
 void
 _glitz_context_init (glitz_context_t  *context,
 		     glitz_drawable_t *drawable);
@@ -1092,10 +1445,18 @@ slim_hidden_proto(glitz_drawable_finish)
 slim_hidden_proto(glitz_drawable_get_features)
 slim_hidden_proto(glitz_drawable_get_format)
 slim_hidden_proto(glitz_drawable_get_gl_string)
+slim_hidden_proto(glitz_drawable_get_state_counters)
+slim_hidden_proto(glitz_drawable_set_pool_budget)
+slim_hidden_proto(glitz_drawable_get_pool_counters)
+slim_hidden_proto(glitz_drawable_get_readback_counters)
+slim_hidden_proto(glitz_pixel_set_threads)
 slim_hidden_proto(glitz_surface_set_transform)
 slim_hidden_proto(glitz_surface_set_fill)
 slim_hidden_proto(glitz_surface_set_component_alpha)
 slim_hidden_proto(glitz_surface_set_dither)
+slim_hidden_proto(glitz_surface_set_yuv_matrix)
+slim_hidden_proto(glitz_surface_begin_batch)
+slim_hidden_proto(glitz_surface_end_batch)
 slim_hidden_proto(glitz_surface_set_filter)
 slim_hidden_proto(glitz_surface_get_width)
 slim_hidden_proto(glitz_surface_get_height)
@@ -277,7 +277,8 @@ glitz_glx_context_get (glitz_glx_screen_info_t *screen_info,
     if (!screen_info->root_context)
 	screen_info->root_context = context->context;
 
-    context->backend.gl = &_glitz_glx_gl_proc_address;
+    context->gl = _glitz_glx_gl_proc_address;
+    context->backend.gl = &context->gl;
 
     context->backend.create_pbuffer = glitz_glx_create_pbuffer;
     context->backend.destroy = glitz_glx_destroy;
@@ -354,7 +355,8 @@ _glitz_glx_context_initialize (glitz_glx_screen_info_t *screen_info,
 			glitz_glx_get_proc_address,
 			(void *) screen_info);
 
-    glitz_initiate_state (&_glitz_glx_gl_proc_address);
+    glitz_initiate_state (context->backend.gl,
+			  &screen_info->state_generation);
 
     version = (const char *)
 	context->backend.gl->get_string (GLITZ_GL_VERSION);
@@ -89,6 +89,7 @@ typedef struct _glitz_glx_context_t {
     glitz_format_id_t id;
     GLXFBConfig       fbconfig;
     glitz_backend_t   backend;
+    glitz_gl_proc_address_list_t gl;
     glitz_bool_t      initialized;
 } glitz_glx_context_t;
 
@@ -103,6 +104,7 @@ struct _glitz_glx_screen_info_t {
     glitz_glx_context_info_t           context_stack[GLITZ_CONTEXT_STACK_SIZE];
     int                                  context_stack_size;
     GLXContext                           root_context;
+    unsigned long                        state_generation;
     glitz_bool_t			 indirect;
     unsigned long                        glx_feature_mask;
     glitz_gl_float_t                     glx_version;
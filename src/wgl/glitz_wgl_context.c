@@ -178,7 +178,8 @@ glitz_wgl_context_get (glitz_wgl_screen_info_t          *screen_info,
 	screen_info->root_context = context->context;
 #endif
 
-    context->backend.gl = &_glitz_wgl_gl_proc_address;
+    context->gl = _glitz_wgl_gl_proc_address;
+    context->backend.gl = &context->gl;
 
     context->backend.create_pbuffer = glitz_wgl_create_pbuffer;
     context->backend.destroy = glitz_wgl_destroy;
@@ -239,7 +240,8 @@ _glitz_wgl_context_initialize (glitz_wgl_screen_info_t *screen_info,
     context->backend.gl->get_integer_v (GLITZ_GL_MAX_VIEWPORT_DIMS,
 					context->max_viewport_dims);
 
-    glitz_initiate_state (&_glitz_wgl_gl_proc_address);
+    glitz_initiate_state (context->backend.gl,
+			  &screen_info->state_generation);
 
     context->initialized = 1;
 }
@@ -91,6 +91,7 @@ typedef struct _glitz_wgl_context_t {
   glitz_format_id_t id;
   int               pixel_format;
   glitz_backend_t   backend;
+  glitz_gl_proc_address_list_t gl;
   glitz_gl_int_t    max_viewport_dims[2];
   glitz_bool_t      initialized;
 } glitz_wgl_context_t;
@@ -111,6 +112,7 @@ struct _glitz_wgl_screen_info_t {
    * around only for proper destruction.
    */
   HGLRC                                root_context;
+  unsigned long                        state_generation;
   HDC                                  root_dc;
   HWND				       root_window;
   unsigned long                        wgl_feature_mask;